@@ -1,7 +1,19 @@
 #include "./app.hpp"
 
 #include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <future>
 #include <iostream>
+#include <limits>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
 
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
@@ -10,6 +22,7 @@
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <easylogging++.h>
 #include <tinyfiledialogs.h>
 
 #include "./motionUtil/bvhExporter.hpp"
@@ -27,6 +40,8 @@ void App::initIkura() {
         ikura::RenderEngineInitConfig::defaultDebugSetting();
     renderConfig.applicationName = "IkulabMotionViewer";
     renderConfig.applicationVersion = VK_MAKE_VERSION(1, 2, 0);
+    renderConfig.pipelineCacheFilePath =
+        getWritableResourceDirectory() / "pipeline_cache.bin";
 
     renderEngine = std::make_shared<ikura::RenderEngine>(renderConfig);
     renderEngine->createInstance();
@@ -112,65 +127,217 @@ void App::initIkura() {
     mainWindow->addVirtualWindow(imGuiVirtualWindow);
 }
 
-void App::setShapes(const char *filePath) {
+void App::initStaticShapes() {
     std::vector<ikura::BasicVertex> vertices;
     std::vector<ikura::BasicIndex> indices;
 
-    if (filePath) {
+    const auto addShape = [&](ikura::shapes::Shape &&shape) {
+        shape.setBaseIndex(vertices.size());
+
+        MeshRange range{};
+        range.firstIndex = indices.size();
+        range.indexCount = shape.getIndices().size();
+
+        vertices.insert(vertices.end(), shape.getVertices().begin(),
+                        shape.getVertices().end());
+        indices.insert(indices.end(), shape.getIndices().begin(),
+                       shape.getIndices().end());
+
+        return range;
+    };
+
+    // Joints ----------
+    // unit length bone, scaled by joint length per instance
+    boneMeshRange = addShape(ikura::shapes::OctahedronBone(1.0, 0));
+    stickBoneMeshRange = addShape(ikura::shapes::StickTetrahedronBone(1.0, 0));
+    lineBoneMeshRange = addShape(ikura::shapes::LineBone(1.0, 0));
+    rootJointMeshRange = addShape(ikura::shapes::SingleColorCube(
+        2.0, 2.0, 2.0, glm::vec3(0.0, 0.0, 0.0), glm::vec3(1.0, 0.0, 0.0), 0));
+
+    // LOD levels ----------
+    // the first index of line bone is its tip, drawn alone as a joint point
+    const MeshRange jointPointMeshRange{lineBoneMeshRange.firstIndex, 1};
+    const auto triangles = ikura::BasicPrimitiveTopology::Triangles;
+    lodMeshes = {
+        LodMeshes{rootJointMeshRange, triangles, boneMeshRange, triangles},
+        LodMeshes{rootJointMeshRange, triangles, stickBoneMeshRange,
+                  triangles},
+        LodMeshes{jointPointMeshRange, ikura::BasicPrimitiveTopology::Points,
+                  lineBoneMeshRange, ikura::BasicPrimitiveTopology::Lines},
+        LodMeshes{jointPointMeshRange, ikura::BasicPrimitiveTopology::Points,
+                  jointPointMeshRange, ikura::BasicPrimitiveTopology::Points}};
+
+    // Other than Joint objects ----------
+    // floor is drawn procedurally, see setShapes()
+    axisObjectMeshRange = addShape(
+        ikura::shapes::DirectionDebugObject(40.0, AXIS_OBJ_GROUP_ID));
+
+    // Shown before loading BVH ----------
+    defaultShapeMeshRange = addShape(ikura::shapes::SeparatedColorCube(
+        100, 100, 100, glm::vec3(0, 0, 0),
+        std::array<glm::vec3, 6>{glm::vec3(0, 0, 1), glm::vec3(0, 1, 0),
+                                 glm::vec3(0, 1, 1), glm::vec3(1, 0, 0),
+                                 glm::vec3(1, 0, 1), glm::vec3(1, 1, 0)},
+        0));
+
+    mainRenderContent->setVertices(vertices);
+    mainRenderContent->setIndices(indices);
+
+    mainRenderContent->uploadVertexBuffer();
+    mainRenderContent->uploadIndexBuffer();
+}
+
+/**
+ * @brief Rebuilds instances and draw commands from characters.
+ * Joint palettes are assigned in order of characters, and meshes of all
+ * characters are drawn by one draw command per mesh.
+ * With LOD, meshes of every LOD level are drawn by their own draw commands
+ * sharing the same instances, and culling groups select one level per
+ * character.
+ */
+void App::setShapes() {
+    // first instance is used for non-instanced meshes
+    std::vector<ikura::BasicInstance> instances = {
+        ikura::BasicInstance::identity()};
+    std::vector<vk::DrawIndexedIndirectCommand> drawCommands;
+    std::vector<ikura::BasicPrimitiveTopology> topologies;
+    cullingGroups.clear();
+
+    // a LOD slot per character
+    isLodApplied =
+        ui->useLod && !characters.empty() &&
+        characters.size() <= static_cast<size_t>(ikura::MAX_NUM_OF_LOD_SLOTS);
+    characterLodLevels.assign(characters.size(), 0);
+    characterBoundingRadii.clear();
+    for (const auto &character : characters) {
+        characterBoundingRadii.push_back(
+            character->getAnimator()->computeBoundingRadius() +
+            ROOT_JOINT_MESH_RADIUS);
+    }
+
+    if (!characters.empty()) {
+        // Joint palettes ----------
+        ikura::GroupID paletteOffset = FIRST_PALETTE_GROUP_ID;
+        for (auto &character : characters) {
+            character->setPaletteOffset(paletteOffset);
+            paletteOffset += character->getPaletteSize();
+        }
+
         // Joints ----------
-        animator->initFromBVH(filePath);
-        std::vector<std::shared_ptr<ikura::shapes::Shape>> shapes;
-        animator->generateBones(shapes);
+        // bounding sphere around root joint, which contains root joint mesh
+        const auto createCullingGroup = [&](size_t characterIndex,
+                                            uint32_t lodLevel,
+                                            uint32_t drawIndex,
+                                            uint32_t firstInstance,
+                                            uint32_t numOfInstances) {
+            const auto &character = characters[characterIndex];
+            ikura::BasicCullingGroup group{};
+            group.boundingSphere = glm::vec4(
+                0.0, 0.0, 0.0, characterBoundingRadii[characterIndex]);
+            group.modelId = character->getPaletteOffset();
+            group.drawIndex = drawIndex;
+            group.firstInstance = firstInstance;
+            group.numOfInstances = numOfInstances;
+            if (isLodApplied) {
+                group.lodSlot = characterIndex;
+                group.lodLevel = lodLevel;
+            }
+            return group;
+        };
 
-        if (shapes.size() + NUM_OF_GROUPS_OTHER_THAN_JOINTS >
-            ikura::NUM_OF_MODEL_MATRIX) {
-            throw std::runtime_error("Too many Joints in loaded model.");
+        // one root joint instance per character, followed by bones of each
+        // character. They are shared by all LOD levels
+        const uint32_t firstRootInstance = instances.size();
+        for (auto &character : characters) {
+            instances.push_back(ikura::BasicInstance(
+                glm::vec3(1.0, 1.0, 1.0), 1.0, character->getPaletteOffset()));
+        }
+        const uint32_t firstBoneInstance = instances.size();
+        // bones of characters[i] are [firstCharacterBones[i] :
+        // firstCharacterBones[i + 1]]
+        std::vector<uint32_t> firstCharacterBones;
+        for (auto &character : characters) {
+            firstCharacterBones.push_back(instances.size());
+            character->getAnimator()->generateBoneInstances(
+                instances, character->getPaletteOffset());
         }
+        firstCharacterBones.push_back(instances.size());
+        const uint32_t numOfBones = instances.size() - firstBoneInstance;
 
-        // Add other than Joint object ----------
-        ikura::BasicIndex baseIndex =
-            shapes.back()->getBaseIndex() + shapes.back()->getVertices().size();
-
-        // DebugObj
-        auto debugObj = std::make_shared<ikura::shapes::DirectionDebugObject>(
-            40.0, AXIS_OBJ_GROUP_ID);
-        debugObj->setBaseIndex(baseIndex);
-        baseIndex += debugObj->getVertices().size();
-        shapes.push_back(debugObj);
-
-        // Floor
-        auto floor = std::make_shared<ikura::shapes::GridFloor>(
-            1000.0, 1000.0, 1, 10, 10, glm::vec3(0.2, 0.9, 0.2),
-            FLOOR_GROUP_ID);
-        floor->setBaseIndex(baseIndex);
-        // baseIndex += floor->getVertices().size();
-        shapes.push_back(floor);
-
-        // Register all Vertices / Indices ----------
-        for (auto &shape : shapes) {
-            vertices.insert(vertices.end(), shape->getVertices().begin(),
-                            shape->getVertices().end());
-            indices.insert(indices.end(), shape->getIndices().begin(),
-                           shape->getIndices().end());
+        const int numOfLodLevels = isLodApplied ? NUM_OF_LOD_LEVELS : 1;
+        for (int level = 0; level < numOfLodLevels; level++) {
+            const auto &meshes = lodMeshes[level];
+            for (size_t i = 0; i < characters.size(); i++) {
+                cullingGroups.push_back(createCullingGroup(
+                    i, level, drawCommands.size(), firstRootInstance + i, 1));
+            }
+            drawCommands.push_back(createDrawCommand(
+                meshes.rootJointMeshRange, characters.size(),
+                firstRootInstance));
+            topologies.push_back(meshes.rootJointTopology);
+
+            if (numOfBones == 0) {
+                continue;
+            }
+            for (size_t i = 0; i < characters.size(); i++) {
+                uint32_t numOfCharacterBones =
+                    firstCharacterBones[i + 1] - firstCharacterBones[i];
+                if (numOfCharacterBones > 0) {
+                    cullingGroups.push_back(createCullingGroup(
+                        i, level, drawCommands.size(), firstCharacterBones[i],
+                        numOfCharacterBones));
+                }
+            }
+            drawCommands.push_back(createDrawCommand(
+                meshes.boneMeshRange, numOfBones, firstBoneInstance));
+            topologies.push_back(meshes.boneTopology);
         }
 
+        // Other than Joint objects ----------
+        drawCommands.push_back(createDrawCommand(axisObjectMeshRange, 1, 0));
+        topologies.push_back(ikura::BasicPrimitiveTopology::Triangles);
+
+        // fade distance follows camera (see updateUniformBuffer())
+        gridFloorParams = ikura::BasicGridFloorParams{};
+        gridFloorParams.color = glm::vec4(0.2, 0.9, 0.2, 1.0);
+        gridFloorParams.cellSize = 100.0;
+        gridFloorParams.lineWidth = 1.0;
+        gridFloorParams.halfExtent = 5000.0;
+        gridFloorParams.fadeDistance = computeFloorFadeDistance();
+        gridFloorParams.modelId = FLOOR_GROUP_ID;
+        mainRenderContent->setGridFloor(gridFloorParams);
+
         modelLoaded = true;
     } else {
-        auto defaultShape = std::make_shared<ikura::shapes::SeparatedColorCube>(
-            100, 100, 100, glm::vec3(0, 0, 0),
-            std::array<glm::vec3, 6>{glm::vec3(0, 0, 1), glm::vec3(0, 1, 0),
-                                     glm::vec3(0, 1, 1), glm::vec3(1, 0, 0),
-                                     glm::vec3(1, 0, 1), glm::vec3(1, 1, 0)},
-            0);
-        vertices = defaultShape->getVertices();
-        indices = defaultShape->getIndices();
+        drawCommands.push_back(createDrawCommand(defaultShapeMeshRange, 1, 0));
+        topologies.push_back(ikura::BasicPrimitiveTopology::Triangles);
+        mainRenderContent->removeGridFloor();
+
+        modelLoaded = false;
     }
 
-    mainRenderContent->setVertices(vertices);
-    mainRenderContent->setIndices(indices);
+    // geometry is not re-uploaded, only instances
+    mainRenderContent->setInstances(instances);
+    numOfInstances = instances.size();
+    mainRenderContent->uploadInstanceBuffer();
+    mainRenderContent->setDrawCommands(drawCommands, topologies);
+    applyCullingGroups();
+    areSkeletonsOutdated = true;
+}
 
-    mainRenderContent->uploadVertexBuffer();
-    mainRenderContent->uploadIndexBuffer();
+/**
+ * @brief Enables culling of characters on GPU by cullingGroups of current
+ * shapes, or disables it, following the debug window.
+ * LOD levels are also selected by culling groups, so they are kept without
+ * frustum culling while LOD is applied.
+ */
+void App::applyCullingGroups() {
+    if (ui->useGpuCulling || isLodApplied) {
+        mainRenderContent->setCullingGroups(cullingGroups);
+    } else {
+        mainRenderContent->setCullingGroups({});
+    }
+    mainRenderContent->setFrustumCullingEnabled(ui->useGpuCulling);
 }
 
 void App::initContexts() {
@@ -180,6 +347,18 @@ void App::initContexts() {
     ui = std::make_shared<UI>();
 
     camera->init();
+
+    // front, side, top
+    const std::array<std::pair<float, float>, 3> fixedRotations = {
+        std::make_pair(0.0f, 0.0f),
+        std::make_pair(glm::radians(90.0f), 0.0f),
+        std::make_pair(0.0f, glm::radians(90.0f) - 0.0001f)};
+    for (int i = 0; i < fixedCameras.size(); i++) {
+        fixedCameras[i] = std::make_shared<Camera>();
+        fixedCameras[i]->init();
+        fixedCameras[i]->hRotation = fixedRotations[i].first;
+        fixedCameras[i]->vRotation = fixedRotations[i].second;
+    }
 }
 
 void App::setGlfwWindowEvents(GLFWwindow *window) {
@@ -191,16 +370,553 @@ void App::setGlfwWindowEvents(GLFWwindow *window) {
     glfwSetKeyCallback(window, keyCallback);
 }
 
+/**
+ * @brief Loads BVH files as characters and sets shapes from them.
+ * Files which fail to load, or whose joints do not fit in model matrices,
+ * are skipped with an error popup.
+ * If replaceExisting is true, loaded characters replace current ones, unless
+ * none of files could be loaded.
+ */
+void App::loadCharacters(const std::vector<std::string> &filePaths,
+                         bool replaceExisting) {
+    // sweep would replace loaded characters with crowd
+    stopCrowdSweep();
+
+    std::vector<std::shared_ptr<Character>> newCharacters;
+    if (!replaceExisting) {
+        newCharacters = characters;
+    }
+    size_t numOfCurrentCharacters = newCharacters.size();
+
+    uint32_t numOfModelMatrices = FIRST_PALETTE_GROUP_ID;
+    for (const auto &character : newCharacters) {
+        numOfModelMatrices += character->getPaletteSize();
+    }
+
+    std::string errorMessage;
+    for (const auto &filePath : filePaths) {
+        auto newAnimator = std::make_shared<Animator>(ui);
+        try {
+            newAnimator->initFromBVH(filePath);
+        } catch (const std::exception &e) {
+            errorMessage += e.what();
+            errorMessage += "\n";
+            continue;
+        }
+
+        if (numOfModelMatrices + newAnimator->getNumOfJoints() >
+            ikura::NUM_OF_MODEL_MATRIX) {
+            errorMessage += "ジョイント数の合計が上限 (";
+            errorMessage += std::to_string(ikura::NUM_OF_MODEL_MATRIX);
+            errorMessage += ") を超えるため読み込めません: ";
+            errorMessage += filePath;
+            errorMessage += "\n";
+            continue;
+        }
+        numOfModelMatrices += newAnimator->getNumOfJoints();
+
+        newAnimator->setLoopEnabled(
+            ui->animationControlWindow.modeIndex ==
+            UI::AnimationControlWindow::MODE_INDEX_EDIT);
+        newCharacters.push_back(std::make_shared<Character>(
+            newAnimator, std::filesystem::path(filePath).stem().string()));
+    }
+
+    if (!errorMessage.empty()) {
+        showErrorPopup(errorMessage);
+    }
+    if (newCharacters.size() == numOfCurrentCharacters) {
+        // nothing has been loaded
+        if (!characters.empty()) {
+            animator->applyRotationOrderToUi();
+        }
+        return;
+    }
+
+    characters = newCharacters;
+    setShapes();
+    if (characters.size() > 1) {
+        arrangeCharacters();
+    }
+    selectCharacter(replaceExisting ? 0 : numOfCurrentCharacters);
+}
+
+void App::removeCharacter(int index) {
+    if (index < 0 || index >= characters.size()) {
+        return;
+    }
+
+    characters.erase(characters.begin() + index);
+    setShapes();
+    selectCharacter(std::min<int>(selectedCharacterIndex,
+                                  static_cast<int>(characters.size()) - 1));
+}
+
+/**
+ * @brief Makes characters[index] controlled by UI.
+ * If there is no character, a placeholder Animator is used.
+ */
+void App::selectCharacter(int index) {
+    if (characters.empty()) {
+        selectedCharacterIndex = 0;
+        selectedJointIndex = -1;
+        animator = std::make_shared<Animator>(ui);
+        return;
+    }
+
+    selectedJointIndex = -1;
+    selectedCharacterIndex =
+        std::clamp(index, 0, static_cast<int>(characters.size()) - 1);
+    animator = characters[selectedCharacterIndex]->getAnimator();
+    animator->applyRotationOrderToUi();
+}
+
+namespace {
+double getElapsedMilliseconds(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(
+               std::chrono::steady_clock::now() - start)
+        .count();
+}
+} // namespace
+
+// Picking ----------
+
+/**
+ * @brief Requests picking at the cursor when the scene is clicked, and selects
+ * what was picked in earlier frames.
+ * Picks are read back from id image of mainRenderTarget after their frames
+ * complete, so selection follows the click by about a frame. The cost does
+ * not depend on the number of characters, since no ray is tested on CPU.
+ */
+void App::updatePicking(bool isUiFocused) {
+    if (mouse->leftClicked && !isUiFocused) {
+        // cursor is in screen coordinates, render images are in pixels
+        int windowWidth, windowHeight;
+        glfwGetWindowSize(mainWindow->getGLFWWindow(), &windowWidth,
+                          &windowHeight);
+        if (windowWidth > 0 && windowHeight > 0) {
+            mainRenderTarget->requestPick(
+                mouse->currentX * mainWindow->getWidth() / windowWidth,
+                mouse->currentY * mainWindow->getHeight() / windowHeight);
+        }
+    }
+
+    auto pickedId = mainRenderTarget->takePickResult();
+    if (pickedId.has_value()) {
+        selectPickedId(pickedId.value());
+    }
+}
+
+/**
+ * @brief Selects character and joint of a value of id image, which is model
+ * matrix id + 1 of the picked mesh. Clicking anything other than characters
+ * clears selected joint.
+ */
+void App::selectPickedId(uint32_t pickedId) {
+    // 0 is cleared value, where nothing is drawn
+    if (pickedId == 0 || pickedId - 1 < FIRST_PALETTE_GROUP_ID) {
+        selectedJointIndex = -1;
+        return;
+    }
+    ikura::GroupID modelId = pickedId - 1;
+
+    // palettes are packed in order of characters
+    auto next = std::upper_bound(
+        characters.begin(), characters.end(), modelId,
+        [](ikura::GroupID id, const std::shared_ptr<Character> &character) {
+            return id < character->getPaletteOffset();
+        });
+    int characterIndex = static_cast<int>(next - characters.begin()) - 1;
+    if (characterIndex < 0) {
+        selectedJointIndex = -1;
+        return;
+    }
+    uint32_t jointIndex =
+        modelId - characters[characterIndex]->getPaletteOffset();
+    if (jointIndex >= characters[characterIndex]->getPaletteSize()) {
+        // characters have changed since the pick was drawn
+        selectedJointIndex = -1;
+        return;
+    }
+
+    selectCharacter(characterIndex);
+    selectedJointIndex = static_cast<int>(jointIndex);
+    LOG(INFO) << "Picked joint '"
+              << animator->getJoints()[jointIndex]->getName()
+              << "' of character " << characterIndex + 1 << ".";
+}
+
+/**
+ * @brief Finds bone under the cursor by ray query on CPU.
+ * Bounding spheres of characters are refitted into characterBvh every frame
+ * instead of rebuilding it, and only characters whose spheres are hit test
+ * capsules of their bones, so thousands of characters are queried on main
+ * thread. Must be called after model and scene matrices of the frame are
+ * generated.
+ */
+void App::updateHover() {
+    auto hoverStart = std::chrono::steady_clock::now();
+    hoveredCharacterIndex = -1;
+    hoveredJointIndex = -1;
+    if (!ui->useHover || !modelLoaded || characters.empty()) {
+        stageTimings.hoverTime = 0.0;
+        return;
+    }
+
+    // Bounding spheres ----------
+    const float globalScale = 0.1f;
+    characterSpheres.resize(characters.size());
+    for (size_t i = 0; i < characters.size(); i++) {
+        const auto &character = characters[i];
+        characterSpheres[i] =
+            character->isVisible()
+                ? glm::vec4(globalScale * character->computeRootPosition(),
+                            globalScale * characterBoundingRadii[i])
+                : glm::vec4(0.0, 0.0, 0.0, -1.0);
+    }
+
+    // topology is rebuilt only if characters are changed or moved far
+    if (characterBvh.getNumOfCharacters() != characters.size() ||
+        characterBvh.refit(characterSpheres)) {
+        characterBvh.build(characterSpheres);
+    }
+
+    // Ray query ----------
+    auto ray = generateCursorRay();
+    if (ray.has_value()) {
+        int jointIndex = -1;
+        glm::vec3 boneStart, boneEnd;
+        auto hit = characterBvh.raycast(
+            ray.value(), [&](uint32_t characterIndex, float closestDistance) {
+                int hitJointIndex;
+                glm::vec3 hitBoneStart, hitBoneEnd;
+                float distance =
+                    raycastBones(ray.value(), characterIndex, hitJointIndex,
+                                 hitBoneStart, hitBoneEnd);
+                if (distance < closestDistance) {
+                    jointIndex = hitJointIndex;
+                    boneStart = hitBoneStart;
+                    boneEnd = hitBoneEnd;
+                }
+                return distance;
+            });
+        if (hit.has_value()) {
+            hoveredCharacterIndex = static_cast<int>(hit.value());
+            hoveredJointIndex = jointIndex;
+            hoveredBoneStart = boneStart;
+            hoveredBoneEnd = boneEnd;
+        }
+    }
+
+    stageTimings.hoverTime = getElapsedMilliseconds(hoverStart);
+}
+
+/**
+ * @brief Generates ray through the cursor from camera of the viewport under
+ * it, in world space of model matrices.
+ */
+std::optional<Ray> App::generateCursorRay() const {
+    int windowWidth, windowHeight;
+    glfwGetWindowSize(mainWindow->getGLFWWindow(), &windowWidth,
+                      &windowHeight);
+    if (windowWidth <= 0 || windowHeight <= 0) {
+        return std::nullopt;
+    }
+    const float x = mouse->currentX / windowWidth;
+    const float y = mouse->currentY / windowHeight;
+
+    const auto &viewportRects = mainWindow->getViewportRects();
+    for (size_t i = 0;
+         i < viewportRects.size() && i < viewportSceneMats.size(); i++) {
+        const auto &rect = viewportRects[i];
+        if (x < rect.x || x >= rect.x + rect.width || y < rect.y ||
+            y >= rect.y + rect.height) {
+            continue;
+        }
+
+        // Y of NDC points down like rows of images, since proj is flipped
+        const glm::vec4 ndc((x - rect.x) / rect.width * 2.0f - 1.0f,
+                            (y - rect.y) / rect.height * 2.0f - 1.0f, 1.0f,
+                            1.0f);
+        const glm::vec4 target = glm::inverse(viewportSceneMats[i].proj) * ndc;
+        const glm::mat4 invView = glm::inverse(viewportSceneMats[i].view);
+
+        Ray ray;
+        ray.origin = glm::vec3(invView[3]);
+        ray.direction = glm::normalize(glm::vec3(
+            invView * glm::vec4(glm::vec3(target) / target.w, 0.0f)));
+        return ray;
+    }
+    return std::nullopt;
+}
+
+/**
+ * @brief Tests capsules of bones of characters[characterIndex], from parent
+ * joint to each joint, and root joint as a sphere.
+ * Returns distance of the closest hit, with its joint and bone segment.
+ * Palettes of modelMats are used if CPU FK wrote them, otherwise only the
+ * tested character is evaluated on CPU.
+ */
+float App::raycastBones(const Ray &ray, uint32_t characterIndex,
+                        int &jointIndex, glm::vec3 &boneStart,
+                        glm::vec3 &boneEnd) {
+    const auto &character = characters[characterIndex];
+    const uint32_t paletteOffset = character->getPaletteOffset();
+    const uint32_t paletteSize = character->getPaletteSize();
+
+    const glm::mat4 *palette;
+    const float globalScale = 0.1f;
+    if (modelMats.size() >= paletteOffset + paletteSize) {
+        palette = &modelMats[paletteOffset];
+    } else {
+        hoverPalette.resize(paletteSize);
+        character->generateModelMatrices(hoverPalette.data());
+        for (auto &m : hoverPalette) {
+            m = glm::scale(glm::mat4(1.0), glm::vec3(globalScale)) * m;
+        }
+        palette = hoverPalette.data();
+    }
+
+    const auto &joints = character->getAnimator()->getJoints();
+    float closestDistance = NO_HIT;
+    for (uint32_t id = 0; id < paletteSize; id++) {
+        const glm::vec3 end(palette[id][3]);
+        const auto &parentIDs = joints[id]->getParentIDs();
+
+        float distance;
+        glm::vec3 start = end;
+        if (parentIDs.empty()) {
+            distance = intersectSphere(ray, end,
+                                       globalScale * ROOT_JOINT_PICK_RADIUS);
+        } else {
+            start = glm::vec3(palette[parentIDs.back()][3]);
+            distance = intersectCapsule(
+                ray, start, end,
+                BONE_CAPSULE_RADIUS_RATIO * glm::distance(start, end));
+        }
+
+        if (distance < closestDistance) {
+            closestDistance = distance;
+            jointIndex = static_cast<int>(id);
+            boneStart = start;
+            boneEnd = end;
+        }
+    }
+    return closestDistance;
+}
+
+/**
+ * @brief Places characters on square grid centered at origin, in order of
+ * characters.
+ */
+void App::arrangeCharacters() {
+    const int numOfColumns = static_cast<int>(
+        std::ceil(std::sqrt(static_cast<float>(characters.size()))));
+    const int numOfRows =
+        (static_cast<int>(characters.size()) + numOfColumns - 1) /
+        numOfColumns;
+
+    for (int i = 0; i < characters.size(); i++) {
+        int column = i % numOfColumns;
+        int row = i / numOfColumns;
+        characters[i]->setPosition(glm::vec3(
+            (column - (numOfColumns - 1) / 2.0f) * CHARACTER_SPACING,
+            (row - (numOfRows - 1) / 2.0f) * CHARACTER_SPACING, 0.0f));
+    }
+}
+
+/**
+ * @brief Returns how many copies of the selected character fit in model
+ * matrices, 0 if nothing is loaded.
+ */
+int App::getMaxCrowdSize() const {
+    if (!modelLoaded || animator->getNumOfJoints() == 0) {
+        return 0;
+    }
+    // also bounded by instances of GPU forward kinematics
+    return std::min<int>((ikura::NUM_OF_MODEL_MATRIX - FIRST_PALETTE_GROUP_ID) /
+                             animator->getNumOfJoints(),
+                         ikura::MAX_NUM_OF_SKELETON_INSTANCES);
+}
+
+/**
+ * @brief Replaces characters with copies of the selected character, arranged
+ * on grid with random time offsets.
+ * Copied Animators share Motion and joints with the source, so copies only
+ * differ in animation time. Bones of all copies are still drawn by one
+ * instanced draw command (see setShapes()).
+ */
+void App::spawnCrowd(int numOfCharacters) {
+    const int maxCrowdSize = getMaxCrowdSize();
+    if (maxCrowdSize == 0) {
+        return;
+    }
+    numOfCharacters = std::clamp(numOfCharacters, 1, maxCrowdSize);
+
+    auto source = characters[selectedCharacterIndex];
+    const auto &sourceAnimator = source->getAnimator();
+    const float motionDuration =
+        sourceAnimator->getNumOfFrames() * sourceAnimator->getFrameRate();
+
+    std::mt19937 randomEngine(CROWD_RANDOM_SEED);
+    std::uniform_real_distribution<float> timeOffsetDistribution(
+        0.0f, motionDuration);
+
+    std::vector<std::shared_ptr<Character>> crowd = {source};
+    for (int i = 1; i < numOfCharacters; i++) {
+        auto character = std::make_shared<Character>(
+            std::make_shared<Animator>(*sourceAnimator),
+            source->getName() + " #" + std::to_string(i + 1));
+        character->setTimeOffset(timeOffsetDistribution(randomEngine));
+        crowd.push_back(character);
+    }
+
+    characters = crowd;
+    setShapes();
+    arrangeCharacters();
+    selectCharacter(0);
+}
+
+/**
+ * @brief Spawns crowds of increasing size from the selected character, and
+ * measures per-stage timings of each size (see updateCrowdSweep()).
+ * FPS limit is removed while sweeping, so that frame time is bounded only by
+ * the slowest stage and present mode.
+ */
+void App::startCrowdSweep() {
+    const int maxCrowdSize = getMaxCrowdSize();
+    if (maxCrowdSize == 0) {
+        return;
+    }
+
+    crowdSweep = CrowdSweep{};
+    for (int crowdSize :
+         {1, 10, 25, 50, 100, 250, 500, 1000, 2500, 5000, 10000}) {
+        if (crowdSize < maxCrowdSize) {
+            crowdSweep.crowdSizes.push_back(crowdSize);
+        }
+    }
+    crowdSweep.crowdSizes.push_back(maxCrowdSize);
+    crowdSweep.isRunning = true;
+    crowdSweepResults.clear();
+
+    appEngine->setFps(0.0f);
+    spawnCrowd(crowdSweep.crowdSizes[0]);
+    crowdSweep.numOfMeasuredFrames = -CROWD_SWEEP_WARM_UP_FRAMES;
+
+    LOG(INFO) << "Crowd sweep started: " << animator->getNumOfJoints()
+              << " joints per character";
+}
+
+/**
+ * @brief Accumulates timings of the previous frame, and moves to the next
+ * crowd size when enough frames are measured.
+ * Called once per frame after AppEngine::vSync(), so that delta time is the
+ * whole previous frame.
+ */
+void App::updateCrowdSweep() {
+    if (!crowdSweep.isRunning) {
+        return;
+    }
+
+    if (crowdSweep.numOfMeasuredFrames >= 0) {
+        auto &sum = crowdSweep.sum;
+        sum.frameTime += appEngine->getDeltaTime() * 1000.0;
+        sum.fkTime += stageTimings.fkTime;
+        sum.uploadTime += stageTimings.uploadTime;
+        sum.drawTime += stageTimings.drawTime;
+        sum.gpuTime += mainRenderTarget->getLastGpuTime();
+    }
+    crowdSweep.numOfMeasuredFrames++;
+    if (crowdSweep.numOfMeasuredFrames < CROWD_SWEEP_MEASURED_FRAMES) {
+        return;
+    }
+
+    // Record result of current size ----------
+    CrowdSweepResult result = crowdSweep.sum;
+    result.numOfCharacters = characters.size();
+    result.numOfInstances = numOfInstances;
+    result.isGpuForwardKinematics = ui->useGpuForwardKinematics;
+    result.isGpuCulling = ui->useGpuCulling;
+    result.isLod = isLodApplied;
+    result.uploadBytes = stageTimings.uploadBytes;
+    result.frameTime /= CROWD_SWEEP_MEASURED_FRAMES;
+    result.fkTime /= CROWD_SWEEP_MEASURED_FRAMES;
+    result.uploadTime /= CROWD_SWEEP_MEASURED_FRAMES;
+    result.drawTime /= CROWD_SWEEP_MEASURED_FRAMES;
+    result.gpuTime /= CROWD_SWEEP_MEASURED_FRAMES;
+    crowdSweepResults.push_back(result);
+
+    LOG(INFO) << "Crowd sweep: characters=" << result.numOfCharacters
+              << " instances=" << result.numOfInstances
+              << " fk_on=" << (result.isGpuForwardKinematics ? "gpu" : "cpu")
+              << " culling=" << (result.isGpuCulling ? "on" : "off")
+              << " lod=" << (result.isLod ? "on" : "off")
+              << " frame=" << result.frameTime << "ms"
+              << " fk=" << result.fkTime << "ms"
+              << " upload=" << result.uploadTime << "ms ("
+              << result.uploadBytes << " bytes)"
+              << " draw=" << result.drawTime << "ms"
+              << " gpu=" << result.gpuTime << "ms";
+
+    // Next size ----------
+    crowdSweep.crowdSizeIndex++;
+    if (crowdSweep.crowdSizeIndex >= crowdSweep.crowdSizes.size()) {
+        stopCrowdSweep();
+        return;
+    }
+    spawnCrowd(crowdSweep.crowdSizes[crowdSweep.crowdSizeIndex]);
+    crowdSweep.numOfMeasuredFrames = -CROWD_SWEEP_WARM_UP_FRAMES;
+    crowdSweep.sum = CrowdSweepResult{};
+}
+
+void App::stopCrowdSweep() {
+    if (!crowdSweep.isRunning) {
+        return;
+    }
+
+    crowdSweep.isRunning = false;
+    appEngine->setFps((float)ui->debugWindow.fpsLimit);
+}
+
+namespace {
+// Splits result of tinyfd_openFileDialog() with multiple selects.
+std::vector<std::string> splitSelectedFilePaths(const char *filePaths) {
+    std::vector<std::string> result;
+    std::stringstream stream(filePaths);
+    std::string filePath;
+    while (std::getline(stream, filePath, '|')) {
+        if (!filePath.empty()) {
+            result.push_back(filePath);
+        }
+    }
+
+    return result;
+}
+} // namespace
+
 void App::selectFileAndInitShapes() {
     const char *filterPattern[1] = {"*.bvh"};
 
-    auto filePath = tinyfd_openFileDialog("Select Motion Data", NULL, 1,
-                                          filterPattern, "BVH file", 0);
-    if (filePath == NULL) {
+    auto filePaths = tinyfd_openFileDialog("Select Motion Data", NULL, 1,
+                                           filterPattern, "BVH file", 1);
+    if (filePaths == NULL) {
         return;
     }
 
-    setShapes(filePath);
+    loadCharacters(splitSelectedFilePaths(filePaths), true);
+}
+
+void App::selectFileAndAddCharacters() {
+    const char *filterPattern[1] = {"*.bvh"};
+
+    auto filePaths = tinyfd_openFileDialog("Select Motion Data", NULL, 1,
+                                           filterPattern, "BVH file", 1);
+    if (filePaths == NULL) {
+        return;
+    }
+
+    loadCharacters(splitSelectedFilePaths(filePaths), false);
 }
 
 void App::selectFileAndExportLoopRange() {
@@ -216,80 +932,455 @@ void App::selectFileAndExportLoopRange() {
                              ui->config.exportAllPositionChannel);
 }
 
+void App::selectFileAndRecordLoopRange() {
+    const char *filterPattern[2] = {"*.y4m", "*.png"};
+
+    auto filePath =
+        tinyfd_saveFileDialog("Select Recording File", NULL, 2, filterPattern,
+                              "Y4M video / PNG sequence");
+    if (filePath == NULL) {
+        return;
+    }
+
+    RecordingRequest request;
+    request.outputPath = filePath;
+    auto extension = request.outputPath.extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   [](unsigned char c) { return std::tolower(c); });
+    if (extension == ".png") {
+        request.format = RecordingFormatEnum::PNG_SEQUENCE;
+    } else {
+        request.format = RecordingFormatEnum::Y4M;
+        if (extension != ".y4m") {
+            request.outputPath += ".y4m";
+        }
+    }
+
+    pendingRecording = request;
+}
+
 void App::updateMatrices() {
-    auto currentFrame = mainWindow->getCurrentFrameIndex();
-    ikura::BasicModelMatUBO modelMat;
-    ikura::BasicSceneMatUBO sceneMat;
+    for (auto &character : characters) {
+        // selected character is held while its seek bar is dragged
+        if (character->getAnimator() == animator &&
+            ui->animationControlWindow.isSeekBarDragging) {
+            continue;
+        }
+        character->getAnimator()->updateAnimator(appEngine->getDeltaTime());
+    }
 
-    if (modelLoaded) {
-        if (!ui->animationControlWindow.isSeekBarDragging) {
-            animator->updateAnimator(appEngine->getDeltaTime());
+    updateUniformBuffer(mainWindow->getCurrentFrameIndex(),
+                        mainWindow->getWidth() /
+                            (float)mainWindow->getHeight());
+}
+
+/**
+ * @brief Generates model matrices of all characters into modelMats.
+ * FK of each character is independent, so characters are split into chunks
+ * processed in parallel.
+ */
+void App::generateModelMatrices() {
+    uint32_t numOfModelMatrices = FIRST_PALETTE_GROUP_ID;
+    for (const auto &character : characters) {
+        numOfModelMatrices += character->getPaletteSize();
+    }
+    modelMats.resize(numOfModelMatrices);
+    if (characters.empty()) {
+        return;
+    }
+
+    const auto generateChunk = [this](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            characters[i]->generateModelMatrices(
+                modelMats.data() + characters[i]->getPaletteOffset());
         }
+    };
+
+    const size_t numOfThreads = std::min<size_t>(
+        characters.size(), std::max(1U, std::thread::hardware_concurrency()));
+    const size_t chunkSize =
+        (characters.size() + numOfThreads - 1) / numOfThreads;
+
+    // the first chunk is processed on this thread
+    std::vector<std::future<void>> jobs;
+    for (size_t begin = chunkSize; begin < characters.size();
+         begin += chunkSize) {
+        jobs.push_back(std::async(
+            std::launch::async, generateChunk, begin,
+            std::min(begin + chunkSize, characters.size())));
+    }
+    generateChunk(0, chunkSize);
+    for (auto &job : jobs) {
+        job.get();
+    }
+}
 
+/**
+ * @brief Uploads one skeleton per Motion of characters for GPU forward
+ * kinematics. Crowd copies share Motion of the source, so its frames are
+ * uploaded only once.
+ */
+void App::uploadSkeletons() {
+    std::vector<ikura::BasicSkeleton> skeletons;
+    std::map<const Motion *, uint32_t> motionSkeletonIndices;
+
+    characterSkeletonIndices.clear();
+    for (const auto &character : characters) {
+        const auto &characterAnimator = character->getAnimator();
+        auto [it, inserted] = motionSkeletonIndices.emplace(
+            characterAnimator->getMotion().get(), skeletons.size());
+        if (inserted) {
+            skeletons.push_back(characterAnimator->generateSkeleton());
+        }
+        characterSkeletonIndices.push_back(it->second);
+    }
+
+    mainRenderContent->setSkeletons(skeletons);
+    areSkeletonsOutdated = false;
+}
+
+/**
+ * @brief Generates time and placement of each character for GPU forward
+ * kinematics. Transform includes global scaling and conversion from
+ * "right-hand Y-up" to "right-hand Z-up", which CPU FK also applies.
+ */
+void App::generateSkeletonInstances() {
+    const glm::mat4 scale = glm::scale(glm::mat4(1.0), glm::vec3(0.1));
+    const glm::mat4 yUpToZUp = glm::rotate(
+        glm::mat4(1.0), glm::radians(90.0f), glm::vec3(1.0, 0.0, 0.0));
+
+    skeletonInstances.resize(characters.size());
+    for (size_t i = 0; i < characters.size(); i++) {
+        const auto &character = characters[i];
+        auto &instance = skeletonInstances[i];
+        // zero transform collapses meshes of hidden character
+        instance.transform =
+            character->isVisible()
+                ? scale * character->generateTransform() * yUpToZUp
+                : glm::mat4(0.0);
+        instance.time = character->getAnimator()->getAnimationTime();
+        instance.skeletonIndex = characterSkeletonIndices[i];
+        instance.paletteOffset = character->getPaletteOffset();
+    }
+}
+
+void App::updateUniformBuffer(int frameIndex, float aspectRatio) {
+    ikura::BasicSceneMatUBO sceneMat;
+
+    auto fkStart = std::chrono::steady_clock::now();
+    if (modelLoaded) {
         // Joints
-        auto modelMat4s = animator->generateModelMatrices();
-        for (int i = 0; i < ikura::NUM_OF_MODEL_MATRIX; i++) {
-            modelMat.model[i] = modelMat4s[i];
+        if (ui->useGpuForwardKinematics) {
+            if (areSkeletonsOutdated) {
+                uploadSkeletons();
+            }
+            // palettes are written by compute shader
+            generateSkeletonInstances();
+            modelMats.resize(FIRST_PALETTE_GROUP_ID);
+        } else {
+            skeletonInstances.clear();
+            generateModelMatrices();
         }
 
         // Other objects
         if (ui->showFloor) {
-            modelMat.model[FLOOR_GROUP_ID] = glm::mat4(1.0);
+            modelMats[FLOOR_GROUP_ID] = glm::mat4(1.0);
+
+            // changed only while zooming, so scene commands are not
+            // re-recorded every frame
+            float fadeDistance = computeFloorFadeDistance();
+            if (fadeDistance != gridFloorParams.fadeDistance) {
+                gridFloorParams.fadeDistance = fadeDistance;
+                mainRenderContent->setGridFloor(gridFloorParams);
+            }
         } else {
-            modelMat.model[FLOOR_GROUP_ID] = glm::mat4(0.0);
+            modelMats[FLOOR_GROUP_ID] = glm::mat4(0.0);
         }
 
         if (ui->showAxisObject) {
-            modelMat.model[AXIS_OBJ_GROUP_ID] = glm::mat4(1.0);
+            modelMats[AXIS_OBJ_GROUP_ID] = glm::mat4(1.0);
         } else {
-            modelMat.model[AXIS_OBJ_GROUP_ID] = glm::mat4(0.0);
+            modelMats[AXIS_OBJ_GROUP_ID] = glm::mat4(0.0);
         }
     } else {
-        modelMat.model[0] = glm::mat4(1.0);
+        skeletonInstances.clear();
+        modelMats.assign(1, glm::mat4(1.0));
     }
 
     // global scaling
-    for (auto &m : modelMat.model) {
+    for (auto &m : modelMats) {
         m = glm::scale(glm::mat4(1.0), glm::vec3(0.1)) * m;
     }
+    stageTimings.fkTime = getElapsedMilliseconds(fkStart);
 
-    sceneMat.view = camera->generateViewMat();
-    sceneMat.proj = glm::perspective(glm::radians(45.0f),
-                                     mainWindow->getWidth() /
-                                         (float)mainWindow->getHeight(),
-                                     0.01f, 1000.0f);
+    // one scene matrix per viewport (see updateViewports())
+    std::vector<std::shared_ptr<Camera>> viewportCameras = {camera};
+    if (ui->viewportLayoutIndex == UI::VIEWPORT_LAYOUT_INDEX_QUAD) {
+        for (auto &fixedCamera : fixedCameras) {
+            fixedCamera->center = camera->center;
+            fixedCamera->distance = camera->distance;
+            viewportCameras.push_back(fixedCamera);
+        }
+    }
+
+    // quad viewports keep aspect ratio of whole image
+    glm::mat4 proj =
+        glm::perspective(glm::radians(45.0f), aspectRatio, 0.01f, 1000.0f);
     // Convert to RightHand Z-up
-    sceneMat.proj[1][1] *= -1;
+    proj[1][1] *= -1;
+
+    viewportSceneMats.clear();
+    for (auto &viewportCamera : viewportCameras) {
+        sceneMat.view = viewportCamera->generateViewMat();
+        sceneMat.proj = proj;
+        viewportSceneMats.push_back(sceneMat);
+    }
+
+    if (modelLoaded && isLodApplied) {
+        float viewportHeight = mainWindow->getHeight();
+        if (ui->viewportLayoutIndex == UI::VIEWPORT_LAYOUT_INDEX_QUAD) {
+            viewportHeight *= 0.5f;
+        }
+        selectLodLevels(viewportSceneMats, viewportHeight);
+    }
+
+    auto uploadStart = std::chrono::steady_clock::now();
+    mainRenderContent->updateUniformBuffer(frameIndex, modelMats,
+                                           viewportSceneMats);
+    mainRenderContent->updateSkeletonInstances(frameIndex, skeletonInstances);
+    if (isLodApplied) {
+        mainRenderContent->updateLodLevels(frameIndex, characterLodLevels);
+    }
+    stageTimings.uploadTime = getElapsedMilliseconds(uploadStart);
+    stageTimings.uploadBytes =
+        modelMats.size() * sizeof(glm::mat4) +
+        viewportSceneMats.size() * sizeof(ikura::BasicSceneMatUBO) +
+        skeletonInstances.size() * sizeof(ikura::BasicSkeletonInstance) +
+        (isLodApplied ? characterLodLevels.size() * sizeof(uint32_t) : 0);
+}
+
+/**
+ * @brief Returns view space distance at which grid floor fades out.
+ * It grows with camera distance, so that the floor around focus point stays
+ * visible at any zoom (fading starts at half of it).
+ */
+float App::computeFloorFadeDistance() const {
+    return std::max(FLOOR_FADE_DISTANCE,
+                    FLOOR_FADE_CAMERA_DISTANCE_RATIO * camera->distance);
+}
+
+/**
+ * @brief Selects LOD level of each character by diameter of its bounding
+ * sphere projected on screen, the largest one of all viewports.
+ * Level i is lowered below lodThresholds[i] pixels, but raised back only above
+ * lodThresholds[i] * (1 + lodHysteresis), so that characters around a
+ * threshold do not switch meshes every frame.
+ */
+void App::selectLodLevels(
+    const std::vector<ikura::BasicSceneMatUBO> &sceneMats,
+    float viewportHeight) {
+    const float globalScale = 0.1f;
+    numOfLodCharacters.fill(0);
+
+    for (size_t i = 0; i < characters.size(); i++) {
+        const auto &character = characters[i];
+        uint32_t &level = characterLodLevels[i];
+        if (!character->isVisible()) {
+            continue;
+        }
+
+        const glm::vec4 center(
+            globalScale * character->computeRootPosition(), 1.0);
+        const float radius = globalScale * characterBoundingRadii[i];
+        float diameter = 0.0f;
+        for (const auto &sceneMat : sceneMats) {
+            float depth = -(sceneMat.view * center).z;
+            if (depth <= radius) {
+                // camera is inside of the sphere
+                diameter = std::numeric_limits<float>::max();
+                break;
+            }
+            diameter = std::max(diameter, radius *
+                                              std::abs(sceneMat.proj[1][1]) *
+                                              viewportHeight / depth);
+        }
+
+        const float hysteresis = 1.0f + ui->lodHysteresis;
+        while (level > 0 &&
+               diameter > ui->lodThresholds[level - 1] * hysteresis) {
+            level--;
+        }
+        while (level < NUM_OF_LOD_LEVELS - 1 &&
+               diameter < ui->lodThresholds[level]) {
+            level++;
+        }
+        numOfLodCharacters[level]++;
+    }
+}
 
-    mainRenderContent->updateUniformBuffer(currentFrame, modelMat, sceneMat);
+/**
+ * @brief Sets viewports of mainWindow by current layout.
+ * Order of viewports must match scene matrices of updateUniformBuffer().
+ */
+void App::updateViewports() {
+    if (ui->viewportLayoutIndex == UI::VIEWPORT_LAYOUT_INDEX_QUAD) {
+        mainWindow->setViewportRects({{0.0f, 0.0f, 0.5f, 0.5f},
+                                      {0.5f, 0.0f, 0.5f, 0.5f},
+                                      {0.0f, 0.5f, 0.5f, 0.5f},
+                                      {0.5f, 0.5f, 0.5f, 0.5f}});
+    } else {
+        mainWindow->setViewportRects({{0.0f, 0.0f, 1.0f, 1.0f}});
+    }
+}
+
+/**
+ * @brief Renders every frame of loop range offscreen, one BVH frame per output
+ * frame, and encodes them on worker threads.
+ * Frames are not paced by AppEngine::vSync(), so recording runs as fast as
+ * rendering and encoding allow, without dropping frames.
+ */
+void App::recordLoopRange(const RecordingRequest &request) {
+    const int width = mainWindow->getWidth();
+    const int height = mainWindow->getHeight();
+    if (!modelLoaded || width == 0 || height == 0) {
+        return;
+    }
+
+    // main window is not drawn while recording
+    renderEngine->waitForDeviceIdle();
+
+    auto recordingWindow = std::make_shared<ikura::OffscreenWindow>(
+        renderEngine, width, height, "recording");
+    auto recordingRenderTarget =
+        basicRenderComponentProvider->createOffscreenRenderTarget(
+            recordingWindow);
+    recordingRenderTarget->setMsaaSamples(mainRenderTarget->getMsaaSamples());
+    recordingWindow->setRenderTarget(recordingRenderTarget);
+    recordingWindow->setRenderContent(mainRenderContent);
+    recordingWindow->setViewportRects(mainWindow->getViewportRects());
+
+    const uint32_t resumeFrameIndex = animator->getCurrentFrameIndex();
+    const uint32_t loopStart = animator->getLoopStartFrameIndex();
+    const uint32_t loopEnd = animator->getLoopEndFrameIndex();
+    std::string errorMessage;
+
+    try {
+        FrameEncoder encoder(request.format, request.outputPath, width, height,
+                             1.0f / animator->getFrameRate(), false);
+        recordingWindow->enableReadback(
+            [&encoder](uint64_t frameNumber, const uint8_t *pixels,
+                       vk::DeviceSize size) {
+                encoder.submitFrame(frameNumber, pixels, size);
+            });
+
+        for (uint32_t frameIndex = loopStart; frameIndex <= loopEnd;
+             frameIndex++) {
+            animator->setCurrentFrameIndex(frameIndex);
+            // other characters play along at frame rate of selected one
+            if (frameIndex != loopStart) {
+                for (auto &character : characters) {
+                    if (character->getAnimator() != animator) {
+                        character->getAnimator()->advanceAnimationTime(
+                            animator->getFrameRate());
+                    }
+                }
+            }
+
+            // uniform region of the frame may still be read by GPU
+            recordingWindow->waitForCurrentFrame();
+            updateUniformBuffer(recordingWindow->getCurrentFrameIndex(),
+                                width / (float)height);
+            recordingWindow->draw();
+
+            // keep main window responding to OS
+            glfwPollEvents();
+        }
+
+        recordingWindow->disableReadback();
+        encoder.finish();
+        errorMessage = encoder.getErrorMessage();
+    } catch (std::exception &e) {
+        errorMessage = e.what();
+    }
+
+    recordingWindow->destroyResources();
+    animator->seekAnimation(resumeFrameIndex);
+
+    if (errorMessage.empty()) {
+        std::string msg;
+        msg += "ループ範囲を録画しました (";
+        msg += std::to_string(loopEnd - loopStart + 1);
+        msg += " フレーム)。\n";
+        msg += "Path: ";
+        msg += request.outputPath.string();
+        showInfoPopup(msg);
+    } else {
+        std::string msg;
+        msg += "録画に失敗しました。\n";
+        msg += errorMessage;
+        showErrorPopup(msg);
+    }
+}
+
+vk::DrawIndexedIndirectCommand
+App::createDrawCommand(const MeshRange &meshRange, uint32_t instanceCount,
+                       uint32_t firstInstance) {
+    vk::DrawIndexedIndirectCommand command{};
+    command.indexCount = meshRange.indexCount;
+    command.instanceCount = instanceCount;
+    command.firstIndex = meshRange.firstIndex;
+    command.vertexOffset = 0;
+    command.firstInstance = firstInstance;
+
+    return command;
 }
 
 App::App() {
     initIkura();
-    setShapes(nullptr);
+    initStaticShapes();
     initContexts();
-    animator = std::make_shared<Animator>(ui);
+    selectCharacter(0);
+    setShapes();
 }
 
 void App::run() {
     appEngine->setStartTime();
 
     while (!appEngine->shouldTerminated()) {
+        if (pendingRecording.has_value()) {
+            recordLoopRange(pendingRecording.value());
+            pendingRecording.reset();
+        }
+        if (pendingFrameSettings.has_value()) {
+            mainWindow->setFrameSettings(
+                pendingFrameSettings->numOfFrames,
+                pendingFrameSettings->numOfSwapChainImages);
+            pendingFrameSettings.reset();
+        }
+
         appEngine->vSync();
+        updateCrowdSweep();
 
-        camera->updateCamera(
-            mouse, keyboard,
+        bool isUiFocused =
             std::any_of(mainWindow->getVirtualWindows().begin(),
                         mainWindow->getVirtualWindows().end(),
                         [](const std::shared_ptr<ikura::VirtualWindow> window) {
                             return window->isFocused();
-                        }));
+                        });
+        camera->updateCamera(mouse, keyboard, isUiFocused);
+        // uniform region of the frame may still be read by GPU, and picks
+        // of completed frames are fetched here
+        mainWindow->waitForCurrentFrame();
+        updatePicking(isUiFocused);
         mouse->reset();
 
         updateMatrices();
+        updateHover();
         updateUI();
 
+        auto drawStart = std::chrono::steady_clock::now();
         appEngine->drawAllWindows();
+        stageTimings.drawTime = getElapsedMilliseconds(drawStart);
         appEngine->destroyClosedWindow();
     }
 
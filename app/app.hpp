@@ -1,6 +1,11 @@
 #pragma once
 
+#include <array>
+#include <filesystem>
 #include <memory>
+#include <optional>
+#include <string>
+#include <vector>
 
 #include <ikura/ikura.hpp>
 
@@ -9,13 +14,35 @@
 #include "./context/mouse.hpp"
 #include "./context/ui.hpp"
 #include "./motionUtil/animator.hpp"
+#include "./motionUtil/character.hpp"
+#include "./picking/characterBvh.hpp"
+#include "./recording/frameEncoder.hpp"
 
 class App {
     // Variables ==========
     // Constants ----------
-    const int NUM_OF_GROUPS_OTHER_THAN_JOINTS = 2;
-    const ikura::GroupID AXIS_OBJ_GROUP_ID = ikura::NUM_OF_MODEL_MATRIX - 3;
-    const ikura::GroupID FLOOR_GROUP_ID = ikura::NUM_OF_MODEL_MATRIX - 2;
+    // model matrices: [axis object, floor, joint palettes of characters...]
+    const ikura::GroupID AXIS_OBJ_GROUP_ID = 0;
+    const ikura::GroupID FLOOR_GROUP_ID = 1;
+    const ikura::GroupID FIRST_PALETTE_GROUP_ID = 2;
+    // margin of bounding sphere of a character for culling, which covers
+    // root joint cube (2 x 2 x 2) in BVH units
+    const float ROOT_JOINT_MESH_RADIUS = 2.0f;
+    // distance between characters arranged by arrangeCharacters()
+    const float CHARACTER_SPACING = 150.0f;
+    // seed of time offsets of crowd, fixed to make sweeps repeatable
+    const uint32_t CROWD_RANDOM_SEED = 12345;
+    // frames skipped after spawning crowd, and frames averaged per size
+    const int CROWD_SWEEP_WARM_UP_FRAMES = 30;
+    const int CROWD_SWEEP_MEASURED_FRAMES = 120;
+    // grid floor fades out at max(FLOOR_FADE_DISTANCE, ratio * camera
+    // distance) in view space
+    const float FLOOR_FADE_DISTANCE = 400.0f;
+    const float FLOOR_FADE_CAMERA_DISTANCE_RATIO = 4.0f;
+    // hover test shapes: capsule radius relative to bone length (like half
+    // width of octahedron bone), and sphere of root joint cube in BVH units
+    const float BONE_CAPSULE_RADIUS_RATIO = 0.1f;
+    const float ROOT_JOINT_PICK_RADIUS = 1.0f;
 
     // ikura objects ----------
     std::unique_ptr<ikura::AppEngine> appEngine;
@@ -32,35 +59,218 @@ class App {
 
     // Contexts ----------
     std::shared_ptr<Camera> camera;
+    // front / side / top cameras of quad layout, following center and
+    // distance of camera
+    std::array<std::shared_ptr<Camera>, 3> fixedCameras;
     std::shared_ptr<Keyboard> keyboard;
     std::shared_ptr<Mouse> mouse;
     std::shared_ptr<UI> ui;
 
+    // Static geometry ----------
+    // uploaded once, loading BVH only updates instances and draw commands
+    struct MeshRange {
+        uint32_t firstIndex;
+        uint32_t indexCount;
+    };
+    MeshRange boneMeshRange;
+    MeshRange stickBoneMeshRange;
+    MeshRange lineBoneMeshRange;
+    MeshRange rootJointMeshRange;
+    MeshRange axisObjectMeshRange;
+    MeshRange defaultShapeMeshRange;
+    // fadeDistance is updated every frame from camera distance
+    ikura::BasicGridFloorParams gridFloorParams{};
+
     // Flags ----------
     bool modelLoaded = false;
 
-    // Others ----------
+    // Recording ----------
+    struct RecordingRequest {
+        std::filesystem::path outputPath;
+        RecordingFormatEnum format;
+    };
+    // executed at the beginning of next frame, not in the middle of UI update
+    std::optional<RecordingRequest> pendingRecording;
+
+    // Frame settings ----------
+    struct FrameSettingsRequest {
+        int numOfFrames;
+        uint32_t numOfSwapChainImages;
+    };
+    // applied at the beginning of next frame, since ImGui is reinitialized
+    std::optional<FrameSettingsRequest> pendingFrameSettings;
+
+    // Characters ----------
+    std::vector<std::shared_ptr<Character>> characters;
+    // characters[selectedCharacterIndex] is controlled by animation control
+    // window, and used by export and recording
+    int selectedCharacterIndex = 0;
+    // joint of selected character picked by mouse click, -1 if none
+    int selectedJointIndex = -1;
+    // Animator of selected character, placeholder if nothing is loaded
     std::shared_ptr<Animator> animator;
+    // reused every frame to avoid reallocation
+    std::vector<glm::mat4> modelMats;
+    // one per viewport, kept for ray queries of the frame
+    std::vector<ikura::BasicSceneMatUBO> viewportSceneMats;
+    // number of instances set by setShapes()
+    uint32_t numOfInstances = 0;
+
+    // GPU forward kinematics ----------
+    // one skeleton per Motion shared by characters, uploaded only when GPU
+    // FK is used
+    bool areSkeletonsOutdated = true;
+    // skeleton index of each character
+    std::vector<uint32_t> characterSkeletonIndices;
+    // reused every frame to avoid reallocation
+    std::vector<ikura::BasicSkeletonInstance> skeletonInstances;
+
+    // GPU frustum culling ----------
+    // root joint and bones of each character, built by setShapes()
+    std::vector<ikura::BasicCullingGroup> cullingGroups;
+
+    // LOD ----------
+    // meshes of each LOD level, from the most detailed one. Each level is
+    // drawn by its own draw commands, selected per character on GPU
+    struct LodMeshes {
+        MeshRange rootJointMeshRange;
+        ikura::BasicPrimitiveTopology rootJointTopology;
+        MeshRange boneMeshRange;
+        ikura::BasicPrimitiveTopology boneTopology;
+    };
+    static const int NUM_OF_LOD_LEVELS = 4;
+    std::array<LodMeshes, NUM_OF_LOD_LEVELS> lodMeshes;
+    // whether shapes are built with all LOD levels, see setShapes()
+    bool isLodApplied = false;
+    // LOD level of each character, kept between frames for hysteresis
+    std::vector<uint32_t> characterLodLevels;
+    // bounding radius of each character in BVH units, built by setShapes()
+    std::vector<float> characterBoundingRadii;
+    // number of characters at each LOD level in the last frame
+    std::array<int, NUM_OF_LOD_LEVELS> numOfLodCharacters = {};
+
+    // Hover ----------
+    // bone under the cursor is found by ray query on CPU every frame, since
+    // hover must follow the cursor without readback latency of picking
+    CharacterBvh characterBvh;
+    // bounding spheres of characters in the current frame (negative radius
+    // if hidden), reused every frame
+    std::vector<glm::vec4> characterSpheres;
+    // palette of a tested character if modelMats has no palettes (GPU FK)
+    std::vector<glm::mat4> hoverPalette;
+    int hoveredCharacterIndex = -1;
+    int hoveredJointIndex = -1;
+    // world space segment of hovered bone, both ends are the same for root
+    glm::vec3 hoveredBoneStart;
+    glm::vec3 hoveredBoneEnd;
+
+    // Stage timings ----------
+    // CPU time of each stage of the last frame, in milliseconds
+    struct StageTimings {
+        // FK of all characters
+        double fkTime = 0.0;
+        // writing model and scene matrices to the uniform buffer ring
+        double uploadTime = 0.0;
+        size_t uploadBytes = 0;
+        // recording and submitting command buffers of all windows
+        double drawTime = 0.0;
+        // refitting characterBvh and ray query under the cursor
+        double hoverTime = 0.0;
+    };
+    StageTimings stageTimings;
+
+    // Crowd ----------
+    // per-stage timings averaged over measured frames of one crowd size
+    struct CrowdSweepResult {
+        int numOfCharacters = 0;
+        uint32_t numOfInstances = 0;
+        bool isGpuForwardKinematics = false;
+        bool isGpuCulling = false;
+        bool isLod = false;
+        double frameTime = 0.0;
+        double fkTime = 0.0;
+        double uploadTime = 0.0;
+        double drawTime = 0.0;
+        double gpuTime = 0.0;
+        size_t uploadBytes = 0;
+    };
+    struct CrowdSweep {
+        bool isRunning = false;
+        std::vector<int> crowdSizes;
+        size_t crowdSizeIndex = 0;
+        // negative while warming up
+        int numOfMeasuredFrames = 0;
+        CrowdSweepResult sum;
+    };
+    CrowdSweep crowdSweep;
+    std::vector<CrowdSweepResult> crowdSweepResults;
 
     // Functions ==========
     // Init ----------
     void initIkura();
-    void setShapes(const char *filePath);
+    void initStaticShapes();
+    void setShapes();
+    void applyCullingGroups();
     void initContexts();
     void setGlfwWindowEvents(GLFWwindow *window);
 
+    // Characters ----------
+    void loadCharacters(const std::vector<std::string> &filePaths,
+                        bool replaceExisting);
+    void removeCharacter(int index);
+    void selectCharacter(int index);
+    void arrangeCharacters();
+
+    // Picking ----------
+    void updatePicking(bool isUiFocused);
+    void selectPickedId(uint32_t pickedId);
+    void updateHover();
+    std::optional<Ray> generateCursorRay() const;
+    float raycastBones(const Ray &ray, uint32_t characterIndex,
+                       int &jointIndex, glm::vec3 &boneStart,
+                       glm::vec3 &boneEnd);
+
+    // Crowd ----------
+    int getMaxCrowdSize() const;
+    void spawnCrowd(int numOfCharacters);
+    void startCrowdSweep();
+    void updateCrowdSweep();
+    void stopCrowdSweep();
+
 	// select file ----------
     void selectFileAndInitShapes();
+    void selectFileAndAddCharacters();
     void selectFileAndExportLoopRange();
+    void selectFileAndRecordLoopRange();
+
+    // Recording ----------
+    void recordLoopRange(const RecordingRequest &request);
 
     // Update ----------
     void updateMatrices();
+    void generateModelMatrices();
+    void uploadSkeletons();
+    void generateSkeletonInstances();
+    void updateUniformBuffer(int frameIndex, float aspectRatio);
+    void selectLodLevels(const std::vector<ikura::BasicSceneMatUBO> &sceneMats,
+                         float viewportHeight);
+    void updateViewports();
+    float computeFloorFadeDistance() const;
+
+    // Misc ----------
+    static vk::DrawIndexedIndirectCommand
+    createDrawCommand(const MeshRange &meshRange, uint32_t instanceCount,
+                      uint32_t firstInstance);
 
     // UI ----------
     void updateUI();
     void updateMainMenu();
     void updateAnimationControlWindow();
+    void updateCharacterWindow();
+    void updateCrowdControls();
     void updateDebugWindow();
+    void updatePerformanceHud();
+    void drawHoverHighlight();
 
     // Glfw Callbacks ----------
     static void cursorPositionCallback(GLFWwindow *window, double xPos,
@@ -22,6 +22,14 @@ void App::mouseButtonCallback(GLFWwindow *window, int button, int action,
     switch (button) {
     case GLFW_MOUSE_BUTTON_LEFT:
         app->mouse->leftButton = (action == GLFW_PRESS);
+        // short drag rotates camera slightly, but is still a click
+        if (action == GLFW_RELEASE) {
+            double dragX = app->mouse->dragEndX - app->mouse->dragStartX;
+            double dragY = app->mouse->dragEndY - app->mouse->dragStartY;
+            app->mouse->leftClicked =
+                dragX * dragX + dragY * dragY <=
+                Mouse::CLICK_DRAG_TOLERANCE * Mouse::CLICK_DRAG_TOLERANCE;
+        }
         break;
     case GLFW_MOUSE_BUTTON_RIGHT:
         app->mouse->rightButton = (action == GLFW_PRESS);
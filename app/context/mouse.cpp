@@ -5,4 +5,5 @@ void Mouse::reset() {
     scrollOffsetY = 0;
     deltaX = 0;
     deltaY = 0;
+    leftClicked = false;
 }
\ No newline at end of file
@@ -2,6 +2,9 @@
 
 class Mouse {
   public:
+    // left button released within this distance from drag start is a click
+    static constexpr double CLICK_DRAG_TOLERANCE = 3.0;
+
     bool leftButton = false;
     bool rightButton = false;
     bool middleButton = false;
@@ -11,6 +14,9 @@ class Mouse {
     double dragEndX = 0.0;
     double dragEndY = 0.0;
 
+    // true only in the frame left button is clicked without dragging
+    bool leftClicked = false;
+
     double currentX = 0.0;
     double currentY = 0.0;
 
@@ -20,9 +20,28 @@ class UI {
         bool isSeekBarDragging;
     } animationControlWindow;
 
+    struct CharacterWindow {
+        bool sizeInitialized = false;
+        bool show = false;
+
+        // number of characters spawned by crowd mode
+        int crowdSize = 100;
+    } characterWindow;
+
     struct DebugWindow {
         bool sizeInitialized = false;
         bool show = false;
+
+        const std::array<const char *, 4> MSAA_ITEMS = {"Off", "2x", "4x",
+                                                        "8x"};
+        // applied to RenderTarget when slider is released
+        float renderScale = 1.0f;
+        // applied to main window at the beginning of next frame
+        int numOfFrames = 3;
+        // 0: default of the surface
+        int numOfSwapChainImages = 0;
+        // target FPS of AppEngine::vSync(), 0: unlimited
+        int fpsLimit = 60;
     } debugWindow;
 
     struct Config {
@@ -32,8 +51,28 @@ class UI {
         bool exportAllPositionChannel = false;
     } config;
 
+    const std::array<const char *, 2> VIEWPORT_LAYOUT_ITEMS = {
+        u8"シングル", u8"4分割 (透視 / 正面 / 側面 / 上面)"};
+    static const int VIEWPORT_LAYOUT_INDEX_SINGLE = 0;
+    static const int VIEWPORT_LAYOUT_INDEX_QUAD = 1;
+    int viewportLayoutIndex = 0;
+
     bool showImGuiDemoWindow = false;
+    bool showPerformanceHud = false;
     bool showFloor = true;
     bool showAxisObject = false;
     bool enableVsinc = true;
+    // evaluate FK of characters by compute shader instead of CPU
+    bool useGpuForwardKinematics = false;
+    // draw only characters in view frustum, culled by compute shader
+    bool useGpuCulling = false;
+    // draw distant characters by lower detail meshes, selected by projected
+    // size on screen
+    bool useLod = false;
+    // LOD level i is lowered below lodThresholds[i] pixels, and raised back
+    // above lodThresholds[i] * (1 + lodHysteresis)
+    std::array<float, 3> lodThresholds = {150.0f, 50.0f, 15.0f};
+    float lodHysteresis = 0.2f;
+    // highlight bone under the cursor, found by BVH on CPU
+    bool useHover = true;
 };
@@ -4,6 +4,7 @@
 
 #define GLM_FORCE_RADIANS
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
 
 #include "./animator.hpp"
 #include "./bvhParser.hpp"
@@ -37,21 +38,36 @@ void Animator::updateAnimator(float deltaTime) {
         return;
     }
 
-    animationTime += deltaTime * animationSpeed;
+    advanceAnimationTime(deltaTime * animationSpeed);
+}
+
+/**
+ * @brief Moves animation time by seconds (may be negative) and wraps it into
+ * loop range, or whole motion if loop is disabled.
+ * Unlike updateAnimator(), this ignores animation speed and stop state.
+ */
+void Animator::advanceAnimationTime(float seconds) {
+    animationTime += seconds;
 
     float loopStartTime;
-    float loopEndTime;
+    float duration;
     if (loopEnabled) {
         loopStartTime = loopStartFrameIndex * frameRate;
-        loopEndTime = loopEndFrameIndex * frameRate;
-        animationTime =
-            fmod((animationTime - loopStartTime), loopDurationTime) +
-            loopStartTime;
+        duration = loopDurationTime;
     } else {
         loopStartTime = 0;
-        loopEndTime = numOfFrames * frameRate;
-        animationTime = fmod(animationTime, numOfFrames * frameRate);
+        duration = numOfFrames * frameRate;
+    }
+    if (duration <= 0) {
+        animationTime = loopStartTime;
+        return;
+    }
+
+    float timeInRange = fmod(animationTime - loopStartTime, duration);
+    if (timeInRange < 0) {
+        timeInRange += duration;
     }
+    animationTime = timeInRange + loopStartTime;
 }
 
 Animator::Animator(std::shared_ptr<UI> ui) { this->ui = ui; }
@@ -67,21 +83,7 @@ void Animator::initFromBVH(std::string filePath) {
     frameRate = motion->frameRate;
 
     // set default rotation order for ui
-    {
-        std::string rotationOrderStr =
-            convertRotationAxisEnumToRotationOrderStr(motion->rotationOrder);
-
-        size_t arrSize = sizeof(ui->config.rotationOrderComboItems) /
-                         sizeof(ui->config.rotationOrderComboItems[0]);
-
-        for (size_t i = 0; i < arrSize; i++) {
-            if (strcmp(ui->config.rotationOrderComboItems[i],
-                       rotationOrderStr.c_str()) == 0) {
-                ui->config.rotationOrderIndex = i;
-                break;
-            }
-        }
-    }
+    applyRotationOrderToUi();
 
     loopStartFrameIndex = 0;
     loopEndFrameIndex = numOfFrames - 1;
@@ -94,31 +96,46 @@ void Animator::initFromBVH(std::string filePath) {
     sourceFilePath = filePath;
 }
 
-void Animator::generateBones(
-    std::vector<std::shared_ptr<ikura::shapes::Shape>> &bones) {
+/**
+ * @brief Selects rotation order of the motion in rotation order combo of ui.
+ */
+void Animator::applyRotationOrderToUi() {
+    std::string rotationOrderStr =
+        convertRotationAxisEnumToRotationOrderStr(motion->rotationOrder);
+
+    size_t arrSize = sizeof(ui->config.rotationOrderComboItems) /
+                     sizeof(ui->config.rotationOrderComboItems[0]);
+
+    for (size_t i = 0; i < arrSize; i++) {
+        if (strcmp(ui->config.rotationOrderComboItems[i],
+                   rotationOrderStr.c_str()) == 0) {
+            ui->config.rotationOrderIndex = i;
+            break;
+        }
+    }
+}
+
+// Appends one instance of unit length bone per non-root joint.
+// Root joint is not included since it is drawn with its own mesh.
+// Instance ids refer to joint palette starting at paletteOffset.
+void Animator::generateBoneInstances(
+    std::vector<ikura::BasicInstance> &instances,
+    ikura::GroupID paletteOffset) {
     assert(joints.size() <= ikura::NUM_OF_MODEL_MATRIX);
-    bones.clear();
-    bones.resize(joints.size());
 
-    uint32_t baseIndex = 0;
     for (ikura::GroupID id = 0; id < joints.size(); id++) {
         if (joints[id]->getParentIDs().empty()) {
-            // Root Joint
-            bones[id] = std::make_shared<ikura::shapes::SingleColorCube>(
-                2.0, 2.0, 2.0, glm::vec3(0.0, 0.0, 0.0),
-                glm::vec3(1.0, 0.0, 0.0), id);
-        } else {
-            float length = glm::length(joints[id]->getPos());
-            bones[id] =
-                std::make_shared<ikura::shapes::OctahedronBone>(length, id);
+            continue;
         }
-        bones[id]->setBaseIndex(baseIndex);
-        baseIndex += bones[id]->getVertices().size();
+        float length = glm::length(joints[id]->getPos());
+        instances.push_back(ikura::BasicInstance(glm::vec3(1.0, 1.0, 1.0),
+                                                 length, paletteOffset + id));
     }
 }
 
-std::array<glm::mat4, ikura::NUM_OF_MODEL_MATRIX>
-Animator::generateModelMatrices() {
+// Writes model matrix of each joint into palette[jointID].
+// palette must have getNumOfJoints() matrices.
+void Animator::generateModelMatrices(glm::mat4 *palette) {
     uint32_t frameIndex = getCurrentFrameIndex();
 
     // calculate current motion
@@ -131,7 +148,7 @@ Animator::generateModelMatrices() {
     }
 
     // generate result matrices
-    std::array<glm::mat4, ikura::NUM_OF_MODEL_MATRIX> result;
+    glm::mat4 *result = palette;
 
     for (ikura::GroupID id = 0; id < joints.size(); id++) {
         result[id] = glm::mat4(1.0);
@@ -185,20 +202,105 @@ Animator::generateModelMatrices() {
                                              : currentJointStates[id].pos);
 
         // rotate current joint object to turn to parent
-        glm::vec3 pos = glm::normalize(joints[id]->getPos());
-        glm::vec3 orig = glm::vec3(1.0, 0.0, 0.0);
-        glm::vec3 cross = glm::normalize(glm::cross(pos, orig));
-        if (glm::length(cross) > 0) {
-            result[id] *= glm::rotate(
-                glm::mat4(1.0),
-                glm::pi<float>() - glm::acos(glm::dot(pos, orig)), cross);
-        } else if (pos.x > 0) {
-            result[id] *= glm::rotate(glm::mat4(1.0), glm::radians(180.0f),
-                                      glm::vec3(0.0, 1.0, 0.0));
+        result[id] *= generateMeshTransform(id);
+    }
+}
+
+// Rotation which turns mesh of joint id (e.g. bone along X axis) to its
+// parent. It only depends on the skeleton.
+glm::mat4 Animator::generateMeshTransform(ikura::GroupID id) const {
+    glm::vec3 pos = glm::normalize(joints[id]->getPos());
+    glm::vec3 orig = glm::vec3(1.0, 0.0, 0.0);
+    glm::vec3 cross = glm::normalize(glm::cross(pos, orig));
+    if (glm::length(cross) > 0) {
+        return glm::rotate(glm::mat4(1.0),
+                           glm::pi<float>() - glm::acos(glm::dot(pos, orig)),
+                           cross);
+    } else if (pos.x > 0) {
+        return glm::rotate(glm::mat4(1.0), glm::radians(180.0f),
+                           glm::vec3(0.0, 1.0, 0.0));
+    }
+    return glm::mat4(1.0);
+}
+
+/**
+ * @brief Converts skeleton and all frames of the motion for forward kinematics
+ * on GPU. Matrices written by GPU match generateModelMatrices() if transform
+ * of the instance is the conversion from "right-hand Y-up" to
+ * "right-hand Z-up".
+ * Rotations are converted into quaternions in current rotation order, so this
+ * must be called again after rotation order is changed.
+ */
+ikura::BasicSkeleton Animator::generateSkeleton() const {
+    ikura::BasicSkeleton skeleton;
+    skeleton.frameTime = frameRate;
+
+    for (ikura::GroupID id = 0; id < joints.size(); id++) {
+        const std::vector<ikura::GroupID> &parentIDs =
+            joints[id]->getParentIDs();
+        skeleton.parentIndices.push_back(
+            parentIDs.empty() ? -1 : static_cast<int32_t>(parentIDs.back()));
+        // root joint is placed by motion position instead of its offset
+        skeleton.offsets.push_back(id != 0 ? joints[id]->getPos()
+                                           : glm::vec3(0.0));
+        skeleton.meshTransforms.push_back(generateMeshTransform(id));
+    }
+
+    for (uint32_t frameIndex = 0; frameIndex < numOfFrames; frameIndex++) {
+        skeleton.rootTranslations.push_back(
+            motion->jointMotions[0]->jointStates[frameIndex]->pos);
+
+        for (ikura::GroupID id = 0; id < joints.size(); id++) {
+            const glm::vec3 &rot =
+                motion->jointMotions[id]->jointStates[frameIndex]->rot;
+            glm::quat rotation(1.0, 0.0, 0.0, 0.0);
+            for (auto axis : motion->rotationOrder) {
+                switch (axis) {
+                case RotationAxisEnum::X:
+                    rotation *= glm::angleAxis(glm::radians(rot.x),
+                                               glm::vec3(1.0, 0.0, 0.0));
+                    break;
+                case RotationAxisEnum::Y:
+                    rotation *= glm::angleAxis(glm::radians(rot.y),
+                                               glm::vec3(0.0, 1.0, 0.0));
+                    break;
+                case RotationAxisEnum::Z:
+                    rotation *= glm::angleAxis(glm::radians(rot.z),
+                                               glm::vec3(0.0, 0.0, 1.0));
+                    break;
+                }
+            }
+            skeleton.rotations.push_back(
+                glm::vec4(rotation.x, rotation.y, rotation.z, rotation.w));
         }
     }
 
-    return result;
+    return skeleton;
+}
+
+/**
+ * @brief Radius of sphere around root joint which contains all joints in any
+ * frame, i.e. the longest sum of joint offsets from root joint to a joint.
+ * It does not depend on rotations, so it is computed without the motion.
+ */
+float Animator::computeBoundingRadius() const {
+    // chainLengths[id]: sum of offsets from root joint to joint id
+    std::vector<float> chainLengths(joints.size(), 0.0f);
+    float radius = 0.0f;
+    for (ikura::GroupID id = 1; id < joints.size(); id++) {
+        const std::vector<ikura::GroupID> &parentIDs =
+            joints[id]->getParentIDs();
+        float parentLength = parentIDs.empty() ? 0.0f
+                                               : chainLengths[parentIDs.back()];
+        chainLengths[id] = parentLength + glm::length(joints[id]->getPos());
+        radius = std::max(radius, chainLengths[id]);
+    }
+    return radius;
+}
+
+// Motion position of root joint in the current frame, in BVH units (Y-up).
+glm::vec3 Animator::getCurrentRootPosition() const {
+    return motion->jointMotions[0]->jointStates[getCurrentFrameIndex()]->pos;
 }
 
 uint32_t Animator::getNumOfJoints() const { return joints.size(); }
@@ -275,6 +377,17 @@ void Animator::seekAnimation(uint32_t frameIndex) {
     animationTime = frameIndex * frameRate;
 }
 
+/**
+ * @brief Shows frameIndex exactly, ignoring loop range.
+ * animationTime is set to the middle of the frame, so that
+ * getCurrentFrameIndex() never returns the previous frame by rounding error.
+ * Used by fixed timestep recording.
+ */
+void Animator::setCurrentFrameIndex(uint32_t frameIndex) {
+    frameIndex = std::min(frameIndex, numOfFrames - 1);
+    animationTime = (frameIndex + 0.5f) * frameRate;
+}
+
 void Animator::incrementFrameIndex(int inc) {
     uint32_t currentFrameIndex = getCurrentFrameIndex();
 
@@ -33,15 +33,15 @@ class Animator {
     float animationTime;
     float animationSpeed;
 
-    bool animationStopped;
-    bool loopEnabled;
+    bool animationStopped = false;
+    bool loopEnabled = false;
 
   public:
     class Joint {
         ikura::GroupID id;
         std::string name;
         glm::vec3 pos;
-        // [parent, grand parent, ..., root]
+        // [root, ..., grand parent, parent]
         std::vector<ikura::GroupID> parentIDs;
         // [childA, childB, ...]
         std::vector<ikura::GroupID> closestChildIDs;
@@ -70,10 +70,16 @@ class Animator {
     Animator(std::shared_ptr<UI> ui);
 
     void initFromBVH(std::string filePath);
-    void
-    generateBones(std::vector<std::shared_ptr<ikura::shapes::Shape>> &bones);
-    std::array<glm::mat4, ikura::NUM_OF_MODEL_MATRIX> generateModelMatrices();
+    void generateBoneInstances(std::vector<ikura::BasicInstance> &instances,
+                               ikura::GroupID paletteOffset = 0);
+    void generateModelMatrices(glm::mat4 *palette);
+    glm::mat4 generateMeshTransform(ikura::GroupID id) const;
+    ikura::BasicSkeleton generateSkeleton() const;
+    float computeBoundingRadius() const;
+    glm::vec3 getCurrentRootPosition() const;
     void updateAnimator(float deltaTime);
+    void advanceAnimationTime(float seconds);
+    void applyRotationOrderToUi();
 
     uint32_t getNumOfJoints() const;
     uint32_t getNumOfFrames() const;
@@ -100,6 +106,7 @@ class Animator {
     void updateLoopRange(uint32_t _loopStartFrameIndex,
                          uint32_t _loopEndFrameIndex);
     void seekAnimation(uint32_t frameIndex);
+    void setCurrentFrameIndex(uint32_t frameIndex);
     void incrementFrameIndex(int inc);
     void setAnimationSpeed(float speed);
 
@@ -0,0 +1,90 @@
+#include "./character.hpp"
+
+#include <algorithm>
+
+#define GLM_FORCE_RADIANS
+#include <glm/gtc/matrix_transform.hpp>
+
+Character::Character(std::shared_ptr<Animator> animator, std::string name)
+    : animator(animator), name(name) {}
+
+/**
+ * @brief Writes model matrices of joints, placed by transform of this
+ * Character, into palette[0 : getPaletteSize()].
+ * Hidden Character gets zero matrices, which collapse its meshes.
+ * This only reads the Animator, so Characters can be processed in parallel.
+ */
+void Character::generateModelMatrices(glm::mat4 *palette) const {
+    const uint32_t paletteSize = getPaletteSize();
+    if (!visible) {
+        std::fill(palette, palette + paletteSize, glm::mat4(0.0));
+        return;
+    }
+
+    animator->generateModelMatrices(palette);
+
+    glm::mat4 transform = generateTransform();
+    for (uint32_t i = 0; i < paletteSize; i++) {
+        palette[i] = transform * palette[i];
+    }
+}
+
+glm::mat4 Character::generateTransform() const {
+    glm::mat4 transform = glm::translate(glm::mat4(1.0), position);
+    return glm::rotate(transform, glm::radians(yaw), glm::vec3(0.0, 0.0, 1.0));
+}
+
+/**
+ * @brief Returns position of root joint in the current frame, placed like
+ * model matrices of generateModelMatrices(), so without global scaling.
+ */
+glm::vec3 Character::computeRootPosition() const {
+    // convert "right-hand Y-up" to "right-hand Z-up", like Animator
+    const glm::mat4 yUpToZUp = glm::rotate(
+        glm::mat4(1.0), glm::radians(90.0f), glm::vec3(1.0, 0.0, 0.0));
+    return glm::vec3(generateTransform() * yUpToZUp *
+                     glm::vec4(animator->getCurrentRootPosition(), 1.0));
+}
+
+// Getters ----------
+
+const std::shared_ptr<Animator> &Character::getAnimator() const {
+    return animator;
+}
+
+const std::string &Character::getName() const { return name; }
+
+glm::vec3 Character::getPosition() const { return position; }
+
+float Character::getYaw() const { return yaw; }
+
+float Character::getTimeOffset() const { return timeOffset; }
+
+bool Character::isVisible() const { return visible; }
+
+ikura::GroupID Character::getPaletteOffset() const { return paletteOffset; }
+
+uint32_t Character::getPaletteSize() const {
+    return animator->getNumOfJoints();
+}
+
+// Setters ----------
+
+void Character::setPosition(glm::vec3 position) { this->position = position; }
+
+void Character::setYaw(float yaw) { this->yaw = yaw; }
+
+/**
+ * @brief Shifts animation time of the Animator by difference from current
+ * offset, so that the Character keeps the offset while playing.
+ */
+void Character::setTimeOffset(float timeOffset) {
+    animator->advanceAnimationTime(timeOffset - this->timeOffset);
+    this->timeOffset = timeOffset;
+}
+
+void Character::setVisible(bool visible) { this->visible = visible; }
+
+void Character::setPaletteOffset(ikura::GroupID paletteOffset) {
+    this->paletteOffset = paletteOffset;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include <glm/glm.hpp>
+
+#include <ikura/ikura.hpp>
+
+#include "./animator.hpp"
+
+/**
+ * @brief BVH performer placed in the scene.
+ *
+ * Each Character owns its Animator, and its joints use a contiguous range of
+ * model matrices (joint palette) starting at paletteOffset. All Characters
+ * share vertex / index / instance buffers of the RenderContent, so adding a
+ * Character only appends instances.
+ */
+class Character {
+    std::shared_ptr<Animator> animator;
+    std::string name;
+
+    // Placement ----------
+    // in BVH units, on the floor (XY plane)
+    glm::vec3 position = glm::vec3(0.0);
+    // rotation around Z axis, in degrees
+    float yaw = 0.0f;
+    // seconds shifted from the time of other Characters
+    float timeOffset = 0.0f;
+    bool visible = true;
+
+    ikura::GroupID paletteOffset = 0;
+
+  public:
+    Character(std::shared_ptr<Animator> animator, std::string name);
+
+    void generateModelMatrices(glm::mat4 *palette) const;
+    glm::mat4 generateTransform() const;
+    glm::vec3 computeRootPosition() const;
+
+    // Getters ----------
+    const std::shared_ptr<Animator> &getAnimator() const;
+    const std::string &getName() const;
+    glm::vec3 getPosition() const;
+    float getYaw() const;
+    float getTimeOffset() const;
+    bool isVisible() const;
+    ikura::GroupID getPaletteOffset() const;
+    uint32_t getPaletteSize() const;
+
+    // Setters ----------
+    void setPosition(glm::vec3 position);
+    void setYaw(float yaw);
+    void setTimeOffset(float timeOffset);
+    void setVisible(bool visible);
+    void setPaletteOffset(ikura::GroupID paletteOffset);
+};
@@ -0,0 +1,185 @@
+#include "./characterBvh.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
+/**
+ * @brief Builds topology by splitting characters at median of centers along
+ * the longest axis, and computes bounds.
+ */
+void CharacterBvh::build(const std::vector<glm::vec4> &spheres) {
+    nodes.clear();
+    itemSpheres.resize(spheres.size());
+    items.resize(spheres.size());
+    std::iota(items.begin(), items.end(), 0);
+    builtRootArea = 0.0f;
+    if (spheres.empty()) {
+        return;
+    }
+
+    nodes.reserve(2 * spheres.size());
+    nodes.push_back(Node{});
+    buildNode(0, 0, static_cast<uint32_t>(items.size()), spheres);
+
+    refit(spheres);
+    builtRootArea = computeSurfaceArea(nodes[0]);
+}
+
+void CharacterBvh::buildNode(uint32_t nodeIndex, uint32_t first,
+                             uint32_t count,
+                             const std::vector<glm::vec4> &spheres) {
+    if (count <= MAX_LEAF_SIZE) {
+        nodes[nodeIndex].first = first;
+        nodes[nodeIndex].count = count;
+        return;
+    }
+
+    glm::vec3 centerMin(std::numeric_limits<float>::max());
+    glm::vec3 centerMax(std::numeric_limits<float>::lowest());
+    for (uint32_t i = first; i < first + count; i++) {
+        centerMin = glm::min(centerMin, glm::vec3(spheres[items[i]]));
+        centerMax = glm::max(centerMax, glm::vec3(spheres[items[i]]));
+    }
+    glm::vec3 extent = centerMax - centerMin;
+    int axis = 0;
+    if (extent.y > extent[axis]) {
+        axis = 1;
+    }
+    if (extent.z > extent[axis]) {
+        axis = 2;
+    }
+
+    uint32_t half = count / 2;
+    std::nth_element(items.begin() + first, items.begin() + first + half,
+                     items.begin() + first + count,
+                     [&](uint32_t a, uint32_t b) {
+                         return spheres[a][axis] < spheres[b][axis];
+                     });
+
+    // nodes may be reallocated, so the parent is referred by index
+    uint32_t left = static_cast<uint32_t>(nodes.size());
+    nodes.push_back(Node{});
+    nodes.push_back(Node{});
+    nodes[nodeIndex].first = left;
+    nodes[nodeIndex].count = 0;
+    buildNode(left, first, half, spheres);
+    buildNode(left + 1, first + half, count - half, spheres);
+}
+
+/**
+ * @brief Updates bounds from spheres of the current frame, keeping topology.
+ * spheres must be ordered like the ones given to build().
+ * Returns true if bounds got so loose that build() should be called.
+ */
+bool CharacterBvh::refit(const std::vector<glm::vec4> &spheres) {
+    // children are visited before their parent
+    for (size_t i = nodes.size(); i-- > 0;) {
+        Node &node = nodes[i];
+        node.boundsMin = glm::vec3(std::numeric_limits<float>::max());
+        node.boundsMax = glm::vec3(std::numeric_limits<float>::lowest());
+
+        if (node.count > 0) {
+            for (uint32_t j = node.first; j < node.first + node.count; j++) {
+                const glm::vec4 &sphere = spheres[items[j]];
+                itemSpheres[j] = sphere;
+                if (sphere.w < 0.0f) {
+                    continue;
+                }
+                node.boundsMin =
+                    glm::min(node.boundsMin, glm::vec3(sphere) - sphere.w);
+                node.boundsMax =
+                    glm::max(node.boundsMax, glm::vec3(sphere) + sphere.w);
+            }
+        } else {
+            const Node &left = nodes[node.first];
+            const Node &right = nodes[node.first + 1];
+            node.boundsMin = glm::min(left.boundsMin, right.boundsMin);
+            node.boundsMax = glm::max(left.boundsMax, right.boundsMax);
+        }
+    }
+
+    return !nodes.empty() &&
+           computeSurfaceArea(nodes[0]) >
+               REBUILD_AREA_RATIO * std::max(builtRootArea, MIN_REBUILD_AREA);
+}
+
+/**
+ * @brief Finds the character of the closest hit along the ray.
+ * hitCharacter(index, closestDistance) is called for characters whose
+ * bounding spheres are hit nearer than the closest hit so far, nearer nodes
+ * first, and returns distance of its own hit or NO_HIT.
+ */
+std::optional<uint32_t> CharacterBvh::raycast(
+    const Ray &ray,
+    const std::function<float(uint32_t, float)> &hitCharacter) const {
+    std::optional<uint32_t> closest;
+    if (nodes.empty()) {
+        return closest;
+    }
+
+    float closestDistance = NO_HIT;
+    const glm::vec3 invDirection = 1.0f / ray.direction;
+    const auto intersectNode = [&](const Node &node) {
+        // empty node (only hidden characters)
+        if (node.boundsMin.x > node.boundsMax.x) {
+            return NO_HIT;
+        }
+        return intersectBox(ray, invDirection, node.boundsMin, node.boundsMax);
+    };
+
+    std::vector<uint32_t> stack = {0};
+    while (!stack.empty()) {
+        const Node &node = nodes[stack.back()];
+        stack.pop_back();
+        if (intersectNode(node) >= closestDistance) {
+            continue;
+        }
+
+        if (node.count > 0) {
+            for (uint32_t i = node.first; i < node.first + node.count; i++) {
+                const glm::vec4 &sphere = itemSpheres[i];
+                if (sphere.w < 0.0f ||
+                    intersectSphere(ray, glm::vec3(sphere), sphere.w) >=
+                        closestDistance) {
+                    continue;
+                }
+                float distance = hitCharacter(items[i], closestDistance);
+                if (distance < closestDistance) {
+                    closestDistance = distance;
+                    closest = items[i];
+                }
+            }
+            continue;
+        }
+
+        // nearer child is popped first
+        uint32_t nearChild = node.first;
+        uint32_t farChild = node.first + 1;
+        float nearDistance = intersectNode(nodes[nearChild]);
+        float farDistance = intersectNode(nodes[farChild]);
+        if (farDistance < nearDistance) {
+            std::swap(nearChild, farChild);
+            std::swap(nearDistance, farDistance);
+        }
+        if (farDistance < closestDistance) {
+            stack.push_back(farChild);
+        }
+        if (nearDistance < closestDistance) {
+            stack.push_back(nearChild);
+        }
+    }
+
+    return closest;
+}
+
+size_t CharacterBvh::getNumOfCharacters() const { return items.size(); }
+
+float CharacterBvh::computeSurfaceArea(const Node &node) {
+    if (node.boundsMin.x > node.boundsMax.x) {
+        return 0.0f;
+    }
+    glm::vec3 extent = node.boundsMax - node.boundsMin;
+    return 2.0f * (extent.x * extent.y + extent.y * extent.z +
+                   extent.z * extent.x);
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "./ray.hpp"
+
+/**
+ * @brief Bounding volume hierarchy over bounding spheres of characters, which
+ * narrows ray queries down to the few characters a ray may hit.
+ *
+ * Topology is built once per set of characters, and bounds are refitted
+ * bottom up every frame in linear time. Refitted bounds get loose as
+ * characters move away from where they were built, so refit() tells when
+ * rebuilding is worth it.
+ * Spheres are given as (center, radius), and negative radius (e.g. hidden
+ * character) is never hit.
+ */
+class CharacterBvh {
+    struct Node {
+        glm::vec3 boundsMin;
+        glm::vec3 boundsMax;
+        // leaf: items[first : first + count]
+        // inner (count is 0): children are nodes[first] and nodes[first + 1]
+        uint32_t first;
+        uint32_t count;
+    };
+
+    static constexpr uint32_t MAX_LEAF_SIZE = 4;
+    // refitted root larger than this ratio of the built one is rebuilt
+    static constexpr float REBUILD_AREA_RATIO = 2.0f;
+    // built root area is clamped to this, so that a degenerate tree (e.g. all
+    // characters hidden) is not rebuilt every frame
+    static constexpr float MIN_REBUILD_AREA = 1.0f;
+
+    // children are always placed after their parent
+    std::vector<Node> nodes;
+    // character indices, grouped by leaves
+    std::vector<uint32_t> items;
+    // itemSpheres[i] is sphere of items[i] in the latest refit()
+    std::vector<glm::vec4> itemSpheres;
+    float builtRootArea = 0.0f;
+
+    void buildNode(uint32_t nodeIndex, uint32_t first, uint32_t count,
+                   const std::vector<glm::vec4> &spheres);
+    static float computeSurfaceArea(const Node &node);
+
+  public:
+    void build(const std::vector<glm::vec4> &spheres);
+    bool refit(const std::vector<glm::vec4> &spheres);
+    std::optional<uint32_t>
+    raycast(const Ray &ray,
+            const std::function<float(uint32_t, float)> &hitCharacter) const;
+
+    size_t getNumOfCharacters() const;
+};
@@ -0,0 +1,79 @@
+#include "./ray.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+float intersectSphere(const Ray &ray, glm::vec3 center, float radius) {
+    glm::vec3 toOrigin = ray.origin - center;
+    float b = glm::dot(toOrigin, ray.direction);
+    float c = glm::dot(toOrigin, toOrigin) - radius * radius;
+    // outside and moving away
+    if (c > 0.0f && b > 0.0f) {
+        return NO_HIT;
+    }
+    float discriminant = b * b - c;
+    if (discriminant < 0.0f) {
+        return NO_HIT;
+    }
+    return std::max(-b - std::sqrt(discriminant), 0.0f);
+}
+
+/**
+ * @brief Tests capsule around segment [a, b].
+ * Distance is measured from the closest point between the ray and the
+ * segment, which is accurate enough for picking and much cheaper than the
+ * exact cylinder and cap tests.
+ */
+float intersectCapsule(const Ray &ray, glm::vec3 a, glm::vec3 b,
+                       float radius) {
+    glm::vec3 segment = b - a;
+    float segmentLength2 = glm::dot(segment, segment);
+    if (segmentLength2 <= 0.0f) {
+        return intersectSphere(ray, a, radius);
+    }
+
+    // closest point on the infinite lines, clamped to the segment, then the
+    // ray parameter and the segment parameter are refined once each
+    glm::vec3 toOrigin = ray.origin - a;
+    float segmentDotDirection = glm::dot(segment, ray.direction);
+    float denominator =
+        segmentLength2 - segmentDotDirection * segmentDotDirection;
+    float s = 0.0f;
+    if (denominator > 0.0f) {
+        s = (glm::dot(segment, toOrigin) -
+             segmentDotDirection * glm::dot(ray.direction, toOrigin)) /
+            denominator;
+        s = std::clamp(s, 0.0f, 1.0f);
+    }
+    float t = std::max(glm::dot(a + s * segment - ray.origin, ray.direction),
+                       0.0f);
+    glm::vec3 pointOnRay = ray.origin + t * ray.direction;
+    s = std::clamp(glm::dot(pointOnRay - a, segment) / segmentLength2, 0.0f,
+                   1.0f);
+
+    glm::vec3 offset = pointOnRay - (a + s * segment);
+    float distance2 = glm::dot(offset, offset);
+    if (distance2 > radius * radius) {
+        return NO_HIT;
+    }
+    return std::max(t - std::sqrt(radius * radius - distance2), 0.0f);
+}
+
+/**
+ * @brief Slab test of axis aligned box.
+ * invDirection is 1 / ray.direction, computed once per ray.
+ */
+float intersectBox(const Ray &ray, glm::vec3 invDirection, glm::vec3 boundsMin,
+                   glm::vec3 boundsMax) {
+    glm::vec3 t0 = (boundsMin - ray.origin) * invDirection;
+    glm::vec3 t1 = (boundsMax - ray.origin) * invDirection;
+    glm::vec3 tNear = glm::min(t0, t1);
+    glm::vec3 tFar = glm::max(t0, t1);
+
+    float enter = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+    float exit = std::min(std::min(tFar.x, tFar.y), tFar.z);
+    if (enter > exit) {
+        return NO_HIT;
+    }
+    return enter;
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <limits>
+
+#include <glm/glm.hpp>
+
+// Half line origin + t * direction (t >= 0). direction must be normalized.
+struct Ray {
+    glm::vec3 origin;
+    glm::vec3 direction;
+};
+
+// Intersection tests return distance along the ray to the first hit, 0 if
+// origin is inside, or NO_HIT if the ray misses.
+static constexpr float NO_HIT = std::numeric_limits<float>::infinity();
+
+float intersectSphere(const Ray &ray, glm::vec3 center, float radius);
+float intersectCapsule(const Ray &ray, glm::vec3 a, glm::vec3 b, float radius);
+float intersectBox(const Ray &ray, glm::vec3 invDirection, glm::vec3 boundsMin,
+                   glm::vec3 boundsMax);
@@ -0,0 +1,342 @@
+#include "./frameEncoder.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <stdexcept>
+
+#include <easylogging++.h>
+
+namespace {
+// PNG helpers --------------------
+// PNGs are written with uncompressed (stored) deflate blocks, so that no
+// compression library is required. Re-encode them if file size matters.
+
+constexpr size_t DEFLATE_MAX_STORED_BLOCK_SIZE = 65535;
+
+const std::array<uint32_t, 256> &getCrcTable() {
+    static const std::array<uint32_t, 256> table = [] {
+        std::array<uint32_t, 256> t{};
+        for (uint32_t n = 0; n < 256; n++) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; k++) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            t[n] = c;
+        }
+        return t;
+    }();
+    return table;
+}
+
+uint32_t updateCrc(uint32_t crc, const uint8_t *data, size_t size) {
+    const auto &table = getCrcTable();
+    for (size_t i = 0; i < size; i++) {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+void appendUint32BE(std::vector<uint8_t> &dst, uint32_t value) {
+    dst.push_back((value >> 24) & 0xFF);
+    dst.push_back((value >> 16) & 0xFF);
+    dst.push_back((value >> 8) & 0xFF);
+    dst.push_back(value & 0xFF);
+}
+
+void writePngChunk(std::ofstream &file, const char *type,
+                   const std::vector<uint8_t> &data) {
+    std::vector<uint8_t> header;
+    appendUint32BE(header, static_cast<uint32_t>(data.size()));
+    header.insert(header.end(), type, type + 4);
+
+    uint32_t crc = updateCrc(0xFFFFFFFFu, header.data() + 4, 4);
+    crc = updateCrc(crc, data.data(), data.size()) ^ 0xFFFFFFFFu;
+    std::vector<uint8_t> footer;
+    appendUint32BE(footer, crc);
+
+    file.write(reinterpret_cast<const char *>(header.data()), header.size());
+    file.write(reinterpret_cast<const char *>(data.data()), data.size());
+    file.write(reinterpret_cast<const char *>(footer.data()), footer.size());
+}
+} // namespace
+
+FrameEncoder::FrameEncoder(RecordingFormatEnum format,
+                           std::filesystem::path outputPath, uint32_t width,
+                           uint32_t height, float framesPerSecond,
+                           bool isBgra) {
+    this->format = format;
+    this->outputPath = outputPath;
+    this->width = width;
+    this->height = height;
+    this->isBgra = isBgra;
+
+    if (format == RecordingFormatEnum::Y4M) {
+        y4mFile.open(outputPath, std::ios::binary | std::ios::trunc);
+        if (!y4mFile) {
+            throw std::runtime_error("Failed to open recording file: " +
+                                     outputPath.string());
+        }
+
+        // frame rate as rational number, e.g. 120fps -> F120000:1000
+        uint32_t rateNumerator =
+            static_cast<uint32_t>(std::lround(framesPerSecond * 1000.0f));
+        y4mFile << "YUV4MPEG2 W" << width << " H" << height << " F"
+                << rateNumerator << ":1000 Ip A1:1 C444\n";
+    }
+
+    // leave one core for rendering thread
+    unsigned int numOfWorkers = std::thread::hardware_concurrency();
+    numOfWorkers = std::clamp(numOfWorkers > 1 ? numOfWorkers - 1 : 1, 1u, 8u);
+    maxNumOfQueuedJobs = numOfWorkers * 2;
+
+    for (unsigned int i = 0; i < numOfWorkers; i++) {
+        workers.emplace_back(&FrameEncoder::workerLoop, this);
+    }
+
+    LOG(INFO) << "FrameEncoder has been started with " << numOfWorkers
+              << " workers: " << outputPath.string();
+}
+
+FrameEncoder::~FrameEncoder() { finish(); }
+
+/**
+ * @brief Queues a copy of pixels (tightly packed, 4 bytes per pixel).
+ * Blocks while the queue is full, so no frame is dropped.
+ */
+void FrameEncoder::submitFrame(uint64_t frameNumber, const uint8_t *pixels,
+                               size_t size) {
+    std::unique_lock<std::mutex> lock(jobMutex);
+    jobDoneCondition.wait(lock, [this] {
+        return queuedJobs.size() < maxNumOfQueuedJobs;
+    });
+
+    Job job;
+    job.frameNumber = frameNumber;
+    if (!freePixelBuffers.empty()) {
+        job.pixels = std::move(freePixelBuffers.back());
+        freePixelBuffers.pop_back();
+    }
+    job.pixels.assign(pixels, pixels + size);
+
+    queuedJobs.push_back(std::move(job));
+    jobQueuedCondition.notify_one();
+}
+
+/**
+ * @brief Waits for all queued frames to be encoded and closes output.
+ * Calling this more than once is no-op.
+ */
+void FrameEncoder::finish() {
+    {
+        std::lock_guard<std::mutex> lock(jobMutex);
+        if (isFinishing) {
+            return;
+        }
+        isFinishing = true;
+    }
+    jobQueuedCondition.notify_all();
+
+    for (auto &worker : workers) {
+        worker.join();
+    }
+    workers.clear();
+
+    if (y4mFile.is_open()) {
+        if (!encodedFrames.empty()) {
+            errorMessage = "Some frames were not written to recording file.";
+        }
+        y4mFile.close();
+    }
+
+    LOG(INFO) << "FrameEncoder has been finished.";
+}
+
+const std::string &FrameEncoder::getErrorMessage() const {
+    return errorMessage;
+}
+
+void FrameEncoder::workerLoop() {
+    while (true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(jobMutex);
+            jobQueuedCondition.wait(lock, [this] {
+                return !queuedJobs.empty() || isFinishing;
+            });
+            if (queuedJobs.empty()) {
+                return;
+            }
+            job = std::move(queuedJobs.front());
+            queuedJobs.pop_front();
+        }
+        // submitFrame() may be waiting for free space
+        jobDoneCondition.notify_one();
+
+        try {
+            encodeFrame(job);
+        } catch (std::exception &e) {
+            std::lock_guard<std::mutex> lock(jobMutex);
+            errorMessage = e.what();
+            LOG(ERROR) << "Failed to encode frame " << job.frameNumber << ": "
+                       << e.what();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(jobMutex);
+            freePixelBuffers.push_back(std::move(job.pixels));
+        }
+    }
+}
+
+void FrameEncoder::encodeFrame(Job &job) {
+    switch (format) {
+    case RecordingFormatEnum::Y4M: {
+        std::vector<uint8_t> yuvPlanes;
+        convertToYuv444(job.pixels, yuvPlanes);
+        writeY4mFrameInOrder(job.frameNumber, std::move(yuvPlanes));
+        break;
+    }
+    case RecordingFormatEnum::PNG_SEQUENCE: {
+        // e.g. out.png -> out_000000.png, out_000001.png, ...
+        char numberStr[32];
+        std::snprintf(numberStr, sizeof(numberStr), "_%06llu",
+                      static_cast<unsigned long long>(job.frameNumber));
+        auto path = outputPath;
+        path.replace_filename(outputPath.stem().string() + numberStr + ".png");
+        writePng(path, job.pixels);
+        break;
+    }
+    }
+}
+
+/**
+ * @brief Stores converted frame, and writes all frames which are ready in
+ * frame order.
+ */
+void FrameEncoder::writeY4mFrameInOrder(uint64_t frameNumber,
+                                        std::vector<uint8_t> &&yuvPlanes) {
+    std::lock_guard<std::mutex> lock(y4mMutex);
+    encodedFrames.emplace(frameNumber, std::move(yuvPlanes));
+
+    auto iter = encodedFrames.find(nextFrameNumberToWrite);
+    while (iter != encodedFrames.end()) {
+        y4mFile << "FRAME\n";
+        y4mFile.write(reinterpret_cast<const char *>(iter->second.data()),
+                      iter->second.size());
+        if (!y4mFile) {
+            throw std::runtime_error("Failed to write recording file.");
+        }
+
+        encodedFrames.erase(iter);
+        nextFrameNumberToWrite++;
+        iter = encodedFrames.find(nextFrameNumberToWrite);
+    }
+}
+
+/**
+ * @brief Converts RGBA (or BGRA) pixels into planar Y, Cb, Cr (BT.601 limited
+ * range).
+ */
+void FrameEncoder::convertToYuv444(const std::vector<uint8_t> &pixels,
+                                   std::vector<uint8_t> &yuvPlanes) const {
+    const size_t numOfPixels = (size_t)width * height;
+    yuvPlanes.resize(numOfPixels * 3);
+    uint8_t *yPlane = yuvPlanes.data();
+    uint8_t *uPlane = yPlane + numOfPixels;
+    uint8_t *vPlane = uPlane + numOfPixels;
+
+    const int rIndex = isBgra ? 2 : 0;
+    const int bIndex = isBgra ? 0 : 2;
+
+    for (size_t i = 0; i < numOfPixels; i++) {
+        const int r = pixels[i * 4 + rIndex];
+        const int g = pixels[i * 4 + 1];
+        const int b = pixels[i * 4 + bIndex];
+
+        yPlane[i] = ((66 * r + 129 * g + 25 * b + 128) >> 8) + 16;
+        uPlane[i] = ((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128;
+        vPlane[i] = ((112 * r - 94 * g - 18 * b + 128) >> 8) + 128;
+    }
+}
+
+/**
+ * @brief Writes pixels as 8-bit RGB PNG (alpha is discarded).
+ */
+void FrameEncoder::writePng(const std::filesystem::path &path,
+                            const std::vector<uint8_t> &pixels) const {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        throw std::runtime_error("Failed to open file: " + path.string());
+    }
+
+    // Signature ----------
+    const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    file.write(reinterpret_cast<const char *>(signature), sizeof(signature));
+
+    // IHDR ----------
+    std::vector<uint8_t> ihdr;
+    appendUint32BE(ihdr, width);
+    appendUint32BE(ihdr, height);
+    ihdr.push_back(8); // bit depth
+    ihdr.push_back(2); // color type: RGB
+    ihdr.push_back(0); // compression
+    ihdr.push_back(0); // filter
+    ihdr.push_back(0); // interlace
+    writePngChunk(file, "IHDR", ihdr);
+
+    // Scanlines (filter type 0 + RGB) ----------
+    const int rIndex = isBgra ? 2 : 0;
+    const int bIndex = isBgra ? 0 : 2;
+    const size_t rowSize = 1 + (size_t)width * 3;
+    std::vector<uint8_t> scanlines(rowSize * height);
+    for (uint32_t y = 0; y < height; y++) {
+        uint8_t *row = scanlines.data() + rowSize * y;
+        const uint8_t *src = pixels.data() + (size_t)width * 4 * y;
+        row[0] = 0;
+        for (uint32_t x = 0; x < width; x++) {
+            row[1 + x * 3 + 0] = src[x * 4 + rIndex];
+            row[1 + x * 3 + 1] = src[x * 4 + 1];
+            row[1 + x * 3 + 2] = src[x * 4 + bIndex];
+        }
+    }
+
+    // IDAT (zlib stream of stored deflate blocks) ----------
+    std::vector<uint8_t> idat;
+    idat.reserve(scanlines.size() +
+                 scanlines.size() / DEFLATE_MAX_STORED_BLOCK_SIZE * 5 + 16);
+    idat.push_back(0x78);
+    idat.push_back(0x01);
+
+    size_t offset = 0;
+    do {
+        const size_t blockSize =
+            std::min(DEFLATE_MAX_STORED_BLOCK_SIZE, scanlines.size() - offset);
+        const bool isFinal = (offset + blockSize == scanlines.size());
+        idat.push_back(isFinal ? 1 : 0);
+        idat.push_back(blockSize & 0xFF);
+        idat.push_back((blockSize >> 8) & 0xFF);
+        idat.push_back(~blockSize & 0xFF);
+        idat.push_back((~blockSize >> 8) & 0xFF);
+        idat.insert(idat.end(), scanlines.begin() + offset,
+                    scanlines.begin() + offset + blockSize);
+        offset += blockSize;
+    } while (offset < scanlines.size());
+
+    // Adler-32 of uncompressed data
+    uint32_t a = 1, b = 0;
+    for (uint8_t byte : scanlines) {
+        a = (a + byte) % 65521;
+        b = (b + a) % 65521;
+    }
+    appendUint32BE(idat, (b << 16) | a);
+    writePngChunk(file, "IDAT", idat);
+
+    // IEND ----------
+    writePngChunk(file, "IEND", {});
+
+    if (!file) {
+        throw std::runtime_error("Failed to write file: " + path.string());
+    }
+}
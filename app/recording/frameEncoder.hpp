@@ -0,0 +1,79 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum class RecordingFormatEnum {
+    // single YUV4MPEG2 stream (4:4:4), readable by ffmpeg etc.
+    Y4M,
+    // numbered PNG files next to the given path
+    PNG_SEQUENCE,
+};
+
+/**
+ * @brief Encodes rendered frames on worker threads.
+ *
+ * submitFrame() copies pixels and returns immediately unless too many frames
+ * are waiting, in which case it blocks instead of dropping frames. Y4M frames
+ * are converted in parallel and written in frame order.
+ */
+class FrameEncoder {
+    struct Job {
+        uint64_t frameNumber;
+        std::vector<uint8_t> pixels;
+    };
+
+    RecordingFormatEnum format;
+    std::filesystem::path outputPath;
+    uint32_t width;
+    uint32_t height;
+    // source pixels are BGRA instead of RGBA
+    bool isBgra;
+
+    // Jobs ----------
+    size_t maxNumOfQueuedJobs;
+    std::deque<Job> queuedJobs;
+    std::vector<std::vector<uint8_t>> freePixelBuffers;
+    bool isFinishing = false;
+    std::mutex jobMutex;
+    std::condition_variable jobQueuedCondition;
+    std::condition_variable jobDoneCondition;
+    std::vector<std::thread> workers;
+
+    // Y4M stream ----------
+    std::ofstream y4mFile;
+    uint64_t nextFrameNumberToWrite = 0;
+    // converted frames waiting for preceding frames
+    std::map<uint64_t, std::vector<uint8_t>> encodedFrames;
+    std::mutex y4mMutex;
+
+    std::string errorMessage;
+
+    void workerLoop();
+    void encodeFrame(Job &job);
+    void writeY4mFrameInOrder(uint64_t frameNumber,
+                              std::vector<uint8_t> &&yuvPlanes);
+    void convertToYuv444(const std::vector<uint8_t> &pixels,
+                         std::vector<uint8_t> &yuvPlanes) const;
+    void writePng(const std::filesystem::path &path,
+                  const std::vector<uint8_t> &pixels) const;
+
+  public:
+    FrameEncoder(RecordingFormatEnum format, std::filesystem::path outputPath,
+                 uint32_t width, uint32_t height, float framesPerSecond,
+                 bool isBgra);
+    ~FrameEncoder();
+
+    void submitFrame(uint64_t frameNumber, const uint8_t *pixels, size_t size);
+    void finish();
+
+    const std::string &getErrorMessage() const;
+};
@@ -1,7 +1,10 @@
 ﻿#include "./app.hpp"
 
 #include <algorithm>
+#include <array>
 #include <cmath>
+#include <string>
+#include <utility>
 
 #include <ikura/external/ikura_ext_imgui/imgui.h>
 
@@ -33,12 +36,19 @@ void App::updateUI() {
     if (ui->animationControlWindow.show) {
         updateAnimationControlWindow();
     }
+    if (ui->characterWindow.show) {
+        updateCharacterWindow();
+    }
     if (ui->debugWindow.show) {
         updateDebugWindow();
     }
+    if (ui->showPerformanceHud) {
+        updatePerformanceHud();
+    }
     if (ui->showImGuiDemoWindow) {
         ImGui::ShowDemoWindow();
     }
+    drawHoverHighlight();
 
     ImGui::Render();
 }
@@ -49,9 +59,17 @@ void App::updateMainMenu() {
             if (ImGui::MenuItem(u8"BVHファイルを開く")) {
                 selectFileAndInitShapes();
             }
+            if (ImGui::MenuItem(u8"BVHファイルを追加", nullptr, false,
+                                modelLoaded)) {
+                selectFileAndAddCharacters();
+            }
             if (ImGui::MenuItem(u8"ループ範囲をエクスポート")) {
                 selectFileAndExportLoopRange();
             }
+            if (ImGui::MenuItem(u8"ループ範囲を録画 (Y4M / PNG)", nullptr,
+                                false, modelLoaded)) {
+                selectFileAndRecordLoopRange();
+            }
             ImGui::EndMenu();
         }
 
@@ -59,12 +77,23 @@ void App::updateMainMenu() {
             ImGui::Checkbox(u8"デバッグウィンドウ", &ui->debugWindow.show);
             ImGui::Checkbox(u8"アニメーションコントロールウィンドウ",
                             &ui->animationControlWindow.show);
+            ImGui::Checkbox(u8"キャラクターウィンドウ",
+                            &ui->characterWindow.show);
+            ImGui::Checkbox(u8"パフォーマンスHUD", &ui->showPerformanceHud);
             ImGui::EndMenu();
         }
 
         if (ImGui::BeginMenu(u8"表示")) {
             ImGui::Checkbox(u8"軸オブジェクト", &ui->showAxisObject);
             ImGui::Checkbox(u8"床", &ui->showFloor);
+            ImGui::Separator();
+            for (int i = 0; i < ui->VIEWPORT_LAYOUT_ITEMS.size(); i++) {
+                if (ImGui::MenuItem(ui->VIEWPORT_LAYOUT_ITEMS[i], nullptr,
+                                    ui->viewportLayoutIndex == i)) {
+                    ui->viewportLayoutIndex = i;
+                    updateViewports();
+                }
+            }
             ImGui::EndMenu();
         }
 
@@ -85,6 +114,8 @@ void App::updateMainMenu() {
                 animator->setRotationOrder(convertStrToRotationOrder(
                     ui->config.rotationOrderComboItems
                         [ui->config.rotationOrderIndex]));
+                // rotations on GPU are converted in rotation order
+                areSkeletonsOutdated = true;
             }
 
             if (!modelLoaded) {
@@ -413,10 +444,334 @@ void updateAnimationControlWindowEditor(bool &modelLoaded,
     }
 }
 
+// ----------------------------------------
+// Character window
+// ----------------------------------------
+
+void App::updateCharacterWindow() {
+    if (!ui->characterWindow.sizeInitialized) {
+        ImGui::SetNextWindowSize(ImVec2(480, 600));
+        ui->characterWindow.sizeInitialized = true;
+    }
+
+    ImGui::Begin(u8"キャラクター", &ui->characterWindow.show);
+
+    // characters are replaced by sweep every few frames
+    if (crowdSweep.isRunning) {
+        ImGui::BeginDisabled();
+    }
+
+    ImGui::Text(u8"キャラクター数: %d", (int)characters.size());
+    if (ImGui::Button(u8"追加##add_characters")) {
+        selectFileAndAddCharacters();
+    }
+    ImGui::SameLine();
+    if (!modelLoaded) {
+        ImGui::BeginDisabled();
+    }
+    if (ImGui::Button(u8"整列##arrange_characters")) {
+        arrangeCharacters();
+    }
+    if (!modelLoaded) {
+        ImGui::EndDisabled();
+    }
+
+    UI::makePadding(10);
+
+    // Selected character ----------
+    // removed after details, since it changes characters
+    int removedIndex = -1;
+    if (!characters.empty()) {
+        auto &character = characters[selectedCharacterIndex];
+        ImGui::Text("%d: %s", selectedCharacterIndex + 1,
+                    character->getName().c_str());
+        // picked by clicking the character in the scene
+        if (selectedJointIndex >= 0) {
+            ImGui::Text(u8"関節: %s",
+                        animator->getJoints()[selectedJointIndex]
+                            ->getName()
+                            .c_str());
+        }
+
+        bool visible = character->isVisible();
+        if (ImGui::Checkbox(u8"表示", &visible)) {
+            character->setVisible(visible);
+        }
+
+        glm::vec3 position = character->getPosition();
+        if (ImGui::DragFloat2(u8"位置", &position.x, 1.0f)) {
+            character->setPosition(position);
+        }
+
+        float yaw = character->getYaw();
+        if (ImGui::SliderFloat(u8"向き (度)", &yaw, -180.0f, 180.0f)) {
+            character->setYaw(yaw);
+        }
+
+        float timeOffset = character->getTimeOffset();
+        if (ImGui::DragFloat(u8"時間オフセット (秒)", &timeOffset, 0.01f)) {
+            character->setTimeOffset(timeOffset);
+        }
+
+        if (ImGui::Button(u8"削除")) {
+            removedIndex = selectedCharacterIndex;
+        }
+    }
+
+    if (crowdSweep.isRunning) {
+        ImGui::EndDisabled();
+    }
+
+    UI::makePadding(10);
+
+    updateCrowdControls();
+
+    UI::makePadding(10);
+
+    // Character list ----------
+    // crowd can have thousands of characters, so only visible rows are
+    // submitted
+    ImGui::BeginChild("##character_list", ImVec2(0, 0),
+                      ImGuiChildFlags_Border);
+    ImGuiListClipper clipper;
+    clipper.Begin(characters.size());
+    while (clipper.Step()) {
+        for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++) {
+            ImGui::PushID(i);
+            // selected character is controlled by animation control window
+            std::string label =
+                std::to_string(i + 1) + ": " + characters[i]->getName();
+            if (ImGui::Selectable(label.c_str(), selectedCharacterIndex == i)) {
+                selectCharacter(i);
+            }
+            ImGui::PopID();
+        }
+    }
+    ImGui::EndChild();
+
+    if (removedIndex >= 0) {
+        removeCharacter(removedIndex);
+    }
+
+    ImGui::End();
+}
+
+/**
+ * @brief Shows controls of crowd mode and per-stage timings of the sweep.
+ * Each row reports which stage takes the longest, CPU stages are measured on
+ * main thread and GPU stage by timestamp queries of main RenderTarget.
+ */
+void App::updateCrowdControls() {
+    if (!ImGui::CollapsingHeader(u8"群衆モード")) {
+        return;
+    }
+
+    const int maxCrowdSize = getMaxCrowdSize();
+    if (maxCrowdSize == 0 || crowdSweep.isRunning) {
+        ImGui::BeginDisabled();
+    }
+    ImGui::SliderInt(u8"人数##crowd_size", &ui->characterWindow.crowdSize, 1,
+                     std::max(maxCrowdSize, 1));
+    if (ImGui::Button(u8"生成##spawn_crowd")) {
+        spawnCrowd(ui->characterWindow.crowdSize);
+    }
+    ImGui::SameLine();
+    if (ImGui::Button(u8"スイープ開始##start_crowd_sweep")) {
+        startCrowdSweep();
+    }
+    if (maxCrowdSize == 0 || crowdSweep.isRunning) {
+        ImGui::EndDisabled();
+    }
+
+    if (crowdSweep.isRunning) {
+        ImGui::SameLine();
+        if (ImGui::Button(u8"スイープ停止##stop_crowd_sweep")) {
+            stopCrowdSweep();
+        }
+        ImGui::Text(u8"計測中: %d / %d (%d人)",
+                    (int)crowdSweep.crowdSizeIndex + 1,
+                    (int)crowdSweep.crowdSizes.size(),
+                    (int)characters.size());
+    }
+    ImGui::TextWrapped(u8"上限: %d人 (%dジョイント/人)。FIFO表示モードでは"
+                       u8"フレーム時間はリフレッシュ間隔で頭打ちになります。",
+                       maxCrowdSize, (int)animator->getNumOfJoints());
+
+    if (crowdSweepResults.empty()) {
+        return;
+    }
+
+    const ImGuiTableFlags flags = ImGuiTableFlags_Borders |
+                                  ImGuiTableFlags_RowBg |
+                                  ImGuiTableFlags_ScrollX;
+    if (ImGui::BeginTable("##crowd_sweep_results", 11, flags)) {
+        ImGui::TableSetupColumn(u8"人数");
+        ImGui::TableSetupColumn("FK");
+        ImGui::TableSetupColumn(u8"カリング");
+        ImGui::TableSetupColumn("LOD");
+        ImGui::TableSetupColumn("Instances");
+        ImGui::TableSetupColumn("Frame (ms)");
+        ImGui::TableSetupColumn("FK (ms)");
+        ImGui::TableSetupColumn("Upload (ms)");
+        ImGui::TableSetupColumn("Draw (ms)");
+        ImGui::TableSetupColumn("GPU (ms)");
+        ImGui::TableSetupColumn(u8"律速");
+        ImGui::TableHeadersRow();
+
+        for (const auto &result : crowdSweepResults) {
+            const std::array<std::pair<const char *, double>, 4> stages = {
+                std::make_pair("FK", result.fkTime),
+                std::make_pair("Upload", result.uploadTime),
+                std::make_pair("Draw", result.drawTime),
+                std::make_pair("GPU", result.gpuTime)};
+            auto slowestStage = std::max_element(
+                stages.begin(), stages.end(),
+                [](const auto &a, const auto &b) { return a.second < b.second; });
+
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("%d", result.numOfCharacters);
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(result.isGpuForwardKinematics ? "GPU"
+                                                                 : "CPU");
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(result.isGpuCulling ? "ON" : "OFF");
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(result.isLod ? "ON" : "OFF");
+            ImGui::TableNextColumn();
+            ImGui::Text("%u", result.numOfInstances);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.2f", result.frameTime);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", result.fkTime);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f (%.0f KB)", result.uploadTime,
+                        result.uploadBytes / 1024.0);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", result.drawTime);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", result.gpuTime);
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(slowestStage->first);
+        }
+        ImGui::EndTable();
+    }
+}
+
 // ----------------------------------------
 // Debug window
 // ----------------------------------------
 
+/**
+ * @brief Shows presentation timings of main window at top right corner.
+ */
+void App::updatePerformanceHud() {
+    const float HUD_MARGIN = 10.0f;
+    const ImGuiViewport *viewport = ImGui::GetMainViewport();
+    ImGui::SetNextWindowPos(
+        ImVec2(viewport->WorkPos.x + viewport->WorkSize.x - HUD_MARGIN,
+               viewport->WorkPos.y + HUD_MARGIN),
+        ImGuiCond_Always, ImVec2(1.0f, 0.0f));
+    ImGui::SetNextWindowBgAlpha(0.5f);
+
+    ImGuiWindowFlags flags =
+        ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_AlwaysAutoResize |
+        ImGuiWindowFlags_NoSavedSettings | ImGuiWindowFlags_NoFocusOnAppearing |
+        ImGuiWindowFlags_NoNav | ImGuiWindowFlags_NoMove;
+    if (ImGui::Begin("##performance_hud", &ui->showPerformanceHud, flags)) {
+        const auto &stats = mainWindow->getPresentStats();
+        ImGui::Text("Present mode: %s",
+                    vk::to_string(mainWindow->getPresentMode()).c_str());
+        ImGui::Text("Frames in flight: %d / SwapChain images: %d",
+                    mainWindow->getNumOfFrames(),
+                    (int)mainWindow->getSwapChainImages().size());
+        ImGui::Text("Present rate: %.1f /s", stats.presentRate);
+        ImGui::Text("Acquire to present: %.2f ms",
+                    stats.acquireToPresentTime);
+        ImGui::Text("Acquire wait: %.2f ms", stats.acquireWaitTime);
+        ImGui::Text("GPU time: %.3f ms", mainRenderTarget->getLastGpuTime());
+
+        // CPU stages of the last frame
+        ImGui::Separator();
+        ImGui::Text("Characters: %d / Instances: %u", (int)characters.size(),
+                    numOfInstances);
+        ImGui::Text("FK (%s): %.3f ms",
+                    ui->useGpuForwardKinematics ? "GPU" : "CPU",
+                    stageTimings.fkTime);
+        ImGui::Text("Upload: %.3f ms (%.0f KB)", stageTimings.uploadTime,
+                    stageTimings.uploadBytes / 1024.0);
+        ImGui::Text("Draw (CPU): %.3f ms", stageTimings.drawTime);
+        if (ui->useHover) {
+            ImGui::Text("Hover (CPU BVH): %.3f ms", stageTimings.hoverTime);
+        }
+        if (isLodApplied) {
+            ImGui::Text("LOD: %d / %d / %d / %d", numOfLodCharacters[0],
+                        numOfLodCharacters[1], numOfLodCharacters[2],
+                        numOfLodCharacters[3]);
+        }
+    }
+    ImGui::End();
+}
+
+/**
+ * @brief Outlines hovered bone in every viewport and shows its name at the
+ * cursor. It is drawn by ImGui over the scene, so instances are not rebuilt.
+ */
+void App::drawHoverHighlight() {
+    if (hoveredCharacterIndex < 0 || ImGui::GetIO().WantCaptureMouse) {
+        return;
+    }
+
+    // viewport rects are normalized, ImGui is in window coordinates
+    const ImVec2 displaySize = ImGui::GetIO().DisplaySize;
+    const auto &viewportRects = mainWindow->getViewportRects();
+    const auto projectToScreen = [&](size_t viewportIndex, glm::vec3 pos,
+                                     ImVec2 &screenPos) {
+        const auto &sceneMat = viewportSceneMats[viewportIndex];
+        glm::vec4 clip = sceneMat.proj * sceneMat.view * glm::vec4(pos, 1.0);
+        if (clip.w <= 0.0f) {
+            return false;
+        }
+        const auto &rect = viewportRects[viewportIndex];
+        screenPos.x = (rect.x + (clip.x / clip.w + 1.0f) * 0.5f * rect.width) *
+                      displaySize.x;
+        screenPos.y = (rect.y + (clip.y / clip.w + 1.0f) * 0.5f * rect.height) *
+                      displaySize.y;
+        return true;
+    };
+
+    const ImU32 HIGHLIGHT_COLOR = IM_COL32(255, 200, 0, 255);
+    ImDrawList *drawList = ImGui::GetBackgroundDrawList();
+    for (size_t i = 0;
+         i < viewportRects.size() && i < viewportSceneMats.size(); i++) {
+        ImVec2 start, end;
+        if (!projectToScreen(i, hoveredBoneStart, start) ||
+            !projectToScreen(i, hoveredBoneEnd, end)) {
+            continue;
+        }
+        // keep drawing inside of the viewport
+        const auto &rect = viewportRects[i];
+        drawList->PushClipRect(
+            ImVec2(rect.x * displaySize.x, rect.y * displaySize.y),
+            ImVec2((rect.x + rect.width) * displaySize.x,
+                   (rect.y + rect.height) * displaySize.y),
+            true);
+        if (hoveredBoneStart == hoveredBoneEnd) {
+            drawList->AddCircle(end, 8.0f, HIGHLIGHT_COLOR, 0, 3.0f);
+        } else {
+            drawList->AddLine(start, end, HIGHLIGHT_COLOR, 3.0f);
+        }
+        drawList->PopClipRect();
+    }
+
+    const auto &character = characters[hoveredCharacterIndex];
+    ImGui::SetTooltip(
+        "%d: %s\n%s", hoveredCharacterIndex + 1, character->getName().c_str(),
+        character->getAnimator()->getJoints()[hoveredJointIndex]
+            ->getName()
+            .c_str());
+}
+
 void App::updateDebugWindow() {
     if (!ui->debugWindow.sizeInitialized) {
         ImGui::SetNextWindowSize(ImVec2(300, 500));
@@ -431,11 +786,113 @@ void App::updateDebugWindow() {
     ImGui::Checkbox(u8"軸オブジェクトを表示する##show_axis_object",
                     &ui->showAxisObject);
     ImGui::Checkbox(u8"床を表示する##show_floor", &ui->showFloor);
+    ImGui::Checkbox(u8"GPUでFKを計算する##use_gpu_forward_kinematics",
+                    &ui->useGpuForwardKinematics);
+    if (ImGui::Checkbox(u8"GPUで視錐台カリングする##use_gpu_culling",
+                        &ui->useGpuCulling)) {
+        applyCullingGroups();
+    }
+    // instances and draw commands of all LOD levels are rebuilt
+    if (ImGui::Checkbox(u8"遠くのキャラクターを簡略表示する (LOD)##use_lod",
+                        &ui->useLod)) {
+        setShapes();
+    }
+    if (ui->useLod) {
+        ImGui::SliderFloat(u8"LOD 1 (px)##lod_threshold_1",
+                           &ui->lodThresholds[0], ui->lodThresholds[1],
+                           1000.0f, "%.0f");
+        ImGui::SliderFloat(u8"LOD 2 (px)##lod_threshold_2",
+                           &ui->lodThresholds[1], ui->lodThresholds[2],
+                           ui->lodThresholds[0], "%.0f");
+        ImGui::SliderFloat(u8"LOD 3 (px)##lod_threshold_3",
+                           &ui->lodThresholds[2], 1.0f, ui->lodThresholds[1],
+                           "%.0f");
+        ImGui::SliderFloat(u8"ヒステリシス##lod_hysteresis",
+                           &ui->lodHysteresis, 0.0f, 1.0f, "%.2f");
+    }
+    ImGui::Checkbox(u8"カーソル下のボーンを強調表示する##use_hover",
+                    &ui->useHover);
     // ImGui::Checkbox("垂直同期を有効化する##enable_vsinc", &ui->enableVsinc);
 
+    UI::makePadding(10);
+
+    // render settings
+    const std::array<vk::SampleCountFlagBits, 4> msaaSamples = {
+        vk::SampleCountFlagBits::e1, vk::SampleCountFlagBits::e2,
+        vk::SampleCountFlagBits::e4, vk::SampleCountFlagBits::e8};
+    int msaaIndex = 0;
+    for (int i = 0; i < msaaSamples.size(); i++) {
+        if (mainRenderTarget->getMsaaSamples() == msaaSamples[i]) {
+            msaaIndex = i;
+        }
+    }
+    if (ImGui::Combo("MSAA##msaa_samples", &msaaIndex,
+                     ui->debugWindow.MSAA_ITEMS.data(),
+                     ui->debugWindow.MSAA_ITEMS.size())) {
+        mainRenderTarget->setMsaaSamples(msaaSamples[msaaIndex]);
+    }
+
+    if (mainRenderTarget->isRenderScaleSupported()) {
+        ImGui::SliderFloat(u8"描画解像度##render_scale",
+                           &ui->debugWindow.renderScale,
+                           ikura::RenderTarget::MIN_RENDER_SCALE, 1.0f,
+                           "%.2f");
+        // rebuilding attachments on every drag step is wasteful
+        if (ImGui::IsItemDeactivatedAfterEdit()) {
+            mainRenderTarget->setRenderScale(ui->debugWindow.renderScale);
+        }
+    }
+
+    // fewer frames in flight: lower input latency, more: higher throughput
+    ImGui::SliderInt(u8"フレーム数 (in flight)##num_of_frames",
+                     &ui->debugWindow.numOfFrames, 1,
+                     ikura::Window::MAX_NUM_OF_FRAMES);
+    bool isFrameSettingsEdited = ImGui::IsItemDeactivatedAfterEdit();
+    ImGui::SliderInt(u8"SwapChain画像数 (0: 自動)##num_of_swapchain_images",
+                     &ui->debugWindow.numOfSwapChainImages, 0, 8);
+    isFrameSettingsEdited |= ImGui::IsItemDeactivatedAfterEdit();
+    if (isFrameSettingsEdited) {
+        pendingFrameSettings = FrameSettingsRequest{
+            ui->debugWindow.numOfFrames,
+            static_cast<uint32_t>(ui->debugWindow.numOfSwapChainImages)};
+    }
+    ImGui::Text("SwapChain images: %d",
+                (int)mainWindow->getSwapChainImages().size());
+
+    // present mode: trade tearing for latency
+    const std::array<vk::PresentModeKHR, 4> presentModes = {
+        vk::PresentModeKHR::eFifo, vk::PresentModeKHR::eFifoRelaxed,
+        vk::PresentModeKHR::eMailbox, vk::PresentModeKHR::eImmediate};
+    auto supportedPresentModes = mainWindow->getSupportedPresentModes();
+    auto currentPresentMode = mainWindow->getPresentMode();
+    if (ImGui::BeginCombo(u8"表示モード##present_mode",
+                          vk::to_string(currentPresentMode).c_str())) {
+        for (const auto &mode : presentModes) {
+            bool isSupported =
+                std::find(supportedPresentModes.begin(),
+                          supportedPresentModes.end(),
+                          mode) != supportedPresentModes.end();
+            if (ImGui::Selectable(vk::to_string(mode).c_str(),
+                                  mode == currentPresentMode,
+                                  isSupported
+                                      ? ImGuiSelectableFlags_None
+                                      : ImGuiSelectableFlags_Disabled)) {
+                mainWindow->setPresentMode(mode);
+            }
+        }
+        ImGui::EndCombo();
+    }
+
+    // CPU side pacing, on top of pacing by present mode
+    if (ImGui::SliderInt(u8"FPS上限 (0: 無制限)##fps_limit",
+                         &ui->debugWindow.fpsLimit, 0, 240)) {
+        appEngine->setFps((float)ui->debugWindow.fpsLimit);
+    }
+
     UI::makePadding(20);
 
     ImGui::Text("FPS: %.1f", io.Framerate);
+    ImGui::Text("GPU Time: %.3f ms", mainRenderTarget->getLastGpuTime());
     ImGui::Text("Joints: %d", animator->getNumOfJoints());
     ImGui::Text("Animation Time: %f", animator->getAnimationTime());
 
@@ -1,40 +1,156 @@
 #pragma once
 
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
 #include <vulkan/vulkan.hpp>
 
 #include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
 
 namespace ikura {
 
 class Vertex {};
 
-class BasicVertex : public Vertex {
-  public:
+// Memory layouts of BasicVertex ----------
+enum class BasicVertexFormat {
+    // vec3 pos, vec3 color, uint32 id (28 bytes)
+    Full,
+    // half4 pos, RGBA8 color, uint16 id (16 bytes)
+    Compact,
+};
+
+template <BasicVertexFormat Format> struct BasicVertexLayout;
+
+template <> struct BasicVertexLayout<BasicVertexFormat::Full> {
     struct Data {
         glm::vec3 pos;
         glm::vec3 color;
         uint32_t id;
+    };
+
+    static constexpr std::array<vk::VertexInputAttributeDescription, 3>
+        attributeDescriptions = {
+            vk::VertexInputAttributeDescription(
+                0, 0, vk::Format::eR32G32B32Sfloat, offsetof(Data, pos)),
+            vk::VertexInputAttributeDescription(
+                1, 0, vk::Format::eR32G32B32Sfloat, offsetof(Data, color)),
+            vk::VertexInputAttributeDescription(2, 0, vk::Format::eR32Uint,
+                                                offsetof(Data, id))};
+
+    static Data pack(glm::vec3 pos, glm::vec3 color, uint32_t id) {
+        return {pos, color, id};
+    }
+    static glm::vec3 unpackPos(const Data &data) { return data.pos; }
+};
+
+template <> struct BasicVertexLayout<BasicVertexFormat::Compact> {
+    struct Data {
+        uint64_t pos;   // half4, w is always 1.0
+        uint32_t color; // RGBA8 unorm, a is always 1.0
+        uint16_t id;
+        uint16_t padding;
+    };
+
+    static constexpr std::array<vk::VertexInputAttributeDescription, 3>
+        attributeDescriptions = {
+            vk::VertexInputAttributeDescription(
+                0, 0, vk::Format::eR16G16B16A16Sfloat, offsetof(Data, pos)),
+            vk::VertexInputAttributeDescription(
+                1, 0, vk::Format::eR8G8B8A8Unorm, offsetof(Data, color)),
+            vk::VertexInputAttributeDescription(2, 0, vk::Format::eR16Uint,
+                                                offsetof(Data, id))};
+
+    static Data pack(glm::vec3 pos, glm::vec3 color, uint32_t id) {
+        Data data{};
+        data.pos = glm::packHalf4x16(glm::vec4(pos, 1.0));
+        data.color = glm::packUnorm4x8(glm::vec4(color, 1.0));
+        data.id = static_cast<uint16_t>(id);
+        return data;
+    }
+    static glm::vec3 unpackPos(const Data &data) {
+        return glm::vec3(glm::unpackHalf4x16(data.pos));
+    }
+};
+
+/**
+ * @brief Vertex of BasicRenderContent.
+ * Memory layout is selected by Format, and attribute descriptions of the
+ * layout are fixed at compile time. The object only holds packed Data, so
+ * std::vector<BasicVertexOf> can be uploaded as it is.
+ */
+template <BasicVertexFormat Format> class BasicVertexOf : public Vertex {
+  public:
+    typedef BasicVertexLayout<Format> Layout;
+    typedef typename Layout::Data Data;
+
+    Data data;
+
+    BasicVertexOf(glm::vec3 pos, glm::vec3 color, uint32_t id)
+        : data(Layout::pack(pos, color, id)) {}
+
+    glm::vec3 getPos() const { return Layout::unpackPos(data); }
+
+    static vk::VertexInputBindingDescription getBindingDescription() {
+        vk::VertexInputBindingDescription bindingDescription{};
+        bindingDescription.binding = 0;
+        bindingDescription.stride = sizeof(Data);
+        bindingDescription.inputRate = vk::VertexInputRate::eVertex;
+
+        return bindingDescription;
+    }
+
+    static std::vector<vk::VertexInputAttributeDescription>
+    getAttributeDescriptions() {
+        return std::vector<vk::VertexInputAttributeDescription>(
+            Layout::attributeDescriptions.begin(),
+            Layout::attributeDescriptions.end());
+    }
+
+    static const Data *getDataPointer(const std::vector<BasicVertexOf> &v) {
+        static_assert(sizeof(BasicVertexOf) == sizeof(Data),
+                      "BasicVertexOf must consist of Data only.");
+        return reinterpret_cast<const Data *>(v.data());
+    }
+
+    bool operator==(const BasicVertexOf &other) const {
+        return memcmp(&data, &other.data, sizeof(Data)) == 0;
+    }
+};
+
+typedef BasicVertexOf<BasicVertexFormat::Compact> BasicVertex;
+
+// Per-instance attributes of BasicVertex meshes.
+// Final GroupID is (vertex id + instance id), and vertex position is scaled
+// by `scale` before model matrix is applied. `color` is multiplied to vertex
+// color.
+class BasicInstance {
+  public:
+    struct Data {
+        glm::vec3 color;
+        float scale;
+        uint32_t id;
     } data;
 
-    BasicVertex(glm::vec3 pos, glm::vec3 color, uint32_t id) {
-        data.pos = pos;
+    BasicInstance(glm::vec3 color, float scale, uint32_t id) {
         data.color = color;
+        data.scale = scale;
         data.id = id;
     }
-    BasicVertex(const BasicVertex &basicVertex) {
-        Data newData;
-        newData.pos = basicVertex.data.pos;
-        newData.color = basicVertex.data.color;
-        newData.id = basicVertex.data.id;
 
-        data = newData;
+    // instance which keeps vertices as they are
+    static BasicInstance identity() {
+        return BasicInstance(glm::vec3(1.0, 1.0, 1.0), 1.0, 0);
     }
 
     static vk::VertexInputBindingDescription getBindingDescription() {
         vk::VertexInputBindingDescription bindingDescription{};
-        bindingDescription.binding = 0;
-        bindingDescription.stride = sizeof(BasicVertex);
-        bindingDescription.inputRate = vk::VertexInputRate::eVertex;
+        bindingDescription.binding = 1;
+        bindingDescription.stride = sizeof(Data);
+        bindingDescription.inputRate = vk::VertexInputRate::eInstance;
 
         return bindingDescription;
     }
@@ -43,18 +159,18 @@ class BasicVertex : public Vertex {
     getAttributeDescriptions() {
         std::vector<vk::VertexInputAttributeDescription> attributeDescriptions(
             3);
-        attributeDescriptions[0].binding = 0;
-        attributeDescriptions[0].location = 0;
+        attributeDescriptions[0].binding = 1;
+        attributeDescriptions[0].location = 3;
         attributeDescriptions[0].format = vk::Format::eR32G32B32Sfloat;
-        attributeDescriptions[0].offset = offsetof(Data, pos);
+        attributeDescriptions[0].offset = offsetof(Data, color);
 
-        attributeDescriptions[1].binding = 0;
-        attributeDescriptions[1].location = 1;
-        attributeDescriptions[1].format = vk::Format::eR32G32B32Sfloat;
-        attributeDescriptions[1].offset = offsetof(Data, color);
+        attributeDescriptions[1].binding = 1;
+        attributeDescriptions[1].location = 4;
+        attributeDescriptions[1].format = vk::Format::eR32Sfloat;
+        attributeDescriptions[1].offset = offsetof(Data, scale);
 
-        attributeDescriptions[2].binding = 0;
-        attributeDescriptions[2].location = 2;
+        attributeDescriptions[2].binding = 1;
+        attributeDescriptions[2].location = 5;
         attributeDescriptions[2].format = vk::Format::eR32Uint;
         attributeDescriptions[2].offset = offsetof(Data, id);
 
@@ -62,20 +178,24 @@ class BasicVertex : public Vertex {
     }
 
     static std::vector<Data>
-    convertToDataVector(std::vector<BasicVertex> vertices) {
-        std::vector<Data> dataVec(vertices.size());
+    convertToDataVector(const std::vector<BasicInstance> &instances) {
+        std::vector<Data> dataVec(instances.size());
 
-        for (int i = 0; i < vertices.size(); i++) {
-            dataVec[i] = vertices[i].data;
+        for (size_t i = 0; i < instances.size(); i++) {
+            dataVec[i] = instances[i].data;
         }
 
         return dataVec;
     }
+};
 
-    bool operator==(const BasicVertex &other) const {
-        return (data.pos == other.data.pos && data.color == other.data.color &&
-                data.id == other.data.id);
-    }
+// Topology of BasicIndex ranges drawn by a draw command. Lines and points
+// are drawn by pipelines of RenderTarget which share the graphics pipeline
+// layout.
+enum class BasicPrimitiveTopology {
+    Triangles,
+    Lines,
+    Points,
 };
 
 typedef uint32_t Index;
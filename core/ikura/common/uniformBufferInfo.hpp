@@ -1,16 +1,95 @@
 #pragma once
 
+#include <cstdint>
+#include <vector>
+
 #include <glm/glm.hpp>
 
 namespace ikura {
-const int NUM_OF_MODEL_MATRIX = 256;
-
-struct BasicModelMatUBO {
-    alignas(16) glm::mat4 model[NUM_OF_MODEL_MATRIX];
-};
+// capacity of model matrix buffer (storage buffer), indexed by vertex id +
+// instance id
+const int NUM_OF_MODEL_MATRIX = 65536;
+// number of BasicSceneMatUBOs, one per viewport of scene pass
+const int MAX_NUM_OF_VIEWPORTS = 4;
+// capacity of BasicSkeletonInstances per frame
+const int MAX_NUM_OF_SKELETON_INSTANCES = 8192;
+// capacity of LOD levels per frame, selected by BasicCullingGroup::lodSlot
+const int MAX_NUM_OF_LOD_SLOTS = 8192;
+// BasicCullingGroup::lodSlot of groups drawn at any LOD level
+const uint32_t NO_LOD_SLOT = 0xFFFFFFFF;
 
 struct BasicSceneMatUBO {
     alignas(16) glm::mat4 view;
     alignas(16) glm::mat4 proj;
 };
-} // namespace ikura
\ No newline at end of file
+
+// Push constants of grid floor pipeline.
+// Lengths are in model space of model matrix `modelId`.
+struct BasicGridFloorParams {
+    alignas(16) glm::vec4 color;
+    float cellSize;
+    float lineWidth;
+    float halfExtent;
+    float fadeDistance; // in view space
+    uint32_t modelId;
+};
+
+/**
+ * @brief Skeleton and its motion, whose forward kinematics is evaluated on
+ * GPU (see BasicRenderContent::setSkeletons()).
+ *
+ * In each motion frame, joint j is placed at
+ * parent frame * translate(offsets[j]), where root joints also add
+ * rootTranslations[frame] and their parent frame is the transform of the
+ * instance. Model matrix of joint j is (placed frame * meshTransforms[j]),
+ * and children of joint j are placed in
+ * (placed frame * rotation of rotations[frame * numOfJoints + j]).
+ */
+struct BasicSkeleton {
+    // parentIndices[j] < j, or -1 for root joints
+    std::vector<int32_t> parentIndices;
+    std::vector<glm::vec3> offsets;
+    std::vector<glm::mat4> meshTransforms;
+    // quaternions (x, y, z, w), numOfFrames * numOfJoints
+    std::vector<glm::vec4> rotations;
+    // one per motion frame
+    std::vector<glm::vec3> rootTranslations;
+    // seconds per motion frame
+    float frameTime = 1.0f;
+};
+
+// Per-frame input of GPU forward kinematics, one per placed skeleton.
+// Layout matches std430 storage buffer of the compute shader.
+struct BasicSkeletonInstance {
+    // parent frame of root joints, zero matrix hides the instance
+    alignas(16) glm::mat4 transform;
+    // seconds from the first motion frame, clamped into the motion
+    float time;
+    uint32_t skeletonIndex;
+    // model matrix of joint j is written to model matrix (paletteOffset + j)
+    uint32_t paletteOffset;
+    uint32_t padding = 0;
+};
+
+/**
+ * @brief Instances of a draw command culled together on GPU by a bounding
+ * sphere (see BasicRenderContent::setCullingGroups()).
+ *
+ * The sphere is placed by model matrix modelId of the frame, so it follows
+ * model matrices written by CPU or by GPU forward kinematics.
+ * Groups with lodSlot are drawn only while LOD level of the slot, written
+ * every frame by BasicRenderContent::updateLodLevels(), equals lodLevel.
+ */
+struct BasicCullingGroup {
+    // center (xyz) and radius (w) in model space of model matrix modelId
+    glm::vec4 boundingSphere;
+    uint32_t modelId;
+    // instances[firstInstance : firstInstance + numOfInstances] of
+    // drawCommands[drawIndex]
+    uint32_t drawIndex;
+    uint32_t firstInstance;
+    uint32_t numOfInstances;
+    uint32_t lodSlot = NO_LOD_SLOT;
+    uint32_t lodLevel = 0;
+};
+} // namespace ikura
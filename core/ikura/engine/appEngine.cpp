@@ -1,6 +1,7 @@
 #include "./appEngine.hpp"
 
 #include <algorithm>
+#include <future>
 #include <iostream>
 #include <thread>
 
@@ -12,6 +13,7 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include "../shape/shapes.hpp"
+#include "./renderEngine/uploadManager.hpp"
 
 namespace ikura {
 AppEngine::AppEngine(std::shared_ptr<RenderEngine> renderEngine) {
@@ -23,20 +25,24 @@ void AppEngine::addWindow(std::shared_ptr<GlfwNativeWindow> glfwNativeWindow) {
 }
 
 void AppEngine::vSync() {
-    auto rightNow = std::chrono::high_resolution_clock::now();
-
-    // time taken to prev drawing process
-    // currentTime must be updated previous frame
-    auto delta = std::chrono::duration<float, std::chrono::nanoseconds::period>(
-        rightNow - currentTime);
-
-    auto waitTime =
-        std::chrono::duration<float, std::chrono::nanoseconds::period>(
-            std::chrono::nanoseconds(
-                uint32_t(1000.0 * 1000.0 * 1000.0 * 1.0 / fps)) -
-            delta);
-
-    std::this_thread::sleep_for(waitTime);
+    // if not limited, frames are paced only by present mode of SwapChain
+    if (fps > 0.0f) {
+        auto rightNow = std::chrono::high_resolution_clock::now();
+
+        // time taken to prev drawing process
+        // currentTime must be updated previous frame
+        auto delta =
+            std::chrono::duration<float, std::chrono::nanoseconds::period>(
+                rightNow - currentTime);
+
+        auto waitTime =
+            std::chrono::duration<float, std::chrono::nanoseconds::period>(
+                std::chrono::nanoseconds(
+                    uint32_t(1000.0 * 1000.0 * 1000.0 * 1.0 / fps)) -
+                delta);
+
+        std::this_thread::sleep_for(waitTime);
+    }
 
     // update deltaTime for main-loop use
     deltaTime = std::chrono::duration<float, std::chrono::seconds::period>(
@@ -58,6 +64,14 @@ float AppEngine::getSecondsFromStart() const { return secondsFromStart; }
 
 float AppEngine::getDeltaTime() const { return deltaTime; }
 
+/**
+ * @brief Sets target frame rate of vSync(). 0 disables limiting, e.g. to
+ * let MAILBOX / IMMEDIATE present modes run as fast as possible.
+ */
+void AppEngine::setFps(float fps) { this->fps = std::max(fps, 0.0f); }
+
+float AppEngine::getFps() const { return fps; }
+
 int AppEngine::shouldTerminated() {
     return std::all_of(nativeWindows.begin(), nativeWindows.end(),
                        [&](const std::shared_ptr<NativeWindow> window) {
@@ -75,9 +89,47 @@ void AppEngine::drawAllWindows() {
         }
     }
 
+    // Submit uploads queued since last frame, and retire completed ones
+    renderEngine->getUploadManager().submit();
+    renderEngine->getUploadManager().poll();
+
+    // Acquire ----------
+    std::vector<NativeWindow *> frameWindows;
     for (auto &window : nativeWindows) {
-        window->draw();
+        if (window->acquireFrame()) {
+            frameWindows.push_back(window.get());
+        }
     }
+    if (frameWindows.empty()) {
+        return;
+    }
+
+    // Record ----------
+    // Scene commands are the costly part, and each window records them into
+    // CommandBuffers of its own CommandPool, so windows are recorded in
+    // parallel. Primary CommandBuffers are recorded afterwards on this
+    // thread, since ImGui is not thread safe.
+    std::vector<std::future<void>> recordings;
+    for (size_t i = 1; i < frameWindows.size(); i++) {
+        auto window = frameWindows[i];
+        recordings.push_back(std::async(std::launch::async, [window]() {
+            window->prepareSceneCommands(window->getCurrentFrameIndex());
+        }));
+    }
+    frameWindows[0]->prepareSceneCommands(
+        frameWindows[0]->getCurrentFrameIndex());
+    for (auto &recording : recordings) {
+        recording.get();
+    }
+
+    for (auto &window : frameWindows) {
+        window->recordFrameCommands();
+    }
+
+    // Submit / Present ----------
+    // one vkQueueSubmit and one vkQueuePresentKHR for all windows
+    NativeWindow::submitFrames(renderEngine, frameWindows);
+    NativeWindow::presentFrames(renderEngine, frameWindows);
 }
 
 void AppEngine::destroyClosedWindow() {
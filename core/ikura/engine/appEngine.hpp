@@ -16,6 +16,7 @@ class AppEngine {
     std::shared_ptr<RenderEngine> renderEngine;
     std::vector<std::shared_ptr<NativeWindow>> nativeWindows;
 
+    // target frame rate of vSync(), not limited if 0
     float fps = 60.0;
     std::chrono::high_resolution_clock::time_point startTime;
     std::chrono::high_resolution_clock::time_point currentTime;
@@ -32,6 +33,8 @@ class AppEngine {
     void setStartTime();
     float getSecondsFromStart() const;
     float getDeltaTime() const;
+    void setFps(float fps);
+    float getFps() const;
 
     int shouldTerminated();
     void drawAllWindows();
@@ -9,6 +9,7 @@
 #include <vk_mem_alloc.h>
 
 #include "../../common/logLevels.hpp"
+#include "./uploadManager.hpp"
 
 namespace ikura {
 struct PhysicalDeviceEvaluation {
@@ -16,10 +17,12 @@ struct PhysicalDeviceEvaluation {
     bool isQueueFamiliesCompleted;
     bool isAllExtensionsSupported;
     bool isSwapChainAdequate;
+    // frames are paced by timeline semaphore (see RenderEngine)
+    bool isTimelineSemaphoreSupported;
 
     bool isSuitable() const {
         return isAllExtensionsSupported && isQueueFamiliesCompleted &&
-               isSwapChainAdequate;
+               isSwapChainAdequate && isTimelineSemaphoreSupported;
     }
 
     bool operator<(const PhysicalDeviceEvaluation &right) const {
@@ -34,6 +37,7 @@ void EvaluateDeviceExtensionSupport(std::vector<const char *> extensionNames,
 void EvaluateSurfaceSupport(vk::SurfaceKHR sampleSurface,
                             vk::PhysicalDevice device,
                             PhysicalDeviceEvaluation &eval);
+vk::SampleCountFlags GetSupportedMsaaSamples(vk::PhysicalDevice device);
 vk::SampleCountFlagBits GetMaxMsaaSamples(vk::PhysicalDevice device);
 QueueFamilyIndices FindQueueFamilies(vk::PhysicalDevice device,
                                      vk::SurfaceKHR sampleSurface);
@@ -85,9 +89,16 @@ void RenderEngine::createDevice() {
     // PhysicalDevice Feature ----------
     vk::PhysicalDeviceFeatures deviceFeatures{};
     deviceFeatures.samplerAnisotropy = VK_TRUE;
+    // point sprites of low detail meshes are larger than 1 pixel if supported
+    deviceFeatures.largePoints = physicalDevice.getFeatures().largePoints;
 
     deviceCI.pEnabledFeatures = &deviceFeatures;
 
+    vk::PhysicalDeviceVulkan12Features vulkan12Features{};
+    vulkan12Features.timelineSemaphore = VK_TRUE;
+
+    deviceCI.pNext = &vulkan12Features;
+
     // Layers / Extensions ----------
     // NOTE: DeviceLayer is now deprecated, but for capabilities
     deviceCI.ppEnabledExtensionNames = deviceExtensionNames.data();
@@ -105,9 +116,41 @@ void RenderEngine::createDevice() {
         queueFamilyIndices.get(QueueFamilyIndices::GRAPHICS), 0);
     queues.presentQueue =
         device.getQueue(queueFamilyIndices.get(QueueFamilyIndices::PRESENT), 0);
+    if (queueFamilyIndices.has(QueueFamilyIndices::TRANSFER)) {
+        queues.transferQueue = device.getQueue(
+            queueFamilyIndices.get(QueueFamilyIndices::TRANSFER), 0);
+        VLOG(VLOG_LV_3_PROCESS_TRACKING) << "Dedicated transfer queue is used.";
+    } else {
+        queues.transferQueue = queues.graphicsQueue;
+    }
 
     // set RenderEngineInfo
     engineInfo.limit.maxMsaaSamples = GetMaxMsaaSamples(physicalDevice);
+    engineInfo.limit.supportedMsaaSamples =
+        GetSupportedMsaaSamples(physicalDevice);
+    engineInfo.limit.minUniformBufferOffsetAlignment =
+        physicalDevice.getProperties().limits.minUniformBufferOffsetAlignment;
+    engineInfo.limit.minStorageBufferOffsetAlignment =
+        physicalDevice.getProperties().limits.minStorageBufferOffsetAlignment;
+    engineInfo.limit.timestampPeriod =
+        physicalDevice.getProperties().limits.timestampPeriod;
+    engineInfo.limit.maxPointSize =
+        deviceFeatures.largePoints
+            ? physicalDevice.getProperties().limits.pointSizeRange[1]
+            : 1.0f;
+    engineInfo.support.isTimestampSupported =
+        physicalDevice.getProperties().limits.timestampComputeAndGraphics &&
+        physicalDevice.getQueueFamilyProperties()
+                .at(queueFamilyIndices.get(QueueFamilyIndices::GRAPHICS))
+                .timestampValidBits > 0;
+    engineInfo.support.isLazilyAllocatedMemorySupported = false;
+    for (const auto &memoryType :
+         physicalDevice.getMemoryProperties().memoryTypes) {
+        if (memoryType.propertyFlags &
+            vk::MemoryPropertyFlagBits::eLazilyAllocated) {
+            engineInfo.support.isLazilyAllocatedMemorySupported = true;
+        }
+    }
 
     // Initialize Vulkan Memory Allocator
     VmaAllocatorCreateInfo allocatorCI{};
@@ -137,6 +180,22 @@ void RenderEngine::createDevice() {
     cmdPool = device.createCommandPool(cmdPoolCI, nullptr);
     VLOG(VLOG_LV_3_PROCESS_TRACKING) << "CommandPool has been created.";
 
+    // Create frame timeline
+    vk::SemaphoreTypeCreateInfo semaphoreTypeCI{};
+    semaphoreTypeCI.semaphoreType = vk::SemaphoreType::eTimeline;
+    semaphoreTypeCI.initialValue = 0;
+    vk::SemaphoreCreateInfo semaphoreCI{};
+    semaphoreCI.pNext = &semaphoreTypeCI;
+
+    frameTimeline = device.createSemaphore(semaphoreCI);
+    VLOG(VLOG_LV_3_PROCESS_TRACKING) << "Frame timeline has been created.";
+
+    // Create PipelineCache
+    createPipelineCache();
+
+    // Create UploadManager
+    uploadManager = std::make_unique<UploadManager>(this);
+
     VLOG(VLOG_LV_3_PROCESS_TRACKING) << "Vulkan Device has been created.";
 }
 
@@ -174,6 +233,12 @@ vk::PhysicalDevice RenderEngine::getSuitablePhysicalDeviceInfo(
                                        eval);
         EvaluateSurfaceSupport(pEngine->sampleSurface, dev, eval);
 
+        auto features = dev.getFeatures2<vk::PhysicalDeviceFeatures2,
+                                         vk::PhysicalDeviceVulkan12Features>();
+        eval.isTimelineSemaphoreSupported =
+            features.get<vk::PhysicalDeviceVulkan12Features>()
+                .timelineSemaphore;
+
         if (!eval.isSuitable()) {
             eval.score = -1;
         }
@@ -202,13 +267,21 @@ QueueFamilyIndices FindQueueFamilies(vk::PhysicalDevice device,
     uint32_t index = 0;
     for (const auto &prop : families) {
         // graphic family
-        if (prop.queueFlags & vk::QueueFlagBits::eGraphics) {
+        // also runs compute passes recorded before scene RenderPass
+        if ((prop.queueFlags & vk::QueueFlagBits::eGraphics) &&
+            (prop.queueFlags & vk::QueueFlagBits::eCompute)) {
             result.set(QueueFamilyIndices::GRAPHICS, index);
         }
 
         // present family
+        // without surface (headless), nothing is presented and graphics
+        // family stands in for it
         vk::Bool32 presentSupport = VK_FALSE;
-        presentSupport = device.getSurfaceSupportKHR(index, sampleSurface);
+        if (sampleSurface) {
+            presentSupport = device.getSurfaceSupportKHR(index, sampleSurface);
+        } else {
+            presentSupport = result.has(QueueFamilyIndices::GRAPHICS);
+        }
         if (presentSupport) {
             result.set(QueueFamilyIndices::PRESENT, index);
         }
@@ -218,6 +291,24 @@ QueueFamilyIndices FindQueueFamilies(vk::PhysicalDevice device,
         index++;
     }
 
+    // dedicated transfer family (transfer capable, but not graphics)
+    // prefer transfer-only family over async compute family
+    std::optional<uint32_t> transferFamily;
+    for (uint32_t i = 0; i < families.size(); i++) {
+        const auto flags = families[i].queueFlags;
+        if (!(flags & vk::QueueFlagBits::eTransfer) ||
+            (flags & vk::QueueFlagBits::eGraphics)) {
+            continue;
+        }
+        if (!transferFamily.has_value() ||
+            !(flags & vk::QueueFlagBits::eCompute)) {
+            transferFamily = i;
+        }
+    }
+    if (transferFamily.has_value()) {
+        result.set(QueueFamilyIndices::TRANSFER, transferFamily.value());
+    }
+
     return result;
 }
 
@@ -287,24 +378,44 @@ void EvaluateDeviceExtensionSupport(std::vector<const char *> extensionNames,
  * @brief Evaluates surface support.
  * If givin surface (i.e. PhysicalDevice) has NO available formats and
  * presentModes, eval.isSwapChainAdequate will be false.
+ * Without surface, it is always adequate.
  */
 void EvaluateSurfaceSupport(vk::SurfaceKHR sampleSurface,
                             vk::PhysicalDevice device,
                             PhysicalDeviceEvaluation &eval) {
+    // headless: SwapChain is never created
+    if (!sampleSurface) {
+        eval.isSwapChainAdequate = true;
+        return;
+    }
+
     auto formats = device.getSurfaceFormatsKHR(sampleSurface);
     auto presentModes = device.getSurfacePresentModesKHR(sampleSurface);
 
     eval.isSwapChainAdequate = (!formats.empty() && !presentModes.empty());
 }
 
+/**
+ * @brief Returns MSAA sample counts supported by color, depth and integer
+ * color (id image) attachments of the scene pass.
+ */
+vk::SampleCountFlags GetSupportedMsaaSamples(vk::PhysicalDevice device) {
+    auto props = device.getProperties2<vk::PhysicalDeviceProperties2,
+                                       vk::PhysicalDeviceVulkan12Properties>();
+    const auto &limits = props.get<vk::PhysicalDeviceProperties2>()
+                             .properties.limits;
+
+    return limits.framebufferColorSampleCounts &
+           limits.framebufferDepthSampleCounts &
+           props.get<vk::PhysicalDeviceVulkan12Properties>()
+               .framebufferIntegerColorSampleCounts;
+}
+
 /**
  * @brief Returns max MSAA samples
  */
 vk::SampleCountFlagBits GetMaxMsaaSamples(vk::PhysicalDevice device) {
-    auto props = device.getProperties();
-
-    vk::SampleCountFlags counts = (props.limits.framebufferColorSampleCounts &
-                                   props.limits.framebufferDepthSampleCounts);
+    vk::SampleCountFlags counts = GetSupportedMsaaSamples(device);
 
     if (counts & vk::SampleCountFlagBits::e64)
         return vk::SampleCountFlagBits::e64;
@@ -38,7 +38,7 @@ void RenderEngine::createInstance() {
     layerNames = initConfig.layerNames;
     instanceExtensionNames = initConfig.instanceExtensionNames;
     // for GLFW
-    {
+    if (initConfig.isGlfwEnabled) {
         auto glfwReqExts = getGlfwRequiredExtensions();
         std::for_each(
             glfwReqExts.begin(), glfwReqExts.end(), [&](const char *ext) {
@@ -77,9 +77,12 @@ void RenderEngine::createInstance() {
     checkInstanceExtensionsSupport(instanceExtensionNames);
     // Glfw
     // terminate program when GlfwNativeWindow creation is requested.
-    engineInfo.support.isGlfwSupported = (glfwVulkanSupported() == GLFW_TRUE);
+    engineInfo.support.isGlfwSupported =
+        initConfig.isGlfwEnabled && (glfwVulkanSupported() == GLFW_TRUE);
     if (engineInfo.support.isGlfwSupported) {
         LOG(INFO) << "Glfw is supported.";
+    } else if (!initConfig.isGlfwEnabled) {
+        LOG(INFO) << "Glfw is disabled by RenderEngineInitConfig.";
     } else {
         LOG(WARNING) << "Glfw is NOT supported.";
     }
@@ -0,0 +1,115 @@
+#include "./renderEngine.hpp"
+
+#include <cstring>
+#include <fstream>
+
+#include <easylogging++.h>
+
+#include "../../common/logLevels.hpp"
+#include "../../util/fileUtils.hpp"
+
+namespace ikura {
+namespace {
+// Header written at the beginning of pipeline cache data by the driver
+// (VkPipelineCacheHeaderVersionOne).
+struct PipelineCacheHeader {
+    uint32_t headerSize;
+    uint32_t headerVersion;
+    uint32_t vendorID;
+    uint32_t deviceID;
+    uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+};
+
+/**
+ * @brief Checks cache data was created by the same device and driver.
+ * Some drivers do not validate passed data, so invalid data is dropped here.
+ */
+bool isPipelineCacheCompatible(const std::vector<char> &data,
+                               const vk::PhysicalDeviceProperties &props) {
+    if (data.size() < sizeof(PipelineCacheHeader)) {
+        return false;
+    }
+
+    PipelineCacheHeader header;
+    memcpy(&header, data.data(), sizeof(header));
+
+    return header.headerSize >= sizeof(PipelineCacheHeader) &&
+           header.headerVersion ==
+               static_cast<uint32_t>(
+                   vk::PipelineCacheHeaderVersion::eOne) &&
+           header.vendorID == props.vendorID &&
+           header.deviceID == props.deviceID &&
+           memcmp(header.pipelineCacheUUID, props.pipelineCacheUUID.data(),
+                  VK_UUID_SIZE) == 0;
+}
+} // namespace
+
+/**
+ * @brief Creates PipelineCache, with initial data loaded from
+ * initConfig.pipelineCacheFilePath if it exists and is compatible.
+ */
+void RenderEngine::createPipelineCache() {
+    std::vector<char> initialData;
+
+    if (!initConfig.pipelineCacheFilePath.empty()) {
+        std::ifstream file(initConfig.pipelineCacheFilePath,
+                           std::ios::binary | std::ios::ate);
+        if (file.is_open()) {
+            initialData.resize(static_cast<size_t>(file.tellg()));
+            file.seekg(0);
+            file.read(initialData.data(), initialData.size());
+            if (!file) {
+                initialData.clear();
+            }
+        }
+
+        if (!initialData.empty() &&
+            !isPipelineCacheCompatible(initialData,
+                                       physicalDevice.getProperties())) {
+            VLOG(VLOG_LV_3_PROCESS_TRACKING)
+                << "Pipeline cache file is not compatible with current "
+                   "device. It is ignored.";
+            initialData.clear();
+        }
+    }
+
+    vk::PipelineCacheCreateInfo pipelineCacheCI{};
+    pipelineCacheCI.initialDataSize = initialData.size();
+    pipelineCacheCI.pInitialData = initialData.data();
+
+    pipelineCache = device.createPipelineCache(pipelineCacheCI);
+
+    VLOG(VLOG_LV_3_PROCESS_TRACKING)
+        << "PipelineCache has been created (" << initialData.size()
+        << " bytes loaded).";
+}
+
+/**
+ * @brief Writes PipelineCache data to initConfig.pipelineCacheFilePath.
+ * Failure is not fatal, pipelines are just compiled again on next run.
+ */
+void RenderEngine::savePipelineCache() {
+    if (initConfig.pipelineCacheFilePath.empty() || !pipelineCache) {
+        return;
+    }
+
+    auto data = device.getPipelineCacheData(pipelineCache);
+
+    auto filePath = initConfig.pipelineCacheFilePath;
+    std::error_code ec;
+    std::filesystem::create_directories(filePath.parent_path(), ec);
+
+    if (!writeFileAtomically(filePath, data.data(), data.size())) {
+        VLOG(VLOG_LV_3_PROCESS_TRACKING)
+            << "Failed to write pipeline cache: " << filePath;
+        return;
+    }
+
+    VLOG(VLOG_LV_3_PROCESS_TRACKING)
+        << "PipelineCache has been saved (" << data.size() << " bytes).";
+}
+
+const vk::PipelineCache RenderEngine::getPipelineCache() const {
+    return pipelineCache;
+}
+} // namespace ikura
@@ -5,6 +5,7 @@
 #include <easylogging++.h>
 
 #include "../../common/logLevels.hpp"
+#include "./uploadManager.hpp"
 
 #define VMA_IMPLEMENTATION
 // for compability
@@ -29,6 +30,11 @@ uint32_t QueueFamilyIndices::get(const QueueIndexKey key) const {
     return indices.at(key).value();
 }
 
+bool QueueFamilyIndices::has(const QueueIndexKey key) const {
+    auto iter = indices.find(key);
+    return iter != indices.end() && iter->second.has_value();
+}
+
 void QueueFamilyIndices::set(QueueIndexKey key, uint32_t value) {
     indices.insert_or_assign(key, value);
 }
@@ -56,8 +62,10 @@ bool QueueFamilyIndices::isShareingIndexBetweenGraphicsAndPresent() const {
 }
 
 RenderEngine::RenderEngine(RenderEngineInitConfig initConfig) {
-    glfwInit();
-    VLOG(VLOG_LV_3_PROCESS_TRACKING) << "Initialized GLFW.";
+    if (initConfig.isGlfwEnabled) {
+        glfwInit();
+        VLOG(VLOG_LV_3_PROCESS_TRACKING) << "Initialized GLFW.";
+    }
     initDispatchLoader();
     VLOG(VLOG_LV_3_PROCESS_TRACKING)
         << "Initialized Vulkan Hpp Dispatch Loader.";
@@ -67,10 +75,27 @@ RenderEngine::RenderEngine(RenderEngineInitConfig initConfig) {
 }
 
 RenderEngine::~RenderEngine() {
+    VLOG(VLOG_LV_3_PROCESS_TRACKING) << "Destroying deferred resources...";
+    device.waitIdle();
+    flushDeferredDestructions();
+    VLOG(VLOG_LV_3_PROCESS_TRACKING)
+        << "Deferred resources have been destroyed.";
+
+    VLOG(VLOG_LV_3_PROCESS_TRACKING) << "Destroying UploadManager...";
+    uploadManager.reset();
+    VLOG(VLOG_LV_3_PROCESS_TRACKING) << "UploadManager has been destroyed.";
+
+    VLOG(VLOG_LV_3_PROCESS_TRACKING) << "Destroying PipelineCache...";
+    savePipelineCache();
+    device.destroyPipelineCache(pipelineCache);
+    VLOG(VLOG_LV_3_PROCESS_TRACKING) << "PipelineCache has been destroyed.";
+
     VLOG(VLOG_LV_3_PROCESS_TRACKING) << "Destroying CommandPool...";
     device.destroyCommandPool(cmdPool);
     VLOG(VLOG_LV_3_PROCESS_TRACKING) << "CommandPool has been destroyed.";
 
+    device.destroySemaphore(frameTimeline);
+
     VLOG(VLOG_LV_3_PROCESS_TRACKING) << "Destroying VmaAllocator...";
     vmaDestroyAllocator(*vmaAllocator);
     VLOG(VLOG_LV_3_PROCESS_TRACKING) << "VmaAllocator has been Destroyed.";
@@ -88,8 +113,10 @@ RenderEngine::~RenderEngine() {
     instance.destroy();
     VLOG(VLOG_LV_3_PROCESS_TRACKING) << "Vulkan Instance has been destroyed.";
 
-    glfwTerminate();
-    VLOG(VLOG_LV_3_PROCESS_TRACKING) << "Terminated GLFW.";
+    if (initConfig.isGlfwEnabled) {
+        glfwTerminate();
+        VLOG(VLOG_LV_3_PROCESS_TRACKING) << "Terminated GLFW.";
+    }
 }
 
 vk::CommandBuffer RenderEngine::beginSingleTimeCommands() {
@@ -126,6 +153,100 @@ void RenderEngine::endSingleTimeCommands(vk::CommandBuffer cmdBuffer) {
     device.freeCommandBuffers(cmdPool, cmdBuffer);
 }
 
+/**
+ * @brief Submits frame commands to graphics queue and issues its frame serial.
+ * An extra batch signalling frame timeline with the serial is appended, and
+ * since the signal waits for all commands submitted before it, the serial
+ * completes only after every earlier frame has completed.
+ *
+ * @return frame serial of this submission, monotonically increasing
+ */
+uint64_t
+RenderEngine::submitFrame(const std::vector<vk::SubmitInfo> &submitInfos) {
+    uint64_t frameSerial = ++lastFrameSerial;
+
+    vk::TimelineSemaphoreSubmitInfo timelineSubmitInfo{};
+    timelineSubmitInfo.setSignalSemaphoreValues(frameSerial);
+
+    vk::SubmitInfo timelineSignalInfo{};
+    timelineSignalInfo.pNext = &timelineSubmitInfo;
+    timelineSignalInfo.setSignalSemaphores(frameTimeline);
+
+    auto batches = submitInfos;
+    batches.push_back(timelineSignalInfo);
+    queues.graphicsQueue.submit(batches);
+
+    return frameSerial;
+}
+
+/**
+ * @brief Returns the serial of the last submitted frame.
+ */
+uint64_t RenderEngine::getLastFrameSerial() const { return lastFrameSerial; }
+
+/**
+ * @brief Returns the serial of the last completed frame without blocking.
+ */
+uint64_t RenderEngine::getCompletedFrameSerial() const {
+    return device.getSemaphoreCounterValue(frameTimeline);
+}
+
+bool RenderEngine::isFrameCompleted(uint64_t frameSerial) const {
+    return frameSerial <= getCompletedFrameSerial();
+}
+
+/**
+ * @brief Blocks until the frame of frameSerial completes, and destroys
+ * deferred resources which are no longer referenced by GPU.
+ * Serial 0 (never submitted) returns immediately.
+ */
+void RenderEngine::waitForFrame(uint64_t frameSerial) {
+    if (frameSerial != 0) {
+        vk::SemaphoreWaitInfo waitInfo{};
+        waitInfo.setSemaphores(frameTimeline);
+        waitInfo.setValues(frameSerial);
+
+        auto result = device.waitSemaphores(waitInfo, UINT64_MAX);
+        if (result != vk::Result::eSuccess) {
+            throw std::runtime_error(
+                "Error occurred while waiting frame timeline.");
+        }
+    }
+
+    retireCompletedFrames();
+}
+
+/**
+ * @brief Destroys deferred resources whose frames have completed.
+ */
+void RenderEngine::retireCompletedFrames() {
+    uint64_t completedFrameSerial = getCompletedFrameSerial();
+    while (!destructionQueue.empty() &&
+           destructionQueue.front().frameSerial <= completedFrameSerial) {
+        destructionQueue.front().destroy();
+        destructionQueue.pop_front();
+    }
+}
+
+/**
+ * @brief Requests destruction of resource which may be used by frames in
+ * flight. `destroy` is called once all frames submitted so far have completed.
+ */
+void RenderEngine::deferDestruction(std::function<void()> destroy) {
+    destructionQueue.push_back({lastFrameSerial, destroy});
+}
+
+/**
+ * @brief Destroys all deferred resources immediately.
+ * Device must be idle.
+ */
+void RenderEngine::flushDeferredDestructions() {
+    for (auto &destruction : destructionQueue) {
+        destruction.destroy();
+    }
+    destructionQueue.clear();
+}
+
 const vk::Instance RenderEngine::getInstance() const { return instance; }
 
 const vk::PhysicalDevice RenderEngine::getPhysicalDevice() const {
@@ -150,6 +271,10 @@ const vk::CommandPool RenderEngine::getCommandPool() const { return cmdPool; }
 
 const RenderEngine::Queues &RenderEngine::getQueues() const { return queues; }
 
+UploadManager &RenderEngine::getUploadManager() const {
+    return *uploadManager;
+}
+
 void RenderEngine::setSampleSurface(vk::SurfaceKHR surface) {
     this->sampleSurface = surface;
 }
@@ -179,6 +304,28 @@ RenderEngineInitConfig RenderEngineInitConfig::defaultDebugSetting() {
     return initConfig;
 }
 
+/**
+ * @brief Setting for rendering without any window system.
+ * Neither surface nor SwapChain extensions are requested, so that the device
+ * can be created without setSampleSurface().
+ */
+RenderEngineInitConfig RenderEngineInitConfig::defaultHeadlessSetting() {
+    RenderEngineInitConfig initConfig = defaultCommonSetting();
+    initConfig.isGlfwEnabled = false;
+
+#if defined(IKURA_ENABLE_VALIDATION_LAYER)
+    initConfig.layerNames.push_back(VALIDATION_LAYER_NAME);
+    initConfig.instanceExtensionNames.push_back(
+        VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
+#endif
+#if defined(__APPLE__)
+    initConfig.instanceExtensionNames.push_back("VK_KHR_portability_enumeration");
+    initConfig.deviceExtensionNames.push_back("VK_KHR_portability_subset");
+#endif
+
+    return initConfig;
+}
+
 RenderEngineInitConfig RenderEngineInitConfig::defaultCommonSetting() {
     RenderEngineInitConfig initConfig;
     initConfig.applicationName = "Ikura Application";
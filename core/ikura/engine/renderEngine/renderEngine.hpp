@@ -1,5 +1,7 @@
 #pragma once
 
+#include <deque>
+#include <filesystem>
 #include <functional>
 #include <iostream>
 #include <map>
@@ -24,14 +26,32 @@ namespace ikura {
 // Forward Declearration ----------
 class RenderEngine;
 class RenderTarget;
+class UploadManager;
+
+// Identifies the batch an upload belongs to (see UploadManager).
+// Tickets increase monotonically, and batches complete in ticket order.
+typedef uint64_t UploadTicket;
 
 struct RenderEngineInfo {
     struct SupportInfo {
         bool isGlfwSupported;
+        // timestamp queries on graphics queue
+        bool isTimestampSupported;
+        // memory type for transient attachments
+        bool isLazilyAllocatedMemorySupported;
     } support;
 
     struct LimitInfo {
         vk::SampleCountFlagBits maxMsaaSamples;
+        // sample counts supported by color, depth and integer color
+        // attachments
+        vk::SampleCountFlags supportedMsaaSamples;
+        vk::DeviceSize minUniformBufferOffsetAlignment;
+        vk::DeviceSize minStorageBufferOffsetAlignment;
+        // nanoseconds per timestamp tick
+        float timestampPeriod;
+        // in pixels, 1.0 unless largePoints feature is supported
+        float maxPointSize;
     } limit;
 };
 
@@ -42,10 +62,13 @@ class QueueFamilyIndices {
   public:
     static const QueueIndexKey GRAPHICS = 0;
     static const QueueIndexKey PRESENT = 1;
+    // optional: set only if dedicated transfer queue family exists
+    static const QueueIndexKey TRANSFER = 2;
 
     QueueFamilyIndices();
 
     uint32_t get(const QueueIndexKey key) const;
+    bool has(const QueueIndexKey key) const;
     void set(QueueIndexKey key, uint32_t value);
 
     std::set<uint32_t> generateUniqueSet();
@@ -69,6 +92,16 @@ struct RenderEngineInitConfig {
     std::vector<const char *> instanceExtensionNames;
     std::vector<const char *> deviceExtensionNames;
 
+    // Pipeline cache ----------
+    // PipelineCache is loaded from / saved to this file.
+    // If empty, PipelineCache is not persisted.
+    std::filesystem::path pipelineCacheFilePath;
+
+    // Window system ----------
+    // If false, GLFW is not initialized and its instance extensions are not
+    // requested. Only OffscreenWindow is available in this case.
+    bool isGlfwEnabled = true;
+
     // callbacks ----------
     std::function<vk::PhysicalDevice(const RenderEngine *,
                                      std::vector<vk::PhysicalDevice>)>
@@ -76,6 +109,7 @@ struct RenderEngineInitConfig {
 
     // Template providers ----------
     static RenderEngineInitConfig defaultDebugSetting();
+    static RenderEngineInitConfig defaultHeadlessSetting();
 
   private:
     static RenderEngineInitConfig defaultCommonSetting();
@@ -90,9 +124,13 @@ class RenderEngine {
     struct Queues {
         vk::Queue graphicsQueue;
         vk::Queue presentQueue;
+        // same as graphicsQueue if dedicated transfer queue is not available
+        vk::Queue transferQueue;
     } queues;
     QueueFamilyIndices queueFamilyIndices;
     vk::CommandPool cmdPool;
+    vk::PipelineCache pipelineCache;
+    std::unique_ptr<UploadManager> uploadManager;
 
     // Layer / Extension ----------
     std::vector<const char *> layerNames;
@@ -109,7 +147,26 @@ class RenderEngine {
     vk::SurfaceKHR sampleSurface; // for PhysicalDevice suitability evaluation
     std::shared_ptr<VmaAllocator> vmaAllocator;
 
+    // Frame timeline ----------
+    // Timeline semaphore of graphics queue. Every frame submission signals it
+    // with its frame serial, so its value is the serial of the last completed
+    // frame.
+    vk::Semaphore frameTimeline;
+    uint64_t lastFrameSerial = 0;
+
+    // Deferred destruction ----------
+    struct DeferredDestruction {
+        // last frame serial issued when destruction was requested
+        uint64_t frameSerial;
+        std::function<void()> destroy;
+    };
+    std::deque<DeferredDestruction> destructionQueue;
+
     // Functions ==========
+    // Pipeline cache ----------
+    void createPipelineCache();
+    void savePipelineCache();
+
     // Destruction ----------
     void destroyExtensions();
 
@@ -131,6 +188,18 @@ class RenderEngine {
     vk::CommandBuffer beginSingleTimeCommands();
     void endSingleTimeCommands(vk::CommandBuffer commandBuffer);
 
+    // Frame timeline ----------
+    uint64_t submitFrame(const std::vector<vk::SubmitInfo> &submitInfos);
+    uint64_t getLastFrameSerial() const;
+    uint64_t getCompletedFrameSerial() const;
+    bool isFrameCompleted(uint64_t frameSerial) const;
+    void waitForFrame(uint64_t frameSerial);
+
+    // Deferred destruction ----------
+    void retireCompletedFrames();
+    void deferDestruction(std::function<void()> destroy);
+    void flushDeferredDestructions();
+
     // Getter ----------
     const vk::Instance getInstance() const;
     const vk::PhysicalDevice getPhysicalDevice() const;
@@ -139,7 +208,9 @@ class RenderEngine {
     const QueueFamilyIndices getQueueFamilyIndices() const;
     const std::shared_ptr<VmaAllocator> getVmaAllocator() const;
     const vk::CommandPool getCommandPool() const;
+    const vk::PipelineCache getPipelineCache() const;
     const Queues &getQueues() const;
+    UploadManager &getUploadManager() const;
 
     // Setter ----------
     void setSampleSurface(vk::SurfaceKHR surface);
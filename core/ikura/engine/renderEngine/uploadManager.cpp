@@ -0,0 +1,350 @@
+#include "./uploadManager.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include <easylogging++.h>
+
+#include "../../common/logLevels.hpp"
+
+namespace ikura {
+UploadManager::UploadManager(RenderEngine *renderEngine) {
+    VLOG(VLOG_LV_3_PROCESS_TRACKING) << "Creating UploadManager...";
+
+    this->renderEngine = renderEngine;
+    auto device = renderEngine->getDevice();
+    auto queueFamilyIndices = renderEngine->getQueueFamilyIndices();
+
+    // CommandPool for transfer queue ----------
+    vk::CommandPoolCreateInfo cmdPoolCI{};
+    cmdPoolCI.flags = vk::CommandPoolCreateFlagBits::eTransient |
+                      vk::CommandPoolCreateFlagBits::eResetCommandBuffer;
+    cmdPoolCI.queueFamilyIndex =
+        queueFamilyIndices.has(QueueFamilyIndices::TRANSFER)
+            ? queueFamilyIndices.get(QueueFamilyIndices::TRANSFER)
+            : queueFamilyIndices.get(QueueFamilyIndices::GRAPHICS);
+
+    cmdPool = device.createCommandPool(cmdPoolCI);
+
+    // Upload timeline ----------
+    vk::SemaphoreTypeCreateInfo semaphoreTypeCI{};
+    semaphoreTypeCI.semaphoreType = vk::SemaphoreType::eTimeline;
+    semaphoreTypeCI.initialValue = 0;
+    vk::SemaphoreCreateInfo semaphoreCI{};
+    semaphoreCI.pNext = &semaphoreTypeCI;
+
+    uploadTimeline = device.createSemaphore(semaphoreCI);
+
+    // Staging ring ----------
+    vk::BufferCreateInfo stagingBufferCI{};
+    stagingBufferCI.size = STAGING_RING_SIZE;
+    stagingBufferCI.usage = vk::BufferUsageFlagBits::eTransferSrc;
+    stagingBufferCI.sharingMode = vk::SharingMode::eExclusive;
+
+    VmaAllocationCreateInfo allocCI{};
+    allocCI.usage = VMA_MEMORY_USAGE_AUTO_PREFER_HOST;
+    allocCI.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT |
+                    VMA_ALLOCATION_CREATE_MAPPED_BIT;
+    VmaAllocationInfo allocInfo{};
+
+    auto vkBufferCI = (VkBufferCreateInfo)stagingBufferCI;
+    VkBuffer vkBuffer;
+    auto result = vmaCreateBuffer(*renderEngine->getVmaAllocator(),
+                                  &vkBufferCI, &allocCI, &vkBuffer,
+                                  &stagingBufferResource.alloc, &allocInfo);
+    if (result != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create staging ring buffer.");
+    }
+    stagingBufferResource.buffer = (vk::Buffer)vkBuffer;
+    stagingMappedData = static_cast<uint8_t *>(allocInfo.pMappedData);
+
+    VLOG(VLOG_LV_3_PROCESS_TRACKING) << "UploadManager has been created.";
+}
+
+UploadManager::~UploadManager() {
+    auto device = renderEngine->getDevice();
+
+    // recording batch is discarded, in-flight batches are waited
+    if (recordingBatch.has_value()) {
+        recordingBatch->cmdBuffer.end();
+        // never submitted, so staging buffers are not used by GPU
+        for (auto &staging : recordingBatch->dedicatedStagingBuffers) {
+            staging.release(*renderEngine->getVmaAllocator());
+        }
+        recordingBatch->dedicatedStagingBuffers.clear();
+        freeBatches.push_back(std::move(recordingBatch.value()));
+        recordingBatch.reset();
+    }
+    while (!inFlightBatches.empty()) {
+        waitForOldestBatch();
+    }
+
+    device.destroySemaphore(uploadTimeline);
+    device.destroyCommandPool(cmdPool);
+
+    stagingBufferResource.release(*renderEngine->getVmaAllocator());
+}
+
+UploadManager::Batch &UploadManager::getRecordingBatch() {
+    if (recordingBatch.has_value()) {
+        return recordingBatch.value();
+    }
+
+    Batch batch;
+    if (!freeBatches.empty()) {
+        batch = std::move(freeBatches.back());
+        freeBatches.pop_back();
+    } else {
+        vk::CommandBufferAllocateInfo allocInfo{};
+        allocInfo.commandPool = cmdPool;
+        allocInfo.level = vk::CommandBufferLevel::ePrimary;
+        allocInfo.commandBufferCount = 1;
+        batch.cmdBuffer =
+            renderEngine->getDevice().allocateCommandBuffers(allocInfo)[0];
+    }
+
+    batch.ticket = nextTicket;
+    batch.hasCommands = false;
+
+    vk::CommandBufferBeginInfo beginInfo{};
+    beginInfo.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+    batch.cmdBuffer.begin(beginInfo);
+
+    recordingBatch = std::move(batch);
+    return recordingBatch.value();
+}
+
+/**
+ * @brief Allocates region from staging ring and returns its offset.
+ * If there is no space left, this function waits for the oldest in-flight
+ * batch (submitting the recording batch first if needed).
+ * size must not be larger than STAGING_RING_SIZE.
+ */
+vk::DeviceSize UploadManager::allocateStagingRegion(vk::DeviceSize size) {
+    size = (size + STAGING_ALIGNMENT - 1) / STAGING_ALIGNMENT *
+           STAGING_ALIGNMENT;
+
+    while (true) {
+        uint64_t pos = stagingHead % STAGING_RING_SIZE;
+        // region must not wrap around the end of ring
+        uint64_t padding =
+            (pos + size > STAGING_RING_SIZE) ? STAGING_RING_SIZE - pos : 0;
+
+        if (stagingHead + padding + size - stagingTail <= STAGING_RING_SIZE) {
+            stagingHead += padding;
+            vk::DeviceSize offset = stagingHead % STAGING_RING_SIZE;
+            stagingHead += size;
+            return offset;
+        }
+
+        if (!inFlightBatches.empty()) {
+            VLOG(VLOG_LV_4_PROCESS_TRACKING_SECONDARY)
+                << "Staging ring is full. Waiting for in-flight upload.";
+            waitForOldestBatch();
+        } else {
+            // all used region belongs to recording batch
+            submit();
+        }
+    }
+}
+
+/**
+ * @brief Copies srcData into staging memory and records copy command.
+ * The copy is executed when the batch is submitted by submit().
+ *
+ * @return ticket to check completion of this upload
+ */
+UploadTicket UploadManager::enqueueBufferUpload(const void *srcData,
+                                                vk::DeviceSize size,
+                                                vk::Buffer dstBuffer,
+                                                vk::DeviceSize dstOffset) {
+    vk::Buffer srcBuffer;
+    vk::DeviceSize srcOffset;
+
+    if (size > STAGING_RING_SIZE) {
+        // too large for staging ring: use dedicated staging buffer
+        BufferResource staging;
+        vk::BufferCreateInfo stagingBufferCI{};
+        stagingBufferCI.size = size;
+        stagingBufferCI.usage = vk::BufferUsageFlagBits::eTransferSrc;
+
+        VmaAllocationCreateInfo allocCI{};
+        allocCI.usage = VMA_MEMORY_USAGE_AUTO_PREFER_HOST;
+        allocCI.flags =
+            VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT |
+            VMA_ALLOCATION_CREATE_MAPPED_BIT;
+        VmaAllocationInfo allocInfo{};
+
+        auto vkBufferCI = (VkBufferCreateInfo)stagingBufferCI;
+        VkBuffer vkBuffer;
+        auto result =
+            vmaCreateBuffer(*renderEngine->getVmaAllocator(), &vkBufferCI,
+                            &allocCI, &vkBuffer, &staging.alloc, &allocInfo);
+        if (result != VK_SUCCESS) {
+            throw std::runtime_error(
+                "Failed to create dedicated staging buffer.");
+        }
+        staging.buffer = (vk::Buffer)vkBuffer;
+
+        memcpy(allocInfo.pMappedData, srcData, size);
+        vmaFlushAllocation(*renderEngine->getVmaAllocator(), staging.alloc, 0,
+                           VK_WHOLE_SIZE);
+
+        srcBuffer = staging.buffer;
+        srcOffset = 0;
+        getRecordingBatch().dedicatedStagingBuffers.push_back(staging);
+    } else {
+        // allocate before getRecordingBatch(): allocation may submit it
+        srcOffset = allocateStagingRegion(size);
+        memcpy(stagingMappedData + srcOffset, srcData, size);
+        vmaFlushAllocation(*renderEngine->getVmaAllocator(),
+                           stagingBufferResource.alloc, srcOffset, size);
+        srcBuffer = stagingBufferResource.buffer;
+    }
+
+    Batch &batch = getRecordingBatch();
+
+    vk::BufferCopy copy{};
+    copy.srcOffset = srcOffset;
+    copy.dstOffset = dstOffset;
+    copy.size = size;
+    batch.cmdBuffer.copyBuffer(srcBuffer, dstBuffer, copy);
+    batch.hasCommands = true;
+
+    return batch.ticket;
+}
+
+/**
+ * @brief Submits recording batch without waiting.
+ *
+ * @return ticket of submitted batch, or the last submitted ticket if there is
+ * nothing to submit.
+ */
+UploadTicket UploadManager::submit() {
+    if (!recordingBatch.has_value() || !recordingBatch->hasCommands) {
+        return nextTicket - 1;
+    }
+
+    Batch batch = std::move(recordingBatch.value());
+    recordingBatch.reset();
+
+    batch.cmdBuffer.end();
+    batch.stagingHead = stagingHead;
+
+    vk::TimelineSemaphoreSubmitInfo timelineSubmitInfo{};
+    timelineSubmitInfo.setSignalSemaphoreValues(batch.ticket);
+
+    vk::SubmitInfo submitInfo{};
+    submitInfo.pNext = &timelineSubmitInfo;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &batch.cmdBuffer;
+    submitInfo.setSignalSemaphores(uploadTimeline);
+
+    renderEngine->getQueues().transferQueue.submit(submitInfo);
+
+    VLOG(VLOG_LV_4_PROCESS_TRACKING_SECONDARY)
+        << "Upload batch " << batch.ticket << " has been submitted.";
+
+    nextTicket++;
+    inFlightBatches.push_back(std::move(batch));
+
+    return inFlightBatches.back().ticket;
+}
+
+/**
+ * @brief Retires completed batches without blocking.
+ */
+void UploadManager::poll() {
+    if (inFlightBatches.empty()) {
+        return;
+    }
+
+    UploadTicket signalledTicket =
+        renderEngine->getDevice().getSemaphoreCounterValue(uploadTimeline);
+    while (!inFlightBatches.empty() &&
+           inFlightBatches.front().ticket <= signalledTicket) {
+        retireBatch(inFlightBatches.front());
+        inFlightBatches.pop_front();
+    }
+}
+
+bool UploadManager::isComplete(UploadTicket ticket) const {
+    return ticket <= completedTicket;
+}
+
+/**
+ * @brief Blocks until the batch of ticket completes.
+ * The batch is submitted if it is still recording.
+ */
+void UploadManager::waitFor(UploadTicket ticket) {
+    if (recordingBatch.has_value() && recordingBatch->ticket <= ticket) {
+        submit();
+    }
+    while (!isComplete(ticket) && !inFlightBatches.empty()) {
+        waitForOldestBatch();
+    }
+}
+
+/**
+ * @brief Records that buffers of ticket are used by commands recorded from
+ * now on. Call this when pending buffers replace current ones.
+ */
+void UploadManager::markApplied(UploadTicket ticket) {
+    appliedTicket = std::max(appliedTicket, ticket);
+}
+
+/**
+ * @brief Returns the highest ticket applied since the last call, 0 if none.
+ * Frame submission waits on upload timeline at this value, which costs
+ * nothing if the ticket has already completed.
+ */
+UploadTicket UploadManager::takeAppliedTicket() {
+    UploadTicket ticket = appliedTicket;
+    appliedTicket = 0;
+    return ticket;
+}
+
+const vk::Semaphore UploadManager::getUploadTimeline() const {
+    return uploadTimeline;
+}
+
+std::vector<uint32_t> UploadManager::getQueueFamiliesAccessingUploads() const {
+    auto indices = renderEngine->getQueueFamilyIndices();
+    std::vector<uint32_t> families = {
+        indices.get(QueueFamilyIndices::GRAPHICS)};
+    if (indices.has(QueueFamilyIndices::TRANSFER)) {
+        families.push_back(indices.get(QueueFamilyIndices::TRANSFER));
+    }
+
+    return families;
+}
+
+void UploadManager::retireBatch(Batch &batch) {
+    for (auto &staging : batch.dedicatedStagingBuffers) {
+        staging.release(*renderEngine->getVmaAllocator());
+    }
+    batch.dedicatedStagingBuffers.clear();
+
+    stagingTail = batch.stagingHead;
+    completedTicket = batch.ticket;
+
+    batch.cmdBuffer.reset();
+    freeBatches.push_back(std::move(batch));
+}
+
+void UploadManager::waitForOldestBatch() {
+    vk::SemaphoreWaitInfo waitInfo{};
+    waitInfo.setSemaphores(uploadTimeline);
+    waitInfo.setValues(inFlightBatches.front().ticket);
+
+    auto result =
+        renderEngine->getDevice().waitSemaphores(waitInfo, UINT64_MAX);
+    if (result != vk::Result::eSuccess) {
+        throw std::runtime_error(
+            "Error occurred while waiting upload timeline.");
+    }
+
+    retireBatch(inFlightBatches.front());
+    inFlightBatches.pop_front();
+}
+} // namespace ikura
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include <vk_mem_alloc.h>
+
+#include "../../renderComponent/renderContent.hpp"
+#include "./renderEngine.hpp"
+
+namespace ikura {
+/**
+ * @brief Uploads data to device local buffers without blocking.
+ *
+ * Source data is copied into a persistently mapped staging ring, and copy
+ * commands are recorded into the current batch. The batch is submitted by
+ * submit() (AppEngine calls it once per frame) to the dedicated transfer queue
+ * if available. Each batch signals upload timeline, a timeline semaphore of
+ * the queue, with its ticket, so completion is tracked by the counter of the
+ * timeline instead of waiting for the queue to be idle.
+ *
+ * Completion observed by host does not make writes of transfer queue visible
+ * to graphics queue. Users report applied tickets by markApplied(), and frame
+ * submissions wait on upload timeline at takeAppliedTicket().
+ */
+class UploadManager {
+    struct Batch {
+        vk::CommandBuffer cmdBuffer;
+        UploadTicket ticket = 0;
+        // staging ring head after this batch, becomes tail on completion
+        uint64_t stagingHead = 0;
+        // staging buffers for data larger than staging ring
+        std::vector<BufferResource> dedicatedStagingBuffers;
+        bool hasCommands = false;
+    };
+
+    static constexpr vk::DeviceSize STAGING_RING_SIZE = 32 * 1024 * 1024;
+    static constexpr vk::DeviceSize STAGING_ALIGNMENT = 16;
+
+    // non-owning, UploadManager is owned by RenderEngine
+    RenderEngine *renderEngine;
+
+    vk::CommandPool cmdPool;
+    // value is the ticket of the last completed batch
+    vk::Semaphore uploadTimeline;
+
+    // Staging ring ----------
+    BufferResource stagingBufferResource;
+    uint8_t *stagingMappedData = nullptr;
+    // virtual offsets, (offset % STAGING_RING_SIZE) is actual position
+    uint64_t stagingHead = 0;
+    uint64_t stagingTail = 0;
+
+    // Batches ----------
+    std::optional<Batch> recordingBatch;
+    std::deque<Batch> inFlightBatches;
+    std::vector<Batch> freeBatches;
+
+    UploadTicket nextTicket = 1;
+    UploadTicket completedTicket = 0;
+    // highest ticket applied since the last takeAppliedTicket(), 0 if none
+    UploadTicket appliedTicket = 0;
+
+    Batch &getRecordingBatch();
+    vk::DeviceSize allocateStagingRegion(vk::DeviceSize size);
+    void retireBatch(Batch &batch);
+    void waitForOldestBatch();
+
+  public:
+    // stages of graphics queue reading uploaded buffers
+    static constexpr vk::PipelineStageFlags CONSUMER_STAGES =
+        vk::PipelineStageFlagBits::eVertexInput |
+        vk::PipelineStageFlagBits::eDrawIndirect |
+        vk::PipelineStageFlagBits::eComputeShader;
+
+    UploadManager(RenderEngine *renderEngine);
+    ~UploadManager();
+
+    UploadTicket enqueueBufferUpload(const void *srcData, vk::DeviceSize size,
+                                     vk::Buffer dstBuffer,
+                                     vk::DeviceSize dstOffset = 0);
+    UploadTicket submit();
+    void poll();
+
+    bool isComplete(UploadTicket ticket) const;
+    void waitFor(UploadTicket ticket);
+
+    void markApplied(UploadTicket ticket);
+    UploadTicket takeAppliedTicket();
+    const vk::Semaphore getUploadTimeline() const;
+
+    // Queue families which access uploaded buffers.
+    // Buffers must be created with eConcurrent if it contains 2 families.
+    std::vector<uint32_t> getQueueFamiliesAccessingUploads() const;
+};
+} // namespace ikura
@@ -18,6 +18,10 @@
 #include "renderComponent/basic/basicRenderComponentProvider.hpp"
 #include "renderComponent/basic/basicRenderContent.hpp"
 #include "renderComponent/basic/basicRenderTarget.hpp"
+#include "renderComponent/basic/offscreenRenderTarget.hpp"
+
+// Windows
+#include "window/offscreenWindow/offscreenWindow.hpp"
 
 // shapes
 #include "shape/shapes.hpp"
\ No newline at end of file
@@ -6,10 +6,44 @@ namespace ikura {
 static const std::string VERTEX_SHADER_CODE = R"(
 #version 450
 
-const int NUM_OF_ID = 256;
+layout(set = 0, binding = 0) readonly buffer ModelMat {
+	mat4 model[];
+} modelMat;
+
+layout(set = 0, binding = 1) uniform SceneMat {
+	mat4 view;
+	mat4 proj;
+} sceneMat;
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inColor;
+layout(location = 2) in uint inId;
+
+layout(location = 3) in vec3 inInstanceColor;
+layout(location = 4) in float inInstanceScale;
+layout(location = 5) in uint inInstanceId;
 
-layout(set = 0, binding = 0) uniform ModelMat {
-	mat4 model[NUM_OF_ID];
+layout(location = 0) out vec3 flagColor;
+// id + 1 of the model matrix, 0 is cleared value (nothing is drawn)
+layout(location = 1) flat out uint flagId;
+
+void main() {
+	gl_Position = sceneMat.proj * sceneMat.view * modelMat.model[inId + inInstanceId] * vec4(inPosition * inInstanceScale, 1.0);
+
+	flagColor = inColor * inInstanceColor;
+	flagId = inId + inInstanceId + 1;
+}
+)";
+
+// Same as VERTEX_SHADER_CODE, but also writes point size, which is required
+// by point list topology. POINT_SIZE is given when the pipeline is created.
+static const std::string POINT_VERTEX_SHADER_CODE = R"(
+#version 450
+
+layout(constant_id = 0) const float POINT_SIZE = 1.0;
+
+layout(set = 0, binding = 0) readonly buffer ModelMat {
+	mat4 model[];
 } modelMat;
 
 layout(set = 0, binding = 1) uniform SceneMat {
@@ -21,12 +55,20 @@ layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec3 inColor;
 layout(location = 2) in uint inId;
 
+layout(location = 3) in vec3 inInstanceColor;
+layout(location = 4) in float inInstanceScale;
+layout(location = 5) in uint inInstanceId;
+
 layout(location = 0) out vec3 flagColor;
+// id + 1 of the model matrix, 0 is cleared value (nothing is drawn)
+layout(location = 1) flat out uint flagId;
 
 void main() {
-	gl_Position = sceneMat.proj * sceneMat.view * modelMat.model[inId] * vec4(inPosition, 1.0);
+	gl_Position = sceneMat.proj * sceneMat.view * modelMat.model[inId + inInstanceId] * vec4(inPosition * inInstanceScale, 1.0);
+	gl_PointSize = POINT_SIZE;
 
-	flagColor = inColor;
+	flagColor = inColor * inInstanceColor;
+	flagId = inId + inInstanceId + 1;
 }
 )";
 
@@ -34,12 +76,299 @@ static const std::string FRAGMENT_SHADER_CODE = R"(
 #version 450
 
 layout(location = 0) in vec3 fragColor;
+layout(location = 1) flat in uint fragId;
 
 layout(location = 0) out vec4 outColor;
+layout(location = 1) out uint outId;
 
 void main() {
 	outColor = vec4(fragColor, 1.0);
+	outId = fragId;
 }
 )";
 
+// Procedural grid floor ----------
+// Draws one large quad on XY plane of model space without vertex buffer,
+// and grid lines are computed analytically in fragment shader.
+static const std::string GRID_FLOOR_VERTEX_SHADER_CODE = R"(
+#version 450
+
+layout(set = 0, binding = 0) readonly buffer ModelMat {
+	mat4 model[];
+} modelMat;
+
+layout(set = 0, binding = 1) uniform SceneMat {
+	mat4 view;
+	mat4 proj;
+} sceneMat;
+
+layout(push_constant) uniform GridFloor {
+	vec4 color;
+	float cellSize;
+	float lineWidth;
+	float halfExtent;
+	float fadeDistance;
+	uint modelId;
+} gridFloor;
+
+layout(location = 0) out vec2 outLocalPos;
+layout(location = 1) out float outViewDistance;
+
+const vec2 CORNERS[6] = vec2[](
+	vec2(-1.0, -1.0), vec2(1.0, -1.0), vec2(1.0, 1.0),
+	vec2(1.0, 1.0), vec2(-1.0, 1.0), vec2(-1.0, -1.0)
+);
+
+void main() {
+	vec2 pos = CORNERS[gl_VertexIndex] * gridFloor.halfExtent;
+	vec4 viewPos = sceneMat.view * modelMat.model[gridFloor.modelId] * vec4(pos, 0.0, 1.0);
+
+	outLocalPos = pos;
+	outViewDistance = length(viewPos.xyz);
+	gl_Position = sceneMat.proj * viewPos;
+}
+)";
+
+static const std::string GRID_FLOOR_FRAGMENT_SHADER_CODE = R"(
+#version 450
+
+layout(push_constant) uniform GridFloor {
+	vec4 color;
+	float cellSize;
+	float lineWidth;
+	float halfExtent;
+	float fadeDistance;
+	uint modelId;
+} gridFloor;
+
+layout(location = 0) in vec2 inLocalPos;
+layout(location = 1) in float inViewDistance;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+	// distance to the nearest line, in cells
+	vec2 coord = inLocalPos / gridFloor.cellSize;
+	vec2 dist = abs(fract(coord + 0.5) - 0.5);
+
+	// anti-aliasing: soften edges over one pixel footprint
+	vec2 halfWidth = vec2(0.5 * gridFloor.lineWidth / gridFloor.cellSize);
+	vec2 footprint = fwidth(coord);
+	vec2 line = 1.0 - smoothstep(halfWidth, halfWidth + footprint, dist);
+	float coverage = max(line.x, line.y);
+
+	// fade out toward distance
+	coverage *= 1.0 - smoothstep(0.5 * gridFloor.fadeDistance, gridFloor.fadeDistance, inViewDistance);
+
+	if (coverage <= 0.0) {
+		discard;
+	}
+	outColor = vec4(gridFloor.color.rgb, gridFloor.color.a * coverage);
+}
+)";
+// GPU forward kinematics ----------
+// One invocation evaluates one joint of one instance. Joints of the same depth
+// level are dispatched together, so parent frames have been written by the
+// previous dispatch.
+static const std::string SKELETON_COMPUTE_SHADER_CODE = R"(
+#version 450
+
+layout(local_size_x = 64) in;
+
+struct Skeleton {
+	uint firstJoint;
+	uint numOfJoints;
+	uint firstRotation;
+	uint firstFrame;
+	uint numOfFrames;
+	float frameTime;
+};
+
+struct Joint {
+	vec4 offset;
+	mat4 meshTransform;
+	int parentIndex;
+};
+
+struct Instance {
+	mat4 transform;
+	float time;
+	uint skeletonIndex;
+	uint paletteOffset;
+};
+
+layout(set = 0, binding = 0) readonly buffer Skeletons {
+	Skeleton skeletons[];
+};
+layout(set = 0, binding = 1) readonly buffer Joints {
+	Joint joints[];
+};
+// joint indices in skeleton, grouped by depth level
+layout(set = 0, binding = 2) readonly buffer LevelJoints {
+	uint levelJoints[];
+};
+layout(set = 0, binding = 3) readonly buffer Rotations {
+	vec4 rotations[];
+};
+layout(set = 0, binding = 4) readonly buffer RootTranslations {
+	vec4 rootTranslations[];
+};
+layout(set = 0, binding = 5) readonly buffer Instances {
+	Instance instances[];
+};
+// frames in which children are placed, indexed like model matrices
+layout(set = 0, binding = 6) buffer JointFrames {
+	mat4 jointFrames[];
+};
+layout(set = 0, binding = 7) writeonly buffer ModelMat {
+	mat4 model[];
+} modelMat;
+
+layout(push_constant) uniform Level {
+	uint skeletonIndex;
+	uint firstLevelJoint;
+	uint numOfLevelJoints;
+	uint firstInstance;
+	uint numOfInstances;
+} level;
+
+mat4 rotationMatrix(vec4 q) {
+	float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+	float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+	float wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+
+	return mat4(
+		1.0 - 2.0 * (yy + zz), 2.0 * (xy + wz), 2.0 * (xz - wy), 0.0,
+		2.0 * (xy - wz), 1.0 - 2.0 * (xx + zz), 2.0 * (yz + wx), 0.0,
+		2.0 * (xz + wy), 2.0 * (yz - wx), 1.0 - 2.0 * (xx + yy), 0.0,
+		0.0, 0.0, 0.0, 1.0);
+}
+
+void main() {
+	uint index = gl_GlobalInvocationID.x;
+	if (index >= level.numOfInstances * level.numOfLevelJoints) {
+		return;
+	}
+
+	Instance instance = instances[level.firstInstance + index / level.numOfLevelJoints];
+	Skeleton skeleton = skeletons[level.skeletonIndex];
+	uint jointIndex = levelJoints[level.firstLevelJoint + index % level.numOfLevelJoints];
+	Joint joint = joints[skeleton.firstJoint + jointIndex];
+
+	uint frame = uint(clamp(floor(instance.time / skeleton.frameTime), 0.0, float(skeleton.numOfFrames - 1)));
+
+	vec3 translation = joint.offset.xyz;
+	mat4 parentFrame;
+	if (joint.parentIndex < 0) {
+		translation += rootTranslations[skeleton.firstFrame + frame].xyz;
+		parentFrame = instance.transform;
+	} else {
+		parentFrame = jointFrames[instance.paletteOffset + uint(joint.parentIndex)];
+	}
+
+	mat4 placed = parentFrame;
+	placed[3] = parentFrame * vec4(translation, 1.0);
+
+	uint paletteIndex = instance.paletteOffset + jointIndex;
+	jointFrames[paletteIndex] = placed * rotationMatrix(rotations[skeleton.firstRotation + frame * skeleton.numOfJoints + jointIndex]);
+	modelMat.model[paletteIndex] = placed * joint.meshTransform;
+}
+)";
+// GPU frustum culling ----------
+// One invocation tests one culling group against the frustum of one viewport
+// (gl_GlobalInvocationID.y). Instances of visible groups are appended to the
+// region of their draw command in compacted instances, and instanceCount of
+// the indirect draw command is counted up by atomicAdd.
+static const std::string CULLING_COMPUTE_SHADER_CODE = R"(
+#version 450
+
+layout(local_size_x = 64) in;
+
+struct CullingGroup {
+	vec4 boundingSphere;
+	uint modelId;
+	uint commandIndex;
+	uint firstInstance;
+	uint numOfInstances;
+	uint firstCompactedInstance;
+	// 0xFFFFFFFF if drawn at any LOD level
+	uint lodSlot;
+	uint lodLevel;
+};
+
+layout(set = 0, binding = 0) readonly buffer CullingGroups {
+	CullingGroup groups[];
+};
+// instances are copied word by word, regardless of their layout
+layout(set = 0, binding = 1) readonly buffer SourceInstances {
+	uint sourceInstanceWords[];
+};
+layout(set = 0, binding = 2) readonly buffer ModelMat {
+	mat4 model[];
+} modelMat;
+// planes[viewport * 6 + i], inside if dot(xyz, p) + w >= 0
+layout(set = 0, binding = 3) readonly buffer Frustums {
+	vec4 planes[];
+};
+// VkDrawIndexedIndirectCommand (5 words), commands[viewport][command]
+layout(set = 0, binding = 4) buffer Commands {
+	uint commandWords[];
+};
+// compactedInstances[viewport][instance]
+layout(set = 0, binding = 5) writeonly buffer CompactedInstances {
+	uint compactedInstanceWords[];
+};
+// lodLevels[lodSlot] of the frame
+layout(set = 0, binding = 6) readonly buffer LodLevels {
+	uint lodLevels[];
+};
+
+layout(push_constant) uniform Culling {
+	uint numOfGroups;
+	uint numOfCommands;
+	// per viewport
+	uint numOfCompactedInstances;
+	// in words
+	uint instanceStride;
+} culling;
+
+void main() {
+	uint groupIndex = gl_GlobalInvocationID.x;
+	uint viewport = gl_GlobalInvocationID.y;
+	if (groupIndex >= culling.numOfGroups) {
+		return;
+	}
+
+	CullingGroup group = groups[groupIndex];
+	if (group.lodSlot != 0xFFFFFFFF && lodLevels[group.lodSlot] != group.lodLevel) {
+		return;
+	}
+
+	mat4 model = modelMat.model[group.modelId];
+	float scale = max(length(model[0].xyz), max(length(model[1].xyz), length(model[2].xyz)));
+	// zero model matrix hides the group
+	if (scale == 0.0) {
+		return;
+	}
+
+	vec3 center = (model * vec4(group.boundingSphere.xyz, 1.0)).xyz;
+	float radius = group.boundingSphere.w * scale;
+	for (uint i = 0; i < 6; i++) {
+		vec4 plane = planes[viewport * 6 + i];
+		if (dot(plane.xyz, center) + plane.w < -radius) {
+			return;
+		}
+	}
+
+	uint commandIndex = viewport * culling.numOfCommands + group.commandIndex;
+	uint slot = atomicAdd(commandWords[commandIndex * 5 + 1], group.numOfInstances);
+	uint dst = viewport * culling.numOfCompactedInstances + group.firstCompactedInstance + slot;
+	for (uint i = 0; i < group.numOfInstances; i++) {
+		for (uint word = 0; word < culling.instanceStride; word++) {
+			compactedInstanceWords[(dst + i) * culling.instanceStride + word] =
+				sourceInstanceWords[(group.firstInstance + i) * culling.instanceStride + word];
+		}
+	}
+}
+)";
 }
\ No newline at end of file
@@ -9,15 +9,17 @@
 namespace ikura {
 void BasicRenderComponentProvider::createDescriptorSetlayout() {
     vk::DescriptorSetLayoutBinding modelMatLayoutBinding{};
-    modelMatLayoutBinding.binding = DESCRIPTOR_SET_BINDING_MODEL_MATRIX_UBO;
+    modelMatLayoutBinding.binding = DESCRIPTOR_SET_BINDING_MODEL_MATRIX_BUFFER;
     modelMatLayoutBinding.descriptorCount = 1;
-    modelMatLayoutBinding.descriptorType = vk::DescriptorType::eUniformBuffer;
+    modelMatLayoutBinding.descriptorType =
+        vk::DescriptorType::eStorageBufferDynamic;
     modelMatLayoutBinding.stageFlags = vk::ShaderStageFlagBits::eVertex;
 
     vk::DescriptorSetLayoutBinding sceneMatLayoutBinding{};
     sceneMatLayoutBinding.binding = DESCRIPTOR_SET_BINDING_SCENE_MATRIX_UBO;
     sceneMatLayoutBinding.descriptorCount = 1;
-    sceneMatLayoutBinding.descriptorType = vk::DescriptorType::eUniformBuffer;
+    sceneMatLayoutBinding.descriptorType =
+        vk::DescriptorType::eUniformBufferDynamic;
     sceneMatLayoutBinding.stageFlags = vk::ShaderStageFlagBits::eVertex;
 
     std::array<vk::DescriptorSetLayoutBinding, NUM_OF_DESCRIPTORS>
@@ -51,17 +53,44 @@ BasicRenderComponentProvider::createBasicRenderTarget(
     auto renderTarget = std::make_shared<BasicRenderTarget>(
         renderEngine, nativeWindow->getSwapChainFormat(),
         nativeWindow->getSwapChainExtent(), descriptorSetLayout, images,
-        nativeWindow->getNumOfFrames());
+        nativeWindow->getNumOfFrames(),
+        nativeWindow->getSwapChainImageUsage());
+
+    return renderTarget;
+}
+
+std::shared_ptr<OffscreenRenderTarget>
+BasicRenderComponentProvider::createOffscreenRenderTarget(
+    const std::shared_ptr<OffscreenWindow> offscreenWindow) {
+
+    auto images = offscreenWindow->getRenderImages();
+    auto renderTarget = std::make_shared<OffscreenRenderTarget>(
+        renderEngine, offscreenWindow->getRenderImageFormat(),
+        offscreenWindow->getRenderImageExtent(), descriptorSetLayout, images,
+        offscreenWindow->getNumOfFrames());
 
     return renderTarget;
 }
 
 std::shared_ptr<BasicRenderContent>
 BasicRenderComponentProvider::createBasicRenderContent(
-    const std::shared_ptr<NativeWindow> nativeWindow) {
+    const std::shared_ptr<Window> window) {
+
+    // All BasicRenderContents share one UniformBufferRing.
+    // It has regions for maximum frames in flight, so that frames in flight
+    // of windows can be changed without recreating it.
+    if (!uniformBufferRing) {
+        uniformBufferRing = std::make_shared<UniformBufferRing>(
+            renderEngine, Window::MAX_NUM_OF_FRAMES,
+            UNIFORM_BUFFER_RING_FRAME_REGION_SIZE);
+    }
+    if (window->getNumOfFrames() > uniformBufferRing->getNumOfFrames()) {
+        throw std::runtime_error(
+            "Number of frames of Window exceeds shared UniformBufferRing.");
+    }
 
     auto renderContent = std::make_shared<BasicRenderContent>(
-        renderEngine, descriptorSetLayout, nativeWindow->getNumOfFrames());
+        renderEngine, descriptorSetLayout, uniformBufferRing);
 
     return renderContent;
 }
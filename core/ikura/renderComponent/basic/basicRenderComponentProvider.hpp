@@ -6,13 +6,21 @@
 
 #include "../../engine/renderEngine/renderEngine.hpp"
 #include "../../window/nativeWindow/nativeWindow.hpp"
+#include "../../window/offscreenWindow/offscreenWindow.hpp"
 #include "../renderComponentProvider.hpp"
 #include "./basicRenderContent.hpp"
 #include "./basicRenderTarget.hpp"
+#include "./offscreenRenderTarget.hpp"
+#include "../uniformBufferRing.hpp"
 
 namespace ikura {
 // Provides Basic RenderComponent compatible with shapes
 class BasicRenderComponentProvider : public RenderComponentProvider {
+    // per-frame size of UniformBufferRing shared by BasicRenderContents
+    static constexpr vk::DeviceSize UNIFORM_BUFFER_RING_FRAME_REGION_SIZE =
+        5 * 1024 * 1024;
+
+    std::shared_ptr<UniformBufferRing> uniformBufferRing;
 
     void createDescriptorSetlayout();
 
@@ -23,7 +31,9 @@ class BasicRenderComponentProvider : public RenderComponentProvider {
 
     std::shared_ptr<BasicRenderTarget>
     createBasicRenderTarget(const std::shared_ptr<NativeWindow> nativeWindow);
+    std::shared_ptr<OffscreenRenderTarget> createOffscreenRenderTarget(
+        const std::shared_ptr<OffscreenWindow> offscreenWindow);
     std::shared_ptr<BasicRenderContent>
-    createBasicRenderContent(const std::shared_ptr<NativeWindow> nativeWindow);
+    createBasicRenderContent(const std::shared_ptr<Window> window);
 };
 } // namespace ikura
\ No newline at end of file
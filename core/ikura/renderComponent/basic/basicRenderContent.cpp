@@ -1,9 +1,12 @@
 #include "./basicRenderContent.hpp"
 
+#include <string>
+
 #include <easylogging++.h>
 
 #include "../../shape/shapes.hpp"
 #include "../../window/window.hpp"
+#include "../renderTarget.hpp"
 #include "./descriptorSetProps.hpp"
 
 #include "../../common/logLevels.hpp"
@@ -15,139 +18,94 @@
 
 namespace ikura {
 void BasicRenderContent::setupUniformBuffers() {
-    VLOG(VLOG_LV_3_PROCESS_TRACKING) << "Creating default UniformBuffers...";
-
-    std::array<vk::DeviceSize, NUM_OF_DESCRIPTORS> uniformBufferSizes;
-    uniformBufferSizes[DESCRIPTOR_SET_BINDING_MODEL_MATRIX_UBO] =
-        sizeof(BasicModelMatUBO);
-    uniformBufferSizes[DESCRIPTOR_SET_BINDING_SCENE_MATRIX_UBO] =
-        sizeof(BasicSceneMatUBO);
-
-    uniformBufferResources.resize(numOfFrames);
-
-    for (size_t frame = 0; frame < numOfFrames; frame++) {
-        uniformBufferResources[frame].resize(NUM_OF_DESCRIPTORS);
-
-        for (size_t descSetIndex = 0; descSetIndex < NUM_OF_DESCRIPTORS;
-             descSetIndex++) {
-            // TODO: create large DeviceMemory and assign part of them to each
-            // uniformBuffers
-            vk::BufferCreateInfo bufferCI{};
-            bufferCI.size = uniformBufferSizes[descSetIndex];
-            bufferCI.usage = vk::BufferUsageFlagBits::eUniformBuffer;
-            bufferCI.sharingMode = vk::SharingMode::eExclusive;
-
-            VmaAllocationCreateInfo allocCI{};
-            allocCI.usage = VMA_MEMORY_USAGE_AUTO;
-            allocCI.flags =
-                VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT |
-                VMA_ALLOCATION_CREATE_MAPPED_BIT;
-
-            auto vkBufferCI = (VkBufferCreateInfo)bufferCI;
-            VkBuffer vkBuffer;
-
-            vmaCreateBuffer(*renderEngine->getVmaAllocator(), &vkBufferCI,
-                            &allocCI, &vkBuffer,
-                            &uniformBufferResources[frame][descSetIndex].alloc,
-                            nullptr);
-
-            vk::Buffer buffer(vkBuffer);
-            uniformBufferResources[frame][descSetIndex].buffer = buffer;
-        }
+    VLOG(VLOG_LV_3_PROCESS_TRACKING)
+        << "Reserving default UniformSlots from UniformBufferRing...";
+
+    modelMatSlot =
+        uniformBufferRing->reserve(sizeof(glm::mat4) * NUM_OF_MODEL_MATRIX);
+    // one per viewport, selected by dynamic offset of scene matrix binding
+    for (int i = 0; i < MAX_NUM_OF_VIEWPORTS; i++) {
+        sceneMatSlots.push_back(
+            uniformBufferRing->reserve(sizeof(BasicSceneMatUBO)));
     }
 
     VLOG(VLOG_LV_3_PROCESS_TRACKING)
-        << "Default UniformBuffers has been created.";
+        << "Default UniformSlots have been reserved.";
 }
 
 void BasicRenderContent::setupDescriptorSets() {
     VLOG(VLOG_LV_3_PROCESS_TRACKING) << "Creating default DescriptorSets...";
 
+    // binding -> descriptor type
+    std::array<vk::DescriptorType, NUM_OF_DESCRIPTORS> descriptorTypes;
+    descriptorTypes[DESCRIPTOR_SET_BINDING_MODEL_MATRIX_BUFFER] =
+        vk::DescriptorType::eStorageBufferDynamic;
+    descriptorTypes[DESCRIPTOR_SET_BINDING_SCENE_MATRIX_UBO] =
+        vk::DescriptorType::eUniformBufferDynamic;
+
     // DescriptorPool ----------
-    std::array<vk::DescriptorPoolSize, 2> poolSizes;
-    poolSizes[DESCRIPTOR_SET_BINDING_MODEL_MATRIX_UBO].type =
-        vk::DescriptorType::eUniformBuffer;
-    poolSizes[DESCRIPTOR_SET_BINDING_MODEL_MATRIX_UBO].descriptorCount =
-        static_cast<uint32_t>(numOfFrames * NUM_OF_DESCRIPTORS);
-    poolSizes[DESCRIPTOR_SET_BINDING_SCENE_MATRIX_UBO].type =
-        vk::DescriptorType::eUniformBuffer;
-    poolSizes[DESCRIPTOR_SET_BINDING_SCENE_MATRIX_UBO].descriptorCount =
-        static_cast<uint32_t>(numOfFrames);
+    std::array<vk::DescriptorPoolSize, NUM_OF_DESCRIPTORS> poolSizes;
+    for (size_t binding = 0; binding < NUM_OF_DESCRIPTORS; binding++) {
+        poolSizes[binding].type = descriptorTypes[binding];
+        poolSizes[binding].descriptorCount = 1;
+    }
 
     vk::DescriptorPoolCreateInfo poolCI{};
     poolCI.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
     poolCI.pPoolSizes = poolSizes.data();
-    poolCI.maxSets =
-        static_cast<uint32_t>(numOfFrames * NUM_OF_DESCRIPTOR_SETS);
+    poolCI.maxSets = static_cast<uint32_t>(NUM_OF_DESCRIPTOR_SETS);
 
     descriptorPool = renderEngine->getDevice().createDescriptorPool(poolCI);
 
-    // DescriptorSets ==========
-    // Array preparation ----------
-    size_t numOfDescriptorWrites = numOfFrames * NUM_OF_DESCRIPTORS;
-
-    std::vector<vk::WriteDescriptorSet> descriptorWrites;
-    descriptorWrites.resize(numOfDescriptorWrites);
-    std::vector<vk::DescriptorBufferInfo> bufferInfos;
-    bufferInfos.resize(numOfDescriptorWrites);
-
-    descriptorSets.resize(numOfFrames);
-
-    // DescriptorSet Allocation loop per frame ----------
-    size_t index = 0;
-    for (size_t frame = 0; frame < numOfFrames; frame++) {
-        // Allocation ----------
-        vk::DescriptorSetAllocateInfo allocInfo{};
-        allocInfo.descriptorPool = descriptorPool;
-        allocInfo.descriptorSetCount = NUM_OF_DESCRIPTOR_SETS;
-        allocInfo.pSetLayouts = &descriptorSetLayout;
-
-        descriptorSets[frame] =
-            renderEngine->getDevice().allocateDescriptorSets(allocInfo);
-
-        // Fill Update Info ----------
-        // Model Matrix UBO
-        bufferInfos[index].buffer =
-            uniformBufferResources[frame]
-                                  [DESCRIPTOR_SET_BINDING_MODEL_MATRIX_UBO]
-                                      .buffer;
-        bufferInfos[index].offset = 0;
-        bufferInfos[index].range = VK_WHOLE_SIZE;
-
-        descriptorWrites[index].dstSet =
-            descriptorSets[frame][DESCRIPTOR_SET_INDEX_MODEL_MATRIX_UBO];
-        descriptorWrites[index].dstBinding =
-            DESCRIPTOR_SET_BINDING_MODEL_MATRIX_UBO;
-        descriptorWrites[index].dstArrayElement = 0;
-        descriptorWrites[index].descriptorType =
-            vk::DescriptorType::eUniformBuffer;
-        descriptorWrites[index].descriptorCount = 1;
-        descriptorWrites[index].pBufferInfo = &bufferInfos[index];
-        index++;
-
-        // Scene Matrix UBO
-        bufferInfos[index].buffer =
-            uniformBufferResources[frame]
-                                  [DESCRIPTOR_SET_BINDING_SCENE_MATRIX_UBO]
-                                      .buffer;
-        bufferInfos[index].offset = 0;
-        bufferInfos[index].range = VK_WHOLE_SIZE;
-
-        descriptorWrites[index].dstSet =
-            descriptorSets[frame][DESCRIPTOR_SET_INDEX_SCENE_MATRIX_UBO];
-        descriptorWrites[index].dstBinding =
-            DESCRIPTOR_SET_BINDING_SCENE_MATRIX_UBO;
-        descriptorWrites[index].dstArrayElement = 0;
-        descriptorWrites[index].descriptorType =
-            vk::DescriptorType::eUniformBuffer;
-        descriptorWrites[index].descriptorCount = 1;
-        descriptorWrites[index].pBufferInfo = &bufferInfos[index];
-        index++;
+    // DescriptorSets ----------
+    // Only one DescriptorSet is needed for all frames,
+    // since each frame region is selected by dynamic offset.
+    vk::DescriptorSetAllocateInfo allocInfo{};
+    allocInfo.descriptorPool = descriptorPool;
+    allocInfo.descriptorSetCount = NUM_OF_DESCRIPTOR_SETS;
+    allocInfo.pSetLayouts = &descriptorSetLayout;
+
+    descriptorSets =
+        renderEngine->getDevice().allocateDescriptorSets(allocInfo);
+
+    // Fill Update Info ----------
+    std::array<vk::DescriptorBufferInfo, NUM_OF_DESCRIPTORS> bufferInfos;
+    std::array<vk::WriteDescriptorSet, NUM_OF_DESCRIPTORS> descriptorWrites;
+
+    // Model Matrix buffer
+    bufferInfos[DESCRIPTOR_SET_BINDING_MODEL_MATRIX_BUFFER].buffer =
+        uniformBufferRing->getBuffer();
+    bufferInfos[DESCRIPTOR_SET_BINDING_MODEL_MATRIX_BUFFER].offset =
+        modelMatSlot.offset;
+    bufferInfos[DESCRIPTOR_SET_BINDING_MODEL_MATRIX_BUFFER].range =
+        modelMatSlot.size;
+
+    // Scene Matrix UBO
+    bufferInfos[DESCRIPTOR_SET_BINDING_SCENE_MATRIX_UBO].buffer =
+        uniformBufferRing->getBuffer();
+    // points the first viewport, the others are reached by dynamic offset
+    bufferInfos[DESCRIPTOR_SET_BINDING_SCENE_MATRIX_UBO].offset =
+        sceneMatSlots[0].offset;
+    bufferInfos[DESCRIPTOR_SET_BINDING_SCENE_MATRIX_UBO].range =
+        sceneMatSlots[0].size;
+
+    std::array<int, NUM_OF_DESCRIPTORS> setIndices;
+    setIndices[DESCRIPTOR_SET_BINDING_MODEL_MATRIX_BUFFER] =
+        DESCRIPTOR_SET_INDEX_MODEL_MATRIX_BUFFER;
+    setIndices[DESCRIPTOR_SET_BINDING_SCENE_MATRIX_UBO] =
+        DESCRIPTOR_SET_INDEX_SCENE_MATRIX_UBO;
+
+    for (size_t binding = 0; binding < NUM_OF_DESCRIPTORS; binding++) {
+        descriptorWrites[binding].dstSet = descriptorSets[setIndices[binding]];
+        descriptorWrites[binding].dstBinding = binding;
+        descriptorWrites[binding].dstArrayElement = 0;
+        descriptorWrites[binding].descriptorType = descriptorTypes[binding];
+        descriptorWrites[binding].descriptorCount = 1;
+        descriptorWrites[binding].pBufferInfo = &bufferInfos[binding];
     }
 
     // Update ----------
-    renderEngine->getDevice().updateDescriptorSets(
-        index, descriptorWrites.data(), 0, nullptr);
+    renderEngine->getDevice().updateDescriptorSets(descriptorWrites, nullptr);
 
     VLOG(VLOG_LV_3_PROCESS_TRACKING)
         << "Default DescriptorSets has been created.";
@@ -155,9 +113,13 @@ void BasicRenderContent::setupDescriptorSets() {
 
 BasicRenderContent::BasicRenderContent(
     std::shared_ptr<RenderEngine> renderEngine,
-    vk::DescriptorSetLayout descriptorSetLayout, int numOfFrames)
+    vk::DescriptorSetLayout descriptorSetLayout,
+    std::shared_ptr<UniformBufferRing> uniformBufferRing)
 
-    : RenderContent(renderEngine, descriptorSetLayout, numOfFrames) {
+    : RenderContent(renderEngine, descriptorSetLayout,
+                    uniformBufferRing->getNumOfFrames()) {
+
+    this->uniformBufferRing = uniformBufferRing;
 
     setupUniformBuffers();
     setupDescriptorSets();
@@ -180,35 +142,219 @@ void BasicRenderContent::setIndices(const std::vector<BasicIndex> &indices) {
     this->indices = indices;
 }
 
-void BasicRenderContent::updateUniformBuffer(int frameIndex,
-                                             BasicModelMatUBO &modelMatUBO,
-                                             BasicSceneMatUBO &sceneMatUBO) {
-    void *data;
-    // Model Matrix
-    vmaMapMemory(*renderEngine->getVmaAllocator(),
-                 uniformBufferResources[frameIndex]
-                                       [DESCRIPTOR_SET_BINDING_MODEL_MATRIX_UBO]
-                                           .alloc,
-                 &data);
-    memcpy(data, &modelMatUBO, sizeof(modelMatUBO));
-    vmaUnmapMemory(
-        *renderEngine->getVmaAllocator(),
-        uniformBufferResources[frameIndex]
-                              [DESCRIPTOR_SET_BINDING_MODEL_MATRIX_UBO]
-                                  .alloc);
-
-    // Scene Matrix
-    vmaMapMemory(*renderEngine->getVmaAllocator(),
-                 uniformBufferResources[frameIndex]
-                                       [DESCRIPTOR_SET_BINDING_SCENE_MATRIX_UBO]
-                                           .alloc,
-                 &data);
-    memcpy(data, &sceneMatUBO, sizeof(sceneMatUBO));
-    vmaUnmapMemory(
-        *renderEngine->getVmaAllocator(),
-        uniformBufferResources[frameIndex]
-                              [DESCRIPTOR_SET_BINDING_SCENE_MATRIX_UBO]
-                                  .alloc);
+void BasicRenderContent::setInstances(
+    const std::vector<BasicInstance> &instances) {
+    this->instances = instances;
+}
+
+/**
+ * @brief Sets draw commands used from next frame.
+ * The commands are applied together with buffers being uploaded,
+ * so they never refer to buffers of other generation.
+ *
+ * @param topologies topologies[drawIndex], or empty if all draw commands
+ * draw triangles.
+ * @exception std::runtime_error if sizes of drawCommands and topologies
+ * differ.
+ */
+void BasicRenderContent::setDrawCommands(
+    const std::vector<vk::DrawIndexedIndirectCommand> &drawCommands,
+    const std::vector<BasicPrimitiveTopology> &topologies) {
+    if (!topologies.empty() && topologies.size() != drawCommands.size()) {
+        throw std::runtime_error(
+            "Number of topologies does not match draw commands.");
+    }
+
+    pendingDrawCommands = drawCommands;
+    pendingTopologies = topologies;
+    hasPendingDrawCommands = true;
+}
+
+void BasicRenderContent::setGridFloor(const BasicGridFloorParams &params) {
+    gridFloor = params;
+    contentVersion++;
+}
+
+void BasicRenderContent::removeGridFloor() {
+    if (gridFloor.has_value()) {
+        gridFloor.reset();
+        contentVersion++;
+    }
+}
+
+void BasicRenderContent::updateUniformBuffer(
+    int frameIndex, const std::vector<glm::mat4> &modelMats,
+    const BasicSceneMatUBO &sceneMatUBO) {
+    updateUniformBuffer(frameIndex, modelMats,
+                        std::vector<BasicSceneMatUBO>{sceneMatUBO});
+}
+
+/**
+ * @brief Updates model matrices and scene matrices of each viewport.
+ * Only modelMats.size() matrices from the beginning are written, and the
+ * others keep values of previous update of the frame.
+ * sceneMatUBOs[i] is used by i-th SceneViewport, and also culls instances
+ * of the viewport if culling groups are set.
+ *
+ * @exception std::runtime_error if there are more than NUM_OF_MODEL_MATRIX
+ * model matrices or more than MAX_NUM_OF_VIEWPORTS scene matrices.
+ */
+void BasicRenderContent::updateUniformBuffer(
+    int frameIndex, const std::vector<glm::mat4> &modelMats,
+    const std::vector<BasicSceneMatUBO> &sceneMatUBOs) {
+    if (modelMats.size() > NUM_OF_MODEL_MATRIX) {
+        throw std::runtime_error("Too many model matrices: up to " +
+                                 std::to_string(NUM_OF_MODEL_MATRIX) +
+                                 " matrices are supported.");
+    }
+    if (sceneMatUBOs.size() > sceneMatSlots.size()) {
+        throw std::runtime_error("Too many scene matrices: up to " +
+                                 std::to_string(MAX_NUM_OF_VIEWPORTS) +
+                                 " viewports are supported.");
+    }
+
+    if (!modelMats.empty()) {
+        uniformBufferRing->write(frameIndex, modelMatSlot, modelMats.data(),
+                                 sizeof(glm::mat4) * modelMats.size());
+    }
+    for (size_t i = 0; i < sceneMatUBOs.size(); i++) {
+        uniformBufferRing->write(frameIndex, sceneMatSlots[i],
+                                 &sceneMatUBOs[i], sizeof(sceneMatUBOs[i]));
+    }
+    uniformBufferRing->flush(frameIndex);
+
+    if (cullingComputePass) {
+        cullingComputePass->updateFrustums(
+            frameIndex, isFrustumCullingEnabled
+                            ? sceneMatUBOs
+                            : std::vector<BasicSceneMatUBO>{});
+    }
+}
+
+/**
+ * @brief Uploads skeletons whose model matrices are evaluated on GPU.
+ * Model matrices of skeleton instances (see updateSkeletonInstances()) are
+ * written by compute shader before scene RenderPass, into the same buffer
+ * as model matrices of updateUniformBuffer(). So palettes of instances must
+ * not overlap model matrices written by CPU.
+ */
+void BasicRenderContent::setSkeletons(
+    const std::vector<BasicSkeleton> &skeletons) {
+    if (!skeletonComputePass) {
+        if (skeletons.empty()) {
+            return;
+        }
+        skeletonComputePass = std::make_unique<SkeletonComputePass>(
+            renderEngine, uniformBufferRing, modelMatSlot);
+    }
+
+    skeletonComputePass->setSkeletons(skeletons);
+}
+
+/**
+ * @brief Sets skeleton instances evaluated in the frame. Only time and
+ * transform of each instance are uploaded per frame.
+ * Empty instances disable GPU forward kinematics of the frame.
+ *
+ * @exception std::runtime_error if instances refer to skeletons which are
+ * not set, or there are too many instances.
+ */
+void BasicRenderContent::updateSkeletonInstances(
+    int frameIndex, const std::vector<BasicSkeletonInstance> &instances) {
+    if (!skeletonComputePass) {
+        if (instances.empty()) {
+            return;
+        }
+        throw std::runtime_error("Skeletons have not been set.");
+    }
+
+    skeletonComputePass->updateInstances(frameIndex, instances);
+}
+
+/**
+ * @brief Sets groups of instances culled on GPU against frustums of viewports,
+ * used from next frame. Like draw commands, they are applied together with
+ * buffers being uploaded, and they refer to instances and draw commands of
+ * the same generation.
+ * Draw commands referred by groups draw only their visible instances, and
+ * instances not in any group are not drawn. Other draw commands are drawn as
+ * they are. Empty groups disable culling.
+ *
+ * @exception std::runtime_error if groups refer to instances out of their draw
+ * commands, or groups of a draw command overlap.
+ */
+void BasicRenderContent::setCullingGroups(
+    const std::vector<BasicCullingGroup> &groups) {
+    CullingComputePass::validateGroups(
+        groups, hasPendingDrawCommands ? pendingDrawCommands : drawCommands);
+
+    pendingCullingGroups = groups;
+    hasPendingCullingGroups = true;
+}
+
+/**
+ * @brief Enables or disables frustum test of culling groups from next
+ * updateUniformBuffer(). Disabled groups are still selected by LOD levels.
+ */
+void BasicRenderContent::setFrustumCullingEnabled(bool enabled) {
+    isFrustumCullingEnabled = enabled;
+}
+
+/**
+ * @brief Writes LOD levels of the frame, levels[lodSlot] selecting culling
+ * groups with lodSlot (see BasicCullingGroup). This is no-op until culling
+ * groups are applied.
+ *
+ * @exception std::runtime_error if there are more than MAX_NUM_OF_LOD_SLOTS
+ * levels.
+ */
+void BasicRenderContent::updateLodLevels(int frameIndex,
+                                         const std::vector<uint32_t> &levels) {
+    if (cullingComputePass) {
+        cullingComputePass->updateLodLevels(frameIndex, levels);
+    }
+}
+
+// Rebuilds culling buffers for current instances, draw commands and groups.
+void BasicRenderContent::updateCullingComputePass() {
+    if (!cullingComputePass) {
+        if (cullingGroups.empty()) {
+            return;
+        }
+        cullingComputePass = std::make_unique<CullingComputePass>(
+            renderEngine, uniformBufferRing, modelMatSlot);
+    }
+
+    cullingComputePass->setGroups(cullingGroups, drawCommands,
+                                  instanceBufferResource.buffer);
+}
+
+/**
+ * @brief Records forward kinematics of skeletons, and then culling which
+ * reads model matrices written by it.
+ */
+void BasicRenderContent::recordComputeCommands(vk::CommandBuffer cmdBuffer,
+                                               int frameIndex) {
+    if (skeletonComputePass) {
+        skeletonComputePass->recordDispatches(cmdBuffer, frameIndex);
+    }
+    if (cullingComputePass) {
+        cullingComputePass->recordDispatches(cmdBuffer, frameIndex);
+    }
+}
+
+std::vector<uint32_t>
+BasicRenderContent::getDynamicOffsets(int frameIndex,
+                                      int viewportIndex) const {
+    // one dynamic offset per dynamic binding, in binding order
+    uint32_t offset = uniformBufferRing->getDynamicOffset(frameIndex);
+    std::vector<uint32_t> offsets(NUM_OF_DESCRIPTORS, offset);
+
+    // slots are aligned, so the distance from the first one is also aligned
+    offsets[DESCRIPTOR_SET_BINDING_SCENE_MATRIX_UBO] += static_cast<uint32_t>(
+        sceneMatSlots[viewportIndex].offset - sceneMatSlots[0].offset);
+
+    return offsets;
 }
 
 void BasicRenderContent::uploadIndexBuffer() {
@@ -219,13 +365,12 @@ void BasicRenderContent::uploadIndexBuffer() {
 
     VLOG(VLOG_LV_3_PROCESS_TRACKING) << "Uploading IndexBuffer...";
 
-    indexBufferResource.release(*renderEngine->getVmaAllocator());
-
-    uploadViaStagingBuffer(indices.data(), indexBufferResource,
-                           vk::BufferUsageFlagBits::eIndexBuffer,
-                           sizeof(indices[0]) * indices.size(), renderEngine);
+    uploadToPendingBuffer(indices.data(), pendingIndexBufferResource,
+                          vk::BufferUsageFlagBits::eIndexBuffer,
+                          sizeof(indices[0]) * indices.size());
+    pendingNumOfIndex = indices.size();
 
-    VLOG(VLOG_LV_3_PROCESS_TRACKING) << "IndexBuffer has been uploaded.";
+    VLOG(VLOG_LV_3_PROCESS_TRACKING) << "IndexBuffer upload has been queued.";
 }
 
 void BasicRenderContent::uploadVertexBuffer() {
@@ -236,17 +381,176 @@ void BasicRenderContent::uploadVertexBuffer() {
 
     VLOG(VLOG_LV_3_PROCESS_TRACKING) << "Uploading VertexBuffer...";
 
-    vertexBufferResource.release(*renderEngine->getVmaAllocator());
+    // vertices are uploaded as they are, without conversion
+    uploadToPendingBuffer(BasicVertex::getDataPointer(vertices),
+                          pendingVertexBufferResource,
+                          vk::BufferUsageFlagBits::eVertexBuffer,
+                          sizeof(BasicVertex::Data) * vertices.size());
 
-    uploadViaStagingBuffer(
-        BasicVertex::convertToDataVector(vertices).data(), vertexBufferResource,
-        vk::BufferUsageFlagBits::eVertexBuffer,
-        sizeof(BasicVertex::Data) * vertices.size(), renderEngine);
+    VLOG(VLOG_LV_3_PROCESS_TRACKING) << "VertexBuffer upload has been queued.";
+}
 
-    VLOG(VLOG_LV_3_PROCESS_TRACKING) << "VertexBuffer has been uploaded.";
+void BasicRenderContent::uploadInstanceBuffer() {
+    if (instances.empty()) {
+        LOG(INFO) << "Instance array is empty. Stopping instanceBuffer upload.";
+        return;
+    }
+
+    VLOG(VLOG_LV_3_PROCESS_TRACKING) << "Uploading InstanceBuffer...";
+
+    // also read by culling compute shader
+    uploadToPendingBuffer(BasicInstance::convertToDataVector(instances).data(),
+                          pendingInstanceBufferResource,
+                          vk::BufferUsageFlagBits::eVertexBuffer |
+                              vk::BufferUsageFlagBits::eStorageBuffer,
+                          sizeof(BasicInstance::Data) * instances.size());
+
+    VLOG(VLOG_LV_3_PROCESS_TRACKING)
+        << "InstanceBuffer upload has been queued.";
+}
+
+bool BasicRenderContent::applyCompletedUploads() {
+    bool applied = RenderContent::applyCompletedUploads();
+    // instance buffer may have been replaced
+    bool isCullingOutdated = applied;
+    if (applied) {
+        numOfIndex = pendingNumOfIndex;
+    }
+    if (hasPendingDrawCommands && !hasPendingUploads) {
+        drawCommands = std::move(pendingDrawCommands);
+        pendingDrawCommands.clear();
+        topologies = std::move(pendingTopologies);
+        pendingTopologies.clear();
+        hasPendingDrawCommands = false;
+        isCullingOutdated = true;
+        contentVersion++;
+    }
+    if (hasPendingCullingGroups && !hasPendingUploads) {
+        cullingGroups = std::move(pendingCullingGroups);
+        pendingCullingGroups.clear();
+        hasPendingCullingGroups = false;
+        isCullingOutdated = true;
+        contentVersion++;
+    }
+
+    // before recording, since draws refer to culling buffers
+    if (isCullingOutdated) {
+        updateCullingComputePass();
+    }
+
+    return applied;
+}
+
+/**
+ * @brief Records draw commands once per viewport.
+ * Buffers and pipelines are bound only once for all viewports, and only
+ * viewport, scissor and dynamic offset of scene matrices are changed between
+ * viewports. Meshes of all viewports are drawn before the grid floor, so that
+ * the pipeline is switched only once.
+ * Culled draw commands are drawn indirectly from compacted instances of the
+ * viewport, which are rebound to instance binding.
+ * Line and point draw commands switch to the pipelines of the topology, and
+ * the scene pipeline is rebound for following triangles.
+ */
+void BasicRenderContent::recordDrawCommands(
+    vk::CommandBuffer cmdBuffer, const RenderTarget &renderTarget,
+    int frameIndex, const std::vector<SceneViewport> &viewports) {
+
+    const auto bindViewport = [&](size_t viewportIndex) {
+        cmdBuffer.setViewport(0, viewports[viewportIndex].viewport);
+        cmdBuffer.setScissor(0, viewports[viewportIndex].scissor);
+        cmdBuffer.bindDescriptorSets(
+            vk::PipelineBindPoint::eGraphics,
+            renderTarget.getGraphicsPipelineLayout(), 0, descriptorSets,
+            getDynamicOffsets(frameIndex, static_cast<int>(viewportIndex)));
+    };
+
+    // Meshes ----------
+    if (vertexBufferResource.buffer && indexBufferResource.buffer &&
+        instanceBufferResource.buffer) {
+        // binding 0: per-vertex, binding 1: per-instance
+        cmdBuffer.bindVertexBuffers(
+            0, {vertexBufferResource.buffer, instanceBufferResource.buffer},
+            {0, 0});
+        cmdBuffer.bindIndexBuffer(indexBufferResource.buffer, 0,
+                                  vk::IndexType::eUint32);
+
+        const bool isCullingActive =
+            cullingComputePass && cullingComputePass->isActive();
+        bool isInstanceBufferBound = true;
+        // scene pipeline has been bound by Window
+        auto boundTopology = BasicPrimitiveTopology::Triangles;
+        const auto bindTopology = [&](BasicPrimitiveTopology topology) {
+            if (topology == boundTopology) {
+                return;
+            }
+            switch (topology) {
+            case BasicPrimitiveTopology::Triangles:
+                cmdBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics,
+                                       renderTarget.getGraphicsPipeline());
+                break;
+            case BasicPrimitiveTopology::Lines:
+                cmdBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics,
+                                       renderTarget.getLinePipeline());
+                break;
+            case BasicPrimitiveTopology::Points:
+                cmdBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics,
+                                       renderTarget.getPointPipeline());
+                break;
+            }
+            boundTopology = topology;
+        };
+
+        for (size_t i = 0; i < viewports.size(); i++) {
+            bindViewport(i);
+
+            if (drawCommands.empty()) {
+                cmdBuffer.drawIndexed(numOfIndex, 1, 0, 0, 0);
+            }
+            for (size_t d = 0; d < drawCommands.size(); d++) {
+                if (!topologies.empty()) {
+                    bindTopology(topologies[d]);
+                }
+                if (isCullingActive && cullingComputePass->isCulled(d)) {
+                    cullingComputePass->recordDraw(
+                        cmdBuffer, frameIndex, static_cast<int>(i), d);
+                    isInstanceBufferBound = false;
+                    continue;
+                }
+
+                if (!isInstanceBufferBound) {
+                    cmdBuffer.bindVertexBuffers(
+                        1, {instanceBufferResource.buffer}, {0});
+                    isInstanceBufferBound = true;
+                }
+                const auto &command = drawCommands[d];
+                cmdBuffer.drawIndexed(command.indexCount,
+                                      command.instanceCount,
+                                      command.firstIndex, command.vertexOffset,
+                                      command.firstInstance);
+            }
+        }
+    }
+
+    // Grid floor ----------
+    // drawn last since it is blended over meshes
+    if (gridFloor.has_value() && renderTarget.getFloorPipeline()) {
+        cmdBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics,
+                               renderTarget.getFloorPipeline());
+        cmdBuffer.pushConstants(renderTarget.getGraphicsPipelineLayout(),
+                                vk::ShaderStageFlagBits::eVertex |
+                                    vk::ShaderStageFlagBits::eFragment,
+                                0, sizeof(BasicGridFloorParams),
+                                &gridFloor.value());
+
+        for (size_t i = 0; i < viewports.size(); i++) {
+            bindViewport(i);
+            cmdBuffer.draw(6, 1, 0, 0);
+        }
+    }
 }
 
-const size_t BasicRenderContent::getNumOfIndex() { return indices.size(); }
+const size_t BasicRenderContent::getNumOfIndex() { return numOfIndex; }
 
 // Demo ----------
 
@@ -258,8 +562,7 @@ void BasicRenderContent::setDemoShape() {
 }
 
 void BasicRenderContent::updateDemoUBO(std::shared_ptr<Window> window) {
-    BasicModelMatUBO modelMat;
-    modelMat.model[0] = glm::mat4(1.0);
+    std::vector<glm::mat4> modelMats = {glm::mat4(1.0)};
 
     BasicSceneMatUBO sceneMat;
     sceneMat.view =
@@ -273,7 +576,7 @@ void BasicRenderContent::updateDemoUBO(std::shared_ptr<Window> window) {
 
     // update all frame
     for (int i = 0; i < window->getNumOfFrames(); i++) {
-        updateUniformBuffer(i, modelMat, sceneMat);
+        updateUniformBuffer(i, modelMats, sceneMat);
     }
 }
 } // namespace ikura
\ No newline at end of file
@@ -1,6 +1,12 @@
 #pragma once
 
+#include <memory>
+#include <optional>
+
 #include "../renderContent.hpp"
+#include "../uniformBufferRing.hpp"
+#include "./cullingComputePass.hpp"
+#include "./skeletonComputePass.hpp"
 
 namespace ikura {
 // Forward declearation
@@ -10,27 +16,91 @@ class BasicRenderContent : public RenderContent {
   protected:
     std::vector<BasicVertex> vertices;
     std::vector<BasicIndex> indices;
+    std::vector<BasicInstance> instances = {BasicInstance::identity()};
+    // number of indices in current / pending IndexBuffer
+    size_t numOfIndex = 0;
+    size_t pendingNumOfIndex = 0;
+
+    // if empty, all indices are drawn with the first instance
+    std::vector<vk::DrawIndexedIndirectCommand> drawCommands;
+    // applied once all pending uploads complete
+    std::vector<vk::DrawIndexedIndirectCommand> pendingDrawCommands;
+    bool hasPendingDrawCommands = false;
+    // topologies[drawIndex], or empty if all draw commands are triangles
+    std::vector<BasicPrimitiveTopology> topologies;
+    std::vector<BasicPrimitiveTopology> pendingTopologies;
+
+    // culled on GPU if not empty, applied together with draw commands
+    std::vector<BasicCullingGroup> cullingGroups;
+    std::vector<BasicCullingGroup> pendingCullingGroups;
+    bool hasPendingCullingGroups = false;
+    // if false, culling groups are only selected by LOD levels
+    bool isFrustumCullingEnabled = true;
+
+    // drawn by floor pipeline of RenderTarget if set
+    std::optional<BasicGridFloorParams> gridFloor;
+
+    std::shared_ptr<UniformBufferRing> uniformBufferRing;
+    UniformSlot modelMatSlot;
+    // sceneMatSlots[viewport], contiguous in frame region
+    std::vector<UniformSlot> sceneMatSlots;
+
+    // writes model matrices of skeletons on GPU, created by the first
+    // setSkeletons()
+    std::unique_ptr<SkeletonComputePass> skeletonComputePass;
+    // created by the first non-empty setCullingGroups()
+    std::unique_ptr<CullingComputePass> cullingComputePass;
 
     void setupUniformBuffers();
     void setupDescriptorSets();
+    void updateCullingComputePass();
 
   public:
     BasicRenderContent(std::shared_ptr<RenderEngine> renderEngine,
                        vk::DescriptorSetLayout descriptorSetLayout,
-                       int numOfFrames);
+                       std::shared_ptr<UniformBufferRing> uniformBufferRing);
 
     void addVertices(const std::vector<BasicVertex> &vertices);
     void addIndices(const std::vector<BasicIndex> &indices);
     void setVertices(const std::vector<BasicVertex> &vertices);
     void setIndices(const std::vector<BasicIndex> &indices);
+    void setInstances(const std::vector<BasicInstance> &instances);
+    void setDrawCommands(
+        const std::vector<vk::DrawIndexedIndirectCommand> &drawCommands,
+        const std::vector<BasicPrimitiveTopology> &topologies = {});
+    void setGridFloor(const BasicGridFloorParams &params);
+    void removeGridFloor();
+
+    void updateUniformBuffer(int frameIndex,
+                             const std::vector<glm::mat4> &modelMats,
+                             const BasicSceneMatUBO &sceneMatUBO);
+    void
+    updateUniformBuffer(int frameIndex, const std::vector<glm::mat4> &modelMats,
+                        const std::vector<BasicSceneMatUBO> &sceneMatUBOs);
+
+    // GPU forward kinematics ----------
+    void setSkeletons(const std::vector<BasicSkeleton> &skeletons);
+    void updateSkeletonInstances(
+        int frameIndex, const std::vector<BasicSkeletonInstance> &instances);
 
-    void updateUniformBuffer(int frameIndex, BasicModelMatUBO &modelMatUBO,
-                             BasicSceneMatUBO &sceneMatUBO);
+    // GPU frustum culling ----------
+    void setCullingGroups(const std::vector<BasicCullingGroup> &groups);
+    void setFrustumCullingEnabled(bool enabled);
+    void updateLodLevels(int frameIndex, const std::vector<uint32_t> &levels);
 
     // Implementation of virtual functions ----------
     void uploadVertexBuffer() override;
     void uploadIndexBuffer() override;
+    void uploadInstanceBuffer() override;
+    bool applyCompletedUploads() override;
+    void recordComputeCommands(vk::CommandBuffer cmdBuffer,
+                               int frameIndex) override;
+    void recordDrawCommands(
+        vk::CommandBuffer cmdBuffer, const RenderTarget &renderTarget,
+        int frameIndex, const std::vector<SceneViewport> &viewports) override;
     const size_t getNumOfIndex() override;
+    std::vector<uint32_t> getDynamicOffsets(int frameIndex,
+                                            int viewportIndex = 0) const override;
 
     // Demo ----------
     void setDemoShape();
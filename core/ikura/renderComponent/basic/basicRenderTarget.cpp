@@ -1,32 +1,53 @@
 #include "./basicRenderTarget.hpp"
 
+#include <algorithm>
+
 #include <easylogging++.h>
 
 #include "../../common/logLevels.hpp"
 #include "../../common/renderPrimitiveTypes.hpp"
+#include "../../common/uniformBufferInfo.hpp"
 #include "../../misc/shaderCodes.hpp"
+#include "../../util/shaderCache.hpp"
 #include "../../util/shaderUtils.hpp"
 
 namespace ikura {
+/**
+ * @brief Creates RenderPass of scene rendering.
+ * Attachments depend on render settings:
+ * - MSAA: multisampled color / depth are resolved into the resolve target.
+ * - no MSAA: scene is rendered into the resolve target directly.
+ * The resolve target is the render image at native resolution, or the
+ * scene image which is upscaled by recordUpscale() afterwards.
+ * Model ids of drawn meshes are written into the second color attachment, and
+ * kept in the id image for picking.
+ */
 void BasicRenderTarget::setupRenderPass() {
     VLOG(VLOG_LV_3_PROCESS_TRACKING) << "Creating Default RenderPass...";
 
+    bool isMsaaEnabled = msaaSamples != vk::SampleCountFlagBits::e1;
+    auto targetFinalLayout = isUpscaling()
+                                 ? vk::ImageLayout::eTransferSrcOptimal
+                                 : vk::ImageLayout::eColorAttachmentOptimal;
+
     // Attachment Descriptions ----------
     vk::AttachmentDescription colorAttachment{};
     colorAttachment.format = colorImageFormat;
-    colorAttachment.samples =
-        renderEngine->getEngineInfo().limit.maxMsaaSamples;
+    colorAttachment.samples = msaaSamples;
     colorAttachment.loadOp = vk::AttachmentLoadOp::eClear;
-    colorAttachment.storeOp = vk::AttachmentStoreOp::eStore;
+    // multisampled color is only needed until resolve
+    colorAttachment.storeOp = isMsaaEnabled ? vk::AttachmentStoreOp::eDontCare
+                                            : vk::AttachmentStoreOp::eStore;
     colorAttachment.stencilLoadOp = vk::AttachmentLoadOp::eDontCare;
     colorAttachment.stencilStoreOp = vk::AttachmentStoreOp::eDontCare;
     colorAttachment.initialLayout = vk::ImageLayout::eUndefined;
-    colorAttachment.finalLayout = vk::ImageLayout::eColorAttachmentOptimal;
+    colorAttachment.finalLayout = isMsaaEnabled
+                                      ? vk::ImageLayout::eColorAttachmentOptimal
+                                      : targetFinalLayout;
 
     vk::AttachmentDescription depthAttachment{};
     depthAttachment.format = RenderTarget::findDepthFormat(renderEngine);
-    depthAttachment.samples =
-        renderEngine->getEngineInfo().limit.maxMsaaSamples;
+    depthAttachment.samples = msaaSamples;
     depthAttachment.loadOp = vk::AttachmentLoadOp::eClear;
     depthAttachment.storeOp = vk::AttachmentStoreOp::eDontCare;
     depthAttachment.stencilLoadOp = vk::AttachmentLoadOp::eDontCare;
@@ -43,81 +64,200 @@ void BasicRenderTarget::setupRenderPass() {
     colorAttachmentResolve.stencilLoadOp = vk::AttachmentLoadOp::eDontCare;
     colorAttachmentResolve.stencilStoreOp = vk::AttachmentStoreOp::eDontCare;
     colorAttachmentResolve.initialLayout = vk::ImageLayout::eUndefined;
-    colorAttachmentResolve.finalLayout = vk::ImageLayout::ePresentSrcKHR;
+    colorAttachmentResolve.finalLayout = targetFinalLayout;
+
+    // id image is copied by recordPickReadback() after this RenderPass
+    vk::AttachmentDescription idAttachment{};
+    idAttachment.format = ID_IMAGE_FORMAT;
+    idAttachment.samples = msaaSamples;
+    idAttachment.loadOp = vk::AttachmentLoadOp::eClear;
+    idAttachment.storeOp = isMsaaEnabled ? vk::AttachmentStoreOp::eDontCare
+                                         : vk::AttachmentStoreOp::eStore;
+    idAttachment.stencilLoadOp = vk::AttachmentLoadOp::eDontCare;
+    idAttachment.stencilStoreOp = vk::AttachmentStoreOp::eDontCare;
+    idAttachment.initialLayout = vk::ImageLayout::eUndefined;
+    idAttachment.finalLayout = isMsaaEnabled
+                                   ? vk::ImageLayout::eColorAttachmentOptimal
+                                   : vk::ImageLayout::eTransferSrcOptimal;
+
+    // integer attachments are resolved by taking sample 0
+    vk::AttachmentDescription idAttachmentResolve = colorAttachmentResolve;
+    idAttachmentResolve.format = ID_IMAGE_FORMAT;
+    idAttachmentResolve.finalLayout = vk::ImageLayout::eTransferSrcOptimal;
 
     // Attachment Refs ----------
-    vk::AttachmentReference colorAttachmentRef{
-        0, vk::ImageLayout::eColorAttachmentOptimal};
+    // 0: color, 1: depth, 2: id, (MSAA only) 3: color resolve, 4: id resolve
+    std::array<vk::AttachmentReference, 2> colorAttachmentRefs = {
+        vk::AttachmentReference{0, vk::ImageLayout::eColorAttachmentOptimal},
+        vk::AttachmentReference{2, vk::ImageLayout::eColorAttachmentOptimal}};
     vk::AttachmentReference depthAttachmentRef{
         1, vk::ImageLayout::eDepthStencilAttachmentOptimal};
-    vk::AttachmentReference colorAttachmentResolveRef{
-        2, vk::ImageLayout::eColorAttachmentOptimal};
+    std::array<vk::AttachmentReference, 2> resolveAttachmentRefs = {
+        vk::AttachmentReference{3, vk::ImageLayout::eColorAttachmentOptimal},
+        vk::AttachmentReference{4, vk::ImageLayout::eColorAttachmentOptimal}};
 
     // Subpass / Dependency ----------
     vk::SubpassDescription subpass{};
     subpass.pipelineBindPoint = vk::PipelineBindPoint::eGraphics;
-    subpass.colorAttachmentCount = 1;
-    subpass.pColorAttachments = &colorAttachmentRef;
+    subpass.colorAttachmentCount = colorAttachmentRefs.size();
+    subpass.pColorAttachments = colorAttachmentRefs.data();
     subpass.pDepthStencilAttachment = &depthAttachmentRef;
-    subpass.pResolveAttachments = &colorAttachmentResolveRef;
-
-    vk::SubpassDependency dependency{};
-    // source
-    dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-    dependency.srcStageMask =
+    subpass.pResolveAttachments =
+        isMsaaEnabled ? resolveAttachmentRefs.data() : nullptr;
+
+    std::array<vk::SubpassDependency, 2> dependencies{};
+    // previous frame may still use attachments shared between frames
+    // (written as attachments, or read by upscale blit)
+    dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+    dependencies[0].srcStageMask =
         (vk::PipelineStageFlagBits::eColorAttachmentOutput |
-         vk::PipelineStageFlagBits::eEarlyFragmentTests);
-    dependency.srcAccessMask = vk::AccessFlagBits::eNoneKHR;
-    // destination
-    dependency.dstSubpass = 0;
-    dependency.dstStageMask =
+         vk::PipelineStageFlagBits::eLateFragmentTests |
+         vk::PipelineStageFlagBits::eTransfer);
+    dependencies[0].srcAccessMask =
+        (vk::AccessFlagBits::eColorAttachmentWrite |
+         vk::AccessFlagBits::eDepthStencilAttachmentWrite);
+    dependencies[0].dstSubpass = 0;
+    dependencies[0].dstStageMask =
         (vk::PipelineStageFlagBits::eColorAttachmentOutput |
          vk::PipelineStageFlagBits::eEarlyFragmentTests);
-    dependency.dstAccessMask =
+    dependencies[0].dstAccessMask =
         (vk::AccessFlagBits::eColorAttachmentWrite |
          vk::AccessFlagBits::eDepthStencilAttachmentWrite);
+    // rendered scene is read by upscale blit or overlayRenderPass, and id
+    // image by pick readback
+    dependencies[1].srcSubpass = 0;
+    dependencies[1].srcStageMask =
+        vk::PipelineStageFlagBits::eColorAttachmentOutput;
+    dependencies[1].srcAccessMask = vk::AccessFlagBits::eColorAttachmentWrite;
+    dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+    dependencies[1].dstStageMask =
+        (vk::PipelineStageFlagBits::eTransfer |
+         vk::PipelineStageFlagBits::eColorAttachmentOutput);
+    dependencies[1].dstAccessMask =
+        (vk::AccessFlagBits::eTransferRead |
+         vk::AccessFlagBits::eColorAttachmentRead |
+         vk::AccessFlagBits::eColorAttachmentWrite);
 
     // RenderPass ----------
-    std::array<vk::AttachmentDescription, 3> attachments = {
-        colorAttachment, depthAttachment, colorAttachmentResolve};
+    std::array<vk::AttachmentDescription, 5> attachments = {
+        colorAttachment, depthAttachment, idAttachment, colorAttachmentResolve,
+        idAttachmentResolve};
     vk::RenderPassCreateInfo renderPassCI{};
-    renderPassCI.attachmentCount = attachments.size();
+    renderPassCI.attachmentCount = isMsaaEnabled ? 5 : 3;
     renderPassCI.pAttachments = attachments.data();
     renderPassCI.subpassCount = 1;
     renderPassCI.pSubpasses = &subpass;
-    renderPassCI.dependencyCount = 1;
-    renderPassCI.pDependencies = &dependency;
+    renderPassCI.dependencyCount = dependencies.size();
+    renderPassCI.pDependencies = dependencies.data();
 
     renderPass = renderEngine->getDevice().createRenderPass(renderPassCI);
     VLOG(VLOG_LV_3_PROCESS_TRACKING) << "Default RenderPass has been created.";
 }
 
+/**
+ * @brief Creates RenderPass which draws overlays onto rendered render image.
+ * It has no MSAA and does not depend on render settings, so pipelines of
+ * VirtualWindows are never rebuilt.
+ */
+void BasicRenderTarget::setupOverlayRenderPass() {
+    VLOG(VLOG_LV_3_PROCESS_TRACKING) << "Creating overlay RenderPass...";
+
+    vk::AttachmentDescription colorAttachment{};
+    colorAttachment.format = colorImageFormat;
+    colorAttachment.samples = vk::SampleCountFlagBits::e1;
+    colorAttachment.loadOp = vk::AttachmentLoadOp::eLoad;
+    colorAttachment.storeOp = vk::AttachmentStoreOp::eStore;
+    colorAttachment.stencilLoadOp = vk::AttachmentLoadOp::eDontCare;
+    colorAttachment.stencilStoreOp = vk::AttachmentStoreOp::eDontCare;
+    colorAttachment.initialLayout = vk::ImageLayout::eColorAttachmentOptimal;
+    colorAttachment.finalLayout = renderImageFinalLayout;
+
+    vk::AttachmentReference colorAttachmentRef{
+        0, vk::ImageLayout::eColorAttachmentOptimal};
+
+    vk::SubpassDescription subpass{};
+    subpass.pipelineBindPoint = vk::PipelineBindPoint::eGraphics;
+    subpass.colorAttachmentCount = 1;
+    subpass.pColorAttachments = &colorAttachmentRef;
+
+    // render image is written by renderPass or upscale blit
+    vk::SubpassDependency dependency{};
+    dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+    dependency.srcStageMask =
+        (vk::PipelineStageFlagBits::eColorAttachmentOutput |
+         vk::PipelineStageFlagBits::eTransfer);
+    dependency.srcAccessMask = (vk::AccessFlagBits::eColorAttachmentWrite |
+                                vk::AccessFlagBits::eTransferWrite);
+    dependency.dstSubpass = 0;
+    dependency.dstStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput;
+    dependency.dstAccessMask = (vk::AccessFlagBits::eColorAttachmentRead |
+                                vk::AccessFlagBits::eColorAttachmentWrite);
+    std::vector<vk::SubpassDependency> dependencies = {dependency};
+
+    // render image is copied right after renderPass (offscreen readback)
+    if (renderImageFinalLayout == vk::ImageLayout::eTransferSrcOptimal) {
+        vk::SubpassDependency readbackDependency{};
+        readbackDependency.srcSubpass = 0;
+        readbackDependency.srcStageMask =
+            vk::PipelineStageFlagBits::eColorAttachmentOutput;
+        readbackDependency.srcAccessMask =
+            vk::AccessFlagBits::eColorAttachmentWrite;
+        readbackDependency.dstSubpass = VK_SUBPASS_EXTERNAL;
+        readbackDependency.dstStageMask = vk::PipelineStageFlagBits::eTransfer;
+        readbackDependency.dstAccessMask = vk::AccessFlagBits::eTransferRead;
+        dependencies.push_back(readbackDependency);
+    }
+
+    vk::RenderPassCreateInfo renderPassCI{};
+    renderPassCI.attachmentCount = 1;
+    renderPassCI.pAttachments = &colorAttachment;
+    renderPassCI.subpassCount = 1;
+    renderPassCI.pSubpasses = &subpass;
+    renderPassCI.dependencyCount = static_cast<uint32_t>(dependencies.size());
+    renderPassCI.pDependencies = dependencies.data();
+
+    overlayRenderPass =
+        renderEngine->getDevice().createRenderPass(renderPassCI);
+    VLOG(VLOG_LV_3_PROCESS_TRACKING) << "Overlay RenderPass has been created.";
+}
+
 void BasicRenderTarget::setupImageResources() {
     VLOG(VLOG_LV_3_PROCESS_TRACKING) << "Creating default ImageResources...";
-    // Color Image
-    createImage(colorImageResource, imageExtent, 1,
-                renderEngine->getEngineInfo().limit.maxMsaaSamples,
-                colorImageFormat, vk::ImageTiling::eOptimal,
-                vk::ImageUsageFlagBits::eTransientAttachment |
-                    vk::ImageUsageFlagBits::eColorAttachment,
-                vk::MemoryPropertyFlagBits::eDeviceLocal,
-                *renderEngine->getVmaAllocator());
 
-    VLOG(VLOG_LV_3_PROCESS_TRACKING) << "Color Image has been created.";
-
-    createImageView(colorImageResource, colorImageFormat,
-                    vk::ImageAspectFlagBits::eColor, 1,
-                    renderEngine->getDevice());
+    // MSAA attachments are never stored, so memory can be lazily allocated
+    vk::MemoryPropertyFlags attachmentMemoryProperties =
+        vk::MemoryPropertyFlagBits::eDeviceLocal;
+    if (renderEngine->getEngineInfo()
+            .support.isLazilyAllocatedMemorySupported) {
+        attachmentMemoryProperties |=
+            vk::MemoryPropertyFlagBits::eLazilyAllocated;
+    }
 
-    VLOG(VLOG_LV_3_PROCESS_TRACKING) << "Color ImageView has been created.";
+    // Color Image
+    if (msaaSamples != vk::SampleCountFlagBits::e1) {
+        createImage(colorImageResource, renderExtent, 1, msaaSamples,
+                    colorImageFormat, vk::ImageTiling::eOptimal,
+                    vk::ImageUsageFlagBits::eTransientAttachment |
+                        vk::ImageUsageFlagBits::eColorAttachment,
+                    attachmentMemoryProperties,
+                    *renderEngine->getVmaAllocator());
+
+        VLOG(VLOG_LV_3_PROCESS_TRACKING) << "Color Image has been created.";
+
+        createImageView(colorImageResource, colorImageFormat,
+                        vk::ImageAspectFlagBits::eColor, 1,
+                        renderEngine->getDevice());
+
+        VLOG(VLOG_LV_3_PROCESS_TRACKING)
+            << "Color ImageView has been created.";
+    }
 
     // Depth Image
-    createImage(depthImageResource, imageExtent, 1,
-                renderEngine->getEngineInfo().limit.maxMsaaSamples,
+    createImage(depthImageResource, renderExtent, 1, msaaSamples,
                 findDepthFormat(renderEngine), vk::ImageTiling::eOptimal,
-                vk::ImageUsageFlagBits::eDepthStencilAttachment,
-                vk::MemoryPropertyFlagBits::eDeviceLocal,
-                *renderEngine->getVmaAllocator());
+                vk::ImageUsageFlagBits::eTransientAttachment |
+                    vk::ImageUsageFlagBits::eDepthStencilAttachment,
+                attachmentMemoryProperties, *renderEngine->getVmaAllocator());
 
     VLOG(VLOG_LV_3_PROCESS_TRACKING) << "Depth Image has been created.";
 
@@ -125,6 +265,47 @@ void BasicRenderTarget::setupImageResources() {
                     vk::ImageAspectFlagBits::eDepth, 1,
                     renderEngine->getDevice());
 
+    // Scene Image (source of upscale)
+    if (isUpscaling()) {
+        createImage(sceneImageResource, renderExtent, 1,
+                    vk::SampleCountFlagBits::e1, colorImageFormat,
+                    vk::ImageTiling::eOptimal,
+                    vk::ImageUsageFlagBits::eColorAttachment |
+                        vk::ImageUsageFlagBits::eTransferSrc,
+                    vk::MemoryPropertyFlagBits::eDeviceLocal,
+                    *renderEngine->getVmaAllocator());
+
+        createImageView(sceneImageResource, colorImageFormat,
+                        vk::ImageAspectFlagBits::eColor, 1,
+                        renderEngine->getDevice());
+
+        VLOG(VLOG_LV_3_PROCESS_TRACKING) << "Scene Image has been created.";
+    }
+
+    // ID Images (multisampled one is resolved into single sampled one)
+    if (msaaSamples != vk::SampleCountFlagBits::e1) {
+        createImage(multisampledIdImageResource, renderExtent, 1, msaaSamples,
+                    ID_IMAGE_FORMAT, vk::ImageTiling::eOptimal,
+                    vk::ImageUsageFlagBits::eTransientAttachment |
+                        vk::ImageUsageFlagBits::eColorAttachment,
+                    attachmentMemoryProperties,
+                    *renderEngine->getVmaAllocator());
+        createImageView(multisampledIdImageResource, ID_IMAGE_FORMAT,
+                        vk::ImageAspectFlagBits::eColor, 1,
+                        renderEngine->getDevice());
+    }
+    createImage(idImageResource, renderExtent, 1, vk::SampleCountFlagBits::e1,
+                ID_IMAGE_FORMAT, vk::ImageTiling::eOptimal,
+                vk::ImageUsageFlagBits::eColorAttachment |
+                    vk::ImageUsageFlagBits::eTransferSrc,
+                vk::MemoryPropertyFlagBits::eDeviceLocal,
+                *renderEngine->getVmaAllocator());
+    createImageView(idImageResource, ID_IMAGE_FORMAT,
+                    vk::ImageAspectFlagBits::eColor, 1,
+                    renderEngine->getDevice());
+
+    VLOG(VLOG_LV_3_PROCESS_TRACKING) << "ID Images have been created.";
+
     VLOG(VLOG_LV_3_PROCESS_TRACKING)
         << "Default ImageResources has been created.";
 }
@@ -135,17 +316,28 @@ void BasicRenderTarget::setupFrameBuffers() {
     frameBuffers.resize(numOfColorImages);
 
     for (int i = 0; i < numOfColorImages; i++) {
-        std::array<vk::ImageView, 3> attachments = {
-            colorImageResource.view, depthImageResource.view,
-            renderImageResources[i].view};
+        const vk::ImageView &target = isUpscaling()
+                                          ? sceneImageResource.view
+                                          : renderImageResources[i].view;
+
+        // attachment order must match with setupRenderPass()
+        std::vector<vk::ImageView> attachments;
+        if (msaaSamples != vk::SampleCountFlagBits::e1) {
+            attachments = {colorImageResource.view, depthImageResource.view,
+                           multisampledIdImageResource.view, target,
+                           idImageResource.view};
+        } else {
+            attachments = {target, depthImageResource.view,
+                           idImageResource.view};
+        }
 
         vk::FramebufferCreateInfo frameBufferCI{};
         frameBufferCI.renderPass = renderPass;
         frameBufferCI.attachmentCount =
             static_cast<uint32_t>(attachments.size());
         frameBufferCI.pAttachments = attachments.data();
-        frameBufferCI.width = imageExtent.width;
-        frameBufferCI.height = imageExtent.height;
+        frameBufferCI.width = renderExtent.width;
+        frameBufferCI.height = renderExtent.height;
         frameBufferCI.layers = 1;
 
         vk::Result result = renderEngine->getDevice().createFramebuffer(
@@ -168,6 +360,26 @@ void BasicRenderTarget::setupFrameBuffers() {
         << "Default FrameBuffers has been created.";
 }
 
+void BasicRenderTarget::setupOverlayFrameBuffers() {
+    overlayFrameBuffers.resize(numOfColorImages);
+
+    for (int i = 0; i < numOfColorImages; i++) {
+        vk::FramebufferCreateInfo frameBufferCI{};
+        frameBufferCI.renderPass = overlayRenderPass;
+        frameBufferCI.attachmentCount = 1;
+        frameBufferCI.pAttachments = &renderImageResources[i].view;
+        frameBufferCI.width = imageExtent.width;
+        frameBufferCI.height = imageExtent.height;
+        frameBufferCI.layers = 1;
+
+        overlayFrameBuffers[i] =
+            renderEngine->getDevice().createFramebuffer(frameBufferCI);
+    }
+
+    VLOG(VLOG_LV_3_PROCESS_TRACKING)
+        << "Overlay FrameBuffers has been created.";
+}
+
 void BasicRenderTarget::setupGraphicsPipeline() {
     VLOG(VLOG_LV_3_PROCESS_TRACKING) << "Creating default GraphicsPipeline...";
 
@@ -179,12 +391,12 @@ void BasicRenderTarget::setupGraphicsPipeline() {
     //        createResourceDirectoryPath(std::filesystem::path("shaders") /
     //        "frag.spv"), renderEngine->getDevice());
 
-    auto vertShader = compileShader(ikura::VERTEX_SHADER_CODE, EShLangVertex);
+    auto vertShader = getShaderSpirv(ikura::VERTEX_SHADER_CODE, EShLangVertex);
     auto vertShaderModule =
         createShaderModule(vertShader, renderEngine->getDevice());
 
     auto fragShader =
-        compileShader(ikura::FRAGMENT_SHADER_CODE, EShLangFragment);
+        getShaderSpirv(ikura::FRAGMENT_SHADER_CODE, EShLangFragment);
     auto fragShaderModule =
         createShaderModule(fragShader, renderEngine->getDevice());
 
@@ -201,13 +413,22 @@ void BasicRenderTarget::setupGraphicsPipeline() {
     std::array<vk::PipelineShaderStageCreateInfo, 2> shaderStages = {
         vertShaderStageCI, fragShaderStageCI};
 
-    auto bindingDescription = BasicVertex::getBindingDescription();
+    // binding 0: per-vertex, binding 1: per-instance
+    std::array<vk::VertexInputBindingDescription, 2> bindingDescriptions = {
+        BasicVertex::getBindingDescription(),
+        BasicInstance::getBindingDescription()};
     auto attributeDescriptions = BasicVertex::getAttributeDescriptions();
+    auto instanceAttributeDescriptions =
+        BasicInstance::getAttributeDescriptions();
+    attributeDescriptions.insert(attributeDescriptions.end(),
+                                 instanceAttributeDescriptions.begin(),
+                                 instanceAttributeDescriptions.end());
 
     // Pipeline input states ----------
     vk::PipelineVertexInputStateCreateInfo vertInputStateCI{};
-    vertInputStateCI.vertexBindingDescriptionCount = 1;
-    vertInputStateCI.pVertexBindingDescriptions = &bindingDescription;
+    vertInputStateCI.vertexBindingDescriptionCount =
+        static_cast<uint32_t>(bindingDescriptions.size());
+    vertInputStateCI.pVertexBindingDescriptions = bindingDescriptions.data();
     vertInputStateCI.vertexAttributeDescriptionCount =
         static_cast<uint32_t>(attributeDescriptions.size());
     vertInputStateCI.pVertexAttributeDescriptions =
@@ -218,24 +439,10 @@ void BasicRenderTarget::setupGraphicsPipeline() {
     inputAssemblyCI.primitiveRestartEnable = VK_FALSE;
 
     // Viewport state ----------
-    vk::Viewport viewport{};
-    viewport.x = 0.0f;
-    viewport.y = 0.0f;
-    viewport.width = (float)imageExtent.width;
-    viewport.height = (float)imageExtent.height;
-    viewport.minDepth = 0.0f;
-    viewport.maxDepth = 1.0f;
-
-    vk::Rect2D scissor{};
-    scissor.offset.x = 0;
-    scissor.offset.y = 0;
-    scissor.extent = imageExtent;
-
+    // viewport and scissor are dynamic, so pipeline does not depend on extent
     vk::PipelineViewportStateCreateInfo viewportStateCI{};
     viewportStateCI.viewportCount = 1;
-    viewportStateCI.pViewports = &viewport;
     viewportStateCI.scissorCount = 1;
-    viewportStateCI.pScissors = &scissor;
 
     // Other states (render configrations) ----------
     vk::PipelineRasterizationStateCreateInfo rasterizerCI{};
@@ -249,8 +456,7 @@ void BasicRenderTarget::setupGraphicsPipeline() {
 
     vk::PipelineMultisampleStateCreateInfo multisamplingCI{};
     multisamplingCI.sampleShadingEnable = VK_FALSE;
-    multisamplingCI.rasterizationSamples =
-        renderEngine->getEngineInfo().limit.maxMsaaSamples;
+    multisamplingCI.rasterizationSamples = msaaSamples;
     multisamplingCI.minSampleShading = 1.0f;
     multisamplingCI.pSampleMask = nullptr;
 
@@ -259,8 +465,8 @@ void BasicRenderTarget::setupGraphicsPipeline() {
     depthStencil.depthWriteEnable = VK_TRUE;
     depthStencil.depthCompareOp = vk::CompareOp::eLess;
 
-    std::vector<vk::DynamicState> dynamicStates = {
-        vk::DynamicState::eViewport, vk::DynamicState::eLineWidth};
+    std::array<vk::DynamicState, 2> dynamicStates = {
+        vk::DynamicState::eViewport, vk::DynamicState::eScissor};
     vk::PipelineDynamicStateCreateInfo dynamicStateCI{};
     dynamicStateCI.dynamicStateCount =
         static_cast<uint32_t>(dynamicStates.size());
@@ -279,25 +485,43 @@ void BasicRenderTarget::setupGraphicsPipeline() {
     colorBlendAttachmentState.dstAlphaBlendFactor = vk::BlendFactor::eZero;
     colorBlendAttachmentState.alphaBlendOp = vk::BlendOp::eAdd;
 
+    // id is written as it is (integer attachments cannot be blended)
+    vk::PipelineColorBlendAttachmentState idBlendAttachmentState{};
+    idBlendAttachmentState.colorWriteMask = vk::ColorComponentFlagBits::eR;
+    idBlendAttachmentState.blendEnable = VK_FALSE;
+
+    std::array<vk::PipelineColorBlendAttachmentState, 2> blendAttachmentStates =
+        {colorBlendAttachmentState, idBlendAttachmentState};
+
     vk::PipelineColorBlendStateCreateInfo colorBlendStateCI{};
     colorBlendStateCI.logicOpEnable = VK_FALSE;
     colorBlendStateCI.logicOp = vk::LogicOp::eCopy;
-    colorBlendStateCI.attachmentCount = 1;
-    colorBlendStateCI.pAttachments = &colorBlendAttachmentState;
+    colorBlendStateCI.attachmentCount = blendAttachmentStates.size();
+    colorBlendStateCI.pAttachments = blendAttachmentStates.data();
     colorBlendStateCI.blendConstants[0] = 0.0f;
     colorBlendStateCI.blendConstants[1] = 0.0f;
     colorBlendStateCI.blendConstants[2] = 0.0f;
     colorBlendStateCI.blendConstants[3] = 0.0f;
 
     // Pipeline layout ----------
-    vk::PipelineLayoutCreateInfo pipelineLayoutCI{};
-    pipelineLayoutCI.setLayoutCount = 1;
-    pipelineLayoutCI.pSetLayouts = &descriptorSetLayout;
-    pipelineLayoutCI.pushConstantRangeCount = 0;
-    pipelineLayoutCI.pPushConstantRanges = nullptr;
-
-    graphicsPipelineLayout =
-        renderEngine->getDevice().createPipelineLayout(pipelineLayoutCI);
+    // layout does not depend on render settings, created only once
+    if (!graphicsPipelineLayout) {
+        // push constants are used by floor pipeline
+        vk::PushConstantRange pushConstantRange{};
+        pushConstantRange.stageFlags = vk::ShaderStageFlagBits::eVertex |
+                                       vk::ShaderStageFlagBits::eFragment;
+        pushConstantRange.offset = 0;
+        pushConstantRange.size = sizeof(BasicGridFloorParams);
+
+        vk::PipelineLayoutCreateInfo pipelineLayoutCI{};
+        pipelineLayoutCI.setLayoutCount = 1;
+        pipelineLayoutCI.pSetLayouts = &descriptorSetLayout;
+        pipelineLayoutCI.pushConstantRangeCount = 1;
+        pipelineLayoutCI.pPushConstantRanges = &pushConstantRange;
+
+        graphicsPipelineLayout =
+            renderEngine->getDevice().createPipelineLayout(pipelineLayoutCI);
+    }
 
     // GraphicsPipeline ----------
     vk::GraphicsPipelineCreateInfo graphicsPipelineCI{};
@@ -311,7 +535,7 @@ void BasicRenderTarget::setupGraphicsPipeline() {
     graphicsPipelineCI.pMultisampleState = &multisamplingCI;
     graphicsPipelineCI.pDepthStencilState = nullptr;
     graphicsPipelineCI.pColorBlendState = &colorBlendStateCI;
-    graphicsPipelineCI.pDynamicState = nullptr;
+    graphicsPipelineCI.pDynamicState = &dynamicStateCI;
     graphicsPipelineCI.pDepthStencilState = &depthStencil;
 
     graphicsPipelineCI.layout = graphicsPipelineLayout;
@@ -321,7 +545,7 @@ void BasicRenderTarget::setupGraphicsPipeline() {
     graphicsPipelineCI.basePipelineIndex = -1;
 
     auto result = renderEngine->getDevice().createGraphicsPipeline(
-        VK_NULL_HANDLE, graphicsPipelineCI);
+        renderEngine->getPipelineCache(), graphicsPipelineCI);
     switch (result.result) {
     case vk::Result::eErrorOutOfHostMemory:
         throw std::runtime_error(
@@ -339,6 +563,48 @@ void BasicRenderTarget::setupGraphicsPipeline() {
     }
     graphicsPipeline = result.value;
 
+    // Line / point variants ----------
+    // low detail meshes, drawn with the same vertex layout and descriptors
+    rasterizerCI.cullMode = vk::CullModeFlagBits::eNone;
+
+    inputAssemblyCI.topology = vk::PrimitiveTopology::eLineList;
+    auto lineResult = renderEngine->getDevice().createGraphicsPipeline(
+        renderEngine->getPipelineCache(), graphicsPipelineCI);
+    if (lineResult.result != vk::Result::eSuccess) {
+        throw std::runtime_error("Failed to create line GraphicsPipeline.");
+    }
+    linePipeline = lineResult.value;
+
+    // point list requires vertex shader writing point size
+    auto pointVertShader =
+        getShaderSpirv(ikura::POINT_VERTEX_SHADER_CODE, EShLangVertex);
+    auto pointVertShaderModule =
+        createShaderModule(pointVertShader, renderEngine->getDevice());
+
+    const float pointSize = std::min(
+        POINT_SPRITE_SIZE, renderEngine->getEngineInfo().limit.maxPointSize);
+    vk::SpecializationMapEntry pointSizeEntry{};
+    pointSizeEntry.constantID = 0;
+    pointSizeEntry.offset = 0;
+    pointSizeEntry.size = sizeof(pointSize);
+    vk::SpecializationInfo pointSpecializationInfo{};
+    pointSpecializationInfo.mapEntryCount = 1;
+    pointSpecializationInfo.pMapEntries = &pointSizeEntry;
+    pointSpecializationInfo.dataSize = sizeof(pointSize);
+    pointSpecializationInfo.pData = &pointSize;
+
+    shaderStages[0].module = pointVertShaderModule;
+    shaderStages[0].pSpecializationInfo = &pointSpecializationInfo;
+    inputAssemblyCI.topology = vk::PrimitiveTopology::ePointList;
+    auto pointResult = renderEngine->getDevice().createGraphicsPipeline(
+        renderEngine->getPipelineCache(), graphicsPipelineCI);
+    renderEngine->getDevice().destroyShaderModule(pointVertShaderModule,
+                                                  nullptr);
+    if (pointResult.result != vk::Result::eSuccess) {
+        throw std::runtime_error("Failed to create point GraphicsPipeline.");
+    }
+    pointPipeline = pointResult.value;
+
     renderEngine->getDevice().destroyShaderModule(vertShaderModule, nullptr);
     renderEngine->getDevice().destroyShaderModule(fragShaderModule, nullptr);
 
@@ -346,19 +612,163 @@ void BasicRenderTarget::setupGraphicsPipeline() {
         << "Default GraphicsPipeline has been created.";
 }
 
+/**
+ * @brief Creates pipeline of procedural grid floor.
+ * It has no vertex input, and is drawn after opaque objects with alpha
+ * blending and without depth write. graphicsPipelineLayout must be created.
+ */
+void BasicRenderTarget::setupFloorPipeline() {
+    VLOG(VLOG_LV_3_PROCESS_TRACKING) << "Creating floor GraphicsPipeline...";
+
+    // ShaderModules ----------
+    auto vertShader =
+        getShaderSpirv(ikura::GRID_FLOOR_VERTEX_SHADER_CODE, EShLangVertex);
+    auto vertShaderModule =
+        createShaderModule(vertShader, renderEngine->getDevice());
+
+    auto fragShader =
+        getShaderSpirv(ikura::GRID_FLOOR_FRAGMENT_SHADER_CODE, EShLangFragment);
+    auto fragShaderModule =
+        createShaderModule(fragShader, renderEngine->getDevice());
+
+    vk::PipelineShaderStageCreateInfo vertShaderStageCI{};
+    vertShaderStageCI.stage = vk::ShaderStageFlagBits::eVertex;
+    vertShaderStageCI.module = vertShaderModule;
+    vertShaderStageCI.pName = "main";
+
+    vk::PipelineShaderStageCreateInfo fragShaderStageCI{};
+    fragShaderStageCI.stage = vk::ShaderStageFlagBits::eFragment;
+    fragShaderStageCI.module = fragShaderModule;
+    fragShaderStageCI.pName = "main";
+
+    std::array<vk::PipelineShaderStageCreateInfo, 2> shaderStages = {
+        vertShaderStageCI, fragShaderStageCI};
+
+    // Pipeline input states ----------
+    // vertices are generated from gl_VertexIndex
+    vk::PipelineVertexInputStateCreateInfo vertInputStateCI{};
+
+    vk::PipelineInputAssemblyStateCreateInfo inputAssemblyCI{};
+    inputAssemblyCI.topology = vk::PrimitiveTopology::eTriangleList;
+    inputAssemblyCI.primitiveRestartEnable = VK_FALSE;
+
+    // Viewport state ----------
+    // viewport and scissor are dynamic, so pipeline does not depend on extent
+    vk::PipelineViewportStateCreateInfo viewportStateCI{};
+    viewportStateCI.viewportCount = 1;
+    viewportStateCI.scissorCount = 1;
+
+    // Other states (render configrations) ----------
+    vk::PipelineRasterizationStateCreateInfo rasterizerCI{};
+    rasterizerCI.depthClampEnable = VK_FALSE;
+    rasterizerCI.rasterizerDiscardEnable = VK_FALSE;
+    rasterizerCI.polygonMode = vk::PolygonMode::eFill;
+    rasterizerCI.lineWidth = 1.0f;
+    // visible from both sides
+    rasterizerCI.cullMode = vk::CullModeFlagBits::eNone;
+    rasterizerCI.frontFace = vk::FrontFace::eCounterClockwise;
+    rasterizerCI.depthBiasEnable = VK_FALSE;
+
+    vk::PipelineMultisampleStateCreateInfo multisamplingCI{};
+    multisamplingCI.sampleShadingEnable = VK_FALSE;
+    multisamplingCI.rasterizationSamples = msaaSamples;
+    multisamplingCI.minSampleShading = 1.0f;
+    multisamplingCI.pSampleMask = nullptr;
+
+    vk::PipelineDepthStencilStateCreateInfo depthStencil{};
+    depthStencil.depthTestEnable = VK_TRUE;
+    depthStencil.depthWriteEnable = VK_FALSE;
+    depthStencil.depthCompareOp = vk::CompareOp::eLessOrEqual;
+    std::array<vk::DynamicState, 2> dynamicStates = {
+        vk::DynamicState::eViewport, vk::DynamicState::eScissor};
+    vk::PipelineDynamicStateCreateInfo dynamicStateCI{};
+    dynamicStateCI.dynamicStateCount =
+        static_cast<uint32_t>(dynamicStates.size());
+    dynamicStateCI.pDynamicStates = dynamicStates.data();
+
+    // Color blend ----------
+    vk::PipelineColorBlendAttachmentState colorBlendAttachmentState{};
+    colorBlendAttachmentState.colorWriteMask =
+        vk::ColorComponentFlagBits::eA | vk::ColorComponentFlagBits::eR |
+        vk::ColorComponentFlagBits::eG | vk::ColorComponentFlagBits::eB;
+    colorBlendAttachmentState.blendEnable = VK_TRUE;
+    colorBlendAttachmentState.srcColorBlendFactor =
+        vk::BlendFactor::eSrcAlpha;
+    colorBlendAttachmentState.dstColorBlendFactor =
+        vk::BlendFactor::eOneMinusSrcAlpha;
+    colorBlendAttachmentState.colorBlendOp = vk::BlendOp::eAdd;
+    colorBlendAttachmentState.srcAlphaBlendFactor = vk::BlendFactor::eOne;
+    colorBlendAttachmentState.dstAlphaBlendFactor =
+        vk::BlendFactor::eOneMinusSrcAlpha;
+    colorBlendAttachmentState.alphaBlendOp = vk::BlendOp::eAdd;
+
+    // floor is not pickable, ids of objects behind it are kept
+    vk::PipelineColorBlendAttachmentState idBlendAttachmentState{};
+    idBlendAttachmentState.colorWriteMask = {};
+    idBlendAttachmentState.blendEnable = VK_FALSE;
+
+    std::array<vk::PipelineColorBlendAttachmentState, 2> blendAttachmentStates =
+        {colorBlendAttachmentState, idBlendAttachmentState};
+
+    vk::PipelineColorBlendStateCreateInfo colorBlendStateCI{};
+    colorBlendStateCI.logicOpEnable = VK_FALSE;
+    colorBlendStateCI.logicOp = vk::LogicOp::eCopy;
+    colorBlendStateCI.attachmentCount = blendAttachmentStates.size();
+    colorBlendStateCI.pAttachments = blendAttachmentStates.data();
+
+    // GraphicsPipeline ----------
+    vk::GraphicsPipelineCreateInfo graphicsPipelineCI{};
+    graphicsPipelineCI.stageCount = 2;
+    graphicsPipelineCI.pStages = shaderStages.data();
+
+    graphicsPipelineCI.pVertexInputState = &vertInputStateCI;
+    graphicsPipelineCI.pInputAssemblyState = &inputAssemblyCI;
+    graphicsPipelineCI.pViewportState = &viewportStateCI;
+    graphicsPipelineCI.pRasterizationState = &rasterizerCI;
+    graphicsPipelineCI.pMultisampleState = &multisamplingCI;
+    graphicsPipelineCI.pColorBlendState = &colorBlendStateCI;
+    graphicsPipelineCI.pDynamicState = &dynamicStateCI;
+    graphicsPipelineCI.pDepthStencilState = &depthStencil;
+
+    graphicsPipelineCI.layout = graphicsPipelineLayout;
+    graphicsPipelineCI.renderPass = renderPass;
+    graphicsPipelineCI.subpass = 0;
+    graphicsPipelineCI.basePipelineHandle = VK_NULL_HANDLE;
+    graphicsPipelineCI.basePipelineIndex = -1;
+
+    auto result = renderEngine->getDevice().createGraphicsPipeline(
+        renderEngine->getPipelineCache(), graphicsPipelineCI);
+    if (result.result != vk::Result::eSuccess) {
+        throw std::runtime_error("Failed to create floor GraphicsPipeline.");
+    }
+    floorPipeline = result.value;
+
+    renderEngine->getDevice().destroyShaderModule(vertShaderModule, nullptr);
+    renderEngine->getDevice().destroyShaderModule(fragShaderModule, nullptr);
+
+    VLOG(VLOG_LV_3_PROCESS_TRACKING)
+        << "Floor GraphicsPipeline has been created.";
+}
+
 BasicRenderTarget::BasicRenderTarget(
     const std::shared_ptr<RenderEngine> renderEngine,
     vk::Format colorImageFormat, vk::Extent2D imageExtent,
     vk::DescriptorSetLayout descriptorSetLayout,
-    std::vector<vk::Image> &renderImages, int numOfFrames)
+    std::vector<vk::Image> &renderImages, int numOfFrames,
+    vk::ImageUsageFlags renderImageUsage,
+    vk::ImageLayout renderImageFinalLayout)
 
     : RenderTarget(renderEngine, colorImageFormat, imageExtent,
-                   descriptorSetLayout, renderImages, numOfFrames) {
+                   descriptorSetLayout, renderImages, numOfFrames,
+                   renderImageUsage, renderImageFinalLayout) {
 
     setupRenderPass();
+    setupOverlayRenderPass();
     setupImageResources();
     setupFrameBuffers();
+    setupOverlayFrameBuffers();
     setupGraphicsPipeline();
+    setupFloorPipeline();
 }
 
 void BasicRenderTarget::recreateResourcesForSwapChainRecreation(
@@ -366,6 +776,7 @@ void BasicRenderTarget::recreateResourcesForSwapChainRecreation(
 
     this->imageExtent = imageExtent;
     this->numOfColorImages = renderImages.size();
+    updateRenderExtent();
 
     // init renderImageResources with renderImages
     renderImageResources.resize(numOfColorImages);
@@ -377,9 +788,32 @@ void BasicRenderTarget::recreateResourcesForSwapChainRecreation(
         renderImageResources[i].releaseImage = false;
     }
 
+    // RenderPasses and pipelines do not depend on extent, so they are kept
     setupImageResources();
+    setupFrameBuffers();
+    setupOverlayFrameBuffers();
+}
+
+/**
+ * @brief Rebuilds only resources affected by render settings.
+ * Render images, overlay resources and (unless MSAA is changed) pipelines
+ * are kept. Old resources are destroyed after frames in flight complete.
+ */
+void BasicRenderTarget::recreateResourcesForRenderSettingsChange(
+    bool isMsaaChanged) {
+
+    VLOG(VLOG_LV_3_PROCESS_TRACKING)
+        << "Render settings changed: MSAA x"
+        << static_cast<uint32_t>(msaaSamples) << ", scale " << renderScale;
+
+    deferReleaseRenderResources(isMsaaChanged);
+
     setupRenderPass();
-    setupGraphicsPipeline();
+    setupImageResources();
     setupFrameBuffers();
+    if (isMsaaChanged) {
+        setupGraphicsPipeline();
+        setupFloorPipeline();
+    }
 }
-} // namespace ikura
\ No newline at end of file
+} // namespace ikura
@@ -4,16 +4,29 @@
 
 namespace ikura {
 class BasicRenderTarget : public RenderTarget {
+    // in pixels, clamped by maxPointSize of the device
+    static constexpr float POINT_SPRITE_SIZE = 4.0f;
+
     void setupRenderPass();
+    void setupOverlayRenderPass();
     void setupImageResources();
     void setupFrameBuffers();
+    void setupOverlayFrameBuffers();
     void setupGraphicsPipeline();
+    void setupFloorPipeline();
+
+    void
+    recreateResourcesForRenderSettingsChange(bool isMsaaChanged) override;
 
   public:
     BasicRenderTarget(const std::shared_ptr<RenderEngine> renderEngine,
                       vk::Format colorImageFormat, vk::Extent2D imageExtent,
                       vk::DescriptorSetLayout descriptorSetLayout,
-                      std::vector<vk::Image> &renderImages, int numOfFrames);
+                      std::vector<vk::Image> &renderImages, int numOfFrames,
+                      vk::ImageUsageFlags renderImageUsage =
+                          vk::ImageUsageFlagBits::eColorAttachment,
+                      vk::ImageLayout renderImageFinalLayout =
+                          vk::ImageLayout::ePresentSrcKHR);
 
     void recreateResourcesForSwapChainRecreation(
         vk::Extent2D imageExtent, std::vector<vk::Image> renderImages) override;
@@ -0,0 +1,616 @@
+#include "./cullingComputePass.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <string>
+
+#include <easylogging++.h>
+
+#include "../../common/logLevels.hpp"
+#include "../../common/renderPrimitiveTypes.hpp"
+#include "../../misc/shaderCodes.hpp"
+#include "../../util/shaderCache.hpp"
+#include "../../util/shaderUtils.hpp"
+
+namespace ikura {
+namespace {
+// must match local_size_x of CULLING_COMPUTE_SHADER_CODE
+constexpr uint32_t WORKGROUP_SIZE = 64;
+constexpr uint32_t NUM_OF_FRUSTUM_PLANES = 6;
+// upper limit of vkCmdUpdateBuffer, which resets indirect commands
+constexpr vk::DeviceSize MAX_SIZE_OF_INITIAL_COMMANDS = 65536;
+
+// Bindings ----------
+constexpr uint32_t BINDING_GROUPS = 0;
+constexpr uint32_t BINDING_SOURCE_INSTANCES = 1;
+constexpr uint32_t BINDING_MODEL_MATRICES = 2;
+constexpr uint32_t BINDING_FRUSTUMS = 3;
+constexpr uint32_t BINDING_COMMANDS = 4;
+constexpr uint32_t BINDING_COMPACTED_INSTANCES = 5;
+constexpr uint32_t BINDING_LOD_LEVELS = 6;
+constexpr uint32_t NUM_OF_BINDINGS = 7;
+constexpr uint32_t NUM_OF_DYNAMIC_BINDINGS = 3;
+
+// model matrices, frustums and LOD levels are selected by dynamic offset of
+// the frame
+bool isDynamicBinding(uint32_t binding) {
+    return binding == BINDING_MODEL_MATRICES || binding == BINDING_FRUSTUMS ||
+           binding == BINDING_LOD_LEVELS;
+}
+
+// Gribb-Hartmann planes of clip space with depth in [0, 1], normalized so
+// that plane.w + dot(plane.xyz, p) is the signed distance of p
+std::array<glm::vec4, NUM_OF_FRUSTUM_PLANES>
+extractFrustumPlanes(const glm::mat4 &viewProj) {
+    const auto row = [&](int i) {
+        return glm::vec4(viewProj[0][i], viewProj[1][i], viewProj[2][i],
+                         viewProj[3][i]);
+    };
+    std::array<glm::vec4, NUM_OF_FRUSTUM_PLANES> planes = {
+        row(3) + row(0), row(3) - row(0), row(3) + row(1),
+        row(3) - row(1), row(2),          row(3) - row(2)};
+    for (auto &plane : planes) {
+        float length = glm::length(glm::vec3(plane));
+        if (length > 0.0f) {
+            plane /= length;
+        }
+    }
+    return planes;
+}
+} // namespace
+
+void CullingComputePass::setupDescriptorSetLayout() {
+    std::array<vk::DescriptorSetLayoutBinding, NUM_OF_BINDINGS> bindings;
+    for (uint32_t binding = 0; binding < NUM_OF_BINDINGS; binding++) {
+        bindings[binding].binding = binding;
+        bindings[binding].descriptorCount = 1;
+        bindings[binding].descriptorType =
+            isDynamicBinding(binding)
+                ? vk::DescriptorType::eStorageBufferDynamic
+                : vk::DescriptorType::eStorageBuffer;
+        bindings[binding].stageFlags = vk::ShaderStageFlagBits::eCompute;
+    }
+
+    vk::DescriptorSetLayoutCreateInfo layoutCI{};
+    layoutCI.bindingCount = bindings.size();
+    layoutCI.pBindings = bindings.data();
+
+    descriptorSetLayout =
+        renderEngine->getDevice().createDescriptorSetLayout(layoutCI);
+}
+
+void CullingComputePass::setupPipeline() {
+    VLOG(VLOG_LV_3_PROCESS_TRACKING) << "Creating culling ComputePipeline...";
+
+    // PipelineLayout ----------
+    vk::PushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = vk::ShaderStageFlagBits::eCompute;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(PushConstants);
+
+    vk::PipelineLayoutCreateInfo pipelineLayoutCI{};
+    pipelineLayoutCI.setLayoutCount = 1;
+    pipelineLayoutCI.pSetLayouts = &descriptorSetLayout;
+    pipelineLayoutCI.pushConstantRangeCount = 1;
+    pipelineLayoutCI.pPushConstantRanges = &pushConstantRange;
+
+    pipelineLayout =
+        renderEngine->getDevice().createPipelineLayout(pipelineLayoutCI);
+
+    // Pipeline ----------
+    auto shader = getShaderSpirv(CULLING_COMPUTE_SHADER_CODE, EShLangCompute);
+    auto shaderModule = createShaderModule(shader, renderEngine->getDevice());
+
+    vk::ComputePipelineCreateInfo pipelineCI{};
+    pipelineCI.stage.stage = vk::ShaderStageFlagBits::eCompute;
+    pipelineCI.stage.module = shaderModule;
+    pipelineCI.stage.pName = "main";
+    pipelineCI.layout = pipelineLayout;
+
+    auto result = renderEngine->getDevice().createComputePipeline(
+        renderEngine->getPipelineCache(), pipelineCI);
+    renderEngine->getDevice().destroyShaderModule(shaderModule, nullptr);
+    if (result.result != vk::Result::eSuccess) {
+        throw std::runtime_error("Failed to create culling ComputePipeline.");
+    }
+    pipeline = result.value;
+
+    VLOG(VLOG_LV_3_PROCESS_TRACKING)
+        << "Culling ComputePipeline has been created.";
+}
+
+BufferResource CullingComputePass::createBuffer(vk::DeviceSize size,
+                                                vk::BufferUsageFlags usage,
+                                                bool isHostVisible) {
+    vk::BufferCreateInfo bufferCI{};
+    bufferCI.size = size;
+    bufferCI.usage = usage;
+    bufferCI.sharingMode = vk::SharingMode::eExclusive;
+
+    VmaAllocationCreateInfo allocCI{};
+    if (isHostVisible) {
+        allocCI.usage = VMA_MEMORY_USAGE_AUTO;
+        allocCI.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT;
+    } else {
+        allocCI.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+    }
+
+    BufferResource bufferResource;
+    auto vkBufferCI = (VkBufferCreateInfo)bufferCI;
+    VkBuffer vkBuffer;
+    auto result =
+        vmaCreateBuffer(*renderEngine->getVmaAllocator(), &vkBufferCI,
+                        &allocCI, &vkBuffer, &bufferResource.alloc, nullptr);
+    if (result != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create culling buffer.");
+    }
+    bufferResource.buffer = (vk::Buffer)vkBuffer;
+
+    return bufferResource;
+}
+
+void CullingComputePass::setupDescriptorSets(CullingBuffers &buffers,
+                                             vk::Buffer sourceInstanceBuffer) {
+    // DescriptorPool ----------
+    std::array<vk::DescriptorPoolSize, 2> poolSizes;
+    poolSizes[0].type = vk::DescriptorType::eStorageBuffer;
+    poolSizes[0].descriptorCount =
+        (NUM_OF_BINDINGS - NUM_OF_DYNAMIC_BINDINGS) * numOfFrames;
+    poolSizes[1].type = vk::DescriptorType::eStorageBufferDynamic;
+    poolSizes[1].descriptorCount = NUM_OF_DYNAMIC_BINDINGS * numOfFrames;
+
+    vk::DescriptorPoolCreateInfo poolCI{};
+    poolCI.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    poolCI.pPoolSizes = poolSizes.data();
+    poolCI.maxSets = numOfFrames;
+
+    buffers.descriptorPool =
+        renderEngine->getDevice().createDescriptorPool(poolCI);
+
+    // one per frame, since indirect commands and compacted instances are
+    // written in every frame
+    std::vector<vk::DescriptorSetLayout> layouts(numOfFrames,
+                                                 descriptorSetLayout);
+    vk::DescriptorSetAllocateInfo allocInfo{};
+    allocInfo.descriptorPool = buffers.descriptorPool;
+    allocInfo.descriptorSetCount = static_cast<uint32_t>(layouts.size());
+    allocInfo.pSetLayouts = layouts.data();
+
+    buffers.descriptorSets =
+        renderEngine->getDevice().allocateDescriptorSets(allocInfo);
+
+    // Fill Update Info ----------
+    for (int frame = 0; frame < numOfFrames; frame++) {
+        std::array<vk::DescriptorBufferInfo, NUM_OF_BINDINGS> bufferInfos;
+        const auto setWholeBuffer = [&](uint32_t binding, vk::Buffer buffer) {
+            bufferInfos[binding].buffer = buffer;
+            bufferInfos[binding].offset = 0;
+            bufferInfos[binding].range = VK_WHOLE_SIZE;
+        };
+        setWholeBuffer(BINDING_GROUPS, buffers.groupBufferResource.buffer);
+        setWholeBuffer(BINDING_SOURCE_INSTANCES, sourceInstanceBuffer);
+        setWholeBuffer(BINDING_COMMANDS,
+                       buffers.commandBufferResources[frame].buffer);
+        setWholeBuffer(BINDING_COMPACTED_INSTANCES,
+                       buffers.compactedInstanceBufferResources[frame].buffer);
+
+        // slots of the first frame, the others are reached by dynamic offset
+        bufferInfos[BINDING_MODEL_MATRICES].buffer =
+            uniformBufferRing->getBuffer();
+        bufferInfos[BINDING_MODEL_MATRICES].offset = modelMatSlot.offset;
+        bufferInfos[BINDING_MODEL_MATRICES].range = modelMatSlot.size;
+        bufferInfos[BINDING_FRUSTUMS].buffer = uniformBufferRing->getBuffer();
+        bufferInfos[BINDING_FRUSTUMS].offset = frustumSlot.offset;
+        bufferInfos[BINDING_FRUSTUMS].range = frustumSlot.size;
+        bufferInfos[BINDING_LOD_LEVELS].buffer = uniformBufferRing->getBuffer();
+        bufferInfos[BINDING_LOD_LEVELS].offset = lodLevelSlot.offset;
+        bufferInfos[BINDING_LOD_LEVELS].range = lodLevelSlot.size;
+
+        std::array<vk::WriteDescriptorSet, NUM_OF_BINDINGS> descriptorWrites;
+        for (uint32_t binding = 0; binding < NUM_OF_BINDINGS; binding++) {
+            descriptorWrites[binding].dstSet = buffers.descriptorSets[frame];
+            descriptorWrites[binding].dstBinding = binding;
+            descriptorWrites[binding].dstArrayElement = 0;
+            descriptorWrites[binding].descriptorType =
+                isDynamicBinding(binding)
+                    ? vk::DescriptorType::eStorageBufferDynamic
+                    : vk::DescriptorType::eStorageBuffer;
+            descriptorWrites[binding].descriptorCount = 1;
+            descriptorWrites[binding].pBufferInfo = &bufferInfos[binding];
+        }
+
+        renderEngine->getDevice().updateDescriptorSets(descriptorWrites,
+                                                       nullptr);
+    }
+}
+
+void CullingComputePass::deferReleaseCullingBuffers(CullingBuffers &buffers) {
+    auto device = renderEngine->getDevice();
+    auto allocator = renderEngine->getVmaAllocator();
+    renderEngine->deferDestruction([device, allocator, buffers]() mutable {
+        buffers.groupBufferResource.release(*allocator);
+        for (auto &bufferResource : buffers.commandBufferResources) {
+            bufferResource.release(*allocator);
+        }
+        for (auto &bufferResource : buffers.compactedInstanceBufferResources) {
+            bufferResource.release(*allocator);
+        }
+        if (buffers.descriptorPool) {
+            device.destroyDescriptorPool(buffers.descriptorPool);
+        }
+    });
+    buffers = {};
+}
+
+CullingComputePass::CullingComputePass(
+    std::shared_ptr<RenderEngine> renderEngine,
+    std::shared_ptr<UniformBufferRing> uniformBufferRing,
+    UniformSlot modelMatSlot)
+    : renderEngine(renderEngine), uniformBufferRing(uniformBufferRing),
+      modelMatSlot(modelMatSlot) {
+
+    numOfFrames = uniformBufferRing->getNumOfFrames();
+    frustumSlot = uniformBufferRing->reserve(
+        sizeof(glm::vec4) * NUM_OF_FRUSTUM_PLANES * MAX_NUM_OF_VIEWPORTS);
+    lodLevelSlot =
+        uniformBufferRing->reserve(sizeof(uint32_t) * MAX_NUM_OF_LOD_SLOTS);
+    // all slots are cleared once, and later only written ones
+    numOfWrittenLodLevels.assign(numOfFrames, MAX_NUM_OF_LOD_SLOTS);
+    // nothing is culled, and LOD level 0 is drawn, until they are updated
+    for (int frame = 0; frame < numOfFrames; frame++) {
+        updateFrustums(frame, {});
+        updateLodLevels(frame, {});
+    }
+
+    setupDescriptorSetLayout();
+    setupPipeline();
+}
+
+CullingComputePass::~CullingComputePass() {
+    auto device = renderEngine->getDevice();
+    auto allocator = *renderEngine->getVmaAllocator();
+    cullingBuffers.groupBufferResource.release(allocator);
+    for (auto &bufferResource : cullingBuffers.commandBufferResources) {
+        bufferResource.release(allocator);
+    }
+    for (auto &bufferResource :
+         cullingBuffers.compactedInstanceBufferResources) {
+        bufferResource.release(allocator);
+    }
+    if (cullingBuffers.descriptorPool) {
+        device.destroyDescriptorPool(cullingBuffers.descriptorPool);
+    }
+
+    device.destroyPipeline(pipeline);
+    device.destroyPipelineLayout(pipelineLayout);
+    device.destroyDescriptorSetLayout(descriptorSetLayout);
+}
+
+/**
+ * @brief Checks that groups refer to instances of drawCommands.
+ *
+ * @exception std::runtime_error if a group refers to a draw command which
+ * does not exist, instances out of its draw command, or groups of a draw
+ * command have more instances than the draw command.
+ */
+void CullingComputePass::validateGroups(
+    const std::vector<BasicCullingGroup> &groups,
+    const std::vector<vk::DrawIndexedIndirectCommand> &drawCommands) {
+    std::vector<uint64_t> numOfGroupInstances(drawCommands.size(), 0);
+    for (const auto &group : groups) {
+        if (group.drawIndex >= drawCommands.size()) {
+            throw std::runtime_error(
+                "Invalid BasicCullingGroup: draw index is out of range of "
+                "draw commands.");
+        }
+        const auto &command = drawCommands[group.drawIndex];
+        if (group.numOfInstances == 0 ||
+            group.firstInstance < command.firstInstance ||
+            static_cast<uint64_t>(group.firstInstance) + group.numOfInstances >
+                static_cast<uint64_t>(command.firstInstance) +
+                    command.instanceCount) {
+            throw std::runtime_error(
+                "Invalid BasicCullingGroup: instances are out of range of "
+                "its draw command.");
+        }
+        if (group.modelId >= NUM_OF_MODEL_MATRIX) {
+            throw std::runtime_error(
+                "Invalid BasicCullingGroup: model id is out of range of "
+                "model matrices.");
+        }
+        if (group.lodSlot != NO_LOD_SLOT &&
+            group.lodSlot >= MAX_NUM_OF_LOD_SLOTS) {
+            throw std::runtime_error(
+                "Invalid BasicCullingGroup: LOD slot is out of range of "
+                "LOD levels.");
+        }
+
+        numOfGroupInstances[group.drawIndex] += group.numOfInstances;
+        if (numOfGroupInstances[group.drawIndex] > command.instanceCount) {
+            throw std::runtime_error(
+                "Invalid BasicCullingGroup: groups of a draw command overlap.");
+        }
+    }
+}
+
+/**
+ * @brief Rebuilds buffers for groups and draw commands, which must be the ones
+ * drawn from the next frame. Draw commands referred by groups are culled, and
+ * only their instances in groups are drawn. Current buffers are released after
+ * frames in flight stop using them.
+ * Empty groups deactivate culling.
+ *
+ * @exception std::runtime_error if groups are invalid (see validateGroups()),
+ * or there are too many culled draw commands.
+ */
+void CullingComputePass::setGroups(
+    const std::vector<BasicCullingGroup> &groups,
+    const std::vector<vk::DrawIndexedIndirectCommand> &drawCommands,
+    vk::Buffer sourceInstanceBuffer) {
+    validateGroups(groups, drawCommands);
+
+    // Culled draw commands ----------
+    std::vector<int32_t> newCommandIndices(drawCommands.size(), -1);
+    std::vector<uint32_t> newFirstCompactedInstances;
+    std::vector<uint32_t> numOfCommandInstances;
+    std::vector<vk::DrawIndexedIndirectCommand> commands;
+    for (const auto &group : groups) {
+        int32_t &commandIndex = newCommandIndices[group.drawIndex];
+        if (commandIndex < 0) {
+            commandIndex = static_cast<int32_t>(commands.size());
+            // instanceCount is counted by compute shader, and firstInstance is
+            // replaced by offset of compacted instances
+            auto command = drawCommands[group.drawIndex];
+            command.instanceCount = 0;
+            command.firstInstance = 0;
+            commands.push_back(command);
+            numOfCommandInstances.push_back(0);
+        }
+        numOfCommandInstances[commandIndex] += group.numOfInstances;
+    }
+
+    uint32_t newNumOfCompactedInstances = 0;
+    for (uint32_t count : numOfCommandInstances) {
+        newFirstCompactedInstances.push_back(newNumOfCompactedInstances);
+        newNumOfCompactedInstances += count;
+    }
+
+    std::vector<vk::DrawIndexedIndirectCommand> newInitialCommands;
+    for (int viewport = 0; viewport < MAX_NUM_OF_VIEWPORTS; viewport++) {
+        newInitialCommands.insert(newInitialCommands.end(), commands.begin(),
+                                  commands.end());
+    }
+    if (sizeof(newInitialCommands[0]) * newInitialCommands.size() >
+        MAX_SIZE_OF_INITIAL_COMMANDS) {
+        throw std::runtime_error("Too many culled draw commands: up to " +
+                                 std::to_string(MAX_SIZE_OF_INITIAL_COMMANDS /
+                                                sizeof(newInitialCommands[0]) /
+                                                MAX_NUM_OF_VIEWPORTS) +
+                                 " draw commands are supported.");
+    }
+
+    // Replace buffers ----------
+    deferReleaseCullingBuffers(cullingBuffers);
+    commandIndices = std::move(newCommandIndices);
+    firstCompactedInstances = std::move(newFirstCompactedInstances);
+    initialCommands = std::move(newInitialCommands);
+    numOfCompactedInstances = newNumOfCompactedInstances;
+    numOfGroups = groups.size();
+
+    if (groups.empty() || !sourceInstanceBuffer) {
+        numOfGroups = 0;
+        return;
+    }
+
+    // groups are written only here, so host visible memory is enough
+    std::vector<CullingGroupData> groupData;
+    for (const auto &group : groups) {
+        CullingGroupData data{};
+        data.boundingSphere = group.boundingSphere;
+        data.modelId = group.modelId;
+        data.commandIndex = commandIndices[group.drawIndex];
+        data.firstInstance = group.firstInstance;
+        data.numOfInstances = group.numOfInstances;
+        data.firstCompactedInstance =
+            firstCompactedInstances[data.commandIndex];
+        data.lodSlot = group.lodSlot;
+        data.lodLevel = group.lodLevel;
+        groupData.push_back(data);
+    }
+
+    const vk::DeviceSize groupBufferSize =
+        sizeof(groupData[0]) * groupData.size();
+    cullingBuffers.groupBufferResource = createBuffer(
+        groupBufferSize, vk::BufferUsageFlagBits::eStorageBuffer, true);
+    auto allocator = *renderEngine->getVmaAllocator();
+    void *mappedData;
+    vmaMapMemory(allocator, cullingBuffers.groupBufferResource.alloc,
+                 &mappedData);
+    std::memcpy(mappedData, groupData.data(), groupBufferSize);
+    vmaFlushAllocation(allocator, cullingBuffers.groupBufferResource.alloc, 0,
+                       VK_WHOLE_SIZE);
+    vmaUnmapMemory(allocator, cullingBuffers.groupBufferResource.alloc);
+
+    for (int frame = 0; frame < numOfFrames; frame++) {
+        cullingBuffers.commandBufferResources.push_back(createBuffer(
+            sizeof(initialCommands[0]) * initialCommands.size(),
+            vk::BufferUsageFlagBits::eIndirectBuffer |
+                vk::BufferUsageFlagBits::eStorageBuffer |
+                vk::BufferUsageFlagBits::eTransferDst,
+            false));
+        cullingBuffers.compactedInstanceBufferResources.push_back(
+            createBuffer(sizeof(BasicInstance::Data) * numOfCompactedInstances *
+                             MAX_NUM_OF_VIEWPORTS,
+                         vk::BufferUsageFlagBits::eVertexBuffer |
+                             vk::BufferUsageFlagBits::eStorageBuffer,
+                         false));
+    }
+
+    setupDescriptorSets(cullingBuffers, sourceInstanceBuffer);
+
+    VLOG(VLOG_LV_3_PROCESS_TRACKING)
+        << "Culling of " << groups.size() << " groups in " << commands.size()
+        << " draw commands has been set.";
+}
+
+/**
+ * @brief Writes frustum planes of the frame, sceneMatUBOs[i] of i-th viewport.
+ * Nothing is culled in viewports without scene matrices.
+ */
+void CullingComputePass::updateFrustums(
+    int frameIndex, const std::vector<BasicSceneMatUBO> &sceneMatUBOs) {
+    // (0, 0, 0, 1) contains everything
+    std::array<glm::vec4, NUM_OF_FRUSTUM_PLANES * MAX_NUM_OF_VIEWPORTS> planes;
+    planes.fill(glm::vec4(0.0, 0.0, 0.0, 1.0));
+    const size_t numOfViewports = std::min<size_t>(
+        sceneMatUBOs.size(), static_cast<size_t>(MAX_NUM_OF_VIEWPORTS));
+    for (size_t i = 0; i < numOfViewports; i++) {
+        auto viewportPlanes = extractFrustumPlanes(sceneMatUBOs[i].proj *
+                                                   sceneMatUBOs[i].view);
+        std::copy(viewportPlanes.begin(), viewportPlanes.end(),
+                  planes.begin() + i * NUM_OF_FRUSTUM_PLANES);
+    }
+
+    uniformBufferRing->write(frameIndex, frustumSlot, planes.data(),
+                             sizeof(planes));
+    uniformBufferRing->flush(frameIndex);
+}
+
+/**
+ * @brief Writes LOD levels of the frame, levels[lodSlot]. Slots out of levels
+ * are level 0.
+ *
+ * @exception std::runtime_error if there are more levels than
+ * MAX_NUM_OF_LOD_SLOTS.
+ */
+void CullingComputePass::updateLodLevels(int frameIndex,
+                                         const std::vector<uint32_t> &levels) {
+    if (levels.size() > static_cast<size_t>(MAX_NUM_OF_LOD_SLOTS)) {
+        throw std::runtime_error("Too many LOD levels: up to " +
+                                 std::to_string(MAX_NUM_OF_LOD_SLOTS) +
+                                 " slots are supported.");
+    }
+
+    // slots written by previous calls are cleared, others are still zero
+    std::vector<uint32_t> paddedLevels(levels);
+    if (paddedLevels.size() < numOfWrittenLodLevels[frameIndex]) {
+        paddedLevels.resize(numOfWrittenLodLevels[frameIndex], 0);
+    }
+    if (!paddedLevels.empty()) {
+        uniformBufferRing->write(frameIndex, lodLevelSlot, paddedLevels.data(),
+                                 sizeof(uint32_t) * paddedLevels.size());
+        uniformBufferRing->flush(frameIndex);
+    }
+    numOfWrittenLodLevels[frameIndex] = levels.size();
+}
+
+/**
+ * @brief Records reset of indirect commands and culling dispatch of the frame,
+ * followed by a barrier making them visible to indirect draws. Must be
+ * recorded outside RenderPass, after commands writing model matrices.
+ */
+void CullingComputePass::recordDispatches(vk::CommandBuffer cmdBuffer,
+                                          int frameIndex) {
+    if (!isActive()) {
+        return;
+    }
+
+    // model matrices may be written by compute shader, and buffers of the
+    // frame may still be read by draws of other windows
+    vk::MemoryBarrier beginBarrier{};
+    beginBarrier.srcAccessMask = vk::AccessFlagBits::eShaderWrite;
+    beginBarrier.dstAccessMask = vk::AccessFlagBits::eTransferWrite |
+                                 vk::AccessFlagBits::eShaderRead |
+                                 vk::AccessFlagBits::eShaderWrite;
+    cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader |
+                                  vk::PipelineStageFlagBits::eDrawIndirect |
+                                  vk::PipelineStageFlagBits::eVertexInput,
+                              vk::PipelineStageFlagBits::eTransfer |
+                                  vk::PipelineStageFlagBits::eComputeShader,
+                              {}, beginBarrier, nullptr, nullptr);
+
+    // Reset instance counts ----------
+    cmdBuffer.updateBuffer(
+        cullingBuffers.commandBufferResources[frameIndex].buffer, 0,
+        sizeof(initialCommands[0]) * initialCommands.size(),
+        initialCommands.data());
+
+    vk::MemoryBarrier resetBarrier{};
+    resetBarrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+    resetBarrier.dstAccessMask =
+        vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite;
+    cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+                              vk::PipelineStageFlagBits::eComputeShader, {},
+                              resetBarrier, nullptr, nullptr);
+
+    // Culling ----------
+    cmdBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, pipeline);
+    const uint32_t dynamicOffset =
+        uniformBufferRing->getDynamicOffset(frameIndex);
+    cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute,
+                                 pipelineLayout, 0,
+                                 cullingBuffers.descriptorSets[frameIndex],
+                                 {dynamicOffset, dynamicOffset, dynamicOffset});
+
+    PushConstants pushConstants{};
+    pushConstants.numOfGroups = numOfGroups;
+    pushConstants.numOfCommands = initialCommands.size() / MAX_NUM_OF_VIEWPORTS;
+    pushConstants.numOfCompactedInstances = numOfCompactedInstances;
+    pushConstants.instanceStride = sizeof(BasicInstance::Data) / 4;
+    cmdBuffer.pushConstants(pipelineLayout, vk::ShaderStageFlagBits::eCompute,
+                            0, sizeof(pushConstants), &pushConstants);
+
+    cmdBuffer.dispatch((numOfGroups + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE,
+                       MAX_NUM_OF_VIEWPORTS, 1);
+
+    // commands and instances are read by draws of scene RenderPass
+    vk::MemoryBarrier drawBarrier{};
+    drawBarrier.srcAccessMask = vk::AccessFlagBits::eShaderWrite;
+    drawBarrier.dstAccessMask = vk::AccessFlagBits::eIndirectCommandRead |
+                                vk::AccessFlagBits::eVertexAttributeRead;
+    cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader,
+                              vk::PipelineStageFlagBits::eDrawIndirect |
+                                  vk::PipelineStageFlagBits::eVertexInput,
+                              {}, drawBarrier, nullptr, nullptr);
+}
+
+/**
+ * @brief Records indirect draw of culled draw command drawIndex in the
+ * viewport. Its compacted instances are bound to instance binding (1), so the
+ * caller must bind its own instance buffer again before other draws.
+ */
+void CullingComputePass::recordDraw(vk::CommandBuffer cmdBuffer,
+                                    int frameIndex, int viewportIndex,
+                                    size_t drawIndex) const {
+    const uint32_t commandIndex = commandIndices[drawIndex];
+    const uint32_t numOfCommands =
+        initialCommands.size() / MAX_NUM_OF_VIEWPORTS;
+
+    const vk::DeviceSize instanceOffset =
+        sizeof(BasicInstance::Data) *
+        (static_cast<vk::DeviceSize>(viewportIndex) * numOfCompactedInstances +
+         firstCompactedInstances[commandIndex]);
+    cmdBuffer.bindVertexBuffers(
+        1, cullingBuffers.compactedInstanceBufferResources[frameIndex].buffer,
+        instanceOffset);
+
+    const vk::DeviceSize commandOffset =
+        sizeof(vk::DrawIndexedIndirectCommand) *
+        (static_cast<vk::DeviceSize>(viewportIndex) * numOfCommands +
+         commandIndex);
+    cmdBuffer.drawIndexedIndirect(
+        cullingBuffers.commandBufferResources[frameIndex].buffer, commandOffset,
+        1, sizeof(vk::DrawIndexedIndirectCommand));
+}
+
+// Getter ----------
+
+bool CullingComputePass::isActive() const {
+    return numOfGroups > 0 && cullingBuffers.groupBufferResource.buffer;
+}
+
+bool CullingComputePass::isCulled(size_t drawIndex) const {
+    return drawIndex < commandIndices.size() && commandIndices[drawIndex] >= 0;
+}
+} // namespace ikura
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include <glm/glm.hpp>
+
+#include "../../common/uniformBufferInfo.hpp"
+#include "../../engine/renderEngine/renderEngine.hpp"
+#include "../renderContent.hpp"
+#include "../uniformBufferRing.hpp"
+
+namespace ikura {
+/**
+ * @brief Culls BasicCullingGroups against frustums of viewports on GPU, and
+ * draws only visible instances by indirect draw commands.
+ *
+ * Each frame, a compute shader tests bounding spheres placed by model matrices
+ * of the frame, copies instances of visible groups into compacted instance
+ * buffer, and counts instanceCount of indirect draw commands. Draw commands
+ * keep being instanced, so the number of draws does not grow with the number
+ * of groups. Only core features are required: firstInstance of indirect
+ * commands is always 0, and compacted instances of each draw command are
+ * selected by offset of vertex buffer binding instead.
+ * Groups may also be selected by LOD levels written by CPU each frame, so that
+ * each LOD level of meshes is drawn by its own instanced draw command.
+ */
+class CullingComputePass {
+    // GPU layouts (std430) ----------
+    struct CullingGroupData {
+        glm::vec4 boundingSphere;
+        uint32_t modelId;
+        uint32_t commandIndex;
+        uint32_t firstInstance;
+        uint32_t numOfInstances;
+        uint32_t firstCompactedInstance;
+        uint32_t lodSlot;
+        uint32_t lodLevel;
+        uint32_t padding;
+    };
+    struct PushConstants {
+        uint32_t numOfGroups;
+        uint32_t numOfCommands;
+        uint32_t numOfCompactedInstances;
+        uint32_t instanceStride;
+    };
+
+    // Culling buffers ----------
+    // replaced as a whole by setGroups()
+    struct CullingBuffers {
+        BufferResource groupBufferResource;
+        // bufferResources[frame]
+        std::vector<BufferResource> commandBufferResources;
+        std::vector<BufferResource> compactedInstanceBufferResources;
+        vk::DescriptorPool descriptorPool;
+        // descriptorSets[frame]
+        std::vector<vk::DescriptorSet> descriptorSets;
+    };
+
+    std::shared_ptr<RenderEngine> renderEngine;
+    std::shared_ptr<UniformBufferRing> uniformBufferRing;
+    UniformSlot modelMatSlot;
+    UniformSlot frustumSlot;
+    UniformSlot lodLevelSlot;
+    // numOfWrittenLodLevels[frame], to clear slots no longer written
+    std::vector<size_t> numOfWrittenLodLevels;
+    int numOfFrames;
+
+    // Pipeline ----------
+    vk::DescriptorSetLayout descriptorSetLayout;
+    vk::PipelineLayout pipelineLayout;
+    vk::Pipeline pipeline;
+
+    CullingBuffers cullingBuffers;
+    uint32_t numOfGroups = 0;
+    uint32_t numOfCompactedInstances = 0;
+    // commandIndices[drawIndex], or -1 if the draw command is not culled
+    std::vector<int32_t> commandIndices;
+    // firstCompactedInstances[commandIndex]
+    std::vector<uint32_t> firstCompactedInstances;
+    // written at the beginning of each frame, instanceCount is counted by
+    // compute shader. commands[viewport][commandIndex]
+    std::vector<vk::DrawIndexedIndirectCommand> initialCommands;
+
+    void setupDescriptorSetLayout();
+    void setupPipeline();
+    void setupDescriptorSets(CullingBuffers &buffers,
+                             vk::Buffer sourceInstanceBuffer);
+    BufferResource createBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage,
+                                bool isHostVisible);
+    void deferReleaseCullingBuffers(CullingBuffers &buffers);
+
+  public:
+    CullingComputePass(std::shared_ptr<RenderEngine> renderEngine,
+                       std::shared_ptr<UniformBufferRing> uniformBufferRing,
+                       UniformSlot modelMatSlot);
+    ~CullingComputePass();
+
+    static void validateGroups(
+        const std::vector<BasicCullingGroup> &groups,
+        const std::vector<vk::DrawIndexedIndirectCommand> &drawCommands);
+    void
+    setGroups(const std::vector<BasicCullingGroup> &groups,
+              const std::vector<vk::DrawIndexedIndirectCommand> &drawCommands,
+              vk::Buffer sourceInstanceBuffer);
+    void updateFrustums(int frameIndex,
+                        const std::vector<BasicSceneMatUBO> &sceneMatUBOs);
+    void updateLodLevels(int frameIndex, const std::vector<uint32_t> &levels);
+    void recordDispatches(vk::CommandBuffer cmdBuffer, int frameIndex);
+    void recordDraw(vk::CommandBuffer cmdBuffer, int frameIndex,
+                    int viewportIndex, size_t drawIndex) const;
+
+    // Getter ----------
+    bool isActive() const;
+    bool isCulled(size_t drawIndex) const;
+};
+} // namespace ikura
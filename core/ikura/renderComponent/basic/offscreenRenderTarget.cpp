@@ -0,0 +1,16 @@
+#include "./offscreenRenderTarget.hpp"
+
+#include "../../window/offscreenWindow/offscreenWindow.hpp"
+
+namespace ikura {
+OffscreenRenderTarget::OffscreenRenderTarget(
+    const std::shared_ptr<RenderEngine> renderEngine,
+    vk::Format colorImageFormat, vk::Extent2D imageExtent,
+    vk::DescriptorSetLayout descriptorSetLayout,
+    std::vector<vk::Image> &renderImages, int numOfFrames)
+
+    : BasicRenderTarget(renderEngine, colorImageFormat, imageExtent,
+                        descriptorSetLayout, renderImages, numOfFrames,
+                        OffscreenWindow::RENDER_IMAGE_USAGE,
+                        vk::ImageLayout::eTransferSrcOptimal) {}
+} // namespace ikura
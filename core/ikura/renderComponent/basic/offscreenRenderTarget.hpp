@@ -0,0 +1,23 @@
+#pragma once
+
+#include "./basicRenderTarget.hpp"
+
+namespace ikura {
+/**
+ * @brief BasicRenderTarget rendering into images owned by OffscreenWindow
+ * instead of SwapChain images.
+ *
+ * Render images are left in TransferSrcOptimal after each frame so that they
+ * can be read back, and no presentation is involved. It works on a device
+ * created without surface and VK_KHR_swapchain.
+ */
+class OffscreenRenderTarget : public BasicRenderTarget {
+  public:
+    OffscreenRenderTarget(const std::shared_ptr<RenderEngine> renderEngine,
+                          vk::Format colorImageFormat,
+                          vk::Extent2D imageExtent,
+                          vk::DescriptorSetLayout descriptorSetLayout,
+                          std::vector<vk::Image> &renderImages,
+                          int numOfFrames);
+};
+} // namespace ikura
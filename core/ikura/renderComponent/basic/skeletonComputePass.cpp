@@ -0,0 +1,523 @@
+#include "./skeletonComputePass.hpp"
+
+#include <algorithm>
+#include <array>
+#include <string>
+
+#include <easylogging++.h>
+
+#include "../../common/logLevels.hpp"
+#include "../../engine/renderEngine/uploadManager.hpp"
+#include "../../misc/shaderCodes.hpp"
+#include "../../util/shaderCache.hpp"
+#include "../../util/shaderUtils.hpp"
+
+namespace ikura {
+namespace {
+// must match local_size_x of SKELETON_COMPUTE_SHADER_CODE
+constexpr uint32_t WORKGROUP_SIZE = 64;
+
+// Bindings ----------
+constexpr uint32_t BINDING_SKELETONS = 0;
+constexpr uint32_t BINDING_JOINTS = 1;
+constexpr uint32_t BINDING_LEVEL_JOINTS = 2;
+constexpr uint32_t BINDING_ROTATIONS = 3;
+constexpr uint32_t BINDING_ROOT_TRANSLATIONS = 4;
+constexpr uint32_t BINDING_INSTANCES = 5;
+constexpr uint32_t BINDING_JOINT_FRAMES = 6;
+constexpr uint32_t BINDING_MODEL_MATRICES = 7;
+constexpr uint32_t NUM_OF_BINDINGS = 8;
+
+// instances and model matrices are selected by dynamic offset of the frame
+bool isDynamicBinding(uint32_t binding) {
+    return binding == BINDING_INSTANCES || binding == BINDING_MODEL_MATRICES;
+}
+} // namespace
+
+void SkeletonComputePass::setupDescriptorSetLayout() {
+    std::array<vk::DescriptorSetLayoutBinding, NUM_OF_BINDINGS> bindings;
+    for (uint32_t binding = 0; binding < NUM_OF_BINDINGS; binding++) {
+        bindings[binding].binding = binding;
+        bindings[binding].descriptorCount = 1;
+        bindings[binding].descriptorType =
+            isDynamicBinding(binding)
+                ? vk::DescriptorType::eStorageBufferDynamic
+                : vk::DescriptorType::eStorageBuffer;
+        bindings[binding].stageFlags = vk::ShaderStageFlagBits::eCompute;
+    }
+
+    vk::DescriptorSetLayoutCreateInfo layoutCI{};
+    layoutCI.bindingCount = bindings.size();
+    layoutCI.pBindings = bindings.data();
+
+    descriptorSetLayout =
+        renderEngine->getDevice().createDescriptorSetLayout(layoutCI);
+}
+
+void SkeletonComputePass::setupPipeline() {
+    VLOG(VLOG_LV_3_PROCESS_TRACKING) << "Creating skeleton ComputePipeline...";
+
+    // PipelineLayout ----------
+    vk::PushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = vk::ShaderStageFlagBits::eCompute;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(PushConstants);
+
+    vk::PipelineLayoutCreateInfo pipelineLayoutCI{};
+    pipelineLayoutCI.setLayoutCount = 1;
+    pipelineLayoutCI.pSetLayouts = &descriptorSetLayout;
+    pipelineLayoutCI.pushConstantRangeCount = 1;
+    pipelineLayoutCI.pPushConstantRanges = &pushConstantRange;
+
+    pipelineLayout =
+        renderEngine->getDevice().createPipelineLayout(pipelineLayoutCI);
+
+    // Pipeline ----------
+    auto shader = getShaderSpirv(SKELETON_COMPUTE_SHADER_CODE, EShLangCompute);
+    auto shaderModule = createShaderModule(shader, renderEngine->getDevice());
+
+    vk::ComputePipelineCreateInfo pipelineCI{};
+    pipelineCI.stage.stage = vk::ShaderStageFlagBits::eCompute;
+    pipelineCI.stage.module = shaderModule;
+    pipelineCI.stage.pName = "main";
+    pipelineCI.layout = pipelineLayout;
+
+    auto result = renderEngine->getDevice().createComputePipeline(
+        renderEngine->getPipelineCache(), pipelineCI);
+    renderEngine->getDevice().destroyShaderModule(shaderModule, nullptr);
+    if (result.result != vk::Result::eSuccess) {
+        throw std::runtime_error("Failed to create skeleton ComputePipeline.");
+    }
+    pipeline = result.value;
+
+    VLOG(VLOG_LV_3_PROCESS_TRACKING)
+        << "Skeleton ComputePipeline has been created.";
+}
+
+void SkeletonComputePass::setupJointFrameBuffer() {
+    vk::BufferCreateInfo bufferCI{};
+    bufferCI.size = sizeof(glm::mat4) * NUM_OF_MODEL_MATRIX;
+    bufferCI.usage = vk::BufferUsageFlagBits::eStorageBuffer;
+    bufferCI.sharingMode = vk::SharingMode::eExclusive;
+
+    VmaAllocationCreateInfo allocCI{};
+    allocCI.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+
+    auto vkBufferCI = (VkBufferCreateInfo)bufferCI;
+    VkBuffer vkBuffer;
+    auto result = vmaCreateBuffer(*renderEngine->getVmaAllocator(),
+                                  &vkBufferCI, &allocCI, &vkBuffer,
+                                  &jointFrameBufferResource.alloc, nullptr);
+    if (result != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create joint frame buffer.");
+    }
+    jointFrameBufferResource.buffer = (vk::Buffer)vkBuffer;
+}
+
+void SkeletonComputePass::setupDescriptorSet(SkeletonBuffers &buffers) {
+    // DescriptorPool ----------
+    std::array<vk::DescriptorPoolSize, 2> poolSizes;
+    poolSizes[0].type = vk::DescriptorType::eStorageBuffer;
+    poolSizes[0].descriptorCount = 6;
+    poolSizes[1].type = vk::DescriptorType::eStorageBufferDynamic;
+    poolSizes[1].descriptorCount = 2;
+
+    vk::DescriptorPoolCreateInfo poolCI{};
+    poolCI.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    poolCI.pPoolSizes = poolSizes.data();
+    poolCI.maxSets = 1;
+
+    buffers.descriptorPool =
+        renderEngine->getDevice().createDescriptorPool(poolCI);
+
+    vk::DescriptorSetAllocateInfo allocInfo{};
+    allocInfo.descriptorPool = buffers.descriptorPool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &descriptorSetLayout;
+
+    buffers.descriptorSet =
+        renderEngine->getDevice().allocateDescriptorSets(allocInfo)[0];
+
+    // Fill Update Info ----------
+    std::array<vk::DescriptorBufferInfo, NUM_OF_BINDINGS> bufferInfos;
+    const auto setWholeBuffer = [&](uint32_t binding,
+                                    const BufferResource &bufferResource) {
+        bufferInfos[binding].buffer = bufferResource.buffer;
+        bufferInfos[binding].offset = 0;
+        bufferInfos[binding].range = VK_WHOLE_SIZE;
+    };
+    setWholeBuffer(BINDING_SKELETONS, buffers.skeletonBufferResource);
+    setWholeBuffer(BINDING_JOINTS, buffers.jointBufferResource);
+    setWholeBuffer(BINDING_LEVEL_JOINTS, buffers.levelJointBufferResource);
+    setWholeBuffer(BINDING_ROTATIONS, buffers.rotationBufferResource);
+    setWholeBuffer(BINDING_ROOT_TRANSLATIONS,
+                   buffers.rootTranslationBufferResource);
+    setWholeBuffer(BINDING_JOINT_FRAMES, jointFrameBufferResource);
+
+    // slots of the first frame, the others are reached by dynamic offset
+    bufferInfos[BINDING_INSTANCES].buffer = uniformBufferRing->getBuffer();
+    bufferInfos[BINDING_INSTANCES].offset = instanceSlot.offset;
+    bufferInfos[BINDING_INSTANCES].range = instanceSlot.size;
+    bufferInfos[BINDING_MODEL_MATRICES].buffer = uniformBufferRing->getBuffer();
+    bufferInfos[BINDING_MODEL_MATRICES].offset = modelMatSlot.offset;
+    bufferInfos[BINDING_MODEL_MATRICES].range = modelMatSlot.size;
+
+    std::array<vk::WriteDescriptorSet, NUM_OF_BINDINGS> descriptorWrites;
+    for (uint32_t binding = 0; binding < NUM_OF_BINDINGS; binding++) {
+        descriptorWrites[binding].dstSet = buffers.descriptorSet;
+        descriptorWrites[binding].dstBinding = binding;
+        descriptorWrites[binding].dstArrayElement = 0;
+        descriptorWrites[binding].descriptorType =
+            isDynamicBinding(binding)
+                ? vk::DescriptorType::eStorageBufferDynamic
+                : vk::DescriptorType::eStorageBuffer;
+        descriptorWrites[binding].descriptorCount = 1;
+        descriptorWrites[binding].pBufferInfo = &bufferInfos[binding];
+    }
+
+    renderEngine->getDevice().updateDescriptorSets(descriptorWrites, nullptr);
+}
+
+/**
+ * @brief Replaces skeleton buffers with pending ones if their upload has
+ * completed. Old buffers are released after frames in flight stop using them.
+ */
+void SkeletonComputePass::applyCompletedUploads() {
+    if (!hasPendingUploads ||
+        !renderEngine->getUploadManager().isComplete(pendingUploadTicket)) {
+        return;
+    }
+
+    setupDescriptorSet(pendingSkeletonBuffers);
+
+    deferReleaseSkeletonBuffers(skeletonBuffers);
+    skeletonBuffers = pendingSkeletonBuffers;
+    pendingSkeletonBuffers = {};
+    renderEngine->getUploadManager().markApplied(pendingUploadTicket);
+    hasPendingUploads = false;
+
+    VLOG(VLOG_LV_4_PROCESS_TRACKING_SECONDARY)
+        << "Uploaded skeletons have been applied.";
+}
+
+void SkeletonComputePass::deferReleaseSkeletonBuffers(
+    SkeletonBuffers &buffers) {
+    auto device = renderEngine->getDevice();
+    auto allocator = renderEngine->getVmaAllocator();
+    renderEngine->deferDestruction([device, allocator, buffers]() mutable {
+        buffers.skeletonBufferResource.release(*allocator);
+        buffers.jointBufferResource.release(*allocator);
+        buffers.levelJointBufferResource.release(*allocator);
+        buffers.rotationBufferResource.release(*allocator);
+        buffers.rootTranslationBufferResource.release(*allocator);
+        if (buffers.descriptorPool) {
+            device.destroyDescriptorPool(buffers.descriptorPool);
+        }
+    });
+    buffers = {};
+}
+
+SkeletonComputePass::SkeletonComputePass(
+    std::shared_ptr<RenderEngine> renderEngine,
+    std::shared_ptr<UniformBufferRing> uniformBufferRing,
+    UniformSlot modelMatSlot)
+    : renderEngine(renderEngine), uniformBufferRing(uniformBufferRing),
+      modelMatSlot(modelMatSlot) {
+
+    instanceSlot = uniformBufferRing->reserve(sizeof(BasicSkeletonInstance) *
+                                              MAX_NUM_OF_SKELETON_INSTANCES);
+    instanceRanges.resize(uniformBufferRing->getNumOfFrames());
+
+    setupDescriptorSetLayout();
+    setupPipeline();
+    setupJointFrameBuffer();
+}
+
+SkeletonComputePass::~SkeletonComputePass() {
+    // pending buffers may be written by transfer queue
+    if (hasPendingUploads) {
+        renderEngine->getUploadManager().waitFor(pendingUploadTicket);
+    }
+
+    auto device = renderEngine->getDevice();
+    auto allocator = *renderEngine->getVmaAllocator();
+    for (auto *buffers : {&skeletonBuffers, &pendingSkeletonBuffers}) {
+        buffers->skeletonBufferResource.release(allocator);
+        buffers->jointBufferResource.release(allocator);
+        buffers->levelJointBufferResource.release(allocator);
+        buffers->rotationBufferResource.release(allocator);
+        buffers->rootTranslationBufferResource.release(allocator);
+        if (buffers->descriptorPool) {
+            device.destroyDescriptorPool(buffers->descriptorPool);
+        }
+    }
+    jointFrameBufferResource.release(allocator);
+
+    device.destroyPipeline(pipeline);
+    device.destroyPipelineLayout(pipelineLayout);
+    device.destroyDescriptorSetLayout(descriptorSetLayout);
+}
+
+/**
+ * @brief Uploads skeletons, replacing current ones once the upload completes.
+ * Nothing is dispatched until then. Joints of each skeleton are grouped by
+ * depth level here, so that one dispatch evaluates one level.
+ *
+ * @exception std::runtime_error if sizes of arrays of a skeleton do not
+ * match, or a parent does not precede its children.
+ */
+void SkeletonComputePass::setSkeletons(
+    const std::vector<BasicSkeleton> &skeletons) {
+    std::vector<SkeletonData> skeletonData;
+    std::vector<JointData> jointData;
+    std::vector<uint32_t> levelJoints;
+    std::vector<glm::vec4> rotations;
+    std::vector<glm::vec4> rootTranslations;
+    std::vector<std::vector<Level>> newLevels;
+    std::vector<uint32_t> newNumOfJoints;
+
+    for (const auto &skeleton : skeletons) {
+        const uint32_t jointCount = skeleton.parentIndices.size();
+        const uint32_t frameCount = skeleton.rootTranslations.size();
+        if (jointCount == 0 || jointCount > NUM_OF_MODEL_MATRIX ||
+            frameCount == 0 || skeleton.offsets.size() != jointCount ||
+            skeleton.meshTransforms.size() != jointCount ||
+            skeleton.rotations.size() !=
+                static_cast<size_t>(jointCount) * frameCount ||
+            skeleton.frameTime <= 0.0f) {
+            throw std::runtime_error(
+                "Invalid BasicSkeleton: sizes of joint and frame arrays do "
+                "not match.");
+        }
+
+        SkeletonData data{};
+        data.firstJoint = jointData.size();
+        data.numOfJoints = jointCount;
+        data.firstRotation = rotations.size();
+        data.firstFrame = rootTranslations.size();
+        data.numOfFrames = frameCount;
+        data.frameTime = skeleton.frameTime;
+        skeletonData.push_back(data);
+
+        // Depth levels ----------
+        std::vector<uint32_t> depths(jointCount);
+        uint32_t maxDepth = 0;
+        for (uint32_t j = 0; j < jointCount; j++) {
+            int32_t parentIndex = skeleton.parentIndices[j];
+            if (parentIndex >= static_cast<int32_t>(j)) {
+                throw std::runtime_error(
+                    "Invalid BasicSkeleton: parent joint must precede its "
+                    "children.");
+            }
+            depths[j] = parentIndex < 0 ? 0 : depths[parentIndex] + 1;
+            maxDepth = std::max(maxDepth, depths[j]);
+        }
+
+        std::vector<Level> skeletonLevels;
+        for (uint32_t depth = 0; depth <= maxDepth; depth++) {
+            Level level{};
+            level.firstLevelJoint = levelJoints.size();
+            for (uint32_t j = 0; j < jointCount; j++) {
+                if (depths[j] == depth) {
+                    levelJoints.push_back(j);
+                }
+            }
+            level.numOfLevelJoints =
+                levelJoints.size() - level.firstLevelJoint;
+            skeletonLevels.push_back(level);
+        }
+        newLevels.push_back(std::move(skeletonLevels));
+        newNumOfJoints.push_back(jointCount);
+
+        // Joints and motion ----------
+        for (uint32_t j = 0; j < jointCount; j++) {
+            JointData joint{};
+            joint.offset = glm::vec4(skeleton.offsets[j], 0.0f);
+            joint.meshTransform = skeleton.meshTransforms[j];
+            joint.parentIndex = skeleton.parentIndices[j];
+            jointData.push_back(joint);
+        }
+        rotations.insert(rotations.end(), skeleton.rotations.begin(),
+                         skeleton.rotations.end());
+        for (const auto &translation : skeleton.rootTranslations) {
+            rootTranslations.push_back(glm::vec4(translation, 0.0f));
+        }
+    }
+
+    // previous pending skeletons have not been applied yet: discard them
+    if (hasPendingUploads) {
+        renderEngine->getUploadManager().waitFor(pendingUploadTicket);
+        deferReleaseSkeletonBuffers(pendingSkeletonBuffers);
+        hasPendingUploads = false;
+    }
+
+    levels = std::move(newLevels);
+    numOfJoints = std::move(newNumOfJoints);
+    for (auto &ranges : instanceRanges) {
+        ranges.clear();
+    }
+
+    if (skeletons.empty()) {
+        deferReleaseSkeletonBuffers(skeletonBuffers);
+        return;
+    }
+
+    // Upload ----------
+    const auto upload = [&](const auto &data, BufferResource &dst) {
+        pendingUploadTicket = std::max(
+            pendingUploadTicket,
+            RenderContent::uploadViaStagingBuffer(
+                data.data(), dst, vk::BufferUsageFlagBits::eStorageBuffer,
+                sizeof(data[0]) * data.size(), renderEngine));
+    };
+    upload(skeletonData, pendingSkeletonBuffers.skeletonBufferResource);
+    upload(jointData, pendingSkeletonBuffers.jointBufferResource);
+    upload(levelJoints, pendingSkeletonBuffers.levelJointBufferResource);
+    upload(rotations, pendingSkeletonBuffers.rotationBufferResource);
+    upload(rootTranslations,
+           pendingSkeletonBuffers.rootTranslationBufferResource);
+    hasPendingUploads = true;
+
+    VLOG(VLOG_LV_3_PROCESS_TRACKING)
+        << "Upload of " << skeletons.size() << " skeletons has been queued ("
+        << rotations.size() * sizeof(rotations[0]) << " bytes of rotations).";
+}
+
+/**
+ * @brief Writes instances of the frame into UniformBufferRing.
+ * Consecutive instances of the same skeleton are evaluated by the same
+ * dispatches, so instances should be grouped by skeleton.
+ *
+ * @exception std::runtime_error if there are more than
+ * MAX_NUM_OF_SKELETON_INSTANCES instances, or joints of an instance do not fit
+ * in model matrices.
+ */
+void SkeletonComputePass::updateInstances(
+    int frameIndex, const std::vector<BasicSkeletonInstance> &instances) {
+    if (instances.size() > MAX_NUM_OF_SKELETON_INSTANCES) {
+        throw std::runtime_error("Too many skeleton instances: up to " +
+                                 std::to_string(MAX_NUM_OF_SKELETON_INSTANCES) +
+                                 " instances are supported.");
+    }
+
+    auto &ranges = instanceRanges[frameIndex];
+    ranges.clear();
+    for (uint32_t i = 0; i < instances.size(); i++) {
+        const auto &instance = instances[i];
+        if (instance.skeletonIndex >= levels.size()) {
+            throw std::runtime_error("Skeleton index of instance is out of "
+                                     "range of uploaded skeletons.");
+        }
+        if (static_cast<size_t>(instance.paletteOffset) +
+                numOfJoints[instance.skeletonIndex] >
+            NUM_OF_MODEL_MATRIX) {
+            throw std::runtime_error("Joints of skeleton instance exceed " +
+                                     std::to_string(NUM_OF_MODEL_MATRIX) +
+                                     " model matrices.");
+        }
+
+        if (!ranges.empty() &&
+            ranges.back().skeletonIndex == instance.skeletonIndex) {
+            ranges.back().numOfInstances++;
+        } else {
+            ranges.push_back({instance.skeletonIndex, i, 1});
+        }
+    }
+
+    if (!instances.empty()) {
+        uniformBufferRing->write(frameIndex, instanceSlot, instances.data(),
+                                 sizeof(instances[0]) * instances.size());
+        uniformBufferRing->flush(frameIndex);
+    }
+}
+
+/**
+ * @brief Records dispatches writing model matrices of the frame, followed by
+ * a barrier making them visible to vertex shader. Must be recorded outside
+ * RenderPass.
+ *
+ * Each depth level is dispatched for all skeletons before a barrier, so the
+ * number of barriers is the depth of the deepest skeleton.
+ */
+void SkeletonComputePass::recordDispatches(vk::CommandBuffer cmdBuffer,
+                                           int frameIndex) {
+    const auto &ranges = instanceRanges[frameIndex];
+
+    // instances always refer to the latest uploaded skeletons, so skipping
+    // dispatches would leave stale matrices in the palette drawn by vertex
+    // shader
+    if (hasPendingUploads && !ranges.empty()) {
+        renderEngine->getUploadManager().waitFor(pendingUploadTicket);
+    }
+    applyCompletedUploads();
+
+    if (hasPendingUploads || !skeletonBuffers.descriptorSet || ranges.empty()) {
+        return;
+    }
+
+    cmdBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, pipeline);
+    const uint32_t dynamicOffset =
+        uniformBufferRing->getDynamicOffset(frameIndex);
+    cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute,
+                                 pipelineLayout, 0,
+                                 skeletonBuffers.descriptorSet,
+                                 {dynamicOffset, dynamicOffset});
+
+    // joint frames are shared by frames, and the previous frame may still
+    // read or write them
+    vk::MemoryBarrier levelBarrier{};
+    levelBarrier.srcAccessMask = vk::AccessFlagBits::eShaderWrite;
+    levelBarrier.dstAccessMask =
+        vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite;
+    cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader,
+                              vk::PipelineStageFlagBits::eComputeShader, {},
+                              levelBarrier, nullptr, nullptr);
+
+    size_t maxNumOfLevels = 0;
+    for (const auto &range : ranges) {
+        maxNumOfLevels =
+            std::max(maxNumOfLevels, levels[range.skeletonIndex].size());
+    }
+
+    for (size_t depth = 0; depth < maxNumOfLevels; depth++) {
+        if (depth > 0) {
+            cmdBuffer.pipelineBarrier(
+                vk::PipelineStageFlagBits::eComputeShader,
+                vk::PipelineStageFlagBits::eComputeShader, {}, levelBarrier,
+                nullptr, nullptr);
+        }
+
+        for (const auto &range : ranges) {
+            const auto &skeletonLevels = levels[range.skeletonIndex];
+            if (depth >= skeletonLevels.size()) {
+                continue;
+            }
+
+            PushConstants pushConstants{};
+            pushConstants.skeletonIndex = range.skeletonIndex;
+            pushConstants.firstLevelJoint =
+                skeletonLevels[depth].firstLevelJoint;
+            pushConstants.numOfLevelJoints =
+                skeletonLevels[depth].numOfLevelJoints;
+            pushConstants.firstInstance = range.firstInstance;
+            pushConstants.numOfInstances = range.numOfInstances;
+            cmdBuffer.pushConstants(pipelineLayout,
+                                    vk::ShaderStageFlagBits::eCompute, 0,
+                                    sizeof(pushConstants), &pushConstants);
+
+            const uint32_t numOfInvocations =
+                range.numOfInstances * skeletonLevels[depth].numOfLevelJoints;
+            cmdBuffer.dispatch(
+                (numOfInvocations + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1, 1);
+        }
+    }
+
+    // model matrices are read by vertex shader of scene RenderPass
+    vk::MemoryBarrier vertexBarrier{};
+    vertexBarrier.srcAccessMask = vk::AccessFlagBits::eShaderWrite;
+    vertexBarrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
+    cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader,
+                              vk::PipelineStageFlagBits::eVertexShader, {},
+                              vertexBarrier, nullptr, nullptr);
+}
+} // namespace ikura
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include <glm/glm.hpp>
+
+#include "../../common/uniformBufferInfo.hpp"
+#include "../../engine/renderEngine/renderEngine.hpp"
+#include "../renderContent.hpp"
+#include "../uniformBufferRing.hpp"
+
+namespace ikura {
+/**
+ * @brief Evaluates forward kinematics of BasicSkeletons on GPU.
+ *
+ * Skeletons, including rotations of all motion frames, are uploaded once into
+ * device local storage buffers. Each frame, only BasicSkeletonInstances are
+ * written into UniformBufferRing, and a compute shader writes model matrices
+ * of all joints into the model matrix slot of the frame, which is read by
+ * vertex shader as it is. Joints are dispatched one depth level at a time,
+ * so that frames of parents are always written before children read them.
+ */
+class SkeletonComputePass {
+    // GPU layouts (std430) ----------
+    struct SkeletonData {
+        uint32_t firstJoint;
+        uint32_t numOfJoints;
+        uint32_t firstRotation;
+        uint32_t firstFrame;
+        uint32_t numOfFrames;
+        float frameTime;
+    };
+    struct JointData {
+        glm::vec4 offset;
+        glm::mat4 meshTransform;
+        int32_t parentIndex;
+        uint32_t padding[3];
+    };
+    struct PushConstants {
+        uint32_t skeletonIndex;
+        uint32_t firstLevelJoint;
+        uint32_t numOfLevelJoints;
+        uint32_t firstInstance;
+        uint32_t numOfInstances;
+    };
+
+    // Skeleton buffers ----------
+    // replaced as a whole by setSkeletons()
+    struct SkeletonBuffers {
+        BufferResource skeletonBufferResource;
+        BufferResource jointBufferResource;
+        BufferResource levelJointBufferResource;
+        BufferResource rotationBufferResource;
+        BufferResource rootTranslationBufferResource;
+        vk::DescriptorPool descriptorPool;
+        vk::DescriptorSet descriptorSet;
+    };
+    // levelJoints[first : first + count] of a depth level
+    struct Level {
+        uint32_t firstLevelJoint;
+        uint32_t numOfLevelJoints;
+    };
+    // consecutive instances of the same skeleton, dispatched together
+    struct InstanceRange {
+        uint32_t skeletonIndex;
+        uint32_t firstInstance;
+        uint32_t numOfInstances;
+    };
+
+    std::shared_ptr<RenderEngine> renderEngine;
+    std::shared_ptr<UniformBufferRing> uniformBufferRing;
+    UniformSlot modelMatSlot;
+    UniformSlot instanceSlot;
+
+    // Pipeline ----------
+    vk::DescriptorSetLayout descriptorSetLayout;
+    vk::PipelineLayout pipelineLayout;
+    vk::Pipeline pipeline;
+
+    // frames of joints in which children are placed, indexed like model
+    // matrices, shared by all frames
+    BufferResource jointFrameBufferResource;
+
+    SkeletonBuffers skeletonBuffers;
+    SkeletonBuffers pendingSkeletonBuffers;
+    UploadTicket pendingUploadTicket = 0;
+    bool hasPendingUploads = false;
+
+    // levels[skeleton][depth] of the latest setSkeletons()
+    std::vector<std::vector<Level>> levels;
+    std::vector<uint32_t> numOfJoints;
+    // instanceRanges[frame]
+    std::vector<std::vector<InstanceRange>> instanceRanges;
+
+    void setupDescriptorSetLayout();
+    void setupPipeline();
+    void setupJointFrameBuffer();
+    void setupDescriptorSet(SkeletonBuffers &buffers);
+    void applyCompletedUploads();
+    void deferReleaseSkeletonBuffers(SkeletonBuffers &buffers);
+
+  public:
+    SkeletonComputePass(std::shared_ptr<RenderEngine> renderEngine,
+                        std::shared_ptr<UniformBufferRing> uniformBufferRing,
+                        UniformSlot modelMatSlot);
+    ~SkeletonComputePass();
+
+    void setSkeletons(const std::vector<BasicSkeleton> &skeletons);
+    void updateInstances(int frameIndex,
+                         const std::vector<BasicSkeletonInstance> &instances);
+    void recordDispatches(vk::CommandBuffer cmdBuffer, int frameIndex);
+};
+} // namespace ikura
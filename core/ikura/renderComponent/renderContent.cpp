@@ -4,10 +4,26 @@
 
 #include <easylogging++.h>
 
-#include "../window/nativeWindow/nativeWindow.hpp"
 #include "../common/logLevels.hpp"
+#include "../engine/renderEngine/uploadManager.hpp"
+#include "../window/nativeWindow/nativeWindow.hpp"
+#include "./renderTarget.hpp"
 
 namespace ikura {
+namespace {
+// release buffer after frames in flight stop referencing it
+void deferRelease(std::shared_ptr<RenderEngine> renderEngine,
+                  BufferResource bufferResource) {
+    if (!bufferResource.buffer) {
+        return;
+    }
+    auto allocator = renderEngine->getVmaAllocator();
+    renderEngine->deferDestruction([allocator, bufferResource]() mutable {
+        bufferResource.release(*allocator);
+    });
+}
+} // namespace
+
 void BufferResource::release(VmaAllocator allocator) {
     if (buffer) {
         vmaDestroyBuffer(allocator, (VkBuffer)buffer, alloc);
@@ -24,24 +40,24 @@ RenderContent::RenderContent(std::shared_ptr<RenderEngine> renderEngine,
 }
 
 RenderContent::~RenderContent() {
+    // pending buffers may be written by transfer queue
+    if (hasPendingUploads) {
+        renderEngine->getUploadManager().waitFor(pendingUploadTicket);
+    }
+
     VLOG(VLOG_LV_3_PROCESS_TRACKING) << "Destroying default DescriptorPool...";
     renderEngine->getDevice().destroyDescriptorPool(descriptorPool);
     VLOG(VLOG_LV_3_PROCESS_TRACKING)
         << "Default DescriptorPool has been destroyed.";
 
-    VLOG(VLOG_LV_3_PROCESS_TRACKING) << "Destroying default UniformBuffers...";
-    for (auto &resources : uniformBufferResources) {
-        for (auto &r : resources) {
-            r.release(*renderEngine->getVmaAllocator());
-        }
-    }
-    VLOG(VLOG_LV_3_PROCESS_TRACKING)
-        << "Default UniformBuffers has been destroyed.";
-
     VLOG(VLOG_LV_3_PROCESS_TRACKING)
         << "Destroying VertexBuffer and IndexBuffer...";
     vertexBufferResource.release(*renderEngine->getVmaAllocator());
     indexBufferResource.release(*renderEngine->getVmaAllocator());
+    instanceBufferResource.release(*renderEngine->getVmaAllocator());
+    pendingVertexBufferResource.release(*renderEngine->getVmaAllocator());
+    pendingIndexBufferResource.release(*renderEngine->getVmaAllocator());
+    pendingInstanceBufferResource.release(*renderEngine->getVmaAllocator());
     VLOG(VLOG_LV_3_PROCESS_TRACKING)
         << "VertexBuffer and IndexBuffer have been destroyed.";
 }
@@ -50,6 +66,45 @@ void RenderContent::uploadVertexBuffer() {}
 
 void RenderContent::uploadIndexBuffer() {}
 
+void RenderContent::uploadInstanceBuffer() {}
+
+/**
+ * @brief Replaces buffers with pending ones if their upload has completed.
+ * NativeWindow calls this before recording commands of each frame.
+ *
+ * @return true if buffers have been replaced.
+ */
+bool RenderContent::applyCompletedUploads() {
+    if (!hasPendingUploads ||
+        !renderEngine->getUploadManager().isComplete(pendingUploadTicket)) {
+        return false;
+    }
+
+    if (pendingVertexBufferResource.buffer) {
+        deferRelease(renderEngine, vertexBufferResource);
+        vertexBufferResource = pendingVertexBufferResource;
+        pendingVertexBufferResource = {};
+    }
+    if (pendingIndexBufferResource.buffer) {
+        deferRelease(renderEngine, indexBufferResource);
+        indexBufferResource = pendingIndexBufferResource;
+        pendingIndexBufferResource = {};
+    }
+    if (pendingInstanceBufferResource.buffer) {
+        deferRelease(renderEngine, instanceBufferResource);
+        instanceBufferResource = pendingInstanceBufferResource;
+        pendingInstanceBufferResource = {};
+    }
+    renderEngine->getUploadManager().markApplied(pendingUploadTicket);
+    hasPendingUploads = false;
+    contentVersion++;
+
+    VLOG(VLOG_LV_4_PROCESS_TRACKING_SECONDARY)
+        << "Uploaded buffers have been applied.";
+
+    return true;
+}
+
 const vk::Buffer &RenderContent::getVertexBuffer() const {
     return vertexBufferResource.buffer;
 }
@@ -58,66 +113,125 @@ const vk::Buffer &RenderContent::getIndexBuffer() const {
     return indexBufferResource.buffer;
 }
 
-const std::vector<vk::DescriptorSet> &
-RenderContent::getDescriptorSets(int index) {
-    return descriptorSets[index];
+const vk::Buffer &RenderContent::getInstanceBuffer() const {
+    return instanceBufferResource.buffer;
+}
+
+const std::vector<vk::DescriptorSet> &RenderContent::getDescriptorSets() const {
+    return descriptorSets;
+}
+
+uint64_t RenderContent::getContentVersion() const { return contentVersion; }
+
+std::vector<uint32_t>
+RenderContent::getDynamicOffsets(int frameIndex, int viewportIndex) const {
+    return {};
 }
 
 const size_t RenderContent::getNumOfIndex() { return 0; }
 
-void RenderContent::uploadViaStagingBuffer(
-    void *srcData, BufferResource &dstBufferResource,
-    vk::BufferUsageFlags dstBufferUsage, vk::DeviceSize bufferSize,
-    std::shared_ptr<RenderEngine> renderEngine) {
+/**
+ * @brief Records commands which must run before scene RenderPass of
+ * frameIndex, e.g. compute dispatches producing model matrices.
+ * Unlike draw commands, they are recorded into the primary CommandBuffer
+ * every frame, so they may depend on per-frame state.
+ */
+void RenderContent::recordComputeCommands(vk::CommandBuffer cmdBuffer,
+                                          int frameIndex) {}
+
+/**
+ * @brief Records binding of buffers / DescriptorSets and draw commands.
+ * Graphics pipeline of renderTarget must be bound by caller, and
+ * implementations may bind other pipelines of renderTarget.
+ * Geometry is drawn once per viewport. Buffers are bound only once, and
+ * only viewport, scissor and dynamic offsets are changed between viewports.
+ * Nothing is drawn until the first upload completes.
+ *
+ * Recorded commands may be replayed in later frames of the same frameIndex,
+ * so they must depend only on the arguments and state covered by
+ * contentVersion.
+ */
+void RenderContent::recordDrawCommands(
+    vk::CommandBuffer cmdBuffer, const RenderTarget &renderTarget,
+    int frameIndex, const std::vector<SceneViewport> &viewports) {
+    if (!vertexBufferResource.buffer || !indexBufferResource.buffer) {
+        return;
+    }
 
-    // Staging buffer allocation ----------
-    BufferResource stagingBufferResource;
-    vk::BufferCreateInfo stagingBufferCI{};
-    stagingBufferCI.size = bufferSize;
-    stagingBufferCI.usage = vk::BufferUsageFlagBits::eTransferSrc;
+    cmdBuffer.bindVertexBuffers(0, {vertexBufferResource.buffer}, {0});
+    cmdBuffer.bindIndexBuffer(indexBufferResource.buffer, 0,
+                              vk::IndexType::eUint32);
 
-    VmaAllocationCreateInfo allocCI{};
-    allocCI.usage = VMA_MEMORY_USAGE_AUTO_PREFER_HOST;
-    allocCI.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT |
-                    VMA_ALLOCATION_CREATE_MAPPED_BIT;
-    VmaAllocationInfo stagingBufferAllocInfo{};
+    for (size_t i = 0; i < viewports.size(); i++) {
+        cmdBuffer.setViewport(0, viewports[i].viewport);
+        cmdBuffer.setScissor(0, viewports[i].scissor);
+        cmdBuffer.bindDescriptorSets(
+            vk::PipelineBindPoint::eGraphics,
+            renderTarget.getGraphicsPipelineLayout(), 0, descriptorSets,
+            getDynamicOffsets(frameIndex, static_cast<int>(i)));
 
-    VkBuffer vkBuffer;
-    auto vkBufferCI = (VkBufferCreateInfo)stagingBufferCI;
-    vmaCreateBuffer(*renderEngine->getVmaAllocator(), &vkBufferCI, &allocCI,
-                    &vkBuffer, &stagingBufferResource.alloc,
-                    &stagingBufferAllocInfo);
-    stagingBufferResource.buffer = (vk::Buffer)vkBuffer;
+        cmdBuffer.drawIndexed(getNumOfIndex(), 1, 0, 0, 0);
+    }
+}
+
+/**
+ * @brief Creates device local buffer and enqueues upload of srcData into it.
+ * The upload is not complete until the returned ticket completes.
+ */
+UploadTicket RenderContent::uploadViaStagingBuffer(
+    const void *srcData, BufferResource &dstBufferResource,
+    vk::BufferUsageFlags dstBufferUsage, vk::DeviceSize bufferSize,
+    std::shared_ptr<RenderEngine> renderEngine) {
+
+    auto &uploadManager = renderEngine->getUploadManager();
 
     // Destination buffer allocation ----------
+    // accessed by both transfer and graphics queue if they are different
+    auto queueFamilies = uploadManager.getQueueFamiliesAccessingUploads();
+
     vk::BufferCreateInfo dstBufferCI{};
     dstBufferCI.size = bufferSize;
     dstBufferCI.usage = dstBufferUsage | vk::BufferUsageFlagBits::eTransferDst;
-    dstBufferCI.sharingMode = vk::SharingMode::eExclusive;
+    if (queueFamilies.size() > 1) {
+        dstBufferCI.sharingMode = vk::SharingMode::eConcurrent;
+        dstBufferCI.setQueueFamilyIndices(queueFamilies);
+    } else {
+        dstBufferCI.sharingMode = vk::SharingMode::eExclusive;
+    }
 
-    allocCI = {};
+    VmaAllocationCreateInfo allocCI{};
     allocCI.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
 
-    vkBufferCI = (VkBufferCreateInfo)dstBufferCI;
+    VkBuffer vkBuffer;
+    auto vkBufferCI = (VkBufferCreateInfo)dstBufferCI;
     vmaCreateBuffer(*renderEngine->getVmaAllocator(), &vkBufferCI, &allocCI,
                     &vkBuffer, &dstBufferResource.alloc, nullptr);
     dstBufferResource.buffer = (vk::Buffer)vkBuffer;
 
     // Copy ----------
-    // srcData to staging buffer
-    memcpy(stagingBufferAllocInfo.pMappedData, srcData, bufferSize);
-
-    // staging buffer to destination buffer
-    auto cmdBuffer = renderEngine->beginSingleTimeCommands();
-
-    vk::BufferCopy copy;
-    copy.size = bufferSize;
-    cmdBuffer.copyBuffer(stagingBufferResource.buffer, dstBufferResource.buffer,
-                         copy);
+    // srcData is copied into staging ring here, so it can be freed after return
+    return uploadManager.enqueueBufferUpload(srcData, bufferSize,
+                                             dstBufferResource.buffer);
+}
 
-    // submit command
-    renderEngine->endSingleTimeCommands(cmdBuffer);
+/**
+ * @brief Uploads srcData into pendingBufferResource.
+ * Pending buffers replace current ones in applyCompletedUploads().
+ */
+void RenderContent::uploadToPendingBuffer(
+    const void *srcData, BufferResource &pendingBufferResource,
+    vk::BufferUsageFlags dstBufferUsage, vk::DeviceSize bufferSize) {
+
+    // previous pending buffer has not been applied yet: discard it
+    if (pendingBufferResource.buffer) {
+        renderEngine->getUploadManager().waitFor(pendingUploadTicket);
+        pendingBufferResource.release(*renderEngine->getVmaAllocator());
+        pendingBufferResource = {};
+    }
 
-    stagingBufferResource.release(*renderEngine->getVmaAllocator());
+    pendingUploadTicket =
+        uploadViaStagingBuffer(srcData, pendingBufferResource, dstBufferUsage,
+                               bufferSize, renderEngine);
+    hasPendingUploads = true;
 }
 } // namespace ikura
\ No newline at end of file
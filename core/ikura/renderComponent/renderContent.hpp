@@ -13,11 +13,22 @@ namespace ikura {
 class BufferResource {
   public:
     vk::Buffer buffer;
-    VmaAllocation alloc;
+    VmaAllocation alloc = VK_NULL_HANDLE;
 
     void release(VmaAllocator allocator);
 };
 
+// Viewport of scene pass, in pixels of render extent.
+// Index of SceneViewport selects scene matrices of the viewport.
+struct SceneViewport {
+    vk::Viewport viewport;
+    vk::Rect2D scissor;
+
+    bool operator==(const SceneViewport &other) const {
+        return viewport == other.viewport && scissor == other.scissor;
+    }
+};
+
 class RenderContent {
   protected:
     RenderContent(std::shared_ptr<RenderEngine> renderEngine,
@@ -29,36 +40,65 @@ class RenderContent {
     // Buffers ----------
     BufferResource vertexBufferResource;
     BufferResource indexBufferResource;
-    // uniformBuffers[frame][set]
-    std::vector<std::vector<BufferResource>> uniformBufferResources;
+    BufferResource instanceBufferResource;
+    // buffers being uploaded, replace above ones on completion
+    BufferResource pendingVertexBufferResource;
+    BufferResource pendingIndexBufferResource;
+    BufferResource pendingInstanceBufferResource;
+    UploadTicket pendingUploadTicket = 0;
+    bool hasPendingUploads = false;
 
     // about DescriptorSet ----------
     vk::DescriptorPool descriptorPool;
-    // descriptorSets[frame][set]
-    std::vector<std::vector<vk::DescriptorSet>> descriptorSets;
+    // descriptorSets[set]
+    // shared between frames, frame is selected by dynamic offsets
+    std::vector<vk::DescriptorSet> descriptorSets;
     vk::DescriptorSetLayout descriptorSetLayout;
 
     // Properties ----------
     int numOfFrames;
+    // incremented whenever recorded draw commands would change
+    uint64_t contentVersion = 0;
 
     // Functions ==========
-    static void
-    uploadViaStagingBuffer(void *srcData, BufferResource &dstBufferResource,
-                           vk::BufferUsageFlags dstBufferUsage,
-                           vk::DeviceSize bufferSize,
-                           std::shared_ptr<RenderEngine> renderEngine);
+    void uploadToPendingBuffer(const void *srcData,
+                               BufferResource &pendingBufferResource,
+                               vk::BufferUsageFlags dstBufferUsage,
+                               vk::DeviceSize bufferSize);
 
   public:
     virtual ~RenderContent();
 
+    // Upload helpers (also used by SkeletonComputePass) ----------
+    static UploadTicket
+    uploadViaStagingBuffer(const void *srcData,
+                           BufferResource &dstBufferResource,
+                           vk::BufferUsageFlags dstBufferUsage,
+                           vk::DeviceSize bufferSize,
+                           std::shared_ptr<RenderEngine> renderEngine);
+
     // Upload to GPU ----------
     virtual void uploadVertexBuffer();
     virtual void uploadIndexBuffer();
+    virtual void uploadInstanceBuffer();
+    virtual bool applyCompletedUploads();
+
+    // Draw ----------
+    virtual void recordComputeCommands(vk::CommandBuffer cmdBuffer,
+                                       int frameIndex);
+    virtual void
+    recordDrawCommands(vk::CommandBuffer cmdBuffer,
+                       const RenderTarget &renderTarget, int frameIndex,
+                       const std::vector<SceneViewport> &viewports);
 
     // Getter ----------
     virtual const size_t getNumOfIndex();
     const vk::Buffer &getVertexBuffer() const;
     const vk::Buffer &getIndexBuffer() const;
-    const std::vector<vk::DescriptorSet> &getDescriptorSets(int index);
+    const vk::Buffer &getInstanceBuffer() const;
+    const std::vector<vk::DescriptorSet> &getDescriptorSets() const;
+    uint64_t getContentVersion() const;
+    virtual std::vector<uint32_t>
+    getDynamicOffsets(int frameIndex, int viewportIndex = 0) const;
 };
 } // namespace ikura
\ No newline at end of file
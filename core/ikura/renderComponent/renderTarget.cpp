@@ -1,5 +1,6 @@
 #include "./renderTarget.hpp"
 
+#include <algorithm>
 #include <array>
 
 #include <easylogging++.h>
@@ -25,46 +26,481 @@ void ImageResource::release(vk::Device device, VmaAllocator allocator) {
             device.destroyImage(image, nullptr);
         }
     }
+
+    // releasing again is no-op
+    image = nullptr;
+    view = nullptr;
+    allocation.reset();
 }
 
 void RenderTarget::createSyncObjects() {
     imageAvailableSemaphores.resize(numOfFrames);
     renderFinishedSemaphores.resize(numOfFrames);
-    renderingFence.resize(numOfFrames);
 
+    // binary semaphores for SwapChain, frames are paced by frame timeline of
+    // RenderEngine
     vk::SemaphoreCreateInfo semaphoreCI{};
-    vk::FenceCreateInfo fenceCI{};
-    fenceCI.flags = vk::FenceCreateFlagBits::eSignaled;
 
     for (int i = 0; i < numOfFrames; i++) {
         imageAvailableSemaphores[i] =
             renderEngine->getDevice().createSemaphore(semaphoreCI);
         renderFinishedSemaphores[i] =
             renderEngine->getDevice().createSemaphore(semaphoreCI);
-        renderingFence[i] = renderEngine->getDevice().createFence(fenceCI);
     }
 }
 
+void RenderTarget::createCommandPool() {
+    vk::CommandPoolCreateInfo cmdPoolCI{};
+    cmdPoolCI.flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer;
+    cmdPoolCI.queueFamilyIndex = renderEngine->getQueueFamilyIndices().get(
+        QueueFamilyIndices::GRAPHICS);
+
+    cmdPool = renderEngine->getDevice().createCommandPool(cmdPoolCI);
+}
+
 void RenderTarget::createRenderCmdBuffers() {
     renderCmdBuffers.resize(numOfFrames);
 
     vk::CommandBufferAllocateInfo allocInfo{};
-    allocInfo.commandPool = renderEngine->getCommandPool();
+    allocInfo.commandPool = cmdPool;
     allocInfo.level = vk::CommandBufferLevel::ePrimary;
     allocInfo.commandBufferCount = renderCmdBuffers.size();
 
     renderCmdBuffers =
         renderEngine->getDevice().allocateCommandBuffers(allocInfo);
+
+    allocInfo.level = vk::CommandBufferLevel::eSecondary;
+    sceneCmdBuffers =
+        renderEngine->getDevice().allocateCommandBuffers(allocInfo);
+}
+
+void RenderTarget::createTimestampQueryPool() {
+    isTimestampWritten.assign(numOfFrames, false);
+
+    if (!renderEngine->getEngineInfo().support.isTimestampSupported) {
+        VLOG(VLOG_LV_3_PROCESS_TRACKING)
+            << "Timestamp query is not supported. GPU timer is disabled.";
+        return;
+    }
+
+    vk::QueryPoolCreateInfo queryPoolCI{};
+    queryPoolCI.queryType = vk::QueryType::eTimestamp;
+    queryPoolCI.queryCount = 2 * numOfFrames;
+
+    timestampQueryPool = renderEngine->getDevice().createQueryPool(queryPoolCI);
+}
+
+/**
+ * @brief Creates host visible buffers, into which a pixel of id image is
+ * copied by recordPickReadback(), one per frame.
+ */
+void RenderTarget::createPickReadbacks() {
+    vk::BufferCreateInfo bufferCI{};
+    bufferCI.size = sizeof(uint32_t);
+    bufferCI.usage = vk::BufferUsageFlagBits::eTransferDst;
+    bufferCI.sharingMode = vk::SharingMode::eExclusive;
+
+    VmaAllocationCreateInfo allocCI{};
+    allocCI.usage = VMA_MEMORY_USAGE_AUTO_PREFER_HOST;
+    allocCI.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT |
+                    VMA_ALLOCATION_CREATE_MAPPED_BIT;
+
+    pickReadbacks.resize(numOfFrames);
+    for (auto &pickReadback : pickReadbacks) {
+        VmaAllocationInfo allocInfo{};
+        auto vkBufferCI = (VkBufferCreateInfo)bufferCI;
+        VkBuffer vkBuffer;
+        auto result = vmaCreateBuffer(
+            *renderEngine->getVmaAllocator(), &vkBufferCI, &allocCI, &vkBuffer,
+            &pickReadback.bufferResource.alloc, &allocInfo);
+        if (result != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create pick readback buffer.");
+        }
+        pickReadback.bufferResource.buffer = (vk::Buffer)vkBuffer;
+        pickReadback.mappedData =
+            static_cast<uint32_t *>(allocInfo.pMappedData);
+    }
+}
+
+/**
+ * @brief Writes begin timestamp of the frame.
+ * Must be recorded outside of RenderPass.
+ */
+void RenderTarget::beginGpuTimer(vk::CommandBuffer cmdBuffer, int frameIndex) {
+    if (!timestampQueryPool) {
+        return;
+    }
+
+    cmdBuffer.resetQueryPool(timestampQueryPool, 2 * frameIndex, 2);
+    cmdBuffer.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe,
+                             timestampQueryPool, 2 * frameIndex);
+}
+
+void RenderTarget::endGpuTimer(vk::CommandBuffer cmdBuffer, int frameIndex) {
+    if (!timestampQueryPool) {
+        return;
+    }
+
+    cmdBuffer.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe,
+                             timestampQueryPool, 2 * frameIndex + 1);
+    isTimestampWritten[frameIndex] = true;
+}
+
+/**
+ * @brief Reads GPU time of the frame into lastGpuTime.
+ * Call after the frame serial of the frame has completed.
+ */
+void RenderTarget::fetchGpuTime(int frameIndex) {
+    if (!timestampQueryPool || !isTimestampWritten[frameIndex]) {
+        return;
+    }
+
+    std::array<uint64_t, 2> timestamps{};
+    auto result = renderEngine->getDevice().getQueryPoolResults(
+        timestampQueryPool, 2 * frameIndex, 2,
+        sizeof(uint64_t) * timestamps.size(), timestamps.data(),
+        sizeof(uint64_t), vk::QueryResultFlagBits::e64);
+    if (result != vk::Result::eSuccess) {
+        return;
+    }
+
+    lastGpuTime = (timestamps[1] - timestamps[0]) *
+                  renderEngine->getEngineInfo().limit.timestampPeriod /
+                  (1000.0 * 1000.0);
+}
+
+// Picking ----------
+
+/**
+ * @brief Requests reading back id image at (x, y) in pixels of render images.
+ * The pixel is copied by the next recordPickReadback(), and the id is taken by
+ * takePickResult() after the frame completes. Later request in the same frame
+ * overrides earlier one.
+ */
+void RenderTarget::requestPick(float x, float y) {
+    if (x < 0.0f || y < 0.0f || x >= imageExtent.width ||
+        y >= imageExtent.height) {
+        return;
+    }
+    requestedPickPixel = vk::Offset2D(static_cast<int32_t>(x),
+                                      static_cast<int32_t>(y));
+}
+
+/**
+ * @brief Records copy of the requested pixel of id image into the pick
+ * readback buffer of the frame, followed by a barrier making it visible to
+ * host. id image must be in TransferSrcOptimal by finalLayout of renderPass.
+ */
+void RenderTarget::recordPickReadback(vk::CommandBuffer cmdBuffer,
+                                      int frameIndex) {
+    if (!requestedPickPixel.has_value()) {
+        return;
+    }
+
+    // requested in pixels of render images, id image is at renderExtent
+    auto pixel = requestedPickPixel.value();
+    int32_t x = std::min<int32_t>(
+        static_cast<int64_t>(pixel.x) * renderExtent.width / imageExtent.width,
+        renderExtent.width - 1);
+    int32_t y = std::min<int32_t>(
+        static_cast<int64_t>(pixel.y) * renderExtent.height /
+            imageExtent.height,
+        renderExtent.height - 1);
+
+    auto &pickReadback = pickReadbacks[frameIndex];
+
+    vk::BufferImageCopy region{};
+    region.bufferOffset = 0;
+    region.bufferRowLength = 0;
+    region.bufferImageHeight = 0;
+    region.imageSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
+    region.imageSubresource.mipLevel = 0;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount = 1;
+    region.imageOffset = vk::Offset3D(x, y, 0);
+    region.imageExtent = vk::Extent3D(1, 1, 1);
+    cmdBuffer.copyImageToBuffer(idImageResource.image,
+                                vk::ImageLayout::eTransferSrcOptimal,
+                                pickReadback.bufferResource.buffer, region);
+
+    vk::BufferMemoryBarrier hostBarrier{};
+    hostBarrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+    hostBarrier.dstAccessMask = vk::AccessFlagBits::eHostRead;
+    hostBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    hostBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    hostBarrier.buffer = pickReadback.bufferResource.buffer;
+    hostBarrier.offset = 0;
+    hostBarrier.size = VK_WHOLE_SIZE;
+    cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+                              vk::PipelineStageFlagBits::eHost, {}, {},
+                              hostBarrier, {});
+
+    pickReadback.isPending = true;
+    requestedPickPixel.reset();
+}
+
+/**
+ * @brief Reads pending pick readback of the frame into pickResult.
+ * Call after the frame serial of the frame has completed.
+ */
+void RenderTarget::fetchPickResult(int frameIndex) {
+    if (!pickReadbacks[frameIndex].isPending) {
+        return;
+    }
+
+    auto &pickReadback = pickReadbacks[frameIndex];
+    vmaInvalidateAllocation(*renderEngine->getVmaAllocator(),
+                            pickReadback.bufferResource.alloc, 0,
+                            VK_WHOLE_SIZE);
+    pickResult = *pickReadback.mappedData;
+    pickReadback.isPending = false;
+}
+
+/**
+ * @brief Returns id image value of the latest completed pick, only once.
+ * The value is model matrix id + 1 of the picked mesh, or 0 if nothing is
+ * drawn at the pixel.
+ */
+std::optional<uint32_t> RenderTarget::takePickResult() {
+    auto result = pickResult;
+    pickResult.reset();
+    return result;
 }
 
 void RenderTarget::recreateResourcesForSwapChainRecreation(
     vk::Extent2D imageExtent, std::vector<vk::Image> renderImages) {
 }
 
+void RenderTarget::recreateResourcesForRenderSettingsChange(
+    bool isMsaaChanged) {}
+
+/**
+ * @brief Rebuilds per-frame sync objects, CommandBuffers and timestamp
+ * queries for new number of frames in flight. Device must be idle.
+ */
+void RenderTarget::recreateResourcesForFrameSettingsChange(int numOfFrames) {
+    destroyFrameResources();
+
+    this->numOfFrames = numOfFrames;
+    createSyncObjects();
+    createRenderCmdBuffers();
+    createTimestampQueryPool();
+    createPickReadbacks();
+    lastGpuTime = 0.0;
+    pickResult.reset();
+}
+
+/**
+ * @brief Destroys per-frame objects created by createSyncObjects(),
+ * createRenderCmdBuffers(), createTimestampQueryPool() and
+ * createPickReadbacks().
+ */
+void RenderTarget::destroyFrameResources() {
+    auto device = renderEngine->getDevice();
+
+    for (int i = 0; i < numOfFrames; i++) {
+        device.destroySemaphore(imageAvailableSemaphores[i]);
+        device.destroySemaphore(renderFinishedSemaphores[i]);
+    }
+    imageAvailableSemaphores.clear();
+    renderFinishedSemaphores.clear();
+
+    device.freeCommandBuffers(cmdPool, renderCmdBuffers);
+    device.freeCommandBuffers(cmdPool, sceneCmdBuffers);
+    renderCmdBuffers.clear();
+    sceneCmdBuffers.clear();
+
+    device.destroyQueryPool(timestampQueryPool);
+    timestampQueryPool = nullptr;
+
+    for (auto &pickReadback : pickReadbacks) {
+        pickReadback.bufferResource.release(*renderEngine->getVmaAllocator());
+    }
+    pickReadbacks.clear();
+}
+
+void RenderTarget::updateRenderExtent() {
+    renderExtent.width = std::max<uint32_t>(
+        1, static_cast<uint32_t>(imageExtent.width * renderScale));
+    renderExtent.height = std::max<uint32_t>(
+        1, static_cast<uint32_t>(imageExtent.height * renderScale));
+}
+
+bool RenderTarget::isUpscaling() const { return renderScale < 1.0f; }
+
+/**
+ * @brief Hands resources depending on render settings over to deferred
+ * destruction, so that settings can be changed without waiting for frames in
+ * flight. RenderPass, FrameBuffers and non-render ImageResources are
+ * released, and also pipelines if releasePipelines is true.
+ */
+void RenderTarget::deferReleaseRenderResources(bool releasePipelines) {
+    auto device = renderEngine->getDevice();
+    auto allocator = *renderEngine->getVmaAllocator();
+
+    std::array<ImageResource, 5> imageResources = {
+        colorImageResource, depthImageResource, sceneImageResource,
+        multisampledIdImageResource, idImageResource};
+    std::vector<vk::Framebuffer> oldFrameBuffers = frameBuffers;
+    vk::RenderPass oldRenderPass = renderPass;
+    std::vector<vk::Pipeline> pipelines;
+    if (releasePipelines) {
+        pipelines = {graphicsPipeline, floorPipeline, linePipeline,
+                     pointPipeline};
+        graphicsPipeline = nullptr;
+        floorPipeline = nullptr;
+        linePipeline = nullptr;
+        pointPipeline = nullptr;
+    }
+
+    renderEngine->deferDestruction([=]() mutable {
+        for (auto &imageResource : imageResources) {
+            imageResource.release(device, allocator);
+        }
+        for (auto &frameBuffer : oldFrameBuffers) {
+            device.destroyFramebuffer(frameBuffer);
+        }
+        for (auto &pipeline : pipelines) {
+            device.destroyPipeline(pipeline);
+        }
+        device.destroyRenderPass(oldRenderPass);
+    });
+
+    colorImageResource = ImageResource{};
+    depthImageResource = ImageResource{};
+    sceneImageResource = ImageResource{};
+    multisampledIdImageResource = ImageResource{};
+    idImageResource = ImageResource{};
+    frameBuffers.clear();
+    renderPass = nullptr;
+}
+
+/**
+ * @brief Sets MSAA sample count of scene rendering.
+ * If the count is not supported, the largest supported count below it is
+ * used. Attachments, RenderPass and pipelines are rebuilt.
+ */
+void RenderTarget::setMsaaSamples(vk::SampleCountFlagBits samples) {
+    auto supported = renderEngine->getEngineInfo().limit.supportedMsaaSamples;
+    while (samples != vk::SampleCountFlagBits::e1 && !(supported & samples)) {
+        samples = static_cast<vk::SampleCountFlagBits>(
+            static_cast<uint32_t>(samples) >> 1);
+    }
+
+    if (samples == msaaSamples) {
+        return;
+    }
+    msaaSamples = samples;
+    recreateResourcesForRenderSettingsChange(true);
+    renderPassVersion++;
+}
+
+/**
+ * @brief Sets scale of scene rendering resolution to render images.
+ * Scene is rendered at the scaled resolution and upscaled by blit.
+ * Attachments and RenderPass are rebuilt, pipelines are kept.
+ */
+void RenderTarget::setRenderScale(float scale) {
+    scale = std::clamp(scale, MIN_RENDER_SCALE, 1.0f);
+    if (!isRenderScaleSupported()) {
+        scale = 1.0f;
+    }
+
+    if (scale == renderScale) {
+        return;
+    }
+    renderScale = scale;
+    updateRenderExtent();
+    recreateResourcesForRenderSettingsChange(false);
+    renderPassVersion++;
+}
+
+/**
+ * @brief Returns whether scene can be upscaled to render images by blit.
+ */
+bool RenderTarget::isRenderScaleSupported() const {
+    if (!(renderImageUsage & vk::ImageUsageFlagBits::eTransferDst)) {
+        return false;
+    }
+
+    auto features =
+        renderEngine->getPhysicalDevice()
+            .getFormatProperties(colorImageFormat)
+            .optimalTilingFeatures;
+    auto required = vk::FormatFeatureFlagBits::eBlitSrc |
+                    vk::FormatFeatureFlagBits::eBlitDst |
+                    vk::FormatFeatureFlagBits::eSampledImageFilterLinear;
+
+    return (features & required) == required;
+}
+
+void RenderTarget::recordUpscale(vk::CommandBuffer cmdBuffer,
+                                 uint32_t imageIndex) {
+    if (!isUpscaling()) {
+        return;
+    }
+
+    vk::ImageSubresourceRange range{};
+    range.aspectMask = vk::ImageAspectFlagBits::eColor;
+    range.baseMipLevel = 0;
+    range.levelCount = 1;
+    range.baseArrayLayer = 0;
+    range.layerCount = 1;
+
+    // render image: undefined -> transfer dst
+    // (chained to image acquisition, which waits at ColorAttachmentOutput)
+    vk::ImageMemoryBarrier toTransferDst{};
+    toTransferDst.srcAccessMask = {};
+    toTransferDst.dstAccessMask = vk::AccessFlagBits::eTransferWrite;
+    toTransferDst.oldLayout = vk::ImageLayout::eUndefined;
+    toTransferDst.newLayout = vk::ImageLayout::eTransferDstOptimal;
+    toTransferDst.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    toTransferDst.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    toTransferDst.image = renderImageResources[imageIndex].image;
+    toTransferDst.subresourceRange = range;
+
+    cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eColorAttachmentOutput,
+                              vk::PipelineStageFlagBits::eTransfer, {}, {}, {},
+                              toTransferDst);
+
+    // scene image is in TransferSrcOptimal by finalLayout of renderPass
+    vk::ImageBlit blit{};
+    blit.srcSubresource = vk::ImageSubresourceLayers(
+        vk::ImageAspectFlagBits::eColor, 0, 0, 1);
+    blit.srcOffsets[1] = vk::Offset3D(renderExtent.width,
+                                      renderExtent.height, 1);
+    blit.dstSubresource = vk::ImageSubresourceLayers(
+        vk::ImageAspectFlagBits::eColor, 0, 0, 1);
+    blit.dstOffsets[1] = vk::Offset3D(imageExtent.width, imageExtent.height, 1);
+
+    cmdBuffer.blitImage(sceneImageResource.image,
+                        vk::ImageLayout::eTransferSrcOptimal,
+                        renderImageResources[imageIndex].image,
+                        vk::ImageLayout::eTransferDstOptimal, blit,
+                        vk::Filter::eLinear);
+
+    // render image: transfer dst -> color attachment (for overlayRenderPass)
+    vk::ImageMemoryBarrier toColorAttachment = toTransferDst;
+    toColorAttachment.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+    toColorAttachment.dstAccessMask =
+        vk::AccessFlagBits::eColorAttachmentRead |
+        vk::AccessFlagBits::eColorAttachmentWrite;
+    toColorAttachment.oldLayout = vk::ImageLayout::eTransferDstOptimal;
+    toColorAttachment.newLayout = vk::ImageLayout::eColorAttachmentOptimal;
+
+    cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+                              vk::PipelineStageFlagBits::eColorAttachmentOutput,
+                              {}, {}, {}, toColorAttachment);
+}
+
 vk::CommandBuffer &RenderTarget::getRenderCommandBuffer(int index) {
     return renderCmdBuffers[index];
 }
 
+vk::CommandBuffer &RenderTarget::getSceneCommandBuffer(int index) {
+    return sceneCmdBuffers[index];
+}
+
 vk::Semaphore &RenderTarget::getImageAvailableSemaphore(int index) {
     return imageAvailableSemaphores[index];
 }
@@ -73,40 +509,92 @@ vk::Semaphore &RenderTarget::getRenderFinishedSemaphore(int index) {
     return renderFinishedSemaphores[index];
 }
 
-vk::Fence &RenderTarget::getRenderingFence(int index) {
-    return renderingFence[index];
-}
-
 const vk::RenderPass &RenderTarget::getRenderPass() const { return renderPass; }
 
+const vk::RenderPass &RenderTarget::getOverlayRenderPass() const {
+    return overlayRenderPass;
+}
+
 const vk::Framebuffer &RenderTarget::getFramebuffer(int imageIndex) const {
     return frameBuffers[imageIndex];
 }
 
+const vk::Framebuffer &
+RenderTarget::getOverlayFramebuffer(int imageIndex) const {
+    return overlayFrameBuffers[imageIndex];
+}
+
+vk::Extent2D RenderTarget::getRenderExtent() const { return renderExtent; }
+
+vk::SampleCountFlagBits RenderTarget::getMsaaSamples() const {
+    return msaaSamples;
+}
+
+float RenderTarget::getRenderScale() const { return renderScale; }
+
 const vk::Pipeline &RenderTarget::getGraphicsPipeline() const {
     return graphicsPipeline;
 }
 
+const vk::Pipeline &RenderTarget::getFloorPipeline() const {
+    return floorPipeline;
+}
+
+const vk::Pipeline &RenderTarget::getLinePipeline() const {
+    return linePipeline;
+}
+
+const vk::Pipeline &RenderTarget::getPointPipeline() const {
+    return pointPipeline;
+}
+
 const vk::PipelineLayout &RenderTarget::getGraphicsPipelineLayout() const {
     return graphicsPipelineLayout;
 }
 
-void RenderTarget::destroyResourcesForSwapChainRecreation() {
-    colorImageResource.release(renderEngine->getDevice(),
-                               *renderEngine->getVmaAllocator());
-    depthImageResource.release(renderEngine->getDevice(),
-                               *renderEngine->getVmaAllocator());
-    for (auto &renderImageResource : renderImageResources) {
-        renderImageResource.release(renderEngine->getDevice(),
-                                    *renderEngine->getVmaAllocator());
-    }
+double RenderTarget::getLastGpuTime() const { return lastGpuTime; }
 
-    for (auto &frameBuffer : frameBuffers) {
-        renderEngine->getDevice().destroyFramebuffer(frameBuffer);
-    }
-    renderEngine->getDevice().destroyPipeline(graphicsPipeline);
-    renderEngine->getDevice().destroyPipelineLayout(graphicsPipelineLayout);
-    renderEngine->getDevice().destroyRenderPass(renderPass);
+uint64_t RenderTarget::getRenderPassVersion() const {
+    return renderPassVersion;
+}
+
+/**
+ * @brief Hands resources depending on SwapChain images over to deferred
+ * destruction, since frames in flight may still use them.
+ * Render images themselves are owned by SwapChain and are not released.
+ */
+void RenderTarget::deferReleaseResourcesForSwapChainRecreation() {
+    auto device = renderEngine->getDevice();
+    auto allocator = *renderEngine->getVmaAllocator();
+
+    std::vector<ImageResource> imageResources = renderImageResources;
+    imageResources.push_back(colorImageResource);
+    imageResources.push_back(depthImageResource);
+    imageResources.push_back(sceneImageResource);
+    imageResources.push_back(multisampledIdImageResource);
+    imageResources.push_back(idImageResource);
+    std::vector<vk::Framebuffer> oldFrameBuffers = frameBuffers;
+    oldFrameBuffers.insert(oldFrameBuffers.end(), overlayFrameBuffers.begin(),
+                           overlayFrameBuffers.end());
+
+    renderEngine->deferDestruction([=]() mutable {
+        for (auto &imageResource : imageResources) {
+            imageResource.release(device, allocator);
+        }
+        for (auto &frameBuffer : oldFrameBuffers) {
+            device.destroyFramebuffer(frameBuffer);
+        }
+    });
+
+    colorImageResource = ImageResource{};
+    depthImageResource = ImageResource{};
+    sceneImageResource = ImageResource{};
+    multisampledIdImageResource = ImageResource{};
+    idImageResource = ImageResource{};
+    renderImageResources.clear();
+    frameBuffers.clear();
+    overlayFrameBuffers.clear();
+    // RenderPass and pipelines are kept: viewport / scissor are dynamic states
 }
 
 /// passed renderImages will not be released.
@@ -115,14 +603,27 @@ RenderTarget::RenderTarget(const std::shared_ptr<RenderEngine> renderEngine,
                            vk::Extent2D imageExtent,
                            vk::DescriptorSetLayout descriptorSetLayout,
                            std::vector<vk::Image> &renderImages,
-                           int numOfFrames) {
+                           int numOfFrames,
+                           vk::ImageUsageFlags renderImageUsage,
+                           vk::ImageLayout renderImageFinalLayout) {
     this->renderEngine = renderEngine;
     this->colorImageFormat = colorImageFormat;
     this->imageExtent = imageExtent;
+    this->renderImageUsage = renderImageUsage;
+    this->renderImageFinalLayout = renderImageFinalLayout;
     this->numOfColorImages = renderImages.size();
     this->numOfFrames = numOfFrames;
     this->descriptorSetLayout = descriptorSetLayout;
 
+    // default render settings: MSAA up to 8x, native resolution
+    this->msaaSamples = std::min(
+        renderEngine->getEngineInfo().limit.maxMsaaSamples,
+        vk::SampleCountFlagBits::e8,
+        [](vk::SampleCountFlagBits a, vk::SampleCountFlagBits b) {
+            return static_cast<uint32_t>(a) < static_cast<uint32_t>(b);
+        });
+    updateRenderExtent();
+
     // init renderImageResources with renderImages
     renderImageResources.resize(numOfColorImages);
     for (int i = 0; i < numOfColorImages; i++) {
@@ -134,12 +635,18 @@ RenderTarget::RenderTarget(const std::shared_ptr<RenderEngine> renderEngine,
     }
 
     createSyncObjects();
+    createCommandPool();
     createRenderCmdBuffers();
+    createTimestampQueryPool();
+    createPickReadbacks();
 }
 
 RenderTarget::~RenderTarget() {
     VLOG(VLOG_LV_3_PROCESS_TRACKING) << "Destroying default GraphicsPipelne...";
     renderEngine->getDevice().destroyPipeline(graphicsPipeline);
+    renderEngine->getDevice().destroyPipeline(floorPipeline);
+    renderEngine->getDevice().destroyPipeline(linePipeline);
+    renderEngine->getDevice().destroyPipeline(pointPipeline);
     renderEngine->getDevice().destroyPipelineLayout(graphicsPipelineLayout);
     VLOG(VLOG_LV_3_PROCESS_TRACKING)
         << "Default GraphicsPipeline has been destroyed.";
@@ -148,6 +655,9 @@ RenderTarget::~RenderTarget() {
     for (const auto &fBuffer : frameBuffers) {
         renderEngine->getDevice().destroyFramebuffer(fBuffer, nullptr);
     }
+    for (const auto &fBuffer : overlayFrameBuffers) {
+        renderEngine->getDevice().destroyFramebuffer(fBuffer, nullptr);
+    }
     VLOG(VLOG_LV_3_PROCESS_TRACKING)
         << "Default FrameBuffers has been destroyed.";
 
@@ -156,6 +666,12 @@ RenderTarget::~RenderTarget() {
                                *renderEngine->getVmaAllocator());
     depthImageResource.release(renderEngine->getDevice(),
                                *renderEngine->getVmaAllocator());
+    sceneImageResource.release(renderEngine->getDevice(),
+                               *renderEngine->getVmaAllocator());
+    multisampledIdImageResource.release(renderEngine->getDevice(),
+                                        *renderEngine->getVmaAllocator());
+    idImageResource.release(renderEngine->getDevice(),
+                            *renderEngine->getVmaAllocator());
     std::for_each(renderImageResources.begin(), renderImageResources.end(),
                   [&](ImageResource &ir) {
                       ir.release(renderEngine->getDevice(), nullptr);
@@ -164,6 +680,7 @@ RenderTarget::~RenderTarget() {
 
     VLOG(VLOG_LV_3_PROCESS_TRACKING) << "Destroying RenderPass...";
     renderEngine->getDevice().destroyRenderPass(renderPass);
+    renderEngine->getDevice().destroyRenderPass(overlayRenderPass);
     VLOG(VLOG_LV_3_PROCESS_TRACKING) << "RenderPass has been destroyed.";
 
     VLOG(VLOG_LV_3_PROCESS_TRACKING) << "Destroying sync objects...";
@@ -171,9 +688,16 @@ RenderTarget::~RenderTarget() {
     for (int i = 0; i < numOfFrame; i++) {
         renderEngine->getDevice().destroySemaphore(imageAvailableSemaphores[i]);
         renderEngine->getDevice().destroySemaphore(renderFinishedSemaphores[i]);
-        renderEngine->getDevice().destroyFence(renderingFence[i]);
     }
     VLOG(VLOG_LV_3_PROCESS_TRACKING) << "Sync objects have been destroyed.";
+
+    renderEngine->getDevice().destroyQueryPool(timestampQueryPool);
+    for (auto &pickReadback : pickReadbacks) {
+        pickReadback.bufferResource.release(*renderEngine->getVmaAllocator());
+    }
+
+    // CommandBuffers are freed together
+    renderEngine->getDevice().destroyCommandPool(cmdPool);
 }
 
 // Static functions ----------
@@ -229,13 +753,20 @@ void RenderTarget::createImage(
     allocCI.usage = VMA_MEMORY_USAGE_AUTO;
     allocCI.flags = VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT;
     allocCI.priority = 1.0f;
+    // transient attachments may never be backed by actual memory on tilers
+    if (properties & vk::MemoryPropertyFlagBits::eLazilyAllocated) {
+        allocCI.usage = VMA_MEMORY_USAGE_GPU_LAZILY_ALLOCATED;
+    }
 
     auto vkImageCI = (VkImageCreateInfo)imageCI;
     VkImage vkImage;
     VmaAllocation allocation;
 
-    vmaCreateImage(allocator, &vkImageCI, &allocCI, &vkImage, &allocation,
-                   nullptr);
+    auto result = vmaCreateImage(allocator, &vkImageCI, &allocCI, &vkImage,
+                                 &allocation, nullptr);
+    if (result != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create Image.");
+    }
 
     imageResource.image = (vk::Image)vkImage;
     imageResource.allocation = allocation;
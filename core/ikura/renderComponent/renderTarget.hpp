@@ -9,6 +9,7 @@
 
 #include "../engine/renderEngine/renderEngine.hpp"
 #include "./renderComponentProvider.hpp"
+#include "./renderContent.hpp"
 
 namespace ikura {
 class ImageResource {
@@ -28,36 +29,110 @@ class RenderTarget {
     std::shared_ptr<RenderEngine> renderEngine;
 
     // Basic objects for render ----------
+    // owned by each RenderTarget, so that windows can be recorded in parallel
+    vk::CommandPool cmdPool;
     std::vector<vk::CommandBuffer> renderCmdBuffers;
+    // secondary, scene pass commands cached by Window
+    std::vector<vk::CommandBuffer> sceneCmdBuffers;
     vk::PipelineLayout graphicsPipelineLayout;
     vk::Pipeline graphicsPipeline;
+    // optional, share graphicsPipelineLayout
+    vk::Pipeline floorPipeline;
+    // same as graphicsPipeline except topology, for low detail meshes
+    vk::Pipeline linePipeline;
+    vk::Pipeline pointPipeline;
+    // renders scene with MSAA at renderExtent
     vk::RenderPass renderPass;
+    // draws overlays (VirtualWindows) onto render images without MSAA
+    vk::RenderPass overlayRenderPass;
     std::vector<vk::Framebuffer> frameBuffers;
+    std::vector<vk::Framebuffer> overlayFrameBuffers;
 
     // Sync objects ----------
     std::vector<vk::Semaphore> imageAvailableSemaphores;
     std::vector<vk::Semaphore> renderFinishedSemaphores;
-    std::vector<vk::Fence> renderingFence;
+
+    // GPU timer ----------
+    // 2 timestamps (begin, end) per frame
+    vk::QueryPool timestampQueryPool;
+    std::vector<bool> isTimestampWritten;
+    double lastGpuTime = 0.0; // milliseconds
 
     // ImageResources ----------
+    // multisampled color, exists only if msaaSamples is not e1
     ImageResource colorImageResource;
     ImageResource depthImageResource;
+    // single sampled scene, exists only if render scale is less than 1
+    ImageResource sceneImageResource;
     std::vector<ImageResource> renderImageResources;
+    // id + 1 of model matrices of drawn meshes, 0 where nothing is drawn.
+    // multisampled one exists only if msaaSamples is not e1, and is resolved
+    // into idImageResource
+    ImageResource multisampledIdImageResource;
+    ImageResource idImageResource;
+
+    // Picking ----------
+    struct PickReadback {
+        BufferResource bufferResource;
+        uint32_t *mappedData = nullptr;
+        // true if copy is recorded but not fetched yet
+        bool isPending = false;
+    };
+    // pickReadbacks[frame]
+    std::vector<PickReadback> pickReadbacks;
+    // pixel of renderExtent copied by the next recordPickReadback()
+    std::optional<vk::Offset2D> requestedPickPixel;
+    // id image value, taken by takePickResult()
+    std::optional<uint32_t> pickResult;
 
     // Properties ----------
     vk::Format colorImageFormat;
     vk::Extent2D imageExtent;
+    vk::ImageUsageFlags renderImageUsage;
+    // layout of render images after a frame is rendered
+    vk::ImageLayout renderImageFinalLayout;
     vk::DescriptorSetLayout descriptorSetLayout;
     int numOfFrames;
     int numOfColorImages;
 
+    // Render settings ----------
+    vk::SampleCountFlagBits msaaSamples;
+    float renderScale = 1.0f;
+    // extent of scene rendering, imageExtent scaled by renderScale
+    vk::Extent2D renderExtent;
+    // incremented whenever RenderPass or pipelines are rebuilt, so that
+    // commands recorded with old ones are re-recorded
+    uint64_t renderPassVersion = 0;
+
     // Methods ==========
     virtual void createSyncObjects();
+    void createCommandPool();
     virtual void createRenderCmdBuffers();
+    virtual void createTimestampQueryPool();
+    void createPickReadbacks();
+    void destroyFrameResources();
+
+    // Render settings ----------
+    virtual void recreateResourcesForRenderSettingsChange(bool isMsaaChanged);
+    void updateRenderExtent();
+    bool isUpscaling() const;
+    void deferReleaseRenderResources(bool releasePipelines);
 
     // helper functions ----------
     static vk::Format
     findDepthFormat(std::shared_ptr<RenderEngine> renderEngine);
+    static vk::ShaderModule
+    createShaderModuleFromFile(const std::filesystem::path fileName,
+                               const vk::Device device);
+    
+    static vk::ShaderModule createBasicVertexShaderModule(const vk::Device& device);
+    static vk::ShaderModule createBasicFragmentShaderModule(const vk::Device& device);
+
+  public:
+    static constexpr float MIN_RENDER_SCALE = 0.25f;
+    static constexpr vk::Format ID_IMAGE_FORMAT = vk::Format::eR32Uint;
+
+    // ImageResource helpers (also used by OffscreenWindow) ----------
     static void createImage(
         ImageResource &imageResource, const vk::Extent2D imageExtent,
         const uint32_t mipLevels, const vk::SampleCountFlagBits numSamples,
@@ -69,36 +144,65 @@ class RenderTarget {
                                 const vk::ImageAspectFlags aspectFlags,
                                 const uint32_t mipLevels,
                                 const vk::Device device);
-    static vk::ShaderModule
-    createShaderModuleFromFile(const std::filesystem::path fileName,
-                               const vk::Device device);
-    
-    static vk::ShaderModule createBasicVertexShaderModule(const vk::Device& device);
-    static vk::ShaderModule createBasicFragmentShaderModule(const vk::Device& device);
 
-  public:
     RenderTarget(const std::shared_ptr<RenderEngine> renderEngine,
                  vk::Format colorImageFormat, vk::Extent2D imageExtent,
                  vk::DescriptorSetLayout descriptorSetLayout,
-                 std::vector<vk::Image> &renderImages, int numOfFrames);
+                 std::vector<vk::Image> &renderImages, int numOfFrames,
+                 vk::ImageUsageFlags renderImageUsage =
+                     vk::ImageUsageFlagBits::eColorAttachment,
+                 vk::ImageLayout renderImageFinalLayout =
+                     vk::ImageLayout::ePresentSrcKHR);
     virtual ~RenderTarget();
 
     virtual void recreateResourcesForSwapChainRecreation(
         vk::Extent2D imageExtent, std::vector<vk::Image> renderImages);
+    void recreateResourcesForFrameSettingsChange(int numOfFrames);
+
+    // Render settings ----------
+    void setMsaaSamples(vk::SampleCountFlagBits samples);
+    void setRenderScale(float scale);
+    bool isRenderScaleSupported() const;
+
+    // Records blit from scene image to render image if render scale is
+    // less than 1. Must be recorded between renderPass and overlayRenderPass.
+    void recordUpscale(vk::CommandBuffer cmdBuffer, uint32_t imageIndex);
+
+    // GPU timer ----------
+    void beginGpuTimer(vk::CommandBuffer cmdBuffer, int frameIndex);
+    void endGpuTimer(vk::CommandBuffer cmdBuffer, int frameIndex);
+    void fetchGpuTime(int frameIndex);
+
+    // Picking ----------
+    void requestPick(float x, float y);
+    // Must be recorded after renderPass.
+    void recordPickReadback(vk::CommandBuffer cmdBuffer, int frameIndex);
+    void fetchPickResult(int frameIndex);
+    std::optional<uint32_t> takePickResult();
 
     // Getters ----------
     vk::CommandBuffer &getRenderCommandBuffer(int index);
+    vk::CommandBuffer &getSceneCommandBuffer(int index);
 
     vk::Semaphore &getImageAvailableSemaphore(int index);
     vk::Semaphore &getRenderFinishedSemaphore(int index);
-    vk::Fence &getRenderingFence(int index);
 
     const vk::RenderPass &getRenderPass() const;
+    const vk::RenderPass &getOverlayRenderPass() const;
     const vk::Framebuffer &getFramebuffer(int imageIndex) const;
+    const vk::Framebuffer &getOverlayFramebuffer(int imageIndex) const;
+    vk::Extent2D getRenderExtent() const;
+    vk::SampleCountFlagBits getMsaaSamples() const;
+    float getRenderScale() const;
     const vk::Pipeline &getGraphicsPipeline() const;
+    const vk::Pipeline &getFloorPipeline() const;
+    const vk::Pipeline &getLinePipeline() const;
+    const vk::Pipeline &getPointPipeline() const;
     const vk::PipelineLayout &getGraphicsPipelineLayout() const;
+    double getLastGpuTime() const;
+    uint64_t getRenderPassVersion() const;
 
     // Destroyers ----------
-    void destroyResourcesForSwapChainRecreation();
+    void deferReleaseResourcesForSwapChainRecreation();
 };
 } // namespace ikura
\ No newline at end of file
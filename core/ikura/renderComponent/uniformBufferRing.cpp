@@ -0,0 +1,121 @@
+#include "./uniformBufferRing.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <string>
+
+#include <easylogging++.h>
+
+#include "../common/logLevels.hpp"
+
+namespace ikura {
+namespace {
+vk::DeviceSize alignUp(vk::DeviceSize size, vk::DeviceSize alignment) {
+    return (size + alignment - 1) / alignment * alignment;
+}
+} // namespace
+
+UniformBufferRing::UniformBufferRing(
+    std::shared_ptr<RenderEngine> renderEngine, int numOfFrames,
+    vk::DeviceSize frameRegionSize) {
+
+    VLOG(VLOG_LV_3_PROCESS_TRACKING) << "Creating UniformBufferRing...";
+
+    this->renderEngine = renderEngine;
+    this->numOfFrames = numOfFrames;
+    const auto &limit = renderEngine->getEngineInfo().limit;
+    this->alignment = std::max<vk::DeviceSize>(
+        {limit.minUniformBufferOffsetAlignment,
+         limit.minStorageBufferOffsetAlignment, 1});
+    this->frameRegionSize = alignUp(frameRegionSize, alignment);
+
+    vk::BufferCreateInfo bufferCI{};
+    bufferCI.size = this->frameRegionSize * numOfFrames;
+    bufferCI.usage = vk::BufferUsageFlagBits::eUniformBuffer |
+                     vk::BufferUsageFlagBits::eStorageBuffer;
+    bufferCI.sharingMode = vk::SharingMode::eExclusive;
+
+    VmaAllocationCreateInfo allocCI{};
+    allocCI.usage = VMA_MEMORY_USAGE_AUTO;
+    allocCI.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT |
+                    VMA_ALLOCATION_CREATE_MAPPED_BIT;
+    VmaAllocationInfo allocInfo{};
+
+    auto vkBufferCI = (VkBufferCreateInfo)bufferCI;
+    VkBuffer vkBuffer;
+    auto result =
+        vmaCreateBuffer(*renderEngine->getVmaAllocator(), &vkBufferCI,
+                        &allocCI, &vkBuffer, &bufferResource.alloc, &allocInfo);
+    if (result != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create UniformBufferRing.");
+    }
+    bufferResource.buffer = (vk::Buffer)vkBuffer;
+    mappedData = static_cast<uint8_t *>(allocInfo.pMappedData);
+
+    VLOG(VLOG_LV_3_PROCESS_TRACKING)
+        << "UniformBufferRing has been created (" << numOfFrames
+        << " frames x " << this->frameRegionSize << " bytes).";
+}
+
+UniformBufferRing::~UniformBufferRing() {
+    VLOG(VLOG_LV_3_PROCESS_TRACKING) << "Destroying UniformBufferRing...";
+    bufferResource.release(*renderEngine->getVmaAllocator());
+    VLOG(VLOG_LV_3_PROCESS_TRACKING) << "UniformBufferRing has been destroyed.";
+}
+
+/**
+ * @brief Reserves a slot of `size` bytes in every frame region.
+ *
+ * @exception std::runtime_error if frame region has no space left.
+ */
+UniformSlot UniformBufferRing::reserve(vk::DeviceSize size) {
+    UniformSlot slot{};
+    slot.offset = reservedSize;
+    slot.size = size;
+
+    if (slot.offset + slot.size > frameRegionSize) {
+        std::string msg;
+        msg += "UniformBufferRing is full: requested ";
+        msg += std::to_string(size);
+        msg += " bytes, but only ";
+        msg += std::to_string(frameRegionSize - reservedSize);
+        msg += " bytes are left.";
+        throw std::runtime_error(msg);
+    }
+
+    reservedSize = alignUp(slot.offset + slot.size, alignment);
+
+    return slot;
+}
+
+/**
+ * @brief Copies data into slot of the frame region.
+ * Written data becomes visible to device after flush().
+ */
+void UniformBufferRing::write(int frameIndex, const UniformSlot &slot,
+                              const void *data, vk::DeviceSize size) {
+    assert(size <= slot.size);
+    memcpy(mappedData + getDynamicOffset(frameIndex) + slot.offset, data,
+           size);
+}
+
+/**
+ * @brief Flushes reserved range of the frame region.
+ * This is no-op if the allocation is HOST_COHERENT.
+ */
+void UniformBufferRing::flush(int frameIndex) {
+    vmaFlushAllocation(*renderEngine->getVmaAllocator(), bufferResource.alloc,
+                       getDynamicOffset(frameIndex), reservedSize);
+}
+
+uint32_t UniformBufferRing::getDynamicOffset(int frameIndex) const {
+    return static_cast<uint32_t>(frameRegionSize * frameIndex);
+}
+
+const vk::Buffer &UniformBufferRing::getBuffer() const {
+    return bufferResource.buffer;
+}
+
+int UniformBufferRing::getNumOfFrames() const { return numOfFrames; }
+} // namespace ikura
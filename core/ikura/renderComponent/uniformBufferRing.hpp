@@ -0,0 +1,54 @@
+#pragma once
+
+#include <memory>
+
+#include <vulkan/vulkan.hpp>
+
+#include "../engine/renderEngine/renderEngine.hpp"
+#include "./renderContent.hpp"
+
+namespace ikura {
+// Range in each frame region of UniformBufferRing.
+// offset is relative to the beginning of frame region.
+struct UniformSlot {
+    vk::DeviceSize offset;
+    vk::DeviceSize size;
+};
+
+/**
+ * @brief Single persistently mapped UniformBuffer shared by RenderContents.
+ * It is also usable as storage buffer, for data larger than uniform buffer
+ * range (e.g. model matrices).
+ *
+ * The buffer is divided into one region per frame in flight.
+ * RenderContent reserves UniformSlots once, and the same slot is placed at the
+ * same offset in every frame region. The frame region is selected by dynamic
+ * offset when DescriptorSets are bound.
+ */
+class UniformBufferRing {
+    std::shared_ptr<RenderEngine> renderEngine;
+
+    BufferResource bufferResource;
+    uint8_t *mappedData = nullptr;
+
+    int numOfFrames;
+    vk::DeviceSize frameRegionSize;
+    vk::DeviceSize alignment;
+    vk::DeviceSize reservedSize = 0;
+
+  public:
+    UniformBufferRing(std::shared_ptr<RenderEngine> renderEngine,
+                      int numOfFrames, vk::DeviceSize frameRegionSize);
+    ~UniformBufferRing();
+
+    UniformSlot reserve(vk::DeviceSize size);
+    void write(int frameIndex, const UniformSlot &slot, const void *data,
+               vk::DeviceSize size);
+    void flush(int frameIndex);
+
+    // Getter ----------
+    uint32_t getDynamicOffset(int frameIndex) const;
+    const vk::Buffer &getBuffer() const;
+    int getNumOfFrames() const;
+};
+} // namespace ikura
@@ -0,0 +1,14 @@
+#include "./lineBone.hpp"
+
+namespace ikura {
+namespace shapes {
+LineBone::LineBone(float length, GroupID id) : Bone(length, id) {
+    glm::vec3 color(0.8, 0.8, 0.8);
+
+    vertices.insert(vertices.end(),
+                    {{glm::vec3(0.0, 0.0, 0.0), color, id},
+                     {glm::vec3(length, 0.0, 0.0), color, id}});
+    indices.insert(indices.end(), {0, 1});
+}
+} // namespace shapes
+} // namespace ikura
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "./bone.hpp"
+
+namespace ikura {
+namespace shapes {
+/**
+ * @brief Lowest detail bone drawn as line list, from tip (origin) to root
+ * (length, 0, 0).
+ * The first index is the tip, so it can also be drawn alone as a point.
+ */
+class LineBone : public Bone {
+  public:
+    LineBone(float length, GroupID id);
+};
+} // namespace shapes
+} // namespace ikura
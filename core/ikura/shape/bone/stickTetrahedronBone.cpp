@@ -1,31 +1,44 @@
-#include <algorithm>
+#include <array>
 #include <cmath>
-#include <memory>
 
 #include <glm/glm.hpp>
 
-#include "../cube/singleColorCube.hpp"
 #include "./stickTetrahedronBone.hpp"
 
 namespace ikura {
 namespace shapes {
 StickTetrahedronBone::StickTetrahedronBone(float length, GroupID id)
     : Bone(length, id) {
-    cube = std::make_unique<SingleColorCube>(length, 1.0, 1.0,
-                                             glm::vec3(length / 2.0f, 0.0, 0.0),
-                                             glm::vec3(0.8, 0.8, 0.8), id);
-}
+    glm::vec3 tip(0.0, 0.0, 0.0);
 
-const std::vector<BasicVertex> &StickTetrahedronBone::getVertices() const {
-    return cube->getVertices();
-}
+    // triangle around root, facing +x
+    const float radius = length * 0.1f;
+    const float sin60 = std::sqrt(3.0f) / 2.0f;
+    std::array<glm::vec3, 3> base = {
+        glm::vec3(length, 0.0, radius),
+        glm::vec3(length, -radius * sin60, -radius * 0.5f),
+        glm::vec3(length, radius * sin60, -radius * 0.5f)};
 
-const std::vector<BasicIndex> &StickTetrahedronBone::getIndices() const {
-    return cube->getIndices();
-}
+    glm::vec3 colorGray(0.5, 0.5, 0.5);
+    glm::vec3 colorWhite(0.8, 0.8, 0.8);
+
+    // root side ---
+    vertices.insert(vertices.end(), {{base[0], colorGray, id},
+                                     {base[1], colorGray, id},
+                                     {base[2], colorGray, id}});
+
+    // tip side ---
+    for (int i = 0; i < 3; i++) {
+        glm::vec3 color = i % 2 == 0 ? colorWhite : colorGray;
+        vertices.insert(vertices.end(), {{tip, color, id},
+                                         {base[(i + 1) % 3], color, id},
+                                         {base[i], color, id}});
+    }
 
-void StickTetrahedronBone::setBaseIndex(BasicIndex baseIndex) {
-    cube->setBaseIndex(baseIndex);
+    // add indices
+    for (int i = 0; i < vertices.size(); i++) {
+        indices.push_back(i);
+    }
 }
 } // namespace shapes
-} // namespace ikura
\ No newline at end of file
+} // namespace ikura
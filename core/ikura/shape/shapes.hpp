@@ -5,6 +5,7 @@
 #include "./debug/directionDebugObject.hpp"
 
 #include "./bone/bone.hpp"
+#include "./bone/lineBone.hpp"
 #include "./bone/octahedronBone.hpp"
 #include "./bone/stickTetrahedronBone.hpp"
 
@@ -0,0 +1,99 @@
+// Build-time tool which compiles shaders in misc/shaderCodes.hpp into SPIR-V,
+// and writes them into a header embedded into ikura.
+// Usage: ikura_shader_precompiler <output header path>
+
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include "../../misc/shaderCodes.hpp"
+#include "../../util/shaderUtils.hpp"
+
+// shaderUtils refers vulkan-hpp default dispatcher
+VULKAN_HPP_DEFAULT_DISPATCH_LOADER_DYNAMIC_STORAGE
+
+namespace {
+struct ShaderEntry {
+    std::string name;
+    const std::string &source;
+    EShLanguage stage;
+};
+
+void writeSpirvArray(std::ofstream &out, const std::string &name,
+                     const std::vector<uint32_t> &spirv) {
+    out << "static const uint32_t " << name << "[] = {";
+    for (size_t i = 0; i < spirv.size(); i++) {
+        if (i % 8 == 0) {
+            out << "\n    ";
+        }
+        out << "0x" << std::hex << spirv[i] << std::dec << "u,";
+    }
+    out << "\n};\n\n";
+}
+} // namespace
+
+int main(int argc, char **argv) {
+    if (argc != 2) {
+        std::cerr << "Usage: " << argv[0] << " <output header path>"
+                  << std::endl;
+        return 1;
+    }
+
+    // shaders which are not listed here are compiled at runtime
+    const std::vector<ShaderEntry> entries = {
+        {"VERTEX_SHADER_SPIRV", ikura::VERTEX_SHADER_CODE, EShLangVertex},
+        {"POINT_VERTEX_SHADER_SPIRV", ikura::POINT_VERTEX_SHADER_CODE,
+         EShLangVertex},
+        {"FRAGMENT_SHADER_SPIRV", ikura::FRAGMENT_SHADER_CODE,
+         EShLangFragment},
+        {"GRID_FLOOR_VERTEX_SHADER_SPIRV",
+         ikura::GRID_FLOOR_VERTEX_SHADER_CODE, EShLangVertex},
+        {"GRID_FLOOR_FRAGMENT_SHADER_SPIRV",
+         ikura::GRID_FLOOR_FRAGMENT_SHADER_CODE, EShLangFragment},
+        {"SKELETON_COMPUTE_SHADER_SPIRV", ikura::SKELETON_COMPUTE_SHADER_CODE,
+         EShLangCompute},
+        {"CULLING_COMPUTE_SHADER_SPIRV", ikura::CULLING_COMPUTE_SHADER_CODE,
+         EShLangCompute},
+    };
+
+    std::ofstream out(argv[1], std::ios::trunc);
+    if (!out.is_open()) {
+        std::cerr << "Failed to open " << argv[1] << std::endl;
+        return 1;
+    }
+
+    out << "// Generated by ikura_shader_precompiler. DO NOT EDIT.\n\n";
+    out << "#pragma once\n\n";
+    out << "#include <cstddef>\n";
+    out << "#include <cstdint>\n\n";
+    out << "namespace ikura::precompiled {\n";
+    out << "struct PrecompiledShader {\n";
+    out << "    uint64_t key;\n";
+    out << "    const uint32_t *code;\n";
+    out << "    size_t size;\n";
+    out << "};\n\n";
+
+    for (const auto &entry : entries) {
+        auto spirv = ikura::compileShader(entry.source, entry.stage);
+        if (spirv.empty()) {
+            std::cerr << "Failed to compile " << entry.name << std::endl;
+            return 1;
+        }
+        writeSpirvArray(out, entry.name, spirv);
+    }
+
+    out << "static const PrecompiledShader SHADERS[] = {\n";
+    for (const auto &entry : entries) {
+        out << "    {0x" << std::hex
+            << ikura::computeShaderKey(entry.source, entry.stage) << std::dec
+            << "ull, " << entry.name << ", sizeof(" << entry.name
+            << ") / sizeof(uint32_t)},\n";
+    }
+    out << "};\n";
+    out << "} // namespace ikura::precompiled\n";
+
+    return out ? 0 : 1;
+}
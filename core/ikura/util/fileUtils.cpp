@@ -0,0 +1,27 @@
+#include "./fileUtils.hpp"
+
+#include <fstream>
+#include <system_error>
+
+namespace ikura {
+bool writeFileAtomically(const std::filesystem::path &filePath,
+                         const void *data, size_t size) {
+    auto tmpFilePath = filePath;
+    tmpFilePath += ".tmp";
+    {
+        std::ofstream file(tmpFilePath, std::ios::binary | std::ios::trunc);
+        file.write(static_cast<const char *>(data), size);
+        if (!file) {
+            return false;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tmpFilePath, filePath, ec);
+    if (ec) {
+        std::filesystem::remove(tmpFilePath, ec);
+        return false;
+    }
+    return true;
+}
+} // namespace ikura
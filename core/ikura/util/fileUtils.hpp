@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+
+namespace ikura {
+/**
+ * @brief Writes data to a temporary file next to filePath and renames it to
+ * filePath, so that other processes never read a partially written file.
+ * Parent directories are not created.
+ *
+ * @return false if the file could not be written or renamed
+ */
+bool writeFileAtomically(const std::filesystem::path &filePath,
+                         const void *data, size_t size);
+} // namespace ikura
@@ -0,0 +1,122 @@
+#include "./shaderCache.hpp"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <unordered_map>
+
+#include <easylogging++.h>
+
+#include "../common/logLevels.hpp"
+#include "../common/resourceDirectory.hpp"
+#include "./fileUtils.hpp"
+#include "./shaderUtils.hpp"
+
+#ifdef IKURA_HAS_PRECOMPILED_SHADERS
+#include <precompiledShaders.hpp>
+#endif
+
+namespace ikura {
+namespace {
+constexpr uint32_t SPIRV_MAGIC_NUMBER = 0x07230203;
+
+std::mutex shaderCacheMutex;
+std::unordered_map<uint64_t, std::vector<uint32_t>> memoryCache;
+
+std::string toHexString(uint64_t key) {
+    char buf[17];
+    snprintf(buf, sizeof(buf), "%016llx", (unsigned long long)key);
+    return buf;
+}
+
+std::filesystem::path getCacheFilePath(uint64_t key) {
+    return createResourceDirectoryPath(std::filesystem::path("shader_cache") /
+                                       (toHexString(key) + ".spv"));
+}
+
+bool findPrecompiledShader(uint64_t key, std::vector<uint32_t> &spirv) {
+#ifdef IKURA_HAS_PRECOMPILED_SHADERS
+    for (const auto &shader : precompiled::SHADERS) {
+        if (shader.key == key) {
+            spirv.assign(shader.code, shader.code + shader.size);
+            return true;
+        }
+    }
+#endif
+    return false;
+}
+
+bool loadCacheFile(uint64_t key, std::vector<uint32_t> &spirv) {
+    std::ifstream file(getCacheFilePath(key),
+                       std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    auto fileSize = static_cast<size_t>(file.tellg());
+    if (fileSize == 0 || fileSize % sizeof(uint32_t) != 0) {
+        return false;
+    }
+
+    std::vector<uint32_t> data(fileSize / sizeof(uint32_t));
+    file.seekg(0);
+    file.read(reinterpret_cast<char *>(data.data()), fileSize);
+    if (!file || data[0] != SPIRV_MAGIC_NUMBER) {
+        return false;
+    }
+
+    spirv = std::move(data);
+    return true;
+}
+
+void storeCacheFile(uint64_t key, const std::vector<uint32_t> &spirv) {
+    auto filePath = getCacheFilePath(key);
+    std::error_code ec;
+    std::filesystem::create_directories(filePath.parent_path(), ec);
+    if (ec) {
+        VLOG(VLOG_LV_3_PROCESS_TRACKING)
+            << "Failed to create shader cache directory: " << ec.message();
+        return;
+    }
+
+    if (!writeFileAtomically(filePath, spirv.data(),
+                             spirv.size() * sizeof(uint32_t))) {
+        VLOG(VLOG_LV_3_PROCESS_TRACKING)
+            << "Failed to write shader cache: " << filePath;
+    }
+}
+} // namespace
+
+std::vector<uint32_t> getShaderSpirv(const std::string &source,
+                                     const EShLanguage &stage) {
+    uint64_t key = computeShaderKey(source, stage);
+
+    std::lock_guard<std::mutex> lock(shaderCacheMutex);
+
+    auto it = memoryCache.find(key);
+    if (it != memoryCache.end()) {
+        return it->second;
+    }
+
+    std::vector<uint32_t> spirv;
+    if (findPrecompiledShader(key, spirv)) {
+        VLOG(VLOG_LV_4_PROCESS_TRACKING_SECONDARY)
+            << "Using precompiled shader " << toHexString(key) << ".";
+    } else if (loadCacheFile(key, spirv)) {
+        VLOG(VLOG_LV_4_PROCESS_TRACKING_SECONDARY)
+            << "Using cached shader " << toHexString(key) << ".";
+    } else {
+        VLOG(VLOG_LV_3_PROCESS_TRACKING)
+            << "Compiling shader " << toHexString(key) << "...";
+        spirv = compileShader(source, stage);
+        if (spirv.empty()) {
+            throw std::runtime_error("Failed to compile shader.");
+        }
+        storeCacheFile(key, spirv);
+    }
+
+    memoryCache[key] = spirv;
+    return spirv;
+}
+} // namespace ikura
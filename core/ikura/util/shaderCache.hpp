@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <glslang/Public/ShaderLang.h>
+
+namespace ikura {
+/**
+ * @brief Returns SPIR-V of GLSL source without compiling it when possible.
+ *
+ * SPIR-V is looked up by computeShaderKey() in the following order:
+ * in-memory cache, shaders precompiled at build time, and disk cache in the
+ * resource directory. Only if all of them miss, the source is compiled by
+ * glslang and the result is stored into the disk cache.
+ *
+ * @exception std::runtime_error if the source fails to compile.
+ */
+std::vector<uint32_t> getShaderSpirv(const std::string &source,
+                                     const EShLanguage &stage);
+} // namespace ikura
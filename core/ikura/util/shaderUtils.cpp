@@ -12,9 +12,34 @@
 #include <vulkan/vulkan.hpp>
 
 namespace ikura {
+namespace {
+// Bump this when compile settings in compileShader() are changed,
+// so that stale SPIR-V in shader cache is not used.
+constexpr uint64_t SHADER_KEY_REVISION = 1;
+
+// glslang process is initialized on first use and finalized at exit,
+// instead of every compileShader() call.
+struct GlslangProcess {
+    GlslangProcess() { glslang::InitializeProcess(); }
+    ~GlslangProcess() { glslang::FinalizeProcess(); }
+};
+
+void ensureGlslangProcess() { static GlslangProcess process; }
+
+// FNV-1a 64bit
+uint64_t hashBytes(uint64_t hash, const void *data, size_t size) {
+    auto bytes = static_cast<const uint8_t *>(data);
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+} // namespace
+
 std::vector<uint32_t> compileShader(const std::string &source,
                                     const EShLanguage &stage) {
-    glslang::InitializeProcess();
+    ensureGlslangProcess();
 
     const char *shaderStrings[1];
     shaderStrings[0] = source.c_str();
@@ -39,19 +64,27 @@ std::vector<uint32_t> compileShader(const std::string &source,
     std::vector<uint32_t> spirv;
     glslang::GlslangToSpv(*program.getIntermediate(stage), spirv);
 
-    glslang::FinalizeProcess();
     return spirv;
 }
 
+uint64_t computeShaderKey(const std::string &source,
+                          const EShLanguage &stage) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    hash = hashBytes(hash, &SHADER_KEY_REVISION, sizeof(SHADER_KEY_REVISION));
+
+    auto stageValue = static_cast<uint32_t>(stage);
+    hash = hashBytes(hash, &stageValue, sizeof(stageValue));
+    hash = hashBytes(hash, source.data(), source.size());
+
+    return hash;
+}
+
 vk::ShaderModule createShaderModule(const std::vector<uint32_t> &spirv,
                                     const vk::Device &device) {
-    glslang::InitializeProcess();
-
     vk::ShaderModuleCreateInfo createInfo;
     createInfo.codeSize = spirv.size() * sizeof(uint32_t);
     createInfo.pCode = spirv.data();
 
-    glslang::FinalizeProcess();
     return device.createShaderModule(createInfo);
 }
 } // namespace ikura
@@ -4,7 +4,9 @@
 
 #pragma once
 
+#include <cstdint>
 #include <string>
+#include <vector>
 
 #include <glslang/Public/ShaderLang.h>
 #include <vulkan/vulkan.hpp>
@@ -14,7 +16,11 @@ namespace ikura {
 std::vector<uint32_t> compileShader(const std::string &source,
                                                       const EShLanguage &stage);
 
+// Key of compiled SPIR-V, computed from shader source and compile settings.
+// Used by both build-time precompiled shaders and runtime shader cache.
+uint64_t computeShaderKey(const std::string &source, const EShLanguage &stage);
+
 vk::ShaderModule createShaderModule(const std::vector<uint32_t> &spirv,
                                                      const vk::Device &device);
 
-} // namespace ikura
\ No newline at end of file
+} // namespace ikura
@@ -13,8 +13,6 @@
 // Forward declearation of helper functions ----------
 vk::SurfaceFormatKHR
 chooseSwapChainFormat(const std::vector<vk::SurfaceFormatKHR> &formats);
-vk::PresentModeKHR
-chooseSwapChainPresentMode(const std::vector<vk::PresentModeKHR> &presentModes);
 vk::Extent2D
 chooseSwapChainExtent(const vk::SurfaceCapabilitiesKHR &capabilities,
                       GLFWwindow *window);
@@ -64,6 +62,8 @@ GlfwNativeWindow::GlfwNativeWindow(
     createSwapChain();
     swapChainImages =
         renderEngine->getDevice().getSwapchainImagesKHR(swapChain);
+
+    frameSerials.assign(numOfFrames, 0);
 }
 
 GlfwNativeWindow::~GlfwNativeWindow() {
@@ -113,8 +113,7 @@ void GlfwNativeWindow::createSwapChain() {
     }
 
     vk::SurfaceFormatKHR format = chooseSwapChainFormat(surfaceFormats);
-    vk::PresentModeKHR presentMode =
-        chooseSwapChainPresentMode(surfacePresentModes);
+    vk::PresentModeKHR presentMode = choosePresentMode(surfacePresentModes);
     vk::Extent2D extent = chooseSwapChainExtent(surfaceCapabilities, window);
     this->width = extent.width;
     this->height = extent.height;
@@ -127,22 +126,20 @@ void GlfwNativeWindow::createSwapChain() {
     VLOG(VLOG_LV_3_PROCESS_TRACKING)
         << "SwapChain Extent: " << extent.width << "x" << extent.height;
 
-    uint32_t imageCount = surfaceCapabilities.minImageCount + 1;
-    if (surfaceCapabilities.maxImageCount > 0 &&
-        imageCount > surfaceCapabilities.maxImageCount) {
-
-        imageCount = surfaceCapabilities.maxImageCount;
-    }
-
     vk::SwapchainCreateInfoKHR swapChainCI;
     swapChainCI.surface = surface;
-    swapChainCI.minImageCount = imageCount;
+    swapChainCI.minImageCount = chooseSwapChainImageCount(surfaceCapabilities);
 
     swapChainCI.imageFormat = format.format;
     swapChainCI.imageColorSpace = format.colorSpace;
     swapChainCI.imageExtent = extent;
     swapChainCI.imageArrayLayers = 1;
     swapChainCI.imageUsage = vk::ImageUsageFlagBits::eColorAttachment;
+    // destination of upscale blit (see RenderTarget::setRenderScale())
+    if (surfaceCapabilities.supportedUsageFlags &
+        vk::ImageUsageFlagBits::eTransferDst) {
+        swapChainCI.imageUsage |= vk::ImageUsageFlagBits::eTransferDst;
+    }
 
     swapChainCI.preTransform = surfaceCapabilities.currentTransform;
     swapChainCI.compositeAlpha = vk::CompositeAlphaFlagBitsKHR::eOpaque;
@@ -166,6 +163,8 @@ void GlfwNativeWindow::createSwapChain() {
     swapChain = renderEngine->getDevice().createSwapchainKHR(swapChainCI);
     swapChainFormat = format.format;
     swapChainExtent = extent;
+    swapChainImageUsage = swapChainCI.imageUsage;
+    this->presentMode = presentMode;
     swapChainCICache = swapChainCI;
 
     VLOG(VLOG_LV_3_PROCESS_TRACKING)
@@ -183,169 +182,179 @@ void GlfwNativeWindow::destroyResources() {
 bool GlfwNativeWindow::closed() { return glfwWindowShouldClose(window) != 0; }
 
 void GlfwNativeWindow::draw() {
+    if (!acquireFrame()) {
+        return;
+    }
+
+    prepareSceneCommands(currentFrame);
+    recordFrameCommands();
+
+    submitFrames(renderEngine, {this});
+    presentFrames(renderEngine, {this});
+}
+
+bool GlfwNativeWindow::acquireFrame() {
     // If window size is zero, prevent drawing.
     // If window is restored from minimized, recreate swapchain and reset
     // states. `isWindowSizeRestoredFromMinimized` can be true by only GLFW
     // callback function.
     if (isWindowSizeZero) {
-        if (!glfwGetWindowAttrib(window, GLFW_ICONIFIED)) {
-            recreateSwapChain(false);
-            isWindowSizeZero = false;
-        } else {
-            return;
+        if (glfwGetWindowAttrib(window, GLFW_ICONIFIED)) {
+            return false;
+        }
+        recreateSwapChain(false);
+        if (isWindowSizeZero) {
+            return false;
         }
     }
 
     // Wait for previous frame to complete
-    auto result = renderEngine->getDevice().waitForFences(
-        renderTarget->getRenderingFence(currentFrame), VK_TRUE, UINT64_MAX);
-    if (result != vk::Result::eSuccess) {
-        throw std::runtime_error("Error occurred while waiting fence.");
-    }
-    renderEngine->getDevice().resetFences(
-        renderTarget->getRenderingFence(currentFrame));
+    waitForCurrentFrame();
 
     // Acquire swapChain image
+    acquireBeginTime = std::chrono::steady_clock::now();
     auto nextImage = renderEngine->getDevice().acquireNextImageKHR(
         swapChain, UINT64_MAX,
         renderTarget->getImageAvailableSemaphore(currentFrame), VK_NULL_HANDLE);
+    acquireEndTime = std::chrono::steady_clock::now();
 
     if (nextImage.result == vk::Result::eErrorOutOfDateKHR) {
         recreateSwapChain();
-        return;
+        return false;
     } else if (nextImage.result != vk::Result::eSuccess &&
                nextImage.result != vk::Result::eSuboptimalKHR) {
         throw std::runtime_error("Failed to acquire next SwapChain image.");
     }
+    acquiredImageIndex = nextImage.value;
+
+    renderContent->applyCompletedUploads();
 
-    // Record command buffer
+    return true;
+}
+
+void GlfwNativeWindow::recordFrameCommands() {
     renderTarget->getRenderCommandBuffer(currentFrame).reset({});
-    recordCommandBuffer(nextImage.value);
-
-    // Submit command buffer
-    std::array<vk::PipelineStageFlags, 1> waitStages = {
-        vk::PipelineStageFlagBits::eColorAttachmentOutput};
-    vk::SubmitInfo submitInfo{};
-    submitInfo.waitSemaphoreCount = 1;
-    submitInfo.setWaitSemaphores(
-        renderTarget->getImageAvailableSemaphore(currentFrame));
-    submitInfo.pWaitDstStageMask = waitStages.data();
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers =
-        &renderTarget->getRenderCommandBuffer(currentFrame);
-    submitInfo.setSignalSemaphores(
-        renderTarget->getRenderFinishedSemaphore(currentFrame));
-
-    renderEngine->getQueues().graphicsQueue.submit(
-        submitInfo, renderTarget->getRenderingFence(currentFrame));
-
-    // Presentation
-    vk::PresentInfoKHR presentInfo{};
-    presentInfo.waitSemaphoreCount = 1;
-    presentInfo.setWaitSemaphores(
-        renderTarget->getRenderFinishedSemaphore(currentFrame));
-    presentInfo.swapchainCount = 1;
-    presentInfo.setSwapchains(swapChain);
-    presentInfo.setImageIndices(nextImage.value);
-
-    try {
-        result = renderEngine->getQueues().presentQueue.presentKHR(presentInfo);
-    } catch (vk::OutOfDateKHRError &e) {
-        frameBufferResized = false;
-        recreateSwapChain();
-    } catch (vk::Error &e) {
-        throw std::runtime_error("Failed to present swapChain image.");
-    }
+    recordCommandBuffer(acquiredImageIndex);
+}
 
-    if (result == vk::Result::eSuboptimalKHR || frameBufferResized) {
+FrameSubmission GlfwNativeWindow::getFrameSubmission() const {
+    FrameSubmission submission{};
+    submission.waitSemaphore =
+        renderTarget->getImageAvailableSemaphore(currentFrame);
+    submission.cmdBuffer = renderTarget->getRenderCommandBuffer(currentFrame);
+    submission.signalSemaphore =
+        renderTarget->getRenderFinishedSemaphore(currentFrame);
+    submission.swapChain = swapChain;
+    submission.imageIndex = acquiredImageIndex;
+
+    return submission;
+}
+
+void GlfwNativeWindow::endFrame(vk::Result presentResult) {
+    addPresentTiming(acquireBeginTime, acquireEndTime,
+                     std::chrono::steady_clock::now());
+
+    if (presentResult == vk::Result::eErrorOutOfDateKHR ||
+        presentResult == vk::Result::eSuboptimalKHR || frameBufferResized) {
         frameBufferResized = false;
         recreateSwapChain();
+    } else if (presentResult != vk::Result::eSuccess) {
+        throw std::runtime_error("Failed to present swapChain image.");
     }
 
     currentFrame = (currentFrame + 1) % numOfFrames;
+    isCurrentFrameWaited = false;
 }
 
 GLFWwindow *GlfwNativeWindow::getGLFWWindow() const { return window; }
 
 void GlfwNativeWindow::recordCommandBuffer(uint32_t imageIndex) {
+    auto &cmdBuffer = renderTarget->getRenderCommandBuffer(currentFrame);
+
     // Begin ----------
     vk::CommandBufferBeginInfo beginInfo{};
-    renderTarget->getRenderCommandBuffer(currentFrame).begin(beginInfo);
-
-    std::array<vk::ClearValue, 2> clearValues{};
-    clearValues[0].color =
-        vk::ClearColorValue(std::array<uint32_t, 4>{1, 0, 0, 0});
-    clearValues[1].depthStencil = vk::ClearDepthStencilValue(1.0f, 0);
-
-    vk::RenderPassBeginInfo renderPassInfo{};
-    renderPassInfo.renderPass = renderTarget->getRenderPass();
-    renderPassInfo.framebuffer = renderTarget->getFramebuffer(imageIndex);
-    renderPassInfo.renderArea.offset = vk::Offset2D(0, 0);
-    renderPassInfo.renderArea.extent = swapChainExtent;
-    renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
-    renderPassInfo.pClearValues = clearValues.data();
-
-    renderTarget->getRenderCommandBuffer(currentFrame)
-        .beginRenderPass(renderPassInfo, vk::SubpassContents::eInline);
-
-    // Bind objects ----------
-    renderTarget->getRenderCommandBuffer(currentFrame)
-        .bindPipeline(vk::PipelineBindPoint::eGraphics,
-                      renderTarget->getGraphicsPipeline());
-    renderTarget->getRenderCommandBuffer(currentFrame)
-        .bindVertexBuffers(0, {renderContent->getVertexBuffer()}, {0});
-    renderTarget->getRenderCommandBuffer(currentFrame)
-        .bindIndexBuffer(renderContent->getIndexBuffer(), 0,
-                         vk::IndexType::eUint32);
-    renderTarget->getRenderCommandBuffer(currentFrame)
-        .bindDescriptorSets(vk::PipelineBindPoint::eGraphics,
-                            renderTarget->getGraphicsPipelineLayout(), 0,
-                            renderContent->getDescriptorSets(currentFrame),
-                            nullptr);
-
-    // Draw ----------
-    renderTarget->getRenderCommandBuffer(currentFrame)
-        .drawIndexed(renderContent->getNumOfIndex(), 1, 0, 0, 0);
-
-    // VirtualWindows ----------
+    cmdBuffer.begin(beginInfo);
+    renderTarget->beginGpuTimer(cmdBuffer, currentFrame);
+
+    // Scene ----------
+    recordScenePass(cmdBuffer, imageIndex, currentFrame);
+
+    // VirtualWindows (at native resolution, without MSAA) ----------
+    beginOverlayPass(cmdBuffer, imageIndex);
     for (auto &vWindow : virtualWindows) {
-        vWindow->recordCommandBuffer(
-            renderTarget->getRenderCommandBuffer(currentFrame));
+        vWindow->recordCommandBuffer(cmdBuffer);
     }
+    cmdBuffer.endRenderPass();
 
     // End ----------
-    renderTarget->getRenderCommandBuffer(currentFrame).endRenderPass();
-    renderTarget->getRenderCommandBuffer(currentFrame).end();
+    renderTarget->endGpuTimer(cmdBuffer, currentFrame);
+    cmdBuffer.end();
 }
 
+/**
+ * @brief Recreates SwapChain and resources depending on it without waiting
+ * for device idle.
+ *
+ * New SwapChain is created with the current one as oldSwapchain, so that
+ * presentation engine can hand over smoothly. Old SwapChain, its image views
+ * and framebuffers are still used by frames in flight, so they are handed
+ * over to deferred destruction and destroyed once the frame serials of
+ * those frames have completed. Frames already submitted keep presenting at
+ * the previous extent meanwhile.
+ *
+ * If destroyExistingResources is false, there is no current SwapChain
+ * (e.g. it has been released while window is minimized).
+ */
 void GlfwNativeWindow::recreateSwapChain(bool destroyExistingResources) {
-    renderEngine->getDevice().waitIdle();
+    auto surfaceCapabilities =
+        renderEngine->getPhysicalDevice().getSurfaceCapabilitiesKHR(surface);
+    auto extent = chooseSwapChainExtent(surfaceCapabilities, window);
 
-    if (destroyExistingResources) {
-        // Clean up SwapChain
-        renderTarget->destroyResourcesForSwapChainRecreation();
-        renderEngine->getDevice().destroySwapchainKHR(swapChain);
+    vk::SwapchainKHR oldSwapChain = nullptr;
+    if (destroyExistingResources && swapChain) {
+        oldSwapChain = swapChain;
     }
 
-    // Recreate SwapChain ----------
-    auto extent = chooseSwapChainExtent(
-        renderEngine->getPhysicalDevice().getSurfaceCapabilitiesKHR(surface),
-        window);
-
     // If window size is zero, prevent new resources creation because Vulkan
     //  cannot create zero-size images.
     // On Windows10, window size will be (0, 0) when window is minimized.
     // On Linux (X11), when window is minimized, window is just hidden
     //  and keep rendering on background.
     // (TODO: investigate on macOS, wayland, (maybe also Windows11 is needed))
-    if (extent.width == 0 | extent.height == 0) {
+    if (extent.width == 0 || extent.height == 0) {
         isWindowSizeZero = true;
+        swapChain = nullptr;
     } else {
         isWindowSizeZero = false;
         vk::SwapchainCreateInfoKHR swapChainCI = swapChainCICache;
         swapChainCI.imageExtent = extent;
+        swapChainCI.oldSwapchain = oldSwapChain;
+        // image count and present mode may have been changed by
+        // setFrameSettings() / setPresentMode()
+        swapChainCI.minImageCount =
+            chooseSwapChainImageCount(surfaceCapabilities);
+        swapChainCI.presentMode = choosePresentMode(
+            renderEngine->getPhysicalDevice().getSurfacePresentModesKHR(
+                surface));
+        swapChainCICache.minImageCount = swapChainCI.minImageCount;
+        swapChainCICache.presentMode = swapChainCI.presentMode;
+        presentMode = swapChainCI.presentMode;
         swapChain = renderEngine->getDevice().createSwapchainKHR(swapChainCI);
+    }
+
+    // Retire old resources ----------
+    if (destroyExistingResources) {
+        renderTarget->deferReleaseResourcesForSwapChainRecreation();
+    }
+    if (oldSwapChain) {
+        auto device = renderEngine->getDevice();
+        renderEngine->deferDestruction([device, oldSwapChain]() {
+            device.destroySwapchainKHR(oldSwapChain);
+        });
+    }
 
+    // Recreate dependent resources ----------
+    if (!isWindowSizeZero) {
         swapChainExtent = extent;
         swapChainImages =
             renderEngine->getDevice().getSwapchainImagesKHR(swapChain);
@@ -379,17 +388,6 @@ chooseSwapChainFormat(const std::vector<vk::SurfaceFormatKHR> &formats) {
     return formats[0];
 }
 
-vk::PresentModeKHR chooseSwapChainPresentMode(
-    const std::vector<vk::PresentModeKHR> &presentModes) {
-    for (const auto &presentMode : presentModes) {
-        if (presentMode == vk::PresentModeKHR::eMailbox) {
-            return presentMode;
-        }
-    }
-
-    return vk::PresentModeKHR::eFifo;
-}
-
 vk::Extent2D
 chooseSwapChainExtent(const vk::SurfaceCapabilitiesKHR &capabilities,
                       GLFWwindow *window) {
@@ -37,6 +37,12 @@ class GlfwNativeWindow : public NativeWindow {
     void draw() override;
     bool closed() override;
 
+    // Frame phases ----------
+    bool acquireFrame() override;
+    void recordFrameCommands() override;
+    FrameSubmission getFrameSubmission() const override;
+    void endFrame(vk::Result presentResult) override;
+
     GLFWwindow *getGLFWWindow() const;
 };
 } // namespace ikura
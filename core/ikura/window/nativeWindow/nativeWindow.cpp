@@ -1,15 +1,42 @@
 #include "./nativeWindow.hpp"
 
+#include <algorithm>
+#include <array>
+#include <string>
+
 #include <easylogging++.h>
 #include <vulkan/vulkan.hpp>
 
 #include "../virtualWindow/virtualWindow.hpp"
 
 #include "../../common/logLevels.hpp"
+#include "../../engine/renderEngine/uploadManager.hpp"
 
 namespace ikura {
 void NativeWindow::recreateSwapChain(bool destroyExistingResources) {}
 
+/**
+ * @brief Returns minImageCount of SwapChain: requestedNumOfSwapChainImages
+ * clamped into the range supported by the surface, or minImageCount + 1 of
+ * the surface if nothing is requested.
+ */
+uint32_t NativeWindow::chooseSwapChainImageCount(
+    const vk::SurfaceCapabilitiesKHR &capabilities) const {
+    uint32_t imageCount = requestedNumOfSwapChainImages;
+    if (imageCount == 0) {
+        imageCount = capabilities.minImageCount + 1;
+    }
+
+    imageCount = std::max(imageCount, capabilities.minImageCount);
+    if (capabilities.maxImageCount > 0 &&
+        imageCount > capabilities.maxImageCount) {
+
+        imageCount = capabilities.maxImageCount;
+    }
+
+    return imageCount;
+}
+
 void NativeWindow::destroySwapChain() {
     VLOG(VLOG_LV_3_PROCESS_TRACKING)
         << "Destroying SwapChain for '" << name << "'...";
@@ -34,11 +61,263 @@ NativeWindow::~NativeWindow() {
 
 void NativeWindow::draw() {}
 
+// Frame phases ----------
+
+/**
+ * @brief Waits for the previous submission of current frame, and fetches its
+ * GPU time and completed picks.
+ * Call this before updating per-frame resources (e.g. uniform buffers) of
+ * current frame. acquireFrame() calls it if not called yet.
+ */
+void NativeWindow::waitForCurrentFrame() {
+    if (isCurrentFrameWaited) {
+        return;
+    }
+
+    renderEngine->waitForFrame(frameSerials[currentFrame]);
+    renderTarget->fetchGpuTime(currentFrame);
+
+    // picks are fetched as soon as their frames complete, usually one frame
+    // later. A pick is recorded and submitted between two calls of this, so
+    // frameSerials already covers every pending pick here
+    uint64_t completedSerial = renderEngine->getCompletedFrameSerial();
+    for (size_t frame = 0; frame < frameSerials.size(); frame++) {
+        if (frameSerials[frame] <= completedSerial) {
+            renderTarget->fetchPickResult(frame);
+        }
+    }
+
+    isCurrentFrameWaited = true;
+}
+
+/**
+ * @brief Waits for the current frame to become reusable and acquires next
+ * SwapChain image.
+ *
+ * @return false if nothing should be drawn in this frame.
+ */
+bool NativeWindow::acquireFrame() { return false; }
+
+void NativeWindow::recordFrameCommands() {}
+
+FrameSubmission NativeWindow::getFrameSubmission() const { return {}; }
+
+/**
+ * @brief Records frame serial of submitted current frame, which is waited
+ * when the frame is acquired next time.
+ */
+void NativeWindow::onFrameSubmitted(uint64_t frameSerial) {
+    frameSerials[currentFrame] = frameSerial;
+}
+
+/**
+ * @brief Handles result of presentation and advances to next frame.
+ */
+void NativeWindow::endFrame(vk::Result presentResult) {}
+
+/**
+ * @brief Submits acquired frames of windows by one vkQueueSubmit.
+ * They share one frame serial, which completes once all of them complete.
+ * Each frame also waits on upload timeline at the ticket applied since last
+ * frame, so that writes of transfer queue are visible to graphics queue.
+ */
+void NativeWindow::submitFrames(std::shared_ptr<RenderEngine> renderEngine,
+                                const std::vector<NativeWindow *> &windows) {
+    auto &uploadManager = renderEngine->getUploadManager();
+    const UploadTicket appliedTicket = uploadManager.takeAppliedTicket();
+    const uint32_t numOfWaits = appliedTicket != 0 ? 2 : 1;
+
+    const std::array<vk::PipelineStageFlags, 2> waitStages = {
+        vk::PipelineStageFlagBits::eColorAttachmentOutput,
+        UploadManager::CONSUMER_STAGES};
+    // value for binary semaphore is ignored
+    const std::array<uint64_t, 2> waitValues = {0, appliedTicket};
+    vk::TimelineSemaphoreSubmitInfo timelineSubmitInfo{};
+    timelineSubmitInfo.setWaitSemaphoreValues(waitValues);
+
+    // submitInfos point into submissions and waitSemaphores
+    std::vector<FrameSubmission> submissions;
+    submissions.reserve(windows.size());
+    std::vector<std::array<vk::Semaphore, 2>> waitSemaphores;
+    waitSemaphores.reserve(windows.size());
+    std::vector<vk::SubmitInfo> submitInfos;
+    for (const auto &window : windows) {
+        submissions.push_back(window->getFrameSubmission());
+        const auto &submission = submissions.back();
+        waitSemaphores.push_back(
+            {submission.waitSemaphore, uploadManager.getUploadTimeline()});
+
+        vk::SubmitInfo submitInfo{};
+        if (appliedTicket != 0) {
+            submitInfo.pNext = &timelineSubmitInfo;
+        }
+        submitInfo.waitSemaphoreCount = numOfWaits;
+        submitInfo.pWaitSemaphores = waitSemaphores.back().data();
+        submitInfo.pWaitDstStageMask = waitStages.data();
+        submitInfo.setCommandBuffers(submission.cmdBuffer);
+        submitInfo.setSignalSemaphores(submission.signalSemaphore);
+        submitInfos.push_back(submitInfo);
+    }
+
+    uint64_t frameSerial = renderEngine->submitFrame(submitInfos);
+
+    for (auto &window : windows) {
+        window->onFrameSubmitted(frameSerial);
+    }
+}
+
+/**
+ * @brief Presents submitted frames of windows by one vkQueuePresentKHR,
+ * and ends the frames with their own results.
+ */
+void NativeWindow::presentFrames(std::shared_ptr<RenderEngine> renderEngine,
+                                 const std::vector<NativeWindow *> &windows) {
+    std::vector<vk::Semaphore> waitSemaphores;
+    std::vector<vk::SwapchainKHR> swapChains;
+    std::vector<uint32_t> imageIndices;
+    for (const auto &window : windows) {
+        auto submission = window->getFrameSubmission();
+        waitSemaphores.push_back(submission.signalSemaphore);
+        swapChains.push_back(submission.swapChain);
+        imageIndices.push_back(submission.imageIndex);
+    }
+    std::vector<vk::Result> results(windows.size(), vk::Result::eSuccess);
+
+    vk::PresentInfoKHR presentInfo{};
+    presentInfo.setWaitSemaphores(waitSemaphores);
+    presentInfo.setSwapchains(swapChains);
+    presentInfo.setImageIndices(imageIndices);
+    presentInfo.pResults = results.data();
+
+    try {
+        renderEngine->getQueues().presentQueue.presentKHR(presentInfo);
+    } catch (vk::OutOfDateKHRError &e) {
+        // results tell which SwapChains are out of date
+    } catch (vk::Error &e) {
+        throw std::runtime_error("Failed to present swapChain image.");
+    }
+
+    for (size_t i = 0; i < windows.size(); i++) {
+        windows[i]->endFrame(results[i]);
+    }
+}
+
+/**
+ * @brief Returns requestedPresentMode if supported. Otherwise returns MAILBOX
+ * if available, or FIFO which is always supported.
+ */
+vk::PresentModeKHR NativeWindow::choosePresentMode(
+    const std::vector<vk::PresentModeKHR> &presentModes) const {
+    auto isSupported = [&](vk::PresentModeKHR mode) {
+        return std::find(presentModes.begin(), presentModes.end(), mode) !=
+               presentModes.end();
+    };
+
+    if (requestedPresentMode.has_value()) {
+        if (isSupported(requestedPresentMode.value())) {
+            return requestedPresentMode.value();
+        }
+        LOG(WARNING) << "Present mode "
+                     << vk::to_string(requestedPresentMode.value())
+                     << " is not supported, falling back to default.";
+    }
+
+    if (isSupported(vk::PresentModeKHR::eMailbox)) {
+        return vk::PresentModeKHR::eMailbox;
+    }
+    return vk::PresentModeKHR::eFifo;
+}
+
+/**
+ * @brief Accumulates timings of a presented frame, and updates presentStats
+ * every half a second.
+ */
+void NativeWindow::addPresentTiming(
+    std::chrono::steady_clock::time_point acquireBegin,
+    std::chrono::steady_clock::time_point acquireEnd,
+    std::chrono::steady_clock::time_point presentEnd) {
+    using Milliseconds = std::chrono::duration<double, std::milli>;
+
+    if (numOfPresentsInStats == 0 &&
+        presentStatsBeginTime == std::chrono::steady_clock::time_point{}) {
+        presentStatsBeginTime = presentEnd;
+        return;
+    }
+
+    numOfPresentsInStats++;
+    acquireToPresentTimeSum += Milliseconds(presentEnd - acquireBegin).count();
+    acquireWaitTimeSum += Milliseconds(acquireEnd - acquireBegin).count();
+
+    double elapsed = Milliseconds(presentEnd - presentStatsBeginTime).count();
+    if (elapsed >= 500.0) {
+        presentStats.presentRate = numOfPresentsInStats * 1000.0 / elapsed;
+        presentStats.acquireToPresentTime =
+            acquireToPresentTimeSum / numOfPresentsInStats;
+        presentStats.acquireWaitTime =
+            acquireWaitTimeSum / numOfPresentsInStats;
+
+        presentStatsBeginTime = presentEnd;
+        numOfPresentsInStats = 0;
+        acquireToPresentTimeSum = 0.0;
+        acquireWaitTimeSum = 0.0;
+    }
+}
+
 void NativeWindow::addVirtualWindow(
     std::shared_ptr<VirtualWindow> virtualWindow) {
     virtualWindows.push_back(virtualWindow);
 }
 
+/**
+ * @brief Changes number of frames in flight and requested number of
+ * SwapChain images (0 for default), and rebuilds per-frame resources of
+ * RenderTarget, SwapChain and VirtualWindows.
+ * Waits for device idle, so call this between frames.
+ *
+ * Fewer frames in flight lower latency from input to display, while more
+ * frames let CPU run ahead of GPU.
+ *
+ * @exception std::runtime_error if numOfFrames is not in
+ * [1, MAX_NUM_OF_FRAMES].
+ */
+void NativeWindow::setFrameSettings(int numOfFrames,
+                                    uint32_t numOfSwapChainImages) {
+    if (numOfFrames < 1 || numOfFrames > MAX_NUM_OF_FRAMES) {
+        throw std::runtime_error("Number of frames in flight must be 1 to " +
+                                 std::to_string(MAX_NUM_OF_FRAMES) + ".");
+    }
+    if (numOfFrames == this->numOfFrames &&
+        numOfSwapChainImages == requestedNumOfSwapChainImages) {
+        return;
+    }
+
+    VLOG(VLOG_LV_3_PROCESS_TRACKING)
+        << "Changing frame settings of '" << name << "': " << numOfFrames
+        << " frames in flight, " << numOfSwapChainImages
+        << " SwapChain images requested.";
+
+    // every submitted frame completes, so nothing is referenced by GPU
+    renderEngine->waitForDeviceIdle();
+    renderEngine->flushDeferredDestructions();
+
+    this->numOfFrames = numOfFrames;
+    requestedNumOfSwapChainImages = numOfSwapChainImages;
+    frameSerials.assign(numOfFrames, 0);
+    currentFrame = 0;
+    isCurrentFrameWaited = false;
+
+    renderTarget->recreateResourcesForFrameSettingsChange(numOfFrames);
+    invalidateSceneCommands();
+    // if minimized, SwapChain is recreated with new settings on restore
+    if (!isWindowSizeZero) {
+        recreateSwapChain();
+    }
+
+    for (auto &vWindow : virtualWindows) {
+        vWindow->onFrameSettingsChanged();
+    }
+}
+
 const vk::SwapchainKHR NativeWindow::getSwapChain() const { return swapChain; }
 
 const vk::Format NativeWindow::getSwapChainFormat() const {
@@ -49,10 +328,63 @@ const vk::Extent2D NativeWindow::getSwapChainExtent() const {
     return swapChainExtent;
 }
 
+const vk::ImageUsageFlags NativeWindow::getSwapChainImageUsage() const {
+    return swapChainImageUsage;
+}
+
 const std::vector<vk::Image> &NativeWindow::getSwapChainImages() const {
     return swapChainImages;
 }
 
+/**
+ * @brief Requests present mode and recreates SwapChain with it.
+ * Unsupported mode falls back to default (see choosePresentMode()).
+ * Recreation does not wait for device idle: the current SwapChain is passed
+ * as oldSwapchain and destroyed once frames in flight stop using it. It is
+ * safe to call at any time outside acquireFrame() to endFrame() of this
+ * window (e.g. while building UI), and the new mode takes effect from the
+ * next acquired frame.
+ *
+ * FIFO never tears and waits for vertical blank. FIFO_RELAXED tears only if
+ * a frame is late. MAILBOX replaces queued image with the latest one, and
+ * IMMEDIATE presents at once with tearing: both have lower latency than
+ * FIFO.
+ */
+void NativeWindow::setPresentMode(vk::PresentModeKHR presentMode) {
+    if (requestedPresentMode == presentMode) {
+        return;
+    }
+    requestedPresentMode = presentMode;
+
+    // reset stats, since they are not comparable between modes
+    presentStats = PresentStats{};
+    presentStatsBeginTime = {};
+    numOfPresentsInStats = 0;
+    acquireToPresentTimeSum = 0.0;
+    acquireWaitTimeSum = 0.0;
+
+    // if minimized, SwapChain is recreated with new mode on restore
+    if (!isWindowSizeZero) {
+        recreateSwapChain();
+    }
+}
+
+const uint32_t NativeWindow::getRequestedNumOfSwapChainImages() const {
+    return requestedNumOfSwapChainImages;
+}
+
+const vk::PresentModeKHR NativeWindow::getPresentMode() const {
+    return presentMode;
+}
+
+std::vector<vk::PresentModeKHR> NativeWindow::getSupportedPresentModes() const {
+    return renderEngine->getPhysicalDevice().getSurfacePresentModesKHR(surface);
+}
+
+const PresentStats &NativeWindow::getPresentStats() const {
+    return presentStats;
+}
+
 const uint32_t NativeWindow::getCurrentFrameIndex() const {
     return currentFrame;
 }
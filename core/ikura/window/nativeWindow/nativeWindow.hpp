@@ -1,6 +1,8 @@
 #pragma once
 
+#include <chrono>
 #include <memory>
+#include <optional>
 #include <vector>
 
 #include <vulkan/vulkan.hpp>
@@ -11,23 +13,73 @@
 namespace ikura {
 class VirtualWindow;
 
+// Presentation timings measured on CPU, averaged over about half a second.
+struct PresentStats {
+    // presents per second
+    double presentRate = 0.0;
+    // milliseconds from acquiring SwapChain image to return of present
+    double acquireToPresentTime = 0.0;
+    // milliseconds blocked in acquiring SwapChain image
+    double acquireWaitTime = 0.0;
+};
+
+// Submission and presentation of a frame acquired by
+// NativeWindow::acquireFrame().
+struct FrameSubmission {
+    vk::Semaphore waitSemaphore;
+    vk::CommandBuffer cmdBuffer;
+    vk::Semaphore signalSemaphore;
+    vk::SwapchainKHR swapChain;
+    uint32_t imageIndex;
+};
+
 class NativeWindow : public Window {
   protected:
     vk::SurfaceKHR surface;
     vk::SwapchainKHR swapChain;
     vk::Format swapChainFormat;
     vk::Extent2D swapChainExtent;
+    vk::ImageUsageFlags swapChainImageUsage;
 
     std::vector<vk::Image> swapChainImages;
+    vk::PresentModeKHR presentMode;
+    // 0: minImageCount + 1 of the surface
+    uint32_t requestedNumOfSwapChainImages = 0;
+    // if not set, MAILBOX is used if available, otherwise FIFO
+    std::optional<vk::PresentModeKHR> requestedPresentMode;
     uint32_t currentFrame = 0;
+    // frameSerials[frame]: RenderEngine frame serial of last submission,
+    // 0 if the frame has never been submitted
+    std::vector<uint64_t> frameSerials;
+    bool isCurrentFrameWaited = false;
     bool swapChainResized = false;
     bool isWindowSizeZero = false;
 
     std::vector<std::shared_ptr<VirtualWindow>> virtualWindows;
 
+    // Acquired frame ----------
+    uint32_t acquiredImageIndex = 0;
+    std::chrono::steady_clock::time_point acquireBeginTime;
+    std::chrono::steady_clock::time_point acquireEndTime;
+
+    // Present stats ----------
+    PresentStats presentStats;
+    std::chrono::steady_clock::time_point presentStatsBeginTime;
+    uint32_t numOfPresentsInStats = 0;
+    double acquireToPresentTimeSum = 0.0;
+    double acquireWaitTimeSum = 0.0;
+
+    void addPresentTiming(std::chrono::steady_clock::time_point acquireBegin,
+                          std::chrono::steady_clock::time_point acquireEnd,
+                          std::chrono::steady_clock::time_point presentEnd);
+
     NativeWindow() {}
 
     virtual void recreateSwapChain(bool destroyExistingResources = true);
+    uint32_t chooseSwapChainImageCount(
+        const vk::SurfaceCapabilitiesKHR &capabilities) const;
+    vk::PresentModeKHR choosePresentMode(
+        const std::vector<vk::PresentModeKHR> &presentModes) const;
 
     virtual void destroySwapChain();
     virtual void destroySurface();
@@ -36,13 +88,35 @@ class NativeWindow : public Window {
     virtual ~NativeWindow();
     virtual void draw();
 
+    // Frame phases ----------
+    // draw() runs them for this window alone, AppEngine::drawAllWindows()
+    // runs each phase for all windows to batch submission and presentation
+    void waitForCurrentFrame();
+    virtual bool acquireFrame();
+    virtual void recordFrameCommands();
+    virtual FrameSubmission getFrameSubmission() const;
+    void onFrameSubmitted(uint64_t frameSerial);
+    virtual void endFrame(vk::Result presentResult);
+
+    static void submitFrames(std::shared_ptr<RenderEngine> renderEngine,
+                             const std::vector<NativeWindow *> &windows);
+    static void presentFrames(std::shared_ptr<RenderEngine> renderEngine,
+                              const std::vector<NativeWindow *> &windows);
+
     void addVirtualWindow(std::shared_ptr<VirtualWindow> virtualWindow);
+    void setFrameSettings(int numOfFrames, uint32_t numOfSwapChainImages);
+    void setPresentMode(vk::PresentModeKHR presentMode);
 
     // Getters ----------
     const vk::SwapchainKHR getSwapChain() const;
     const vk::Format getSwapChainFormat() const;
     const vk::Extent2D getSwapChainExtent() const;
+    const vk::ImageUsageFlags getSwapChainImageUsage() const;
     const std::vector<vk::Image> &getSwapChainImages() const;
+    const uint32_t getRequestedNumOfSwapChainImages() const;
+    const vk::PresentModeKHR getPresentMode() const;
+    std::vector<vk::PresentModeKHR> getSupportedPresentModes() const;
+    const PresentStats &getPresentStats() const;
     const uint32_t getCurrentFrameIndex() const;
     const std::vector<std::shared_ptr<VirtualWindow>> &
     getVirtualWindows() const;
@@ -0,0 +1,433 @@
+#include "./offscreenWindow.hpp"
+
+#include <cstring>
+
+#include <easylogging++.h>
+
+#include "../../engine/renderEngine/uploadManager.hpp"
+
+#include "../../common/logLevels.hpp"
+
+namespace ikura {
+OffscreenWindow::OffscreenWindow(
+    const std::shared_ptr<RenderEngine> renderEngine, int width, int height,
+    std::string name, vk::Format renderImageFormat) {
+
+    VLOG(VLOG_LV_3_PROCESS_TRACKING)
+        << "Creating OffscreenWindow '" << name << "'...";
+    this->renderEngine = renderEngine;
+    this->width = width;
+    this->height = height;
+    this->name = name;
+    this->renderImageFormat = renderImageFormat;
+
+    createRenderImages();
+    frameSerials.assign(numOfFrames, 0);
+
+    VLOG(VLOG_LV_3_PROCESS_TRACKING)
+        << "OffscreenWindow '" << name << "' has been created.";
+}
+
+OffscreenWindow::~OffscreenWindow() {
+    if (!resourceDestroyed) {
+        destroyResources();
+    }
+}
+
+void OffscreenWindow::createRenderImages() {
+    renderImageResources.resize(numOfFrames);
+    for (auto &imageResource : renderImageResources) {
+        RenderTarget::createImage(
+            imageResource, getRenderImageExtent(), 1,
+            vk::SampleCountFlagBits::e1, renderImageFormat,
+            vk::ImageTiling::eOptimal, RENDER_IMAGE_USAGE,
+            vk::MemoryPropertyFlagBits::eDeviceLocal,
+            *renderEngine->getVmaAllocator());
+        // ImageView is created by RenderTarget
+        imageResource.releaseImageView = false;
+    }
+}
+
+void OffscreenWindow::destroyResources() {
+    VLOG(VLOG_LV_3_PROCESS_TRACKING)
+        << "Destroying resources of OffscreenWindow '" << name << "'...";
+
+    renderEngine->getDevice().waitIdle();
+    renderEngine->flushDeferredDestructions();
+
+    // RenderTarget holds ImageViews of render images
+    renderTarget.reset();
+    for (auto &imageResource : renderImageResources) {
+        imageResource.release(renderEngine->getDevice(),
+                              *renderEngine->getVmaAllocator());
+    }
+    renderImageResources.clear();
+    for (auto &readbackBuffer : readbackBuffers) {
+        readbackBuffer.bufferResource.release(*renderEngine->getVmaAllocator());
+    }
+    readbackBuffers.clear();
+
+    resourceDestroyed = true;
+
+    VLOG(VLOG_LV_3_PROCESS_TRACKING)
+        << "Resources of OffscreenWindow '" << name << "' have been destroyed.";
+}
+
+/**
+ * @brief Waits for the previous submission of current frame, and passes its
+ * readback to callback if any.
+ * Call this before updating per-frame resources (e.g. uniform buffers) of
+ * current frame. draw() calls it if not called yet.
+ */
+void OffscreenWindow::waitForCurrentFrame() {
+    if (isCurrentFrameWaited) {
+        return;
+    }
+
+    renderEngine->waitForFrame(frameSerials[currentFrame]);
+    renderTarget->fetchGpuTime(currentFrame);
+    renderTarget->fetchPickResult(currentFrame);
+    deliverReadback(currentFrame);
+
+    isCurrentFrameWaited = true;
+}
+
+/**
+ * @brief Renders one frame into the render image of current frame.
+ * Unlike NativeWindow, nothing is acquired or presented, and the submission
+ * waits only on upload timeline for applied uploads. Uploads queued by
+ * RenderContent are submitted here, since OffscreenWindow is not driven by
+ * AppEngine.
+ */
+void OffscreenWindow::draw() {
+    // Wait for previous frame to complete
+    waitForCurrentFrame();
+
+    // Submit uploads queued since last frame, and retire completed ones
+    renderEngine->getUploadManager().submit();
+    renderEngine->getUploadManager().poll();
+
+    // Record command buffer
+    renderContent->applyCompletedUploads();
+    renderTarget->getRenderCommandBuffer(currentFrame).reset({});
+    recordCommandBuffer();
+
+    // Submit command buffer
+    // writes of transfer queue must be made visible to graphics queue
+    const UploadTicket appliedTicket =
+        renderEngine->getUploadManager().takeAppliedTicket();
+    const vk::Semaphore uploadTimeline =
+        renderEngine->getUploadManager().getUploadTimeline();
+    const vk::PipelineStageFlags uploadWaitStage =
+        UploadManager::CONSUMER_STAGES;
+    vk::TimelineSemaphoreSubmitInfo timelineSubmitInfo{};
+    timelineSubmitInfo.setWaitSemaphoreValues(appliedTicket);
+
+    vk::SubmitInfo submitInfo{};
+    if (appliedTicket != 0) {
+        submitInfo.pNext = &timelineSubmitInfo;
+        submitInfo.setWaitSemaphores(uploadTimeline);
+        submitInfo.pWaitDstStageMask = &uploadWaitStage;
+    }
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers =
+        &renderTarget->getRenderCommandBuffer(currentFrame);
+
+    frameSerials[currentFrame] = renderEngine->submitFrame({submitInfo});
+
+    if (!readbackBuffers.empty()) {
+        readbackBuffers[currentFrame].isPending = true;
+        readbackBuffers[currentFrame].frameNumber = numOfDrawnFrames;
+    }
+
+    numOfDrawnFrames++;
+    lastRenderedFrame = currentFrame;
+    currentFrame = (currentFrame + 1) % numOfFrames;
+    isCurrentFrameWaited = false;
+}
+
+/**
+ * @brief Records commands of current frame.
+ * Render image index is the same as frame index, since each frame has its own
+ * render image.
+ */
+void OffscreenWindow::recordCommandBuffer() {
+    auto &cmdBuffer = renderTarget->getRenderCommandBuffer(currentFrame);
+
+    // Begin ----------
+    vk::CommandBufferBeginInfo beginInfo{};
+    beginInfo.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+    cmdBuffer.begin(beginInfo);
+    renderTarget->beginGpuTimer(cmdBuffer, currentFrame);
+
+    // Scene ----------
+    recordScenePass(cmdBuffer, currentFrame, currentFrame);
+
+    // Overlay (empty, transitions render image into TransferSrcOptimal) -----
+    beginOverlayPass(cmdBuffer, currentFrame);
+    cmdBuffer.endRenderPass();
+
+    // Readback (overlay RenderPass makes render image ready for transfer) ----
+    if (!readbackBuffers.empty()) {
+        recordReadback(cmdBuffer, currentFrame,
+                       readbackBuffers[currentFrame].bufferResource.buffer);
+    }
+
+    // End ----------
+    renderTarget->endGpuTimer(cmdBuffer, currentFrame);
+    cmdBuffer.end();
+}
+
+/**
+ * @brief Records copy of render image of frameIndex into dstBuffer, followed by
+ * a barrier making it visible to host.
+ * Render image must be in TransferSrcOptimal and ready for transfer.
+ */
+void OffscreenWindow::recordReadback(vk::CommandBuffer cmdBuffer,
+                                     uint32_t frameIndex,
+                                     vk::Buffer dstBuffer) {
+    vk::BufferImageCopy region{};
+    region.bufferOffset = 0;
+    region.bufferRowLength = 0;
+    region.bufferImageHeight = 0;
+    region.imageSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
+    region.imageSubresource.mipLevel = 0;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount = 1;
+    region.imageOffset = vk::Offset3D(0, 0, 0);
+    region.imageExtent = vk::Extent3D(getRenderImageExtent(), 1);
+    cmdBuffer.copyImageToBuffer(renderImageResources[frameIndex].image,
+                                vk::ImageLayout::eTransferSrcOptimal,
+                                dstBuffer, region);
+
+    vk::BufferMemoryBarrier hostBarrier{};
+    hostBarrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+    hostBarrier.dstAccessMask = vk::AccessFlagBits::eHostRead;
+    hostBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    hostBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    hostBarrier.buffer = dstBuffer;
+    hostBarrier.offset = 0;
+    hostBarrier.size = VK_WHOLE_SIZE;
+    cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+                              vk::PipelineStageFlagBits::eHost, {}, {},
+                              hostBarrier, {});
+}
+
+/**
+ * @brief Passes pending readback of frameIndex to callback.
+ * The frame must have been waited.
+ */
+void OffscreenWindow::deliverReadback(uint32_t frameIndex) {
+    if (readbackBuffers.empty() || !readbackBuffers[frameIndex].isPending) {
+        return;
+    }
+
+    auto &readbackBuffer = readbackBuffers[frameIndex];
+    vmaInvalidateAllocation(*renderEngine->getVmaAllocator(),
+                            readbackBuffer.bufferResource.alloc, 0,
+                            VK_WHOLE_SIZE);
+    readbackCallback(readbackBuffer.frameNumber, readbackBuffer.mappedData,
+                     getRenderImageSize());
+    readbackBuffer.isPending = false;
+}
+
+/**
+ * @brief Returns size of tightly packed render image in bytes.
+ *
+ * @exception std::runtime_error if format of render images is not 4 bytes per
+ * pixel.
+ */
+vk::DeviceSize OffscreenWindow::getRenderImageSize() const {
+    switch (renderImageFormat) {
+    case vk::Format::eR8G8B8A8Srgb:
+    case vk::Format::eR8G8B8A8Unorm:
+    case vk::Format::eB8G8R8A8Srgb:
+    case vk::Format::eB8G8R8A8Unorm:
+        return (vk::DeviceSize)width * height * 4;
+    default:
+        throw std::runtime_error("Reading back OffscreenWindow supports only "
+                                 "8-bit RGBA / BGRA formats.");
+    }
+}
+
+/**
+ * @brief Copies the last rendered image into pixels (tightly packed rows,
+ * 4 bytes per pixel in renderImageFormat order).
+ * This function blocks until rendering and copy complete. Use
+ * enableReadback() to read every frame without blocking.
+ *
+ * @exception std::runtime_error if nothing has been rendered yet, or format of
+ * render images is not 4 bytes per pixel.
+ */
+void OffscreenWindow::readPixels(std::vector<uint8_t> &pixels) {
+    if (lastRenderedFrame < 0) {
+        throw std::runtime_error(
+            "OffscreenWindow::readPixels() is called before draw().");
+    }
+
+    auto allocator = *renderEngine->getVmaAllocator();
+    const vk::DeviceSize size = getRenderImageSize();
+
+    renderEngine->waitForFrame(frameSerials[lastRenderedFrame]);
+
+    // Readback buffer ----------
+    vk::BufferCreateInfo bufferCI{};
+    bufferCI.size = size;
+    bufferCI.usage = vk::BufferUsageFlagBits::eTransferDst;
+    bufferCI.sharingMode = vk::SharingMode::eExclusive;
+
+    VmaAllocationCreateInfo allocCI{};
+    allocCI.usage = VMA_MEMORY_USAGE_AUTO_PREFER_HOST;
+    allocCI.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT |
+                    VMA_ALLOCATION_CREATE_MAPPED_BIT;
+    VmaAllocationInfo allocInfo{};
+
+    BufferResource readbackBuffer;
+    auto vkBufferCI = (VkBufferCreateInfo)bufferCI;
+    VkBuffer vkBuffer;
+    auto vmaResult =
+        vmaCreateBuffer(allocator, &vkBufferCI, &allocCI, &vkBuffer,
+                        &readbackBuffer.alloc, &allocInfo);
+    if (vmaResult != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create readback buffer.");
+    }
+    readbackBuffer.buffer = (vk::Buffer)vkBuffer;
+
+    // Copy ----------
+    // rendering is completed (frame serial), but its writes must be made available
+    auto cmdBuffer = renderEngine->beginSingleTimeCommands();
+
+    vk::ImageMemoryBarrier barrier{};
+    barrier.srcAccessMask = vk::AccessFlagBits::eColorAttachmentWrite;
+    barrier.dstAccessMask = vk::AccessFlagBits::eTransferRead;
+    barrier.oldLayout = vk::ImageLayout::eTransferSrcOptimal;
+    barrier.newLayout = vk::ImageLayout::eTransferSrcOptimal;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = renderImageResources[lastRenderedFrame].image;
+    barrier.subresourceRange.aspectMask = vk::ImageAspectFlagBits::eColor;
+    barrier.subresourceRange.baseMipLevel = 0;
+    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = 1;
+    cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eColorAttachmentOutput,
+                              vk::PipelineStageFlagBits::eTransfer, {}, {}, {},
+                              barrier);
+
+    recordReadback(cmdBuffer, lastRenderedFrame, readbackBuffer.buffer);
+
+    renderEngine->endSingleTimeCommands(cmdBuffer);
+
+    // Read ----------
+    vmaInvalidateAllocation(allocator, readbackBuffer.alloc, 0, VK_WHOLE_SIZE);
+    pixels.resize(size);
+    std::memcpy(pixels.data(), allocInfo.pMappedData, size);
+
+    readbackBuffer.release(allocator);
+}
+
+// Readback ----------
+
+/**
+ * @brief Starts reading back every frame drawn after this call.
+ * callback is called in draw() (or waitForCurrentFrame(), flushReadbacks())
+ * on the calling thread, about numOfFrames frames after the frame is drawn.
+ *
+ * @exception std::runtime_error if format of render images is not 4 bytes per
+ * pixel.
+ */
+void OffscreenWindow::enableReadback(ReadbackCallback callback) {
+    if (!readbackBuffers.empty()) {
+        flushReadbacks();
+        readbackCallback = callback;
+        return;
+    }
+
+    vk::BufferCreateInfo bufferCI{};
+    bufferCI.size = getRenderImageSize();
+    bufferCI.usage = vk::BufferUsageFlagBits::eTransferDst;
+    bufferCI.sharingMode = vk::SharingMode::eExclusive;
+
+    VmaAllocationCreateInfo allocCI{};
+    allocCI.usage = VMA_MEMORY_USAGE_AUTO_PREFER_HOST;
+    allocCI.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT |
+                    VMA_ALLOCATION_CREATE_MAPPED_BIT;
+
+    readbackBuffers.resize(numOfFrames);
+    for (auto &readbackBuffer : readbackBuffers) {
+        VmaAllocationInfo allocInfo{};
+        auto vkBufferCI = (VkBufferCreateInfo)bufferCI;
+        VkBuffer vkBuffer;
+        auto result = vmaCreateBuffer(
+            *renderEngine->getVmaAllocator(), &vkBufferCI, &allocCI, &vkBuffer,
+            &readbackBuffer.bufferResource.alloc, &allocInfo);
+        if (result != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create readback buffer.");
+        }
+        readbackBuffer.bufferResource.buffer = (vk::Buffer)vkBuffer;
+        readbackBuffer.mappedData = static_cast<uint8_t *>(allocInfo.pMappedData);
+    }
+    readbackCallback = callback;
+
+    VLOG(VLOG_LV_3_PROCESS_TRACKING)
+        << "Readback of OffscreenWindow '" << name << "' has been enabled.";
+}
+
+/**
+ * @brief Waits for all pending readbacks and passes them to callback in
+ * drawn order.
+ */
+void OffscreenWindow::flushReadbacks() {
+    if (readbackBuffers.empty()) {
+        return;
+    }
+
+    // the oldest submission is current frame
+    for (int i = 0; i < numOfFrames; i++) {
+        uint32_t frameIndex = (currentFrame + i) % numOfFrames;
+        if (!readbackBuffers[frameIndex].isPending) {
+            continue;
+        }
+
+        renderEngine->waitForFrame(frameSerials[frameIndex]);
+        deliverReadback(frameIndex);
+    }
+}
+
+/**
+ * @brief Flushes pending readbacks and releases readback buffers.
+ */
+void OffscreenWindow::disableReadback() {
+    flushReadbacks();
+
+    // no copy into readback buffers is in flight after flush
+    for (auto &readbackBuffer : readbackBuffers) {
+        readbackBuffer.bufferResource.release(*renderEngine->getVmaAllocator());
+    }
+    readbackBuffers.clear();
+    readbackCallback = nullptr;
+}
+
+// Getters ----------
+
+const vk::Format OffscreenWindow::getRenderImageFormat() const {
+    return renderImageFormat;
+}
+
+const vk::Extent2D OffscreenWindow::getRenderImageExtent() const {
+    return vk::Extent2D(width, height);
+}
+
+std::vector<vk::Image> OffscreenWindow::getRenderImages() const {
+    std::vector<vk::Image> images;
+    for (const auto &imageResource : renderImageResources) {
+        images.push_back(imageResource.image);
+    }
+
+    return images;
+}
+
+const uint32_t OffscreenWindow::getCurrentFrameIndex() const {
+    return currentFrame;
+}
+} // namespace ikura
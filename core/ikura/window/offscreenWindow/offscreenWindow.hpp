@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include "../../engine/renderEngine/renderEngine.hpp"
+#include "../window.hpp"
+
+namespace ikura {
+// Receives pixels of a rendered frame (see OffscreenWindow::enableReadback()).
+// pixels are valid only during the call.
+typedef std::function<void(uint64_t frameNumber, const uint8_t *pixels,
+                           vk::DeviceSize size)>
+    ReadbackCallback;
+
+/**
+ * @brief Window without GLFW or surface, rendering into VMA allocated images.
+ *
+ * It owns one render image per frame in flight, as NativeWindow owns
+ * SwapChain images, and is driven by calling draw() directly.
+ * Use with OffscreenRenderTarget (see
+ * BasicRenderComponentProvider::createOffscreenRenderTarget()).
+ *
+ * If readback is enabled, each frame copies its render image into its own
+ * host visible buffer in the same submission, and the pixels are passed to
+ * the callback when the frame is waited next time. So reading back never
+ * stalls the GPU, which keeps rendering the following frames meanwhile.
+ */
+class OffscreenWindow : public Window {
+    struct ReadbackBuffer {
+        BufferResource bufferResource;
+        uint8_t *mappedData = nullptr;
+        // true if copy is submitted but not passed to callback yet
+        bool isPending = false;
+        uint64_t frameNumber = 0;
+    };
+
+    vk::Format renderImageFormat;
+    std::vector<ImageResource> renderImageResources;
+
+    uint32_t currentFrame = 0;
+    // frameSerials[frame]: RenderEngine frame serial of last submission,
+    // 0 if the frame has never been submitted
+    std::vector<uint64_t> frameSerials;
+    // -1 if nothing has been rendered yet
+    int lastRenderedFrame = -1;
+    // number of frames submitted by draw()
+    uint64_t numOfDrawnFrames = 0;
+    bool isCurrentFrameWaited = false;
+
+    // Readback ----------
+    std::vector<ReadbackBuffer> readbackBuffers;
+    ReadbackCallback readbackCallback;
+
+    void createRenderImages();
+    void recordCommandBuffer();
+    void recordReadback(vk::CommandBuffer cmdBuffer, uint32_t frameIndex,
+                        vk::Buffer dstBuffer);
+    void deliverReadback(uint32_t frameIndex);
+    vk::DeviceSize getRenderImageSize() const;
+
+  public:
+    static constexpr vk::ImageUsageFlags RENDER_IMAGE_USAGE =
+        vk::ImageUsageFlagBits::eColorAttachment |
+        vk::ImageUsageFlagBits::eTransferSrc |
+        vk::ImageUsageFlagBits::eTransferDst;
+
+    OffscreenWindow(const std::shared_ptr<RenderEngine> renderEngine,
+                    int width, int height, std::string name,
+                    vk::Format renderImageFormat = vk::Format::eR8G8B8A8Srgb);
+    ~OffscreenWindow();
+
+    void destroyResources() override;
+    void waitForCurrentFrame();
+    void draw();
+    void readPixels(std::vector<uint8_t> &pixels);
+
+    // Readback ----------
+    void enableReadback(ReadbackCallback callback);
+    void flushReadbacks();
+    void disableReadback();
+
+    // Getters ----------
+    const vk::Format getRenderImageFormat() const;
+    const vk::Extent2D getRenderImageExtent() const;
+    std::vector<vk::Image> getRenderImages() const;
+    const uint32_t getCurrentFrameIndex() const;
+};
+} // namespace ikura
@@ -1,5 +1,6 @@
 #include "./imGuiVirtualWindow.hpp"
 
+#include <algorithm>
 #include <filesystem>
 
 #include <ikura_ext_imgui/imgui.h>
@@ -35,23 +36,7 @@ void ImGuiVirtualWindow::initImGuiResources(
         renderEngine->getDevice().createDescriptorPool(poolCI);
 
     ImGui_ImplGlfw_InitForVulkan(nativeWindow->getGLFWWindow(), true);
-
-    ImGui_ImplVulkan_InitInfo initInfo{};
-    initInfo.Instance = (VkInstance)renderEngine->getInstance();
-    initInfo.PhysicalDevice =
-        (VkPhysicalDevice)renderEngine->getPhysicalDevice();
-    initInfo.Device = (VkDevice)renderEngine->getDevice();
-    initInfo.QueueFamily = renderEngine->getQueueFamilyIndices().get(
-        ikura::QueueFamilyIndices::GRAPHICS);
-    initInfo.Queue = (VkQueue)renderEngine->getQueues().graphicsQueue;
-    initInfo.DescriptorPool = (VkDescriptorPool)imGuiDescriptorPool;
-    initInfo.MinImageCount = 3;
-    initInfo.ImageCount = 3;
-    initInfo.MSAASamples = (VkSampleCountFlagBits)renderEngine->getEngineInfo()
-                               .limit.maxMsaaSamples;
-    initInfo.RenderPass = (VkRenderPass)nativeWindow->getRenderTarget()->getRenderPass();
-
-    ImGui_ImplVulkan_Init(&initInfo);
+    initImGuiRenderer();
 
     // Upload default font
     ImGuiIO &io = ImGui::GetIO();
@@ -69,6 +54,39 @@ void ImGuiVirtualWindow::initImGuiResources(
     //    ImGui_ImplVulkan_DestroyFontUploadObjects();
 }
 
+/**
+ * @brief Initializes Vulkan backend of ImGui for current frame settings of
+ * nativeWindow. Font texture is created at the next newFrame().
+ */
+void ImGuiVirtualWindow::initImGuiRenderer() {
+    // ImGui cycles its vertex / index buffers through ImageCount sets, so it
+    // must not be less than frames in flight
+    uint32_t numOfSwapChainImages =
+        static_cast<uint32_t>(nativeWindow->getSwapChainImages().size());
+    uint32_t numOfFrames =
+        static_cast<uint32_t>(nativeWindow->getNumOfFrames());
+
+    ImGui_ImplVulkan_InitInfo initInfo{};
+    initInfo.Instance = (VkInstance)renderEngine->getInstance();
+    initInfo.PhysicalDevice =
+        (VkPhysicalDevice)renderEngine->getPhysicalDevice();
+    initInfo.Device = (VkDevice)renderEngine->getDevice();
+    initInfo.QueueFamily = renderEngine->getQueueFamilyIndices().get(
+        ikura::QueueFamilyIndices::GRAPHICS);
+    initInfo.Queue = (VkQueue)renderEngine->getQueues().graphicsQueue;
+    initInfo.DescriptorPool = (VkDescriptorPool)imGuiDescriptorPool;
+    initInfo.PipelineCache =
+        (VkPipelineCache)renderEngine->getPipelineCache();
+    initInfo.MinImageCount = std::max(2u, numOfSwapChainImages);
+    initInfo.ImageCount = std::max(initInfo.MinImageCount, numOfFrames);
+    // ImGui is drawn in overlay RenderPass, which has no MSAA
+    initInfo.MSAASamples = VK_SAMPLE_COUNT_1_BIT;
+    initInfo.RenderPass = (VkRenderPass)nativeWindow->getRenderTarget()
+                              ->getOverlayRenderPass();
+
+    ImGui_ImplVulkan_Init(&initInfo);
+}
+
 void ImGuiVirtualWindow::destroyImGuiResources() {
     setCurrentImGuiContext();
 
@@ -102,6 +120,18 @@ void ImGuiVirtualWindow::recordCommandBuffer(vk::CommandBuffer cmdBuffer) {
     ImGui_ImplVulkan_RenderDrawData(drawData, (VkCommandBuffer)cmdBuffer);
 }
 
+/**
+ * @brief Reinitializes Vulkan backend of ImGui, since number of its frame
+ * buffers cannot be changed after initialization.
+ * Must be called outside of ImGui frame, i.e. before newFrame().
+ */
+void ImGuiVirtualWindow::onFrameSettingsChanged() {
+    setCurrentImGuiContext();
+
+    ImGui_ImplVulkan_Shutdown();
+    initImGuiRenderer();
+}
+
 bool ImGuiVirtualWindow::isFocused() const {
     setCurrentImGuiContext();
     return ImGui::IsWindowFocused(ImGuiFocusedFlags_AnyWindow);
@@ -20,6 +20,7 @@ class ImGuiVirtualWindow : public VirtualWindow {
     vk::DescriptorPool imGuiDescriptorPool;
 
     void initImGuiResources(ImGuiVirtualWindowInitConfig *initConfig);
+    void initImGuiRenderer();
     void destroyImGuiResources();
 
   public:
@@ -30,6 +31,7 @@ class ImGuiVirtualWindow : public VirtualWindow {
 
     void recordCommandBuffer(vk::CommandBuffer cmdBuffer) override;
     bool isFocused() const override;
+    void onFrameSettingsChanged() override;
 
     void setCurrentImGuiContext() const;
     // TODO: rename to newImGuiFrame()
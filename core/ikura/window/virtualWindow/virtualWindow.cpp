@@ -12,4 +12,6 @@ VirtualWindow::~VirtualWindow() {}
 void VirtualWindow::recordCommandBuffer(vk::CommandBuffer) {}
 
 bool VirtualWindow::isFocused() const { return false; }
+
+void VirtualWindow::onFrameSettingsChanged() {}
 } // namespace ikura
\ No newline at end of file
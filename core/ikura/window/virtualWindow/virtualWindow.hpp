@@ -18,5 +18,8 @@ class VirtualWindow : public Window {
 
     virtual void recordCommandBuffer(vk::CommandBuffer);
     virtual bool isFocused() const;
+    // called after frames in flight or SwapChain images of NativeWindow
+    // have changed, while device is idle
+    virtual void onFrameSettingsChanged();
 };
 } // namespace ikura
\ No newline at end of file
@@ -1,5 +1,10 @@
 #include "./window.hpp"
 
+#include <algorithm>
+#include <array>
+#include <string>
+#include <utility>
+
 #include <easylogging++.h>
 
 namespace ikura {
@@ -9,6 +14,168 @@ Window::~Window() {}
 
 void Window::destroyResources() {}
 
+// Recording helpers ----------
+
+/**
+ * @brief Converts viewportRects into pixels of render extent.
+ */
+std::vector<SceneViewport> Window::createSceneViewports() const {
+    const auto renderExtent = renderTarget->getRenderExtent();
+    std::vector<SceneViewport> sceneViewports;
+    for (const auto &rect : viewportRects) {
+        SceneViewport sceneViewport{};
+
+        // snap to pixels, so that adjacent viewports neither overlap nor gap
+        int32_t x0 = static_cast<int32_t>(rect.x * renderExtent.width);
+        int32_t y0 = static_cast<int32_t>(rect.y * renderExtent.height);
+        int32_t x1 = static_cast<int32_t>((rect.x + rect.width) *
+                                          renderExtent.width);
+        int32_t y1 = static_cast<int32_t>((rect.y + rect.height) *
+                                          renderExtent.height);
+        if (x1 <= x0 || y1 <= y0) {
+            continue;
+        }
+
+        sceneViewport.viewport.x = (float)x0;
+        sceneViewport.viewport.y = (float)y0;
+        sceneViewport.viewport.width = (float)(x1 - x0);
+        sceneViewport.viewport.height = (float)(y1 - y0);
+        sceneViewport.viewport.minDepth = 0.0f;
+        sceneViewport.viewport.maxDepth = 1.0f;
+
+        sceneViewport.scissor.offset = vk::Offset2D(x0, y0);
+        sceneViewport.scissor.extent =
+            vk::Extent2D(static_cast<uint32_t>(x1 - x0),
+                         static_cast<uint32_t>(y1 - y0));
+
+        sceneViewports.push_back(sceneViewport);
+    }
+
+    return sceneViewports;
+}
+
+/**
+ * @brief Records scene draws of renderContent into secondary sceneCmdBuffer,
+ * which is executed inside scene RenderPass.
+ */
+void Window::recordSceneCommands(vk::CommandBuffer sceneCmdBuffer,
+                                 int frameIndex,
+                                 const std::vector<SceneViewport> &viewports) {
+    // framebuffer is left null since it differs between images
+    vk::CommandBufferInheritanceInfo inheritanceInfo{};
+    inheritanceInfo.renderPass = renderTarget->getRenderPass();
+    inheritanceInfo.subpass = 0;
+
+    vk::CommandBufferBeginInfo beginInfo{};
+    beginInfo.flags = vk::CommandBufferUsageFlagBits::eRenderPassContinue;
+    beginInfo.pInheritanceInfo = &inheritanceInfo;
+    sceneCmdBuffer.begin(beginInfo);
+
+    // Bind pipeline ----------
+    sceneCmdBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics,
+                                renderTarget->getGraphicsPipeline());
+
+    // Draw ----------
+    renderContent->recordDrawCommands(sceneCmdBuffer, *renderTarget,
+                                      frameIndex, viewports);
+
+    sceneCmdBuffer.end();
+}
+
+/**
+ * @brief Records scene draws of frameIndex into secondary command buffer of
+ * renderTarget, unless cached ones are still valid.
+ *
+ * They are re-recorded only if renderContent, its content version,
+ * RenderPass / pipelines of renderTarget or viewports have changed since the
+ * last frame of the same frameIndex.
+ * Only CommandBuffers of this window are recorded, so different windows can
+ * be prepared on different threads (see AppEngine::drawAllWindows()).
+ */
+void Window::prepareSceneCommands(int frameIndex) {
+    if (sceneCommandCaches.size() != static_cast<size_t>(numOfFrames)) {
+        sceneCommandCaches.assign(numOfFrames, SceneCommandCache{});
+    }
+
+    auto &cache = sceneCommandCaches[frameIndex];
+    auto sceneViewports = createSceneViewports();
+    auto &sceneCmdBuffer = renderTarget->getSceneCommandBuffer(frameIndex);
+    if (!cache.isValid || cache.renderContent != renderContent.get() ||
+        cache.contentVersion != renderContent->getContentVersion() ||
+        cache.renderPassVersion != renderTarget->getRenderPassVersion() ||
+        cache.viewports != sceneViewports) {
+
+        recordSceneCommands(sceneCmdBuffer, frameIndex, sceneViewports);
+
+        cache.isValid = true;
+        cache.renderContent = renderContent.get();
+        cache.contentVersion = renderContent->getContentVersion();
+        cache.renderPassVersion = renderTarget->getRenderPassVersion();
+        cache.viewports = std::move(sceneViewports);
+    }
+}
+
+/**
+ * @brief Records compute commands of renderContent and scene RenderPass of
+ * renderTarget executing scene commands (see prepareSceneCommands()),
+ * followed by upscale to render image if needed.
+ */
+void Window::recordScenePass(vk::CommandBuffer cmdBuffer, uint32_t imageIndex,
+                             int frameIndex) {
+    prepareSceneCommands(frameIndex);
+    auto &sceneCmdBuffer = renderTarget->getSceneCommandBuffer(frameIndex);
+
+    // Compute (outside RenderPass) ----------
+    renderContent->recordComputeCommands(cmdBuffer, frameIndex);
+
+    // RenderPass ----------
+    // color, depth, id (resolve attachments are not cleared)
+    std::array<vk::ClearValue, 3> clearValues{};
+    clearValues[0].color =
+        vk::ClearColorValue(std::array<uint32_t, 4>{1, 0, 0, 0});
+    clearValues[1].depthStencil = vk::ClearDepthStencilValue(1.0f, 0);
+    clearValues[2].color =
+        vk::ClearColorValue(std::array<uint32_t, 4>{0, 0, 0, 0});
+
+    vk::RenderPassBeginInfo renderPassInfo{};
+    renderPassInfo.renderPass = renderTarget->getRenderPass();
+    renderPassInfo.framebuffer = renderTarget->getFramebuffer(imageIndex);
+    renderPassInfo.renderArea.offset = vk::Offset2D(0, 0);
+    renderPassInfo.renderArea.extent = renderTarget->getRenderExtent();
+    renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+    renderPassInfo.pClearValues = clearValues.data();
+
+    cmdBuffer.beginRenderPass(renderPassInfo,
+                              vk::SubpassContents::eSecondaryCommandBuffers);
+    cmdBuffer.executeCommands(sceneCmdBuffer);
+    cmdBuffer.endRenderPass();
+
+    // Pick readback (only if requested) ----------
+    renderTarget->recordPickReadback(cmdBuffer, frameIndex);
+
+    // Upscale (only if render scale is less than 1) ----------
+    renderTarget->recordUpscale(cmdBuffer, imageIndex);
+}
+
+/**
+ * @brief Begins overlay RenderPass of renderTarget at native resolution.
+ * The caller records overlays and ends the RenderPass. It must be recorded
+ * even if there is no overlay, since it transitions render image into its
+ * final layout.
+ */
+void Window::beginOverlayPass(vk::CommandBuffer cmdBuffer,
+                              uint32_t imageIndex) {
+    vk::RenderPassBeginInfo renderPassInfo{};
+    renderPassInfo.renderPass = renderTarget->getOverlayRenderPass();
+    renderPassInfo.framebuffer =
+        renderTarget->getOverlayFramebuffer(imageIndex);
+    renderPassInfo.renderArea.offset = vk::Offset2D(0, 0);
+    renderPassInfo.renderArea.extent.width = width;
+    renderPassInfo.renderArea.extent.height = height;
+
+    cmdBuffer.beginRenderPass(renderPassInfo, vk::SubpassContents::eInline);
+}
+
 // Getters ----------
 
 const int Window::getNumOfFrames() const { return numOfFrames; }
@@ -25,13 +192,53 @@ const std::shared_ptr<RenderContent> &Window::getRenderContent() {
     return renderContent;
 }
 
+const std::vector<ViewportRect> &Window::getViewportRects() const {
+    return viewportRects;
+}
+
 // Setters ----------
 
 void Window::setRenderTarget(std::shared_ptr<RenderTarget> renderTarget) {
     this->renderTarget = renderTarget;
+    invalidateSceneCommands();
 }
 
 void Window::setRenderContent(std::shared_ptr<RenderContent> renderContent) {
     this->renderContent = renderContent;
+    invalidateSceneCommands();
+}
+
+/**
+ * @brief Forces scene commands to be re-recorded in the next frames.
+ * Needed only if RenderContent changes what it records without incrementing
+ * its content version.
+ */
+void Window::invalidateSceneCommands() {
+    for (auto &cache : sceneCommandCaches) {
+        cache.isValid = false;
+    }
+}
+
+/**
+ * @brief Sets viewports of scene pass. Rects are clamped into render image.
+ *
+ * @exception std::runtime_error if viewportRects is empty or has more than
+ * MAX_NUM_OF_VIEWPORTS rects.
+ */
+void Window::setViewportRects(const std::vector<ViewportRect> &viewportRects) {
+    if (viewportRects.empty() ||
+        viewportRects.size() > static_cast<size_t>(MAX_NUM_OF_VIEWPORTS)) {
+        throw std::runtime_error("Number of viewports must be 1 to " +
+                                 std::to_string(MAX_NUM_OF_VIEWPORTS) + ".");
+    }
+
+    this->viewportRects.clear();
+    for (auto rect : viewportRects) {
+        rect.x = std::clamp(rect.x, 0.0f, 1.0f);
+        rect.y = std::clamp(rect.y, 0.0f, 1.0f);
+        rect.width = std::clamp(rect.width, 0.0f, 1.0f - rect.x);
+        rect.height = std::clamp(rect.height, 0.0f, 1.0f - rect.y);
+        this->viewportRects.push_back(rect);
+    }
 }
 } // namespace ikura
\ No newline at end of file
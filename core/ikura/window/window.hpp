@@ -2,6 +2,7 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 #include <vulkan/vulkan.hpp>
 
@@ -9,6 +10,14 @@
 #include "../renderComponent/renderTarget.hpp"
 
 namespace ikura {
+// Region of render image drawn by a viewport, normalized to [0, 1].
+struct ViewportRect {
+    float x;
+    float y;
+    float width;
+    float height;
+};
+
 class Window {
   protected:
     Window() {}
@@ -24,7 +33,36 @@ class Window {
     std::shared_ptr<RenderContent> renderContent;
     std::shared_ptr<RenderTarget> renderTarget;
 
+    // viewports of scene pass, i-th one uses i-th scene matrices
+    std::vector<ViewportRect> viewportRects = {{0.0f, 0.0f, 1.0f, 1.0f}};
+
+    // Scene command cache ----------
+    // what the scene command buffer of a frame was recorded with
+    struct SceneCommandCache {
+        bool isValid = false;
+        const RenderContent *renderContent = nullptr;
+        uint64_t contentVersion = 0;
+        uint64_t renderPassVersion = 0;
+        std::vector<SceneViewport> viewports;
+    };
+    // sceneCommandCaches[frame]
+    std::vector<SceneCommandCache> sceneCommandCaches;
+
+    // Recording helpers ----------
+    std::vector<SceneViewport> createSceneViewports() const;
+    void recordSceneCommands(vk::CommandBuffer sceneCmdBuffer, int frameIndex,
+                             const std::vector<SceneViewport> &viewports);
+    void recordScenePass(vk::CommandBuffer cmdBuffer, uint32_t imageIndex,
+                         int frameIndex);
+    void beginOverlayPass(vk::CommandBuffer cmdBuffer, uint32_t imageIndex);
+
   public:
+    void prepareSceneCommands(int frameIndex);
+
+    // upper limit of frames in flight, UniformBufferRing reserves a region
+    // for each of them
+    static constexpr int MAX_NUM_OF_FRAMES = 4;
+
     virtual ~Window();
     virtual bool closed();
     virtual void destroyResources();
@@ -36,6 +74,7 @@ class Window {
     const int getHeight() const;
     const std::shared_ptr<RenderTarget> &getRenderTarget();
     const std::shared_ptr<RenderContent> &getRenderContent();
+    const std::vector<ViewportRect> &getViewportRects() const;
 
     virtual float getScaleX() const { return 1.0f; };
     virtual float getScaleY() const { return 1.0f; };
@@ -43,5 +82,7 @@ class Window {
     // Setters ----------
     void setRenderTarget(std::shared_ptr<RenderTarget> renderTarget);
     void setRenderContent(std::shared_ptr<RenderContent> renderContent);
+    void setViewportRects(const std::vector<ViewportRect> &viewportRects);
+    void invalidateSceneCommands();
 };
 } // namespace ikura
\ No newline at end of file